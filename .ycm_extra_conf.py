@@ -1,41 +1,51 @@
-import os
-import ycm_core
-import logging
-import subprocess
-import re
-
-vimvs_exe = ""
-
-def Vimvs_getycm( filename ):
-	global vimvs_exe
-	startupinfo = subprocess.STARTUPINFO()
-	startupinfo.dwFlags |= subprocess.STARTF_USESHOWWINDOW
-	p = subprocess.Popen([vimvs_exe, '-getycm=' + filename], stdout=subprocess.PIPE, startupinfo=startupinfo)
-	out,err = p.communicate()
-	if p.returncode>0:
-		raise Exception("VIMVS: getycm failed")
-	strings = re.search("^\s*YCM_CMD:(.*)", out, flags=re.MULTILINE)
-	if strings is None:
-		raise Exception("VIMVS: error parsing getycm output. Could not find YCM_CMD line.")
-
-	res = []
-	cmds = strings.group(1).split("|")
-	for cmd in cmds:
-		if cmd.strip()!="":
-			res.append(cmd)
-	return res
-
-def FlagsForFile( filename, **kwargs ):
-	global vimvs_exe
-	if not (kwargs and 'client_data' in kwargs):
-		raise Exception("VIMVS: client_data not found in kwargs")
-	client_data = kwargs['client_data']
-	if not (client_data and 'g:vimvs_exe' in client_data):
-		raise Exception("VIMVS: g:vimvs_exe not present in client_data")
-	vimvs_exe = client_data['g:vimvs_exe']
-	cmd = Vimvs_getycm( filename )
-	return {
-		'flags' : cmd,
-		'do_cache' : True
-	}
-
+import os
+import ycm_core
+import logging
+import subprocess
+import re
+
+vimvs_exe = ""
+vimvs_cfg_params = []
+
+def Vimvs_getycm( filename ):
+	global vimvs_exe
+	startupinfo = subprocess.STARTUPINFO()
+	startupinfo.dwFlags |= subprocess.STARTF_USESHOWWINDOW
+	p = subprocess.Popen([vimvs_exe, '-getycm=' + filename] + vimvs_cfg_params, stdout=subprocess.PIPE, startupinfo=startupinfo)
+	out,err = p.communicate()
+	if p.returncode>0:
+		raise Exception("VIMVS: getycm failed")
+	strings = re.search("^\s*YCM_CMD:(.*)", out, flags=re.MULTILINE)
+	if strings is None:
+		raise Exception("VIMVS: error parsing getycm output. Could not find YCM_CMD line.")
+
+	res = []
+	cmds = strings.group(1).split("|")
+	for cmd in cmds:
+		if cmd.strip()!="":
+			res.append(cmd)
+	# Files not in the database yet get the flags of a file near them
+	inferred = re.search("^\s*INFERRED:", out, flags=re.MULTILINE) is not None
+	return res, inferred
+
+def FlagsForFile( filename, **kwargs ):
+	global vimvs_exe
+	if not (kwargs and 'client_data' in kwargs):
+		raise Exception("VIMVS: client_data not found in kwargs")
+	client_data = kwargs['client_data']
+	if not (client_data and 'g:vimvs_exe' in client_data):
+		raise Exception("VIMVS: g:vimvs_exe not present in client_data")
+	vimvs_exe = client_data['g:vimvs_exe']
+	global vimvs_cfg_params
+	vimvs_cfg_params = []
+	if client_data.get('g:vimvs_configuration'):
+		vimvs_cfg_params.append('-configuration=' + client_data['g:vimvs_configuration'])
+	if client_data.get('g:vimvs_platform'):
+		vimvs_cfg_params.append('-platform=' + client_data['g:vimvs_platform'])
+	cmd, inferred = Vimvs_getycm( filename )
+	return {
+		'flags' : cmd,
+		# So the real flags are used once the database is built again
+		'do_cache' : not inferred
+	}
+
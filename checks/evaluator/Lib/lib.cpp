@@ -0,0 +1 @@
+// Part of the native evaluator fixture (see checks/evaluator/expected.txt)
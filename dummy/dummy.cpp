@@ -1,8 +1,267 @@
-//#include <windows.h>
-//#include <vector>
-//#include "d0\a.h"
-
-int main()
-{
-	return 0;
-}
+//#include <windows.h>
+//#include <vector>
+//#include "d0\a.h"
+
+//
+// What the fast parser (-fastparser) gives msbuild instead of the compiler, librarian and linker, copied to
+// vimvs-dummy-cl/lib/link. It doesn't build anything.
+// If vim-vs created a tool channel (see source/ToolChannel.h), it sends it the arguments, working directory and the
+// contents of the response files (msbuild deletes those once the tool finishes), so vim-vs gets the exact command
+// lines instead of finding them in msbuild's output.
+//
+
+#ifdef _WIN32
+	#include <windows.h>
+#else
+	#include <errno.h>
+	#include <stddef.h>
+	#include <string.h>
+	#include <unistd.h>
+	#include <sys/socket.h>
+	#include <sys/un.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include "ToolMessage.h"
+
+using namespace cz;
+
+namespace
+{
+
+// How long to keep trying to connect, if vim-vs is busy with other tools
+const auto kConnectTimeout = std::chrono::seconds(30);
+
+void appendUtf8(std::string& dst, uint32_t c)
+{
+	if (c < 0x80)
+		dst += static_cast<char>(c);
+	else if (c < 0x800)
+	{
+		dst += static_cast<char>(0xC0 | (c >> 6));
+		dst += static_cast<char>(0x80 | (c & 0x3F));
+	}
+	else if (c < 0x10000)
+	{
+		dst += static_cast<char>(0xE0 | (c >> 12));
+		dst += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+		dst += static_cast<char>(0x80 | (c & 0x3F));
+	}
+	else
+	{
+		dst += static_cast<char>(0xF0 | (c >> 18));
+		dst += static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+		dst += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+		dst += static_cast<char>(0x80 | (c & 0x3F));
+	}
+}
+
+//! Converts the contents of a response file to UTF-8.
+// msbuild writes them as UTF-16 (with a BOM). Without a BOM, they are in the system's code page on Windows.
+std::string decodeResponseFile(const std::string& data)
+{
+	if (data.size() >= 2 && static_cast<uint8_t>(data[0]) == 0xFF && static_cast<uint8_t>(data[1]) == 0xFE)
+	{
+		std::string res;
+		for (size_t i = 2; i + 1 < data.size(); i += 2)
+		{
+			uint32_t c = static_cast<uint8_t>(data[i]) | (static_cast<uint8_t>(data[i + 1]) << 8);
+			if (c >= 0xD800 && c < 0xDC00 && i + 3 < data.size())
+			{
+				uint32_t low = static_cast<uint8_t>(data[i + 2]) | (static_cast<uint8_t>(data[i + 3]) << 8);
+				if (low >= 0xDC00 && low < 0xE000)
+				{
+					c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+					i += 2;
+				}
+			}
+			appendUtf8(res, c);
+		}
+		return res;
+	}
+
+	if (data.size() >= 3 && data.compare(0, 3, "\xEF\xBB\xBF") == 0)
+		return data.substr(3);
+
+#ifdef _WIN32
+	int size = MultiByteToWideChar(CP_ACP, 0, data.data(), static_cast<int>(data.size()), NULL, 0);
+	std::wstring wide(size, 0);
+	MultiByteToWideChar(CP_ACP, 0, data.data(), static_cast<int>(data.size()), &wide[0], size);
+	std::string res;
+	for (auto c : wide)
+		appendUtf8(res, static_cast<uint16_t>(c)); // The code pages are all in the BMP
+	return res;
+#else
+	return data;
+#endif
+}
+
+#ifdef _WIN32
+
+std::string narrow(const wchar_t* str)
+{
+	int size = WideCharToMultiByte(CP_UTF8, 0, str, -1, NULL, 0, NULL, NULL);
+	if (size <= 1)
+		return "";
+	std::string res(size, 0);
+	WideCharToMultiByte(CP_UTF8, 0, str, -1, &res[0], size, NULL, NULL);
+	res.pop_back();
+	return res;
+}
+
+std::wstring widen(const std::string& str)
+{
+	int size = MultiByteToWideChar(CP_UTF8, 0, str.c_str(), -1, NULL, 0);
+	std::wstring res(size, 0);
+	MultiByteToWideChar(CP_UTF8, 0, str.c_str(), -1, &res[0], size);
+	res.pop_back();
+	return res;
+}
+
+bool send(const std::string& channel, const std::string& data)
+{
+	auto name = widen(channel);
+	auto start = std::chrono::steady_clock::now();
+	HANDLE h;
+	while (true)
+	{
+		h = CreateFileW(name.c_str(), GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL);
+		if (h != INVALID_HANDLE_VALUE)
+			break;
+		// vim-vs reads the tools one at a time
+		if (GetLastError() != ERROR_PIPE_BUSY || std::chrono::steady_clock::now() - start > kConnectTimeout)
+			return false;
+		WaitNamedPipeW(name.c_str(), 1000);
+	}
+
+	bool ok = true;
+	size_t done = 0;
+	while (ok && done < data.size())
+	{
+		DWORD n = 0;
+		ok = WriteFile(h, data.data() + done, static_cast<DWORD>(data.size() - done), &n, NULL) != FALSE;
+		done += n;
+	}
+	// So vim-vs has everything by the time msbuild sees the tool finishing
+	FlushFileBuffers(h);
+	CloseHandle(h);
+	return ok;
+}
+
+#else
+
+bool send(const std::string& channel, const std::string& data)
+{
+	sockaddr_un addr = {};
+	addr.sun_family = AF_UNIX;
+	// A leading '@' is an abstract socket, whose address starts with a null character
+	if (channel.empty() || channel.size() >= sizeof(addr.sun_path))
+		return false;
+	memcpy(addr.sun_path, channel.c_str(), channel.size());
+	if (channel[0] == '@')
+		addr.sun_path[0] = 0;
+	auto addrLen = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + channel.size());
+
+	int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0)
+		return false;
+	bool ok = connect(fd, reinterpret_cast<sockaddr*>(&addr), addrLen) == 0;
+	size_t done = 0;
+	while (ok && done < data.size())
+	{
+		auto n = write(fd, data.data() + done, data.size() - done);
+		if (n < 0 && errno == EINTR)
+			continue;
+		ok = n > 0;
+		if (ok)
+			done += n;
+	}
+	close(fd);
+	return ok;
+}
+
+#endif
+
+std::string getToolName(const std::string& exe)
+{
+	auto name = exe.substr(exe.find_last_of("/\\") + 1);
+	auto dot = name.rfind('.');
+	if (dot != std::string::npos)
+		name.erase(dot);
+	return name;
+}
+
+bool readResponseFile(const std::string& path, std::string& dst)
+{
+#ifdef _WIN32
+	std::ifstream file(widen(path), std::ifstream::in | std::ifstream::binary);
+#else
+	std::ifstream file(path, std::ifstream::in | std::ifstream::binary);
+#endif
+	if (!file.is_open())
+		return false;
+	std::stringstream ss;
+	ss << file.rdbuf();
+	dst = decodeResponseFile(ss.str());
+	return true;
+}
+
+int run(std::vector<std::string> argv, const std::string& workdir)
+{
+	std::string channel;
+#ifdef _WIN32
+	if (auto env = _wgetenv(L"" VIMVS_CHANNEL_ENV))
+		channel = narrow(env);
+#else
+	if (auto env = getenv(VIMVS_CHANNEL_ENV))
+		channel = env;
+#endif
+	if (channel.empty() || argv.empty())
+		return EXIT_SUCCESS;
+
+	ToolMessage msg;
+	msg.tool = getToolName(argv[0]);
+	msg.workdir = workdir;
+	msg.args.assign(argv.begin() + 1, argv.end());
+	for (auto&& a : msg.args)
+	{
+		if (a.size() < 2 || a[0] != '@')
+			continue;
+		std::string contents;
+		if (readResponseFile(a.substr(1), contents))
+			msg.responseFiles.emplace_back(a.substr(1), std::move(contents));
+		else
+			fprintf(stderr, "%s: Failed to read response file '%s'\n", msg.tool.c_str(), a.c_str() + 1);
+	}
+
+	// Not being able to tell vim-vs is not an error for msbuild. vim-vs takes the missing command lines from msbuild's
+	// output instead, and warns about it.
+	if (!send(channel, encodeToolMessage(msg)))
+		fprintf(stderr, "%s: Failed to send the command line to vim-vs (%s)\n", msg.tool.c_str(), channel.c_str());
+	return EXIT_SUCCESS;
+}
+
+} // anonymous namespace
+
+#ifdef _WIN32
+int wmain(int argc, wchar_t* argv[])
+{
+	std::vector<std::string> args;
+	for (int i = 0; i < argc; i++)
+		args.push_back(narrow(argv[i]));
+	std::wstring workdir(GetCurrentDirectoryW(0, NULL), 0);
+	workdir.resize(GetCurrentDirectoryW(static_cast<DWORD>(workdir.size()), &workdir[0]));
+	return run(std::move(args), narrow(workdir.c_str()));
+}
+#else
+int main(int argc, char* argv[])
+{
+	std::vector<char> workdir(4096);
+	if (!getcwd(workdir.data(), workdir.size()))
+		workdir[0] = 0;
+	return run(std::vector<std::string>(argv, argv + argc), workdir.data());
+}
+#endif
@@ -1,5 +1,5 @@
-rmdir /q /s build
-md build
-cd build
-cmake -G "Visual Studio 14 Win64" ..
-
+rmdir /q /s build
+md build
+cd build
+cmake -G "Visual Studio 15 2017 Win64" ..
+
@@ -14,7 +14,7 @@ del bin\vimvs*.exe
 rem Generate projects
 md %BUILDDIR%
 cd %BUILDDIR%
-cmake -G "Visual Studio 14 Win64" ..
+cmake -G "Visual Studio 15 2017 Win64" ..
 if %errorlevel% neq 0 goto Error
 cd ..
 
@@ -1,229 +1,417 @@
-"
-" vim-vs
-" Check [https://github.com/ruifig/vim-vs] for updates
-"
-
-if !has('python')
-	echoerr "vimvs requires Python support"
-	finish
-endif
-
-let g:vimvs_plugin_root = resolve(expand('<sfile>:p:h') . "\\..\\")
-
-if !exists('g:vimvs_exe')
-	let g:vimvs_exe = resolve(fnamemodify(resolve(expand('<sfile>:p')), ':h') . "\\..\\bin\\vimvs.exe")
-endif
-
-if !exists('g:vimvs_configuration')
-	let g:vimvs_configuration = "Debug"
-endif
-
-if !exists('g:vimvs_platform')
-	let g:vimvs_platform = "x64"
-endif
-
-" If 1, it will save all files before running any build/compile commands
-if !exists('g:vimvs_wa')
-	let g:vimvs_wa = 0
-endif
-
-if !exists('g:ycm_global_ycm_extra_conf')
-	let g:ycm_global_ycm_extra_conf = g:vimvs_plugin_root + 'plugin/.ycm_extran_conf.py'
-endif
-
-" TODO: Why do I have the 1 in [1, 'g:vimvs_exe'] ? Seems like garbage.
-" Add "g:vimvs_exe" to g:ycm:extra_conf_vim_data
-if exists('g:ycm_extra_conf_vim_data')
-	if index(g:ycm_extra_conf_vim_data, 'g:vimvs_exe')==-1
-		let g:ycm_extra_conf_vim_data = g:ycm_extra_conf_vim_data + [1, 'g:vimvs_exe']
-	endif
-else
-	let g:ycm_extra_conf_vim_data = [1, 'g:vimvs_exe']
-endif
-
-" Load vimvs Python module
-python << EOF
-# Add python sources folder to the system path.
-import vim
-sys.path.insert( 0, vim.eval('g:vimvs_plugin_root') + 'plugin' )
-import vimvs
-reload(vimvs)
-EOF
-
-"
-" ========================== Utility function
-"
-function! vimvs#PrintError(msg) abort
-    execute 'normal! \<Esc>'
-    echohl WarningMsg
-    echomsg a:msg
-    echohl None
-endfunction
-
-function! vimvs#GetConfiguration()
-	if exists('g:vimvs_configuration')
-		return g:vimvs_configuration
-	else
-		return ""
-endfunction
-
-function! vimvs#GetPlatform()
-	if exists('g:vimvs_platform')
-		return g:vimvs_platform
-	else
-		return ""
-endfunction
-
-function! vimvs#GetConfigurationAndPlatformCmd()
-	let configuration = vimvs#GetConfiguration()
-	let platform = vimvs#GetPlatform()
-	let res = ""
-	if configuration != ""
-		let res = ' -configuration=' . configuration
-	endif
-	if platform != ""
-		let res = res . ' -platform=' . platform
-	endif
-	return res
-endfunction
-
-"
-" ========================== User functions
-"
-
-function! vimvs#GetRoot()
-	let res = ""
-python << EOF
-# Notes:
-#	repr so it convert any character to a way that I can pass them to the vim.command
-#	[1:-1] so it removes the single quotes at the start and end that repr puts in there
-try:
-	vim.command("let res = %s" % vimvs.ToVimString(vimvs.GetRoot()))
-except RuntimeError as e:
-	vimvs.PrintError(e.message)
-EOF
-	return res
-endfunction
-
-"
-"
-function! vimvs#LoadQuickfix()
-	if empty(vimvs#GetRoot())
-		return
-	endif
-python << EOF
-try:
-	vimvs.LoadQuickfix()
-except RuntimeError as e:
-	vimvs.PrintError(e.message)
-EOF
-endfunction
-
-"
-"
-function! vimvs#Build()
-	if empty(vimvs#GetRoot())
-		return
-	endif
-	if g:vimvs_wa
-		wa
-	endif
-	let cmd = g:vimvs_exe . ' -build' . vimvs#GetConfigurationAndPlatformCmd()
-	execute 'AsyncRun -post=:call\ vimvs\#LoadQuickfix() @' . cmd
-endfunction
-
-"
-"
-function! vimvs#Rebuild()
-	if empty(vimvs#GetRoot())
-		return
-	endif
-	if g:vimvs_wa
-		wa
-	endif
-	let cmd = g:vimvs_exe . ' -build=prj:Rebuild' . vimvs#GetConfigurationAndPlatformCmd()
-	execute 'AsyncRun -post=:call\ vimvs\#LoadQuickfix() @' . cmd
-endfunction
-
-"
-"
-function! vimvs#BuildDB(fastparser)
-	if empty(vimvs#GetRoot())
-		return
-	endif
-	if g:vimvs_wa
-		wa
-	endif
-	if a:fastparser
-		let cmd = g:vimvs_exe . ' -fastparser -builddb' . vimvs#GetConfigurationAndPlatformCmd()
-	else
-		let cmd = g:vimvs_exe . ' -builddb=prj:Rebuild' . vimvs#GetConfigurationAndPlatformCmd()
-	endif
-	execute 'AsyncRun -post=:call\ vimvs\#LoadQuickfix() @' . cmd
-endfunction
-
-"
-"
-function! vimvs#Clean()
-	if empty(vimvs#GetRoot())
-		return
-	endif
-	if g:vimvs_wa
-		wa
-	endif
-	let cmd = g:vimvs_exe . ' -build=prj:Clean' . vimvs#GetConfigurationAndPlatformCmd()
-	<execute 'AsyncRun -post=:call\ vimvs\#LoadQuickfix() @' . cmd
-endfunction
-
-"
-"
-function! vimvs#CompileFile(file)
-	if empty(vimvs#GetRoot())
-		return
-	endif
-	if g:vimvs_wa
-		wa
-	endif
-	let cmd = g:vimvs_exe . ' -build=file:"' . a:file . '"' . vimvs#GetConfigurationAndPlatformCmd()
-	echo cmd
-	execute 'AsyncRun -post=:call\ vimvs\#LoadQuickfix() @' . cmd
-endfunction
-
-"
-"
-function! vimvs#GetAlt(file)
-	let res = ""
-	if empty(vimvs#GetRoot())
-		return ""
-	endif
-python << EOF
-try:
-	vim.command("let res = %s" % vimvs.ToVimString(vimvs.GetAlt(vim.eval('a:file'))))
-except RuntimeError as e:
-	vimvs.PrintError(e.message)
-EOF
-	return res
-endfunction
-
-"
-"
-function! vimvs#OpenAlt(file)
-	let res = vimvs#GetAlt(a:file)
-	if !empty(res)
-		execute "edit " res
-	endif
-endfunction
-
-command! VimvsRoot echo vimvs#GetRoot()
-command! VimvsUpdateDB call vimvs#BuildDB(1)
-command! VimvsUpdateDBSlow call vimvs#BuildDB(0) " This should not be needed. It uses the old way of building the database, by running a real build
-command! VimvsActiveConfig echo vimvs#GetConfiguration() "|" vimvs#GetPlatform()
-command! -nargs=1 VimvsSetConfiguration execute("let g:vimvs_configuration='" . <f-args> . "'")
-command! -nargs=1 VimvsSetPlatform execute("let g:vimvs_platform='" . <f-args> . "'")
-command! VimvsBuild call vimvs#Build()
-command! VimvsRebuild call vimvs#Rebuild()
-command! VimvsClean call vimvs#Clean()
-command! VimvsCompile call vimvs#CompileFile(expand("%:p"))
-command! VimvsGetAlt call vimvs#GetAlt(expand("%:p"))
-command! VimvsOpenAlt call vimvs#OpenAlt(expand("%:p"))
-
+"
+" vim-vs
+" Check [https://github.com/ruifig/vim-vs] for updates
+"
+
+if !has('python')
+	echoerr "vimvs requires Python support"
+	finish
+endif
+
+let g:vimvs_plugin_root = resolve(expand('<sfile>:p:h') . "\\..\\")
+
+if !exists('g:vimvs_exe')
+	let g:vimvs_exe = resolve(fnamemodify(resolve(expand('<sfile>:p')), ':h') . "\\..\\bin\\vimvs.exe")
+endif
+
+if !exists('g:vimvs_configuration')
+	let g:vimvs_configuration = "Debug"
+endif
+
+if !exists('g:vimvs_platform')
+	let g:vimvs_platform = "x64"
+endif
+
+" If 1, it will save all files before running any build/compile commands
+if !exists('g:vimvs_wa')
+	let g:vimvs_wa = 0
+endif
+
+if !exists('g:ycm_global_ycm_extra_conf')
+	let g:ycm_global_ycm_extra_conf = g:vimvs_plugin_root + 'plugin/.ycm_extran_conf.py'
+endif
+
+" TODO: Why do I have the 1 in [1, 'g:vimvs_exe'] ? Seems like garbage.
+" Add "g:vimvs_exe" to g:ycm:extra_conf_vim_data
+if exists('g:ycm_extra_conf_vim_data')
+	if index(g:ycm_extra_conf_vim_data, 'g:vimvs_exe')==-1
+		let g:ycm_extra_conf_vim_data = g:ycm_extra_conf_vim_data + [1, 'g:vimvs_exe']
+	endif
+else
+	let g:ycm_extra_conf_vim_data = [1, 'g:vimvs_exe']
+endif
+" So YouCompleteMe gets the flags for the active Configuration|Platform
+for s:var in ['g:vimvs_configuration', 'g:vimvs_platform']
+	if index(g:ycm_extra_conf_vim_data, s:var)==-1
+		let g:ycm_extra_conf_vim_data = g:ycm_extra_conf_vim_data + [s:var]
+	endif
+endfor
+
+" List of "Configuration|Platform" to build the database for (e.g: ['Debug|x64', 'Release|Win32']).
+" If empty, the database is built for the active Configuration|Platform only
+if !exists('g:vimvs_builddb_configurations')
+	let g:vimvs_builddb_configurations = []
+endif
+
+" If set, the database is built in memory, and only written to disk when complete
+if !exists('g:vimvs_builddb_inmemory')
+	let g:vimvs_builddb_inmemory = 0
+endif
+
+" If set, :VimvsUpdateDB only processes the projects that changed since the last update (vimvs -incremental).
+" :VimvsUpdateDB! always processes the whole solution.
+if !exists('g:vimvs_builddb_incremental')
+	let g:vimvs_builddb_incremental = 0
+endif
+
+" If set, the database file is shrunk after updating it
+if !exists('g:vimvs_builddb_vacuum')
+	let g:vimvs_builddb_vacuum = 0
+endif
+
+" If set, :VimvsUpdateDB evaluates the projects directly instead of running msbuild (faster, but less accurate)
+if !exists('g:vimvs_builddb_native')
+	let g:vimvs_builddb_native = 0
+endif
+
+" If set, build commands only show the errors and warnings, and a summary of the progress, instead of the whole
+" build output (vimvs -progress)
+if !exists('g:vimvs_progress')
+	let g:vimvs_progress = 1
+endif
+
+" If set (and vim has jobs and channels), queries are sent to a vimvs process kept running (vimvs -server), instead
+" of launching vimvs for every query
+if !exists('g:vimvs_use_server')
+	let g:vimvs_use_server = 1
+endif
+
+" Load vimvs Python module
+python << EOF
+# Add python sources folder to the system path.
+import vim
+sys.path.insert( 0, vim.eval('g:vimvs_plugin_root') + 'plugin' )
+import vimvs
+reload(vimvs)
+EOF
+
+"
+" ========================== Utility function
+"
+function! vimvs#PrintError(msg) abort
+    execute 'normal! \<Esc>'
+    echohl WarningMsg
+    echomsg a:msg
+    echohl None
+endfunction
+
+function! vimvs#GetConfiguration()
+	if exists('g:vimvs_configuration')
+		return g:vimvs_configuration
+	else
+		return ""
+endfunction
+
+function! vimvs#GetPlatform()
+	if exists('g:vimvs_platform')
+		return g:vimvs_platform
+	else
+		return ""
+endfunction
+
+function! vimvs#GetConfigurationAndPlatformCmd()
+	let configuration = vimvs#GetConfiguration()
+	let platform = vimvs#GetPlatform()
+	let res = ""
+	if configuration != ""
+		let res = ' -configuration=' . configuration
+	endif
+	if platform != ""
+		let res = res . ' -platform=' . platform
+	endif
+	return res
+endfunction
+
+function! vimvs#GetBuildOptionsCmd()
+	if g:vimvs_progress
+		return ' -progress'
+	else
+		return ''
+	endif
+endfunction
+
+"
+" ========================== Server
+"
+" The server is started on the first query, and restarted if the current directory changes, since that can change
+" the project root. The root is cached, since it's only found when the server starts.
+
+let s:server = {}
+
+function! s:OnServerError(channel, msg)
+	let s:server.error = a:msg
+endfunction
+
+" Returns 1 if the server is running
+function! s:StartServer()
+	if !g:vimvs_use_server || !has('job') || !has('channel')
+		return 0
+	endif
+	let cwd = getcwd()
+	if has_key(s:server, 'job') && job_status(s:server.job) == 'run'
+		if s:server.cwd == cwd
+			return 1
+		endif
+		call job_stop(s:server.job)
+	endif
+	let s:server = {'cwd': cwd, 'root': '', 'error': ''}
+	let s:server.job = job_start([g:vimvs_exe, '-server'],
+		\ {'mode': 'json', 'cwd': cwd, 'err_mode': 'nl', 'err_cb': function('s:OnServerError')})
+	return job_status(s:server.job) == 'run'
+endfunction
+
+function! s:MakeRequest(req)
+	return extend({'configuration': vimvs#GetConfiguration(), 'platform': vimvs#GetPlatform()}, a:req)
+endfunction
+
+" Sends a request, and waits for the response. Returns {} if the request failed (the error is displayed).
+function! s:Request(req)
+	let res = ch_evalexpr(job_getchannel(s:server.job), s:MakeRequest(a:req), {'timeout': 10000})
+	if type(res) != v:t_dict
+		call vimvs#PrintError(empty(s:server.error) ? 'VIMVS: No response from the server' : 'VIMVS: ' . s:server.error)
+		return {}
+	elseif has_key(res, 'error')
+		call vimvs#PrintError('VIMVS: ' . res.error)
+		return {}
+	endif
+	return res
+endfunction
+
+" Sends a request without waiting. Several requests can be in flight.
+" a:Callback is called with the response, if the request didn't fail.
+function! s:RequestAsync(req, Callback)
+	call ch_sendexpr(job_getchannel(s:server.job), s:MakeRequest(a:req),
+		\ {'callback': function('s:OnResponse', [a:Callback])})
+endfunction
+
+function! s:OnResponse(Callback, channel, res)
+	if type(a:res) != v:t_dict
+		call vimvs#PrintError('VIMVS: Invalid response from the server')
+	elseif has_key(a:res, 'error')
+		call vimvs#PrintError('VIMVS: ' . a:res.error)
+	else
+		call a:Callback(a:res)
+	endif
+endfunction
+
+"
+" ========================== User functions
+"
+
+function! vimvs#GetRoot()
+	if s:StartServer()
+		if empty(s:server.root)
+			let s:server.root = get(s:Request({'cmd': 'getroot'}), 'root', '')
+		endif
+		return s:server.root
+	endif
+
+	let res = ""
+python << EOF
+# Notes:
+#	repr so it convert any character to a way that I can pass them to the vim.command
+#	[1:-1] so it removes the single quotes at the start and end that repr puts in there
+try:
+	vim.command("let res = %s" % vimvs.ToVimString(vimvs.GetRoot()))
+except RuntimeError as e:
+	vimvs.PrintError(e.message)
+EOF
+	return res
+endfunction
+
+"
+"
+function! vimvs#LoadQuickfix()
+	let root = vimvs#GetRoot()
+	if empty(root)
+		return
+	endif
+	let fname = root . '.vimvs-tmp.quickfix'
+	if !filereadable(fname)
+		return
+	endif
+	" Each line is: File|Line|Col|Type|Code|Message
+	" Errors without a file (e.g: Command line errors) have an empty File
+	let efm_save = &errorformat
+	let &errorformat = '%f|%l|%c|fatal %t%*[^|]|%*[A-Za-z]%n|%m,'
+		\ . '%f|%l|%c|%t%*[^|]|%*[A-Za-z]%n|%m,'
+		\ . '|%*[0-9]|%*[0-9]|%t%*[^|]|%*[A-Za-z]%n|%m'
+	try
+		execute 'cgetfile ' . fnameescape(fname)
+	finally
+		let &errorformat = efm_save
+	endtry
+endfunction
+
+"
+"
+function! vimvs#Build()
+	if empty(vimvs#GetRoot())
+		return
+	endif
+	if g:vimvs_wa
+		wa
+	endif
+	let cmd = g:vimvs_exe . ' -build' . vimvs#GetConfigurationAndPlatformCmd() . vimvs#GetBuildOptionsCmd()
+	execute 'AsyncRun -post=:call\ vimvs\#LoadQuickfix() @' . cmd
+endfunction
+
+"
+"
+function! vimvs#Rebuild()
+	if empty(vimvs#GetRoot())
+		return
+	endif
+	if g:vimvs_wa
+		wa
+	endif
+	let cmd = g:vimvs_exe . ' -build=prj:Rebuild' . vimvs#GetConfigurationAndPlatformCmd() . vimvs#GetBuildOptionsCmd()
+	execute 'AsyncRun -post=:call\ vimvs\#LoadQuickfix() @' . cmd
+endfunction
+
+"
+"
+function! vimvs#BuildDB(fastparser, full)
+	if empty(vimvs#GetRoot())
+		return
+	endif
+	if g:vimvs_wa
+		wa
+	endif
+	if a:fastparser
+		let cmd = g:vimvs_exe . ' -fastparser -builddb' . vimvs#GetConfigurationAndPlatformCmd() . vimvs#GetBuildOptionsCmd()
+		if g:vimvs_builddb_incremental && !a:full
+			let cmd = cmd . ' -incremental'
+		endif
+		if g:vimvs_builddb_native
+			let cmd = cmd . ' -native'
+		endif
+	else
+		let cmd = g:vimvs_exe . ' -builddb=prj:Rebuild' . vimvs#GetConfigurationAndPlatformCmd() . vimvs#GetBuildOptionsCmd()
+	endif
+	if !empty(g:vimvs_builddb_configurations)
+		let cmd = cmd . ' "-configurations=' . join(g:vimvs_builddb_configurations, ';') . '"'
+	endif
+	if g:vimvs_builddb_inmemory
+		let cmd = cmd . ' -inmemorydb'
+	endif
+	if g:vimvs_builddb_vacuum
+		let cmd = cmd . ' -vacuum'
+	endif
+	execute 'AsyncRun -post=:call\ vimvs\#LoadQuickfix() @' . cmd
+endfunction
+
+"
+"
+function! vimvs#Clean()
+	if empty(vimvs#GetRoot())
+		return
+	endif
+	if g:vimvs_wa
+		wa
+	endif
+	let cmd = g:vimvs_exe . ' -build=prj:Clean' . vimvs#GetConfigurationAndPlatformCmd() . vimvs#GetBuildOptionsCmd()
+	<execute 'AsyncRun -post=:call\ vimvs\#LoadQuickfix() @' . cmd
+endfunction
+
+"
+"
+function! vimvs#CompileFile(file)
+	if empty(vimvs#GetRoot())
+		return
+	endif
+	if g:vimvs_wa
+		wa
+	endif
+	let cmd = g:vimvs_exe . ' -build=file:"' . a:file . '"' . vimvs#GetConfigurationAndPlatformCmd() . vimvs#GetBuildOptionsCmd()
+	echo cmd
+	execute 'AsyncRun -post=:call\ vimvs\#LoadQuickfix() @' . cmd
+endfunction
+
+"
+"
+function! vimvs#GetAlt(file)
+	let res = ""
+	if empty(vimvs#GetRoot())
+		return ""
+	endif
+	if s:StartServer()
+		return get(s:Request({'cmd': 'getalt', 'file': a:file}), 'alt', '')
+	endif
+python << EOF
+try:
+	vim.command("let res = %s" % vimvs.ToVimString(vimvs.GetAlt(vim.eval('a:file'))))
+except RuntimeError as e:
+	vimvs.PrintError(e.message)
+EOF
+	return res
+endfunction
+
+"
+"
+function! vimvs#OpenAlt(file)
+	" With the server, the file is opened when the response arrives, so vim doesn't wait
+	if !empty(vimvs#GetRoot()) && s:StartServer()
+		call s:RequestAsync({'cmd': 'getalt', 'file': a:file}, {res -> execute('edit ' . fnameescape(res.alt), '')})
+		return
+	endif
+	let res = vimvs#GetAlt(a:file)
+	if !empty(res)
+		execute "edit " res
+	endif
+endfunction
+
+"
+" Lists the files in the database that match the pattern in the quickfix list, best match first
+function! vimvs#Find(pattern)
+	if empty(vimvs#GetRoot())
+		return
+	endif
+	if s:StartServer()
+		call s:RequestAsync({'cmd': 'find', 'pattern': a:pattern}, {res -> s:SetFindResults(res.files)})
+		return
+	endif
+	let files = []
+python << EOF
+try:
+	cfg = vim.eval('vimvs#GetConfigurationAndPlatformCmd()').split()
+	vim.command("let files = [%s]" % ','.join(vimvs.ToVimString(f) for f in vimvs.Find(vim.eval('a:pattern'), cfg)))
+except RuntimeError as e:
+	vimvs.PrintError(e.message)
+EOF
+	call s:SetFindResults(files)
+endfunction
+
+function! s:SetFindResults(files)
+	if empty(a:files)
+		echo "No files found"
+		return
+	endif
+	call setqflist(map(copy(a:files), '{"filename": v:val, "lnum": 1}'))
+	copen
+endfunction
+
+command! VimvsRoot echo vimvs#GetRoot()
+command! -bang VimvsUpdateDB call vimvs#BuildDB(1, <bang>0)
+command! VimvsUpdateDBSlow call vimvs#BuildDB(0, 1) " This should not be needed. It uses the old way of building the database, by running a real build
+command! VimvsActiveConfig echo vimvs#GetConfiguration() "|" vimvs#GetPlatform()
+command! -nargs=1 VimvsSetConfiguration execute("let g:vimvs_configuration='" . <f-args> . "'")
+command! -nargs=1 VimvsSetPlatform execute("let g:vimvs_platform='" . <f-args> . "'")
+command! VimvsBuild call vimvs#Build()
+command! VimvsRebuild call vimvs#Rebuild()
+command! VimvsClean call vimvs#Clean()
+command! VimvsCompile call vimvs#CompileFile(expand("%:p"))
+command! VimvsGetAlt call vimvs#GetAlt(expand("%:p"))
+command! VimvsOpenAlt call vimvs#OpenAlt(expand("%:p"))
+command! -nargs=+ VimvsFind call vimvs#Find(<q-args>)
+
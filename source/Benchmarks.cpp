@@ -0,0 +1,733 @@
+#include "vimvsPCH.h"
+#include "Benchmarks.h"
+#include "Database.h"
+#include "Logging.h"
+#include "Trace.h"
+#include "PathTable.h"
+#include "PathRank.h"
+#include "FileFinder.h"
+#include "FileReader.h"
+#include "BuildGraph.h"
+#include "Parser.h"
+
+#include <sys/stat.h>
+
+namespace cz
+{
+
+namespace
+{
+
+//! Returns the average time of one call of 'f', in nanoseconds
+template<typename F>
+double timeIt(int iterations, F&& f)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < iterations; i++)
+		f(i);
+	auto end = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+}
+
+void printResult(const char* name, double ns)
+{
+	printf("    %-50s %12.1f ns\n", name, ns);
+}
+
+//
+// Compares the way rows used to be read (std::function callback, and copying every column into a SourceFile),
+// with the variadic SqStmt::exec, std::string_view columns, and projection statements.
+//
+void benchSqStmt()
+{
+	const int numFiles = 20000;
+	const int filesPerName = 10;
+
+	SqDatabase db;
+	CZ_CHECK(db.open(":memory:", true));
+	SqStmt create;
+	CZ_CHECK(create.init(db, "CREATE TABLE files (id INTEGER PRIMARY KEY, fullpath VARCHAR COLLATE NOCASE, name VARCHAR COLLATE NOCASE, prjName VARCHAR, prjFile VARCHAR, configuration VARCHAR, defines VARCHAR, includes VARCHAR)"));
+	CZ_CHECK(create.exec());
+	SqStmt index;
+	CZ_CHECK(index.init(db, "CREATE INDEX files_name ON files(name)"));
+	CZ_CHECK(index.exec());
+
+	// Sizes similar to what a real project has
+	std::string defines;
+	for (int i = 0; i < 20; i++)
+		defines += formatString("-DSOME_DEFINE_%d=1|", i);
+	std::string includes;
+	for (int i = 0; i < 20; i++)
+		includes += formatString("-IC:/Work/SomeProject/ThirdParty/Library%d/include|", i);
+
+	{
+		SqTransaction transaction(db);
+		SqStmt insert;
+		CZ_CHECK(insert.init(db, "INSERT INTO files(id,fullpath,name,prjName,prjFile,configuration,defines,includes) VALUES(?,?,?,?,?,?,?,?)"));
+		for (int i = 0; i < numFiles; i++)
+		{
+			std::string name = formatString("file%d.cpp", i / filesPerName);
+			std::string fullpath = formatString("C:/Work/SomeProject/Source/Module%d/%s", i % filesPerName, name.c_str());
+			CZ_CHECK(insert.bind(int64_t(i), fullpath, name, "SomeProject", "C:/Work/SomeProject/SomeProject.vcxproj",
+				"Debug|x64", defines, includes));
+			CZ_CHECK(insert.exec());
+		}
+		transaction.commit();
+	}
+
+	SqStmt all;
+	CZ_CHECK(all.init(db, "SELECT id,fullpath,name,prjName,prjFile,configuration,defines,includes FROM files WHERE name=?"));
+	SqStmt projection;
+	CZ_CHECK(projection.init(db, "SELECT fullpath FROM files WHERE name=?"));
+
+	const int iterations = 20000;
+	int64_t check = 0;
+	auto getName = [&](int i)
+	{
+		return std::string(formatString("file%d.cpp", i % (numFiles / filesPerName)));
+	};
+
+	printResult("Lookup by name: std::function, copy all columns", timeIt(iterations, [&](int i)
+	{
+		std::vector<SourceFile> res;
+		std::function<bool(int64_t, const char*, const char*, const char*, const char*, const char*, const char*, const char*)> cb =
+			[&](int64_t id, const char* fullpath, const char* name, const char* prjName, const char* prjFile, const char* configuration, const char* defines, const char* includes)
+		{
+			SourceFile out;
+			out.id = id;
+			out.fullpath = fullpath;
+			out.name = name;
+			out.prjName = prjName;
+			out.prjFile = prjFile;
+			out.configuration = configuration;
+			out.defines = defines;
+			out.includes = includes;
+			res.push_back(std::move(out));
+			return true;
+		};
+		CZ_CHECK(all.bindText(1, getName(i)));
+		all.exec<int64_t, const char*, const char*, const char*, const char*, const char*, const char*, const char*>(cb);
+		check += res.size();
+	}));
+
+	printResult("Lookup by name: inlined, string_view columns", timeIt(iterations, [&](int i)
+	{
+		CZ_CHECK(all.bind(getName(i)));
+		all.exec<int64_t, VIMVS_FILES_COLUMNS_VIEWS>(
+			[&](int64_t /*id*/, std::string_view fullpath, std::string_view /*name*/, std::string_view /*prjName*/, std::string_view /*prjFile*/,
+				std::string_view /*configuration*/, std::string_view /*defines*/, std::string_view /*includes*/)
+		{
+			check += fullpath.size();
+			return true;
+		});
+	}));
+
+	printResult("Lookup by name: inlined, fullpath projection", timeIt(iterations, [&](int i)
+	{
+		CZ_CHECK(projection.bind(getName(i)));
+		projection.exec<std::string_view>([&](std::string_view fullpath)
+		{
+			check += fullpath.size();
+			return true;
+		});
+	}));
+
+	// Just so the compiler can't throw away the work
+	CZ_LOG(logDefault, Log, "Benchmark check value: %lld", check);
+}
+
+//
+// Compares the old synchronous file logging (std::endl on every line) with AsyncLogOutput, with several threads
+// logging at once, plus the cost of a message that is filtered out.
+//
+class SyncFileLogOutput : public LogOutput
+{
+public:
+	SyncFileLogOutput(const std::string& filename) : m_out(nativePath(filename), std::ofstream::out | std::ofstream::trunc)
+	{
+	}
+private:
+	virtual void log(const char* /*file*/, int /*line*/, const LogCategoryBase* /*category*/, LogVerbosity /*verbosity*/, const char* msg) override
+	{
+		std::lock_guard<std::mutex> lk(m_mtx);
+		m_out << msg << std::endl;
+	}
+	std::mutex m_mtx;
+	std::ofstream m_out;
+};
+
+class AsyncFileLogOutput : public AsyncLogOutput
+{
+public:
+	AsyncFileLogOutput(const std::string& filename) : m_out(nativePath(filename), std::ofstream::out | std::ofstream::trunc)
+	{
+	}
+	~AsyncFileLogOutput()
+	{
+		stop();
+	}
+private:
+	virtual void write(const std::string& batch) override
+	{
+		m_out.write(batch.data(), batch.size());
+		m_out.flush();
+	}
+	std::ofstream m_out;
+};
+
+void benchLogging()
+{
+	const std::string filename = "vimvs-bench.log";
+	const int numThreads = 4;
+	const int iterations = 50000;
+	std::string includes;
+	for (int i = 0; i < 10; i++)
+		includes += formatString("-IC:/Work/SomeProject/ThirdParty/Library%d/include|", i);
+
+	auto logFromThreads = [&]()
+	{
+		std::vector<std::thread> threads;
+		for (int t = 0; t < numThreads; t++)
+		{
+			threads.emplace_back([&, t]()
+			{
+				for (int i = 0; i < iterations; i++)
+					CZ_LOG(logDefault, Log, "Adding file file%d_%d.cpp to database: %s", t, i, includes.c_str());
+			});
+		}
+		for (auto&& th : threads)
+			th.join();
+	};
+
+	{
+		SyncFileLogOutput out(filename);
+		printResult("Synchronous, std::endl per line (per message)", timeIt(1, [&](int)
+		{
+			logFromThreads();
+		}) / (numThreads * iterations));
+	}
+
+	{
+		AsyncFileLogOutput out(filename);
+		printResult("Async ring buffer, batched writes (per message)", timeIt(1, [&](int)
+		{
+			logFromThreads();
+			out.flush();
+		}) / (numThreads * iterations));
+	}
+
+	// Verbose is suppressed by default, so this is just the check
+	printResult("Filtered out message", timeIt(iterations, [&](int i)
+	{
+		CZ_LOG(logDefault, Verbose, "Adding file file%d.cpp to database: %s", i, includes.c_str());
+	}));
+
+	deleteFile(filename);
+}
+
+//
+// Cost of a trace scope, when tracing is not enabled (the normal case), and when it is.
+//
+void benchTrace()
+{
+	const int iterations = 1000000;
+	printResult("Scope, tracing disabled", timeIt(iterations, [&](int)
+	{
+		CZ_TRACE_SCOPE("bench", "scope");
+	}));
+
+	trace::start();
+	printResult("Scope, tracing enabled", timeIt(iterations, [&](int)
+	{
+		CZ_TRACE_SCOPE("bench", "scope");
+	}));
+	printResult("Scope with detail, tracing enabled", timeIt(iterations, [&](int i)
+	{
+		CZ_TRACE_SCOPE_DETAIL("bench", "scope", formatString("C:/Work/SomeProject/Source/File%d.cpp", i));
+	}));
+	trace::stop("vimvs-bench.trace.json");
+	deleteFile("vimvs-bench.trace.json");
+}
+
+//
+// Path canonicalization and interning, as done for every header probe of the build graph
+//
+void benchPaths()
+{
+	const int iterations = 200000;
+	std::vector<std::string> dirs;
+	for (int i = 0; i < 20; i++)
+		dirs.push_back(formatString("C:\\Work\\SomeProject\\Source\\Module%d\\Private\\", i));
+	std::string inc = "../Public/Module.h";
+
+	std::string dst;
+	printResult("canonicalizePath", timeIt(iterations, [&](int i)
+	{
+		canonicalizePath(dst, inc, dirs[i % dirs.size()]);
+	}));
+
+	printResult("fullPath", timeIt(iterations, [&](int i)
+	{
+		fullPath(dst, inc, dirs[i % dirs.size()]);
+	}));
+
+	PathTable paths;
+	printResult("canonicalizePath + PathTable::intern", timeIt(iterations, [&](int i)
+	{
+		canonicalizePath(dst, inc, dirs[i % dirs.size()]);
+		paths.intern(dst);
+	}));
+
+	printResult("canonicalizePath + PathTable::isExistingFile", timeIt(iterations, [&](int i)
+	{
+		canonicalizePath(dst, inc, dirs[i % dirs.size()]);
+		paths.isExistingFile(paths.intern(dst));
+	}));
+
+	printResult("canonicalizePath + isExistingFile", timeIt(iterations, [&](int i)
+	{
+		canonicalizePath(dst, inc, dirs[i % dirs.size()]);
+		isExistingFile(dst);
+	}));
+}
+
+//
+// File lookups (isExistingFile) against a plain stat of the full path, for files that exist and files that don't,
+// in a deep directory, as with the header probes of the build graph. On Linux, lookups go through the directory
+// cache, which only checks the directory once per generation.
+//
+void benchStat()
+{
+	const int iterations = 200000;
+	std::string root = getCWD() + "vimvs-bench-stat";
+	ensureTrailingSlash(root);
+	std::vector<std::string> dirs;
+	std::string dir = root;
+	for (auto name : { "Work", "SomeProject", "Source", "Runtime", "Module", "Private", "Detail" })
+	{
+		dir += name;
+		dirs.push_back(dir);
+		dir += "/";
+	}
+	createDirectory(root);
+	for (auto&& d : dirs)
+		createDirectory(d);
+	std::vector<std::string> files, missing;
+	for (int i = 0; i < 20; i++)
+	{
+		files.push_back(dir + formatString("File%d.h", i));
+		missing.push_back(dir + formatString("Missing%d.h", i));
+		std::ofstream(nativePath(files.back())).close();
+	}
+
+	int found = 0;
+	struct stat st;
+	printResult("stat, existing file", timeIt(iterations, [&](int i)
+	{
+		found += stat(files[i % files.size()].c_str(), &st) == 0;
+	}));
+	printResult("isExistingFile, existing file", timeIt(iterations, [&](int i)
+	{
+		found += isExistingFile(files[i % files.size()]);
+	}));
+	printResult("isExistingFile, existing file, new generation", timeIt(iterations, [&](int i)
+	{
+		newFileSystemGeneration();
+		found += isExistingFile(files[i % files.size()]);
+	}));
+	printResult("stat, missing file", timeIt(iterations, [&](int i)
+	{
+		found += stat(missing[i % missing.size()].c_str(), &st) == 0;
+	}));
+	printResult("isExistingFile, missing file", timeIt(iterations, [&](int i)
+	{
+		found += isExistingFile(missing[i % missing.size()]);
+	}));
+	if (found != iterations * 3)
+		printf("    Wrong number of files found\n");
+
+	for (auto&& f : files)
+		deleteFile(f);
+	for (auto it = dirs.rbegin(); it != dirs.rend(); ++it)
+		removeDirectory(*it);
+	removeDirectory(root);
+}
+
+//
+// File ids: the old hash(tolower(path)) against hashPath
+//
+void benchHashPath()
+{
+	const int iterations = 1000000;
+	std::vector<std::string> paths;
+	for (int i = 0; i < 64; i++)
+	{
+		paths.push_back(formatString("C:\\Work\\SomeProject\\Source\\Module%d\\%sPrivate\\File%d.cpp",
+			i, std::string(i, 'x').c_str(), i));
+	}
+
+	int64_t sum = 0;
+	printResult("hash(tolower(path))", timeIt(iterations, [&](int i)
+	{
+		sum += hash(tolower(paths[i % paths.size()]));
+	}));
+	printResult("hashPath(path)", timeIt(iterations, [&](int i)
+	{
+		sum += hashPath(paths[i % paths.size()]);
+	}));
+
+	// So the compiler doesn't optimize the loops away
+	if (sum == 0)
+		printf("\n");
+}
+
+// What -getalt used to rank the candidates with, before PathRanker
+// From https://en.wikibooks.org/wiki/Algorithm_Implementation/Strings/Levenshtein_distance#C.2B.2B
+int levenshtein_distance(const std::string& s1, const std::string& s2)
+{
+	// To change the type this function manipulates and returns, change
+	// the return type and the types of the two variables below.
+	int s1len = static_cast<int>(s1.size());
+	int s2len = static_cast<int>(s2.size());
+
+	auto column_start = (decltype(s1len))1;
+
+	auto column = new decltype(s1len)[s1len + 1];
+	std::iota(column + column_start, column + s1len + 1, column_start);
+
+	for (auto x = column_start; x <= s2len; x++)
+	{
+		column[0] = x;
+		auto last_diagonal = x - column_start;
+		for (auto y = column_start; y <= s1len; y++)
+		{
+			auto old_diagonal = column[y];
+			auto possibilities = {column[y] + 1, column[y - 1] + 1, last_diagonal + (s1[y - 1] == s2[x - 1] ? 0 : 1)};
+			column[y] = std::min(possibilities);
+			last_diagonal = old_diagonal;
+		}
+	}
+	auto result = column[s1len];
+	delete[] column;
+	return result;
+}
+
+//
+// -getalt ranking: the old levenshtein_distance of the full paths, exactly as cmd_getalt used to do it, against
+// PathRanker.
+//
+void benchGetAlt()
+{
+	const int iterations = 100;
+	std::string ref = "C:\\Work\\SomeProject\\Source\\Engine\\Core\\Private\\Utils.cpp";
+	std::vector<std::string> candidates;
+	for (int i = 0; i < 500; i++)
+	{
+		candidates.push_back(formatString("C:\\Work\\SomeProject\\Source\\%s%d\\Module%d\\%s\\Utils.h",
+			(i % 3) ? "Engine" : "ThirdParty", i % 7, i, (i % 2) ? "Public" : "Private\\Detail"));
+	}
+
+	size_t sum = 0;
+	printResult("levenshtein_distance(full paths) + sort", timeIt(iterations, [&](int)
+	{
+		std::vector<std::pair<int, std::string>> dists;
+		for (auto&& c : candidates)
+		{
+			std::string alt(c);
+			dists.emplace_back(levenshtein_distance(ref, alt), std::move(alt));
+		}
+		std::sort(
+			dists.begin(), dists.end(),
+			[](auto&& a, auto && b)
+			{
+				return a.first < b.first;
+			});
+		sum += dists[0].first;
+	}));
+	printResult("PathRanker", timeIt(iterations, [&](int)
+	{
+		PathRanker ranker(ref);
+		for (auto&& c : candidates)
+			ranker.add(c);
+		sum += ranker.getRanked().size();
+	}));
+
+	if (sum == 0)
+		printf("\n");
+}
+
+//
+// -find over 200k paths: building the trigram index, and queries
+//
+void benchFind()
+{
+	const char* dirs[] = { "Source", "Include", "Private", "Public", "Detail", "Tests", "ThirdParty", "Runtime" };
+	const char* exts[] = { "cpp", "h", "inl", "hpp" };
+	FindIndexWriter writer;
+	for (int i = 0; i < 200000; i++)
+	{
+		writer.add(formatString("C:\\Work\\Game\\%s\\Module%d\\%s\\%sFile%d.%s",
+			dirs[i % 8], i / 500, dirs[(i / 7) % 8], (i % 3) ? "Render" : "Physics", i, exts[i % 4]),
+			formatString("Module%d", i / 500));
+	}
+
+	std::string data;
+	printResult("FindIndexWriter::serialize (200k files)", timeIt(1, [&](int)
+	{
+		data = writer.serialize();
+	}));
+	printf("    Index size: %d bytes\n", static_cast<int>(data.size()));
+
+	FindIndex index;
+	CZ_CHECK(index.open("bench", reinterpret_cast<const uint8_t*>(data.data()), data.size()));
+	size_t sum = 0;
+	for (auto pattern : { "PhysicsFile12345", "physcsfile12345", "module12 render", "fi", "private file999" })
+	{
+		FindQuery query;
+		query.pattern = pattern;
+		printResult(formatString("find '%s'", pattern), timeIt(20, [&](int)
+		{
+			sum += index.find(query).size();
+		}));
+	}
+
+	if (sum == 0)
+		printf("\n");
+}
+
+//
+// Include scanning of a generated tree of 500 source files and 3000 headers: reading the files with io_uring
+// against the thread pool, and the build graph scan with both.
+// The files are in the OS cache after being generated, so this doesn't show what happens with a cold cache, where
+// having lots of reads in flight matters the most.
+//
+void benchScan()
+{
+	const int numSources = 500;
+	const int numHeaders = 3000;
+	std::string dir = getCWD() + "vimvs-bench-scan";
+	ensureTrailingSlash(dir);
+	createDirectory(dir);
+
+	// Mostly code, with the includes at the top, as in real files
+	std::string body;
+	for (int i = 0; i < 300; i++)
+		body += formatString("	int someFunction%d(int a, int b) { return a * %d + b; } // Some comment\n", i, i);
+	std::vector<std::string> files;
+	auto writeFile = [&](const std::string& name, int numIncludes, int seed)
+	{
+		std::ofstream out(nativePath(dir + name), std::ofstream::out | std::ofstream::binary);
+		out << "#pragma once\n";
+		for (int i = 0; i < numIncludes; i++)
+			out << formatString("#include \"Header%d.h\"\n", (seed * 7 + i * 13) % numHeaders);
+		out << body;
+		files.push_back(dir + name);
+	};
+	for (int i = 0; i < numHeaders; i++)
+		writeFile(formatString("Header%d.h", i), 5, i);
+	for (int i = 0; i < numSources; i++)
+		writeFile(formatString("Source%d.cpp", i), 20, i);
+
+	std::atomic<size_t> bytes(0);
+	size_t sum = 0;
+	for (bool useIoUring : { true, false })
+	{
+		FileReader reader(useIoUring);
+		if (useIoUring && !reader.isUsingIoUring())
+			continue;
+		printResult(useIoUring ? "FileReader (io_uring)" : "FileReader (thread pool)", timeIt(10, [&](int)
+		{
+			for (auto&& f : files)
+			{
+				reader.read(f, [&bytes](bool, std::string data)
+				{
+					bytes += data.size();
+				});
+			}
+			reader.wait();
+		}));
+	}
+
+	for (bool async : { false, true })
+	{
+		printResult(async ? "Graph::processIncludes (async)" : "Graph::processIncludes (sync)", timeIt(5, [&](int)
+		{
+			buildgraph::Graph graph;
+			auto defines = graph.internDefines({});
+			for (int i = 0; i < numSources; i++)
+			{
+				auto includeDirs = std::make_shared<buildgraph::IncludeDirs>();
+				includeDirs->pushParent(dir);
+				graph.processIncludes(buildgraph::Node::Type::Source, files[numHeaders + i], includeDirs, defines, async);
+			}
+			graph.finishWork();
+			graph.iterate([&sum](auto&&) { sum++; });
+		}));
+	}
+
+	for (auto&& f : files)
+		deleteFile(f);
+	removeDirectory(dir);
+
+	if (sum == 0 || bytes == 0)
+		printf("\n");
+}
+
+//
+// Parsing the output of a parallel msbuild run (16 nodes) when updating the database: The thread calling inject only
+// splits the lines by node, and the nodes' lines are parsed by the worker threads. Also the same projects built
+// without /m, one after the other, where each project is a new node.
+// Also checks the database ends up the same every time, since the results are applied in the order received.
+//
+void benchParse()
+{
+	const int numNodes = 16;
+	const int projectsPerNode = 10;
+	const int compilesPerProject = 3;
+	const int filesPerCompile = 10;
+	const int includesPerFile = 50;
+
+	// Each node's output, which is then interleaved line by line
+	std::vector<std::vector<std::string>> nodes(numNodes);
+	for (int n = 0; n < numNodes; n++)
+	{
+		auto& out = nodes[n];
+		for (int p = 0; p < projectsPerNode; p++)
+		{
+			std::string prj = formatString("Project%d_%d", n, p);
+			std::string prjFile = formatString("C:\\Work\\Game\\%s\\%s.vcxproj", prj.c_str(), prj.c_str());
+			out.push_back(formatString(
+				"rem vim-vs-begin: ProjectName=\"%s\", ProjectPath=\"%s\", ProjectConfiguration=\"Debug\", "
+				"ProjectPlatform=\"x64\", AllProjects=\"%s\", ExecutablePath=\"\", IncludePath=C:\\VS\\include;C:\\SDK\\include",
+				prj.c_str(), prjFile.c_str(), prjFile.c_str()));
+			out.push_back("ClCompile:");
+			for (int c = 0; c < compilesPerProject; c++)
+			{
+				std::string cl = "C:\\VS\\bin\\CL.exe /c /I\"..\\Include\" /IPublic /Zi /nologo /W3 /Od /D \"WIN32\" "
+					"/D \"_DEBUG\" /D \"SOME_DEFINE=1\" /EHsc /MDd /showIncludes";
+				for (int f = 0; f < filesPerCompile; f++)
+					cl += formatString(" Source\\File%d_%d.cpp", c, f);
+				out.push_back(cl);
+				for (int f = 0; f < filesPerCompile; f++)
+				{
+					out.push_back(formatString("File%d_%d.cpp", c, f));
+					for (int i = 0; i < includesPerFile; i++)
+					{
+						out.push_back(formatString("Note: including file:   C:\\Work\\Game\\Include\\Lib%d\\Header%d.h",
+							i % 10, (f * 7 + i) % 300));
+					}
+				}
+			}
+			out.push_back(formatString("rem vim-vs-end: ProjectName=\"%s\"", prj.c_str()));
+		}
+	}
+
+	// Without /m, msbuild goes through the projects one at a time, without the "N>" prefixes
+	std::string sequential = "Project \"C:\\Work\\Game\\Game.sln\" on node 1 (default targets).\n";
+	for (auto&& out : nodes)
+	{
+		for (auto&& l : out)
+			sequential += l + "\n";
+	}
+
+	std::string data = "1>Project \"C:\\Work\\Game\\Game.sln\" on node 1 (default targets).\n";
+	int numLines = 1;
+	for (size_t i = 0; ; i++)
+	{
+		bool any = false;
+		for (int n = 0; n < numNodes; n++)
+		{
+			if (i < nodes[n].size())
+			{
+				data += formatString("%d>", n + 1) + nodes[n][i] + "\n";
+				numLines++;
+				any = true;
+			}
+		}
+		if (!any)
+			break;
+	}
+
+	int numFiles = 0;
+	bool same = true;
+	// A header gets the settings of the first project that includes it, so each way of building the projects is only
+	// compared with itself
+	auto run = [&](const std::string& output, int64_t& first)
+	{
+		Database db;
+		CZ_CHECK(db.open("vimvs-bench-parse.db", true));
+		db.setConfiguration("Debug|x64");
+		Parser parser(db, true, true, false);
+		parser.setProgressMode(0);
+		// In pieces, as read from msbuild's output
+		for (size_t pos = 0; pos < output.size(); pos += 64 * 1024)
+			parser.inject(output.substr(pos, 64 * 1024));
+		parser.finishWork();
+
+		int64_t h = 0;
+		numFiles = 0;
+		db.iterateFiles([&](const SourceFileView& f)
+		{
+			numFiles++;
+			h = hash(std::to_string(h) + std::string(f.fullpath) + std::string(f.prjName) + std::string(f.defines));
+		});
+		for (auto&& prj : parser.getProjects())
+			h = hash(std::to_string(h) + std::to_string(prj.second.clHash));
+		if (first == 0)
+			first = h;
+		same = same && h == first;
+	};
+
+	int64_t firstParallel = 0;
+	int64_t firstSequential = 0;
+	printResult(formatString("Parser::inject (%d lines, /m)", numLines),
+		timeIt(3, [&](int) { run(data, firstParallel); }));
+	printResult(formatString("Parser::inject (%d lines, no /m)", numLines),
+		timeIt(3, [&](int) { run(sequential, firstSequential); }));
+	printf("    %d files in the database. Same results every time: %s\n", numFiles, same ? "yes" : "no");
+}
+
+struct Benchmark
+{
+	const char* name;
+	void(*func)();
+};
+
+const Benchmark gBenchmarks[] =
+{
+	{ "sqstmt", &benchSqStmt },
+	{ "logging", &benchLogging },
+	{ "trace", &benchTrace },
+	{ "paths", &benchPaths },
+	{ "stat", &benchStat },
+	{ "hashpath", &benchHashPath },
+	{ "getalt", &benchGetAlt },
+	{ "find", &benchFind },
+	{ "scan", &benchScan },
+	{ "parse", &benchParse },
+};
+
+} // anonymous namespace
+
+bool runBenchmarks(const std::string& filter)
+{
+	bool found = false;
+	for (auto&& b : gBenchmarks)
+	{
+		if (filter.size() && std::string(b.name).find(filter) == std::string::npos)
+			continue;
+		found = true;
+		printf("%s:\n", b.name);
+		b.func();
+	}
+
+	if (!found)
+	{
+		fprintf(stderr, "No benchmark matches '%s'\n", filter.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+}
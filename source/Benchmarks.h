@@ -0,0 +1,12 @@
+#pragma once
+
+#include <string>
+
+namespace cz
+{
+
+//! Runs the microbenchmarks whose name contains 'filter' (or all of them if empty), and prints the results.
+// This is only meant for development (see the hidden -bench command)
+bool runBenchmarks(const std::string& filter);
+
+}
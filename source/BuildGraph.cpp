@@ -1,238 +1,331 @@
-#include "vimvsPCH.h"
-#include "BuildGraph.h"
-#include "Utils.h"
-
-namespace cz
-{
-
-CZ_DECLARE_LOG_CATEGORY(logBuildGraph, Log, Log)
-CZ_DEFINE_LOG_CATEGORY(logBuildGraph)
-
-namespace buildgraph
-{
-
-//
-//- Relative paths passed to CL.exe are relative to the project's file path
-//- CL.exe include search rules (https://msdn.microsoft.com/en-us/library/36k2cdd4.aspx)
-//Quoted form:
-//The preprocessor searches for include files in this order:
-//	1) In the same directory as the file that contains the #include statement.
-//	2) In the directories of the currently opened include files, in the reverse order in which they were opened. The search begins in the directory of the parent include file and continues upward through the directories of any grandparent include files.
-//	3) Along the path that's specified by each /I compiler option.
-//	4) Along the paths that are specified by the INCLUDE environment variable.
-//
-//Angle-bracket form:
-//The preprocessor searches for include files in this order:
-//	1) Along the path that's specified by each /I compiler option.
-//	2) When compiling occurs on the command line, along the paths that are specified by the INCLUDE environment variable.
-std::string IncludeDirs::findHeader(const std::string& inc, bool quoted)
-{
-	if (quoted)
-	{
-		for (auto i = m_parents.rbegin(); i != m_parents.rend(); ++i )
-		{ 
-			auto f = *i + inc;
-			CZ_CHECK(fullPath(f, f, ""));
-			if (isExistingFile(f))
-			{
-				return f;
-			}
-		} 
-	}
-
-	for(auto&& i : m_userIncs)
-	{
-		auto f = i + inc;
-		CZ_CHECK(fullPath(f, f, ""));
-		if (isExistingFile(f))
-		{
-			return f;
-		}
-	}
-
-	for(auto&& i : m_systemIncs)
-	{
-		auto f = i + inc;
-		CZ_CHECK(fullPath(f, f, ""));
-		if (isExistingFile(f))
-		{
-			return f;
-		}
-	}
-
-	return "";
-}
-
-std::shared_ptr<Node> Graph::getNode(Node::Type type, const std::string& name, bool create)
-{
-	int64_t key = hash(tolower(name));
-	return m_data([&](Data& data) -> std::shared_ptr<Node>
-	{
-		auto it = data.nodes.find(key);
-		if (it!=data.nodes.end())
-			return it->second;
-		if (!create)
-			return nullptr;
-		auto node = std::make_shared<Node>(type, name, key);
-		data.nodes.emplace(key, node);
-		return node;
-	});
-}
-
-void Graph::processIncludes(Node::Type type, const std::string& filename, const std::shared_ptr<IncludeDirs>& includeDirs,
-	std::vector<std::string> defines, bool async)
-{
-	if (!isExistingFile(filename))
-	{
-		CZ_LOG(logBuildGraph, Error, "File '%s' not found", filename.c_str());
-		return;
-	}
-
-	auto node = getNode(type, filename, true);
-	if (!prepareProcess(node, includeDirs, defines, node))
-		return;
-	processIncludes(node, includeDirs, std::move(defines), node, async);
-}
-
-// If this file was already process with the specified include directories, then any #includes in the file
-// will lead to the same headers, therefore nothing changing. So we can skip this
-bool Graph::prepareProcess(const std::shared_ptr<Node>& node, const std::shared_ptr<IncludeDirs>& includeDirs,
-	const std::vector<std::string>& defines,
-	const std::shared_ptr<Node>& translationUnit)
-{
-	bool ok = true;
-	if (node!=translationUnit)
-	{
-		translationUnit->m_data([&](Node::Data& data)
-		{
-			if (data.deps.find(node->getHash()) == data.deps.end())
-			{
-				data.deps.emplace(node->getHash(), node);
-				ok = true;
-			}
-			else
-			{
-				ok = false;
-			}
-		});
-	}
-
-	if (!ok)
-		return false;
-
-	node->m_data([&](Node::Data& data)
-	{
-		if (data.includeDirs.find(includeDirs->getHash()) == data.includeDirs.end())
-		{
-			data.defines = defines;
-			data.includeDirs.emplace(includeDirs->getHash(), includeDirs);
-		}
-		else
-		{
-			ok = false;
-		}
-	});
-
-	return ok;
-}
-
-void Graph::processIncludes(const std::shared_ptr<Node>& node, const std::shared_ptr<IncludeDirs>& includeDirs,
-	std::vector<std::string> defines,
-	const std::shared_ptr<Node>& translationUnit,
-	bool async)
-{
-	std::ifstream file(widen(node->m_name));
-	if (!file.is_open())
-	{
-		auto msg = formatString("Could not open file '%s'", node->m_name.c_str());
-		fprintf(stderr, "%s\n", msg);
-		CZ_LOG(logBuildGraph, Fatal, msg);
-		return;
-	}
-
-	//                                                                    1     2    3
-	static std::regex rgx("^[[:space:]]*#[[:space:]]*include[[:space:]]*(\"|<)(.+)(\"|>)", std::regex::optimize);
-	std::string line;
-	std::vector<std::future<void>> work;
-	std::string folder = splitFolderAndFile(node->m_name).first;
-	while(std::getline(file, line))
-	{
-		std::smatch matches;
-		if (!std::regex_match(line,matches, rgx))
-			continue;
-
-		auto quoted = matches[1].str()=="\"";
-		auto inc = matches[2].str();
-		auto otherName = includeDirs->findHeader(inc, quoted);
-		if (otherName=="") 
-		{
-			// header file not found
-			CZ_LOG(logBuildGraph, Warning, "Failed to find header '%s' in file '%s'", inc.c_str(), node->m_name.c_str());
-			continue;
-		}
-		//printf("%0*d%s\n", includeDirs->getNumParents(), 0, otherName.c_str());
-		auto otherFolder = splitFolderAndFile(otherName).first;
-		std::shared_ptr<IncludeDirs> otherIncludeDirs;
-		if (otherFolder==folder)
-		{
-			otherIncludeDirs = includeDirs;
-		}
-		else
-		{
-			otherIncludeDirs = std::make_shared<IncludeDirs>();
-			*otherIncludeDirs = *includeDirs;
-			otherIncludeDirs->pushParent(otherFolder);
-		}
-
-		auto otherNode = getNode(Node::Type::Header, otherName, true);
-
-		if (node != translationUnit)
-		{
-			node->m_data([&otherNode](Node::Data& data)
-			{
-				if (data.deps.find(otherNode->m_hash) == data.deps.end())
-					data.deps.emplace(otherNode->m_hash, otherNode);
-			});
-		}
-
-		if (prepareProcess(otherNode, otherIncludeDirs, defines, translationUnit))
-		{
-			auto ft = std::async(
-				async ? std::launch::async : std::launch::deferred,
-				[this, otherNode, otherIncludeDirs, defines, translationUnit, async]()
-			{
-				processIncludes(otherNode, otherIncludeDirs, defines, translationUnit, async);
-			});
-			work.push_back(std::move(ft));
-		}
-	}
-
-	//printf("Finished: %s\n", node->getName().c_str());
-	m_data([&](Data& data)
-	{
-		moveAppend(work, data.work);
-	});
-}
-
-void Graph::finishWork()
-{
-	while (true)
-	{
-		std::vector<std::future<void>> work;
-		m_data([&](Data& data)
-		{
-			work = std::move(data.work);
-			data.work.clear();
-		});
-
-		if (work.size() == 0)
-			return;
-		// This blocks until all futures complete
-		for (auto&& w : work)
-			w.get();
-	}
-}
-
-} // namespace buildgraph
-} // namespace cz
-
+#include "vimvsPCH.h"
+#include "BuildGraph.h"
+#include "Utils.h"
+#include "Trace.h"
+
+namespace cz
+{
+
+CZ_DECLARE_LOG_CATEGORY(logBuildGraph, Log, Log)
+CZ_DEFINE_LOG_CATEGORY(logBuildGraph)
+
+namespace buildgraph
+{
+
+//
+//- Relative paths passed to CL.exe are relative to the project's file path
+//- CL.exe include search rules (https://msdn.microsoft.com/en-us/library/36k2cdd4.aspx)
+//Quoted form:
+//The preprocessor searches for include files in this order:
+//	1) In the same directory as the file that contains the #include statement.
+//	2) In the directories of the currently opened include files, in the reverse order in which they were opened. The search begins in the directory of the parent include file and continues upward through the directories of any grandparent include files.
+//	3) Along the path that's specified by each /I compiler option.
+//	4) Along the paths that are specified by the INCLUDE environment variable.
+//
+//Angle-bracket form:
+//The preprocessor searches for include files in this order:
+//	1) Along the path that's specified by each /I compiler option.
+//	2) When compiling occurs on the command line, along the paths that are specified by the INCLUDE environment variable.
+PathId IncludeDirs::findHeader(const std::string& inc, bool quoted)
+{
+	CZ_TRACE_SCOPE("buildgraph", "findHeader");
+	auto&& paths = getPathTable();
+	// Reused by all the probes, so there are no allocations once it's big enough
+	thread_local std::string f;
+
+	// Paths not found are interned too, so the next translation unit looking for the same header doesn't hit the
+	// filesystem again.
+	auto probe = [&](const std::string& dir) -> PathId
+	{
+		if (!canonicalizePath(f, inc, dir))
+			return kInvalidPathId;
+		auto id = paths.intern(f);
+		return paths.isExistingFile(id) ? id : kInvalidPathId;
+	};
+
+	if (quoted)
+	{
+		for (auto i = m_parents.rbegin(); i != m_parents.rend(); ++i )
+		{ 
+			if (auto id = probe(*i))
+				return id;
+		} 
+	}
+
+	for(auto&& i : m_userIncs)
+	{
+		if (auto id = probe(i))
+			return id;
+	}
+
+	for(auto&& i : m_systemIncs)
+	{
+		if (auto id = probe(i))
+			return id;
+	}
+
+	return kInvalidPathId;
+}
+
+Defines DefinesTable::intern(std::vector<std::string> defines)
+{
+	std::string s;
+	for (auto&& d : defines)
+	{
+		s += d;
+		s += '\0';
+	}
+	int64_t key = hash(s);
+
+	return m_data([&](std::unordered_map<int64_t, Defines>& data) -> Defines
+	{
+		auto it = data.find(key);
+		if (it == data.end())
+		{
+			auto res = std::make_shared<const std::vector<std::string>>(std::move(defines));
+			data.emplace(key, res);
+			return res;
+		}
+		else if (*it->second == defines)
+		{
+			return it->second;
+		}
+		else
+		{
+			// Hash collision. Extremely unlikely, so not worth handling other than not sharing this one
+			return std::make_shared<const std::vector<std::string>>(std::move(defines));
+		}
+	});
+}
+
+std::shared_ptr<Node> Graph::getNode(Node::Type type, const std::string& name, bool create)
+{
+	auto id = create ? getPathTable().intern(name) : getPathTable().find(name);
+	if (id == kInvalidPathId)
+		return nullptr;
+	return getNode(type, id, create);
+}
+
+std::shared_ptr<Node> Graph::getNode(Node::Type type, PathId id, bool create)
+{
+	return m_data([&](Data& data) -> std::shared_ptr<Node>
+	{
+		auto it = data.nodes.find(id);
+		if (it!=data.nodes.end())
+			return it->second;
+		if (!create)
+			return nullptr;
+		auto node = std::make_shared<Node>(type, id);
+		data.nodes.emplace(id, node);
+		return node;
+	});
+}
+
+void Graph::processIncludes(Node::Type type, const std::string& filename, const std::shared_ptr<IncludeDirs>& includeDirs,
+	const Defines& defines, bool async)
+{
+	auto id = getPathTable().intern(filename);
+	if (!getPathTable().isExistingFile(id))
+	{
+		CZ_LOG(logBuildGraph, Error, "File '%s' not found", filename.c_str());
+		return;
+	}
+
+	auto node = getNode(type, id, true);
+	if (!prepareProcess(node, includeDirs, defines, node))
+		return;
+	processIncludes(node, includeDirs, defines, node, async);
+}
+
+// If this file was already process with the specified include directories, then any #includes in the file
+// will lead to the same headers, therefore nothing changing. So we can skip this
+bool Graph::prepareProcess(const std::shared_ptr<Node>& node, const std::shared_ptr<IncludeDirs>& includeDirs,
+	const Defines& defines,
+	const std::shared_ptr<Node>& translationUnit)
+{
+	bool ok = true;
+	if (node!=translationUnit)
+	{
+		translationUnit->m_data([&](Node::Data& data)
+		{
+			if (data.deps.find(node->getId()) == data.deps.end())
+			{
+				data.deps.emplace(node->getId(), node);
+				ok = true;
+			}
+			else
+			{
+				ok = false;
+			}
+		});
+	}
+
+	if (!ok)
+		return false;
+
+	node->m_data([&](Node::Data& data)
+	{
+		if (data.includeDirs.find(includeDirs->getHash()) == data.includeDirs.end())
+		{
+			data.defines = defines;
+			data.includeDirs.emplace(includeDirs->getHash(), includeDirs);
+		}
+		else
+		{
+			ok = false;
+		}
+	});
+
+	return ok;
+}
+
+FileReader& Graph::getReader()
+{
+	std::call_once(m_readerCreated, [this]
+	{
+		m_reader = std::make_unique<FileReader>();
+	});
+	return *m_reader;
+}
+
+void Graph::processIncludes(const std::shared_ptr<Node>& node, const std::shared_ptr<IncludeDirs>& includeDirs,
+	const Defines& defines,
+	const std::shared_ptr<Node>& translationUnit,
+	bool async)
+{
+	auto scan = [this, node, includeDirs, defines, translationUnit, async](bool ok, std::string content)
+	{
+		if (!ok)
+		{
+			auto msg = formatString("Could not open file '%s'", node->m_name.c_str());
+			fprintf(stderr, "%s\n", msg);
+			CZ_LOG(logBuildGraph, Fatal, msg);
+			return;
+		}
+		scanIncludes(node, content, includeDirs, defines, translationUnit, async);
+	};
+
+	if (async)
+	{
+		// The reader submits the reads of all the headers found so far at once, and scans them as they complete
+		getReader().read(node->m_name, std::move(scan));
+	}
+	else
+	{
+		std::string content;
+		bool ok = readFile(node->m_name, content);
+		scan(ok, std::move(content));
+	}
+}
+
+void Graph::scanIncludes(const std::shared_ptr<Node>& node, const std::string& content,
+	const std::shared_ptr<IncludeDirs>& includeDirs,
+	const Defines& defines,
+	const std::shared_ptr<Node>& translationUnit,
+	bool async)
+{
+	CZ_TRACE_SCOPE_DETAIL("buildgraph", "scanFile", node->m_name);
+
+	//                                                                    1     2    3
+	static std::regex rgx("^[[:space:]]*#[[:space:]]*include[[:space:]]*(\"|<)(.+)(\"|>)", std::regex::optimize);
+	std::string folder = splitFolderAndFile(node->m_name).first;
+	size_t pos = 0;
+	while (pos < content.size())
+	{
+		auto end = content.find('\n', pos);
+		if (end == std::string::npos)
+			end = content.size();
+		std::string_view line(content.data() + pos, end - pos);
+		pos = end + 1;
+		// The file is read as it is, so it might have Windows line endings
+		if (line.size() && line.back() == '\r')
+			line.remove_suffix(1);
+
+		// Only a few lines are preprocessor directives, so skip all the others before using the regex
+		auto first = line.find_first_not_of(" \t");
+		if (first == std::string_view::npos || line[first] != '#')
+			continue;
+
+		std::cmatch matches;
+		if (!std::regex_match(line.data(), line.data() + line.size(), matches, rgx))
+			continue;
+
+		auto quoted = matches[1].str()=="\"";
+		auto inc = matches[2].str();
+		auto otherId = includeDirs->findHeader(inc, quoted);
+		if (otherId == kInvalidPathId) 
+		{
+			// header file not found
+			CZ_LOG(logBuildGraph, Warning, "Failed to find header '%s' in file '%s'", inc.c_str(), node->m_name.c_str());
+			continue;
+		}
+		//printf("%0*d%s\n", includeDirs->getNumParents(), 0, otherName.c_str());
+		auto&& otherName = getPathTable().get(otherId);
+		auto otherFolder = splitFolderAndFile(otherName).first;
+		std::shared_ptr<IncludeDirs> otherIncludeDirs;
+		if (otherFolder==folder)
+		{
+			otherIncludeDirs = includeDirs;
+		}
+		else
+		{
+			otherIncludeDirs = std::make_shared<IncludeDirs>();
+			*otherIncludeDirs = *includeDirs;
+			otherIncludeDirs->pushParent(otherFolder);
+		}
+
+		auto otherNode = getNode(Node::Type::Header, otherId, true);
+
+		if (node != translationUnit)
+		{
+			node->m_data([&otherNode](Node::Data& data)
+			{
+				if (data.deps.find(otherNode->m_id) == data.deps.end())
+					data.deps.emplace(otherNode->m_id, otherNode);
+			});
+		}
+
+		if (prepareProcess(otherNode, otherIncludeDirs, defines, translationUnit))
+			processIncludes(otherNode, otherIncludeDirs, defines, translationUnit, async);
+	}
+}
+
+void Graph::finishWork()
+{
+	// This also waits for the reads started by the scans themselves
+	if (m_reader)
+		m_reader->wait();
+}
+
+std::vector<std::shared_ptr<Node>> Graph::getIncludeClosure(const std::shared_ptr<Node>& node)
+{
+	// A header already processed by another translation unit with the same include directories is not traversed
+	// again, so a translation unit's own dependencies are not necessarily the full closure. We need to walk the
+	// dependencies of each header too.
+	std::vector<std::shared_ptr<Node>> res;
+	std::unordered_set<PathId> visited;
+	std::vector<std::shared_ptr<Node>> pending;
+	pending.push_back(node);
+	visited.insert(node->getId());
+	while (pending.size())
+	{
+		auto n = std::move(pending.back());
+		pending.pop_back();
+		n->m_data([&](Node::Data& data)
+		{
+			for (auto&& d : data.deps)
+			{
+				if (visited.insert(d.first).second)
+				{
+					res.push_back(d.second);
+					pending.push_back(d.second);
+				}
+			}
+		});
+	}
+	return res;
+}
+
+} // namespace buildgraph
+} // namespace cz
+
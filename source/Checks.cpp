@@ -0,0 +1,659 @@
+#include "vimvsPCH.h"
+#include "Checks.h"
+#include "Database.h"
+#include "FileFinder.h"
+#include "MsBuildEvaluator.h"
+#include "Parser.h"
+#include "PathRank.h"
+#include "SqLiteWrapper.h"
+#include "ScopeGuard.h"
+#include "ToolChannel.h"
+
+//
+// Self checks of behaviour that is hard to see from the outside, and easy to break. Like the benchmarks, they are
+// run with a hidden command (-check), and they don't need a solution or a .vimvs.ini.
+//
+
+namespace cz
+{
+
+namespace
+{
+
+//! Prints the failure, so a check can report everything that is wrong instead of stopping at the first problem
+bool expect(bool ok, const char* what)
+{
+	if (!ok)
+		printf("    FAILED: %s\n", what);
+	return ok;
+}
+
+#define CZ_EXPECT(expr) ok &= expect((expr), #expr)
+
+//
+// -builddb -incremental only processes the projects that changed. A header several projects use has a single row,
+// so processing one of them must not remove the header while the others still use it.
+//
+bool checkIncremental()
+{
+	bool ok = true;
+	Database db;
+	CZ_CHECK(db.open("vimvs-check-incremental.db", true));
+	db.setConfiguration("Debug|x64");
+
+	auto exists = [&db](const char* fullpath)
+	{
+		return db.getFile(fullpath).id != 0;
+	};
+
+	// Full build: A and B both include shared.h, and only A includes onlyA.h
+	db.beginGeneration();
+	db.addFile("/prj/a/a.cpp", "A", "/prj/a/A.vcxproj", "-DA|", "", "A", true);
+	db.addFile("/prj/shared.h", "", "", "-DA|", "", "A", true);
+	db.addFile("/prj/a/onlyA.h", "", "", "-DA|", "", "A", true);
+	db.addFile("/prj/b/b.cpp", "B", "/prj/b/B.vcxproj", "-DB|", "", "B", true);
+	db.addFile("/prj/shared.h", "", "", "-DB|", "", "B", true);
+	db.removeStaleFiles("A");
+	db.removeStaleFiles("B");
+	CZ_EXPECT(exists("/prj/shared.h") && exists("/prj/a/onlyA.h"));
+
+	// Only A is processed again, and it doesn't include any header anymore
+	db.beginGeneration();
+	db.addFile("/prj/a/a.cpp", "A", "/prj/a/A.vcxproj", "-DA|", "", "A", true);
+	db.removeStaleFiles("A");
+	CZ_EXPECT(exists("/prj/a/a.cpp"));
+	CZ_EXPECT(!exists("/prj/a/onlyA.h"));
+	CZ_EXPECT(exists("/prj/shared.h"));
+	CZ_EXPECT(db.getFile("/prj/shared.h").defines == "-DA|");
+
+	// Once B is gone too, nothing uses the header
+	db.removeProject("B");
+	CZ_EXPECT(!exists("/prj/b/b.cpp"));
+	CZ_EXPECT(!exists("/prj/shared.h"));
+	CZ_EXPECT(exists("/prj/a/a.cpp"));
+
+	return ok;
+}
+
+//
+// -inmemorydb writes the database with the backup API. If the file is in use, the backup fails, and that needs to be
+// reported, or the build is silently lost. Having the file open somewhere else (e.g: the editor's -server) is not a
+// problem though, even on Windows, where it can't be replaced.
+//
+bool checkBackup()
+{
+	bool ok = true;
+	const char* fname = "vimvs-check-backup.db";
+	deleteFile(fname);
+	SCOPE_EXIT{ deleteFile(fname); };
+
+	SqDatabase src;
+	CZ_CHECK(src.open(":memory:", true));
+	CZ_CHECK(sqlite3_exec(src, "CREATE TABLE t(a INTEGER); INSERT INTO t VALUES(1);", 0, 0, 0) == SQLITE_OK);
+
+	SqDatabase dst;
+	CZ_CHECK(dst.open(fname, true));
+	CZ_EXPECT(dst.backupFrom(src));
+
+	// Someone else writing to the file
+	SqDatabase other;
+	CZ_CHECK(other.open(fname));
+	CZ_CHECK(sqlite3_exec(other, "BEGIN EXCLUSIVE", 0, 0, 0) == SQLITE_OK);
+	CZ_EXPECT(!dst.backupFrom(src));
+	CZ_CHECK(sqlite3_exec(other, "ROLLBACK", 0, 0, 0) == SQLITE_OK);
+	CZ_EXPECT(dst.backupFrom(src));
+
+	const char* dbName = "vimvs-check-persist.db";
+	deleteFile(dbName);
+	SCOPE_EXIT{ deleteFile(dbName); };
+	{
+		Database db;
+		CZ_CHECK(db.open(dbName));
+		db.setConfiguration("Debug|x64");
+		db.beginGeneration();
+		db.addFile("/prj/a.cpp", "A", "/prj/A.vcxproj", "", "", "A", true);
+	}
+
+	SqDatabase reader;
+	CZ_CHECK(reader.open(dbName));
+	{
+		Database db;
+		CZ_CHECK(db.open(dbName, true));
+		db.setConfiguration("Debug|x64");
+		db.beginGeneration();
+		db.addFile("/prj/b.cpp", "B", "/prj/B.vcxproj", "", "", "B", true);
+		CZ_EXPECT(db.persist());
+	}
+	Database db;
+	CZ_CHECK(db.open(dbName));
+	db.setConfiguration("Debug|x64");
+	CZ_EXPECT(db.getFile("/prj/a.cpp").id != 0);
+	CZ_EXPECT(db.getFile("/prj/b.cpp").id != 0);
+
+	return ok;
+}
+
+//
+// The native evaluator (-builddb -native) against the fixture solution in checks/evaluator, which has conditions,
+// imports (with a wildcard), item definition metadata, wildcard items and a Choose. What each project and source file
+// evaluate to, for each solution configuration, needs to match checks/evaluator/expected.txt.
+// The fixture doesn't use the Visual C++ props, so the system includes (which come from them) are not compared.
+// It's found relative to the current directory, so this needs to run from the repository's root (as ctest does).
+//
+
+//! Paths relative to 'root', with '/' as separator, so the dump doesn't depend on where the repository is
+std::string relativePath(std::string path, const std::string& root)
+{
+	std::replace(path.begin(), path.end(), '\\', '/');
+	beginsWith(path, root, &path);
+	return path;
+}
+
+std::string dumpEvaluation(
+	const std::string& slnConfiguration, const std::vector<EvaluatedProject>& projects, const std::string& root)
+{
+	std::string res = slnConfiguration + "\n";
+	for (auto&& prj : projects)
+	{
+		res += formatString("  %s (%s|%s)%s\n", prj.name.c_str(), prj.configuration.c_str(), prj.platform.c_str(),
+			prj.ok ? "" : " FAILED");
+		for (auto&& f : prj.files)
+			res += "    import " + relativePath(f, root) + "\n";
+
+		std::vector<std::string> lines;
+		for (auto&& src : prj.sources)
+		{
+			std::string line = "    " + relativePath(src.first, root) + ":";
+			for (auto&& d : src.second->defines)
+				line += " -D" + d;
+			for (auto&& i : src.second->userIncs)
+				line += " -I" + relativePath(i, root);
+			lines.push_back(std::move(line));
+		}
+		// Wildcards don't give the files in any particular order
+		std::sort(lines.begin(), lines.end());
+		for (auto&& l : lines)
+			res += l + "\n";
+	}
+	return res;
+}
+
+bool checkEvaluator()
+{
+	bool ok = true;
+	auto root = getCWD();
+	ensureTrailingSlash(root);
+	std::replace(root.begin(), root.end(), '\\', '/');
+	root += "checks/evaluator/";
+
+	std::string actual;
+	for (auto&& cfg : { "Debug", "Release" })
+	{
+		std::vector<EvaluatedProject> projects;
+		CZ_EXPECT(evaluateSolution(root + "Fixture.sln", cfg, "x64", {}, {}, projects));
+		std::sort(projects.begin(), projects.end(),
+			[](const EvaluatedProject& a, const EvaluatedProject& b) { return a.name < b.name; });
+		actual += dumpEvaluation(std::string(cfg) + "|x64", projects, root);
+	}
+
+	std::ifstream file(nativePath(root + "expected.txt"), std::ifstream::in | std::ifstream::binary);
+	std::stringstream ss;
+	ss << file.rdbuf();
+	auto expected = ss.str();
+	// The file might have Windows line endings, depending on how the repository was checked out
+	expected.erase(std::remove(expected.begin(), expected.end(), '\r'), expected.end());
+
+	if (!expect(actual == expected, "evaluation matches checks/evaluator/expected.txt"))
+	{
+		printf("    Actual:\n%s", actual.c_str());
+		ok = false;
+	}
+	return ok;
+}
+
+//
+// File lookups on Linux use cached directory descriptors (see PlatformLinux.cpp), which need to follow a directory
+// being renamed, and another one created with the same path, from the next generation (see newFileSystemGeneration).
+// Files added to a cached directory are seen right away.
+//
+bool checkRenamedDirectory()
+{
+	bool ok = true;
+	std::string dir = getCWD();
+	ensureTrailingSlash(dir);
+	dir += "vimvs-check-dir";
+	auto moved = dir + "-moved";
+	auto cleanup = [&]()
+	{
+		deleteFile(dir + "/a.h");
+		deleteFile(dir + "/b.h");
+		deleteFile(moved + "/a.h");
+		removeDirectory(dir);
+		removeDirectory(moved);
+	};
+	cleanup();
+	SCOPE_EXIT{ cleanup(); };
+
+	CZ_CHECK(createDirectory(dir));
+	CZ_EXPECT(!isExistingFile(dir + "/a.h"));
+	std::ofstream(nativePath(dir + "/a.h")).close();
+	CZ_EXPECT(isExistingFile(dir + "/a.h"));
+
+	CZ_CHECK(renameFile(dir, moved));
+	CZ_CHECK(createDirectory(dir));
+	std::ofstream(nativePath(dir + "/b.h")).close();
+	newFileSystemGeneration();
+	CZ_EXPECT(!isExistingFile(dir + "/a.h"));
+	CZ_EXPECT(isExistingFile(dir + "/b.h"));
+	CZ_EXPECT(isExistingFile(moved + "/a.h"));
+
+	return ok;
+}
+
+//
+// With the fast parser's tool channel, the compiler command lines come from the dummy tools. The values of options
+// such as "/Fo out\" are not files to compile, and a command line whose message never arrives (e.g: the tool timed out
+// connecting) is taken from msbuild's output instead.
+//
+bool checkToolChannel()
+{
+	bool ok = true;
+	std::string dir = getCWD();
+	ensureTrailingSlash(dir);
+	dir += "vimvs-check-toolchannel/";
+	const char* dbName = "vimvs-check-toolchannel.db";
+	auto cleanup = [&]()
+	{
+		deleteFile(dir + "a.cpp");
+		deleteFile(dir + "b.cpp");
+		removeDirectory(dir);
+		deleteFile(dbName);
+	};
+	cleanup();
+	SCOPE_EXIT{ cleanup(); };
+	CZ_CHECK(createDirectory(dir));
+	std::ofstream(nativePath(dir + "a.cpp")).close();
+	std::ofstream(nativePath(dir + "b.cpp")).close();
+
+	Database db;
+	CZ_CHECK(db.open(dbName, true));
+	db.setConfiguration("Debug|x64");
+	db.beginGeneration();
+
+	ToolChannel channel;
+	CZ_CHECK(channel.open());
+	Parser parser(db, true, false, true);
+	parser.setToolChannel(&channel);
+	parser.setProgressMode(1);
+
+	// msbuild's output has both command lines, but only a.cpp's tool sends its message
+	parser.inject(formatString(
+		"Project \"%sApp.vcxproj\" on node 1 (default targets).\n"
+		"rem vim-vs-begin: ProjectName=\"App\", ProjectPath=\"%sApp.vcxproj\", ProjectConfiguration=\"Debug\", "
+		"ProjectPlatform=\"x64\", AllProjects=\"\", ExecutablePath=\"\", IncludePath=;\n"
+		"ClCompile:\n"
+		"  C:\\bin\\" VIMVS_FAST_PARSER_CL ".exe /c /D LOG /Fo out\\ a.cpp\n"
+		"  C:\\bin\\" VIMVS_FAST_PARSER_CL ".exe /c /D LOG /Fo out\\ b.cpp\n",
+		dir.c_str(), dir.c_str()));
+
+	ToolMessage msg;
+	msg.tool = VIMVS_FAST_PARSER_CL;
+	msg.workdir = dir;
+	msg.args = { "/c", "/D", "TOOL", "/Fo", "out\\", "/Fp:", "out\\App.pch", "@a.rsp" };
+	msg.responseFiles.emplace_back("a.rsp", VIMVS_FAST_PARSER_PROJECT_OPTION + dir + "App.vcxproj a.cpp");
+	channel.add(encodeToolMessage(msg));
+	parser.finishWork();
+
+	CZ_EXPECT(parser.getNumFiles() == 2);
+	CZ_EXPECT(parser.getNumMissingToolCommands() == 1);
+	CZ_EXPECT(db.getFile(dir + "a.cpp").defines == "-DTOOL|");
+	CZ_EXPECT(db.getFile(dir + "b.cpp").defines == "-DLOG|");
+
+	return ok;
+}
+
+//
+// canonicalizePath replaced PathCanonicalize, so it needs to handle everything a path in a project or build output can
+// have. The expected results use '/', which is replaced with the platform's separator.
+//
+bool checkCanonicalizePath()
+{
+	bool ok = true;
+	struct Case
+	{
+		const char* path;
+		const char* root;
+		const char* expected; // Null if it should fail
+	};
+	const Case cases[] =
+	{
+		// Relative paths, "." and ".."
+		{ "a/b/../c", "/r", "/r/a/c" },
+		{ "./a/./b/.", "/r/", "/r/a/b" },
+		{ "..", "/r/s", "/r" },
+		{ "a", "/r/s/..", "/r/a" },
+		// ".." past the root
+		{ "../../../a", "/r/s", "/a" },
+		{ "/..", "/r", "/" },
+		{ "C:\\..\\..\\a", "/r", "C:/a" },
+		{ "\\\\server\\share\\a\\..\\..\\..\\b", "/r", "//server/share/b" },
+		// Repeated separators, and mixed separators
+		{ "a//b\\\\c", "/r", "/r/a/b/c" },
+		{ "C:/a\\/b", "/r", "C:/a/b" },
+		// Roots
+		{ "/", "/r", "/" },
+		{ "C:", "/r", "C:" },
+		{ "C:\\", "/r", "C:/" },
+		{ "c:foo\\..\\bar", "/r", "c:bar" },
+		{ "//server/share", "/r", "//server/share/" },
+		{ "a", "C:\\dir", "C:/dir/a" },
+		{ "a", "\\\\server\\share\\dir", "//server/share/dir/a" },
+		// Trailing separators are only kept if the path has one
+		{ "a/b/", "/r", "/r/a/b/" },
+		{ "a/b", "/r/", "/r/a/b" },
+		{ "a/..", "/r/", "/r" },
+		{ "", "/r/s/", "/r/s/" },
+		{ "", "/r/s", "/r/s" },
+		// Relative root
+		{ "a", "r", nullptr },
+		{ "a", "", nullptr },
+	};
+
+	for (auto&& c : cases)
+	{
+		std::string dst;
+		bool res = canonicalizePath(dst, c.path, c.root);
+		bool caseOk;
+		if (c.expected)
+			caseOk = res && dst == replace(c.expected, '/', kPathSeparator);
+		else
+			caseOk = !res;
+		if (!caseOk)
+		{
+			printf("    FAILED: canonicalizePath(\"%s\", \"%s\") = %s\"%s\"\n", c.path, c.root, res ? "" : "(failed) ",
+				dst.c_str());
+			ok = false;
+		}
+	}
+	return ok;
+}
+
+//
+// hashPath gives the file ids, so the SSE2 and scalar code need to give the same result, and it needs to be case
+// insensitive. Checked for every length up to 64 (several SSE2 blocks, plus every possible tail), at different
+// alignments.
+//
+bool checkHashPath()
+{
+	bool ok = true;
+	const char chars[] = "aZ/\\.m_Q-z@[`{\xC3\xA9";
+	std::string buf;
+	for (int i = 0; i < 67; i++)
+		buf += chars[(i * 7 + i / 5) % (sizeof(chars) - 1)];
+	std::string lower = buf;
+	for (auto&& c : lower)
+		c = (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c;
+
+	int failed = 0;
+	for (size_t offset = 0; offset < 3; offset++)
+	{
+		for (size_t len = 0; len <= 64; len++)
+		{
+			std::string_view path(buf.data() + offset, len);
+			auto h = hashPath(path);
+			if (h != hashPathScalar(path) || h != hashPath(std::string_view(lower.data() + offset, len)))
+				failed++;
+		}
+	}
+	CZ_EXPECT(failed == 0);
+	CZ_EXPECT(hashPath("C:\\Foo\\Bar.h") == hashPath("c:\\foo\\bar.H"));
+	CZ_EXPECT(hashPath("C:\\Foo\\Bar.h") != hashPath("C:\\Foo\\Bar.hh"));
+	CZ_EXPECT(hashPath("") != hashPath(std::string_view("\0", 1)));
+
+	return ok;
+}
+
+//
+// editDistance uses a bit-parallel algorithm for strings up to 64 characters, and dynamic programming above that. Both
+// are compared with a plain dynamic programming reference, for lengths around that boundary, the empty string, and
+// with limits.
+//
+int referenceEditDistance(std::string_view a, std::string_view b)
+{
+	auto lower = [](char c) { return (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c; };
+	std::vector<std::vector<int>> d(a.size() + 1, std::vector<int>(b.size() + 1));
+	for (size_t i = 0; i <= a.size(); i++)
+		d[i][0] = static_cast<int>(i);
+	for (size_t j = 0; j <= b.size(); j++)
+		d[0][j] = static_cast<int>(j);
+	for (size_t i = 1; i <= a.size(); i++)
+	{
+		for (size_t j = 1; j <= b.size(); j++)
+		{
+			int sub = d[i - 1][j - 1] + (lower(a[i - 1]) == lower(b[j - 1]) ? 0 : 1);
+			d[i][j] = std::min({ d[i - 1][j] + 1, d[i][j - 1] + 1, sub });
+		}
+	}
+	return d[a.size()][b.size()];
+}
+
+bool checkEditDistance()
+{
+	bool ok = true;
+	// Small alphabet, so the strings have plenty of matches, with both cases
+	const char chars[] = "abAB/c";
+	uint32_t seed = 1;
+	auto random = [&seed]() { seed = seed * 1103515245 + 12345; return (seed >> 16) & 0x7FFF; };
+	auto makeString = [&](size_t len)
+	{
+		std::string s;
+		for (size_t i = 0; i < len; i++)
+			s += chars[random() % (sizeof(chars) - 1)];
+		return s;
+	};
+
+	const size_t lengths[] = { 0, 1, 2, 7, 31, 63, 64, 65, 66, 100, 130 };
+	int failed = 0;
+	for (auto la : lengths)
+	{
+		for (auto lb : lengths)
+		{
+			for (int i = 0; i < 4; i++)
+			{
+				auto a = makeString(la);
+				// Some pairs are similar, and some unrelated
+				auto b = (i % 2) ? makeString(lb) : a.substr(0, std::min(la, lb)) + makeString(lb - std::min(la, lb));
+				if (i == 2 && b.size())
+					b[b.size() / 2] = b[b.size() / 2] == 'a' ? 'A' : 'b';
+				int expected = referenceEditDistance(a, b);
+				int limit = static_cast<int>(random() % 140);
+				if (editDistance(a, b) != expected || editDistance(b, a) != expected ||
+					editDistance(a, b, limit) != std::min(expected, limit + 1))
+				{
+					if (failed++ < 5)
+						printf("    Mismatch for '%s' and '%s' (expected %d)\n", a.c_str(), b.c_str(), expected);
+				}
+			}
+		}
+	}
+	CZ_EXPECT(failed == 0);
+	CZ_EXPECT(editDistance("", "") == 0);
+	CZ_EXPECT(editDistance("Include", "include") == 0);
+	CZ_EXPECT(editDistance("kitten", "sitting") == 3);
+
+	return ok;
+}
+
+//
+// The find index (see FileFinder.h) is written by -builddb and memory mapped by the queries, so it needs to survive
+// the round trip to disk, and a file from an older version, or one that was cut short, needs to be rejected instead of
+// read past its end.
+//
+bool checkFindIndex()
+{
+	bool ok = true;
+	const char* fname = "vimvs-check-find.idx";
+	deleteFile(fname);
+	SCOPE_EXIT{ deleteFile(fname); };
+
+	FindIndexWriter writer;
+	writer.add("/prj/Engine/Render/Texture.cpp", "Engine");
+	writer.add("/prj/Engine/Render/Texture.h", "Engine");
+	writer.add("/prj/Engine/Audio/Sound.cpp", "Engine");
+	writer.add("/prj/Game/Main.cpp", "Game");
+	CZ_CHECK(writer.write(fname));
+
+	auto paths = [](const std::vector<FindMatch>& matches)
+	{
+		std::vector<std::string> res;
+		for (auto&& m : matches)
+			res.emplace_back(m.path);
+		return res;
+	};
+
+	std::string data;
+	{
+		FindIndex idx;
+		CZ_CHECK(idx.open(fname));
+		CZ_EXPECT(idx.getNumFiles() == 4);
+
+		FindQuery q;
+		q.pattern = "texture";
+		auto res = paths(idx.find(q));
+		CZ_EXPECT(res.size() == 2);
+		CZ_EXPECT(std::find(res.begin(), res.end(), "/prj/Engine/Render/Texture.cpp") != res.end());
+		CZ_EXPECT(std::find(res.begin(), res.end(), "/prj/Engine/Render/Texture.h") != res.end());
+
+		q.kind = FileKind::Header;
+		res = paths(idx.find(q));
+		CZ_EXPECT(res.size() == 1 && res[0] == "/prj/Engine/Render/Texture.h");
+
+		// A typo still finds it
+		q.pattern = "texure";
+		q.kind = FileKind::Other;
+		res = paths(idx.find(q));
+		CZ_EXPECT(res.size() && (res[0] == "/prj/Engine/Render/Texture.cpp" || res[0] == "/prj/Engine/Render/Texture.h"));
+
+		q.pattern = "main";
+		q.project = "Engine";
+		CZ_EXPECT(idx.find(q).empty());
+		q.project = "Game";
+		res = paths(idx.find(q));
+		CZ_EXPECT(res.size() == 1 && res[0] == "/prj/Game/Main.cpp");
+
+		q.pattern = "zzzzzz";
+		q.project.clear();
+		CZ_EXPECT(idx.find(q).empty());
+
+		// The in memory index is the same thing
+		FindIndex mem;
+		auto serialized = writer.serialize();
+		CZ_CHECK(mem.open("memory", reinterpret_cast<const uint8_t*>(serialized.data()), serialized.size()));
+		q.pattern = "sound";
+		res = paths(mem.find(q));
+		CZ_EXPECT(res.size() == 1 && res[0] == "/prj/Engine/Audio/Sound.cpp");
+	}
+	CZ_CHECK(readFile(fname, data));
+	CZ_CHECK(data.size() > sizeof(FindIndexHeader));
+
+	auto rejects = [](const std::string& bytes)
+	{
+		FindIndex idx;
+		return !idx.open("corrupt", reinterpret_cast<const uint8_t*>(bytes.data()), bytes.size());
+	};
+
+	// Older version
+	{
+		auto bytes = data;
+		reinterpret_cast<FindIndexHeader*>(&bytes[0])->version = VIMVS_FINDINDEX_VERSION - 1;
+		CZ_EXPECT(rejects(bytes));
+	}
+	// Not an index
+	{
+		auto bytes = data;
+		reinterpret_cast<FindIndexHeader*>(&bytes[0])->magic = 0;
+		CZ_EXPECT(rejects(bytes));
+	}
+	// Truncated, or with counts that don't match the size
+	CZ_EXPECT(rejects(data.substr(0, sizeof(FindIndexHeader) - 1)));
+	CZ_EXPECT(rejects(data.substr(0, data.size() - 1)));
+	CZ_EXPECT(rejects(data + '\0'));
+	{
+		auto bytes = data;
+		reinterpret_cast<FindIndexHeader*>(&bytes[0])->numTrigrams += 1;
+		CZ_EXPECT(rejects(bytes));
+	}
+	FindQuery texture;
+	texture.pattern = "texture";
+
+	// Truncated on disk
+	{
+		std::ofstream out(nativePath(fname), std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+		out.write(data.data(), data.size() / 2);
+	}
+	{
+		FindIndex idx;
+		CZ_EXPECT(!idx.open(fname));
+		CZ_EXPECT(idx.find(texture).empty());
+	}
+
+	// Empty index (e.g a configuration with no files)
+	{
+		FindIndexWriter empty;
+		CZ_CHECK(empty.write(fname));
+		FindIndex idx;
+		CZ_EXPECT(idx.open(fname));
+		CZ_EXPECT(idx.getNumFiles() == 0);
+		CZ_EXPECT(idx.find(texture).empty());
+	}
+
+	return ok;
+}
+
+struct Check
+{
+	const char* name;
+	bool(*func)();
+};
+
+const Check gChecks[] =
+{
+	{ "incremental", &checkIncremental },
+	{ "backup", &checkBackup },
+	{ "evaluator", &checkEvaluator },
+	{ "renameddir", &checkRenamedDirectory },
+	{ "toolchannel", &checkToolChannel },
+	{ "canonicalize", &checkCanonicalizePath },
+	{ "hashpath", &checkHashPath },
+	{ "editdistance", &checkEditDistance },
+	{ "findindex", &checkFindIndex },
+};
+
+} // anonymous namespace
+
+bool runChecks(const std::string& filter)
+{
+	bool found = false;
+	int failed = 0;
+	for (auto&& c : gChecks)
+	{
+		if (filter.size() && std::string(c.name).find(filter) == std::string::npos)
+			continue;
+		found = true;
+		printf("%s:\n", c.name);
+		bool ok = c.func();
+		printf("    %s\n", ok ? "OK" : "FAILED");
+		if (!ok)
+			failed++;
+	}
+
+	if (!found)
+	{
+		fprintf(stderr, "No check matches '%s'\n", filter.c_str());
+		return false;
+	}
+
+	return failed == 0;
+}
+
+}
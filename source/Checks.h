@@ -0,0 +1,12 @@
+#pragma once
+
+#include <string>
+
+namespace cz
+{
+
+//! Runs the self checks whose name contains 'filter' (or all of them if empty), and prints the results.
+// Returns false if any failed. This is only meant for development (see the hidden -check command, which ctest runs).
+bool runChecks(const std::string& filter);
+
+}
@@ -1,261 +1,435 @@
-
-#include "vimvsPCH.h"
-#include "ChildProcessLauncher.h"
-#include "Utils.h"
-
-namespace cz {
-
-ChildProcessLauncher::ChildProcessLauncher()
-{
-	//m_hStdIn = NULL;
-	m_hChildProcess = NULL;
-	m_bRunThread = TRUE;
-}
-
-ChildProcessLauncher::~ChildProcessLauncher()
-{
-	/*
-	std::vector<String> lines;
-	cz::stringSplitIntoLines(m_output.c_str(), m_output.size(), &lines);
-	for(auto &l : lines)
-	{
-		//
-		// Simply doing  CZ_LOG(logDefault, Log, l.c_str())  will crash, if 'l' itself has any printf like stuff.
-		// so, doing this thing below...
-		CZ_LOG(logDefault, Log, "%s", l.c_str());
-	}
-	*/
-}
-
-int ChildProcessLauncher::ErrorMessage(const char* funcname) 
-{ 
-	if (m_errmsg.size())
-		return 1;
-
-	m_errmsg = getWin32Error(funcname);
-
-	return 1;
-}
-
-void ChildProcessLauncher::addOutput(const std::string& str)
-{
-	for(auto c : str)
-	{
-		if (c == 0xA)
-		{
-			if (m_tmpline.size() && m_tmpline.back() == 0xD)
-				m_tmpline.pop_back();
-
-			m_tmpline.push_back(c);
-			m_output += m_tmpline;
-			if (m_logfunc)
-				m_logfunc(false, m_tmpline);
-			m_tmpline.clear();
-		}
-		else
-		{
-			m_tmpline.push_back(c);
-		}
-	}
-}
-
-int ChildProcessLauncher::launch(const std::string& name, const std::string& params, const std::function<void(bool, const std::string& str)>& logfunc)
-{
-	m_name = name;
-	m_params = params;
-	m_logfunc = logfunc;
-
-	HANDLE hOutputReadTmp, hOutputRead, hOutputWrite;
-	HANDLE hInputWriteTmp, hInputRead, hInputWrite;
-	HANDLE hErrorWrite;
-	//HANDLE hThread;
-	//DWORD ThreadId;
-	SECURITY_ATTRIBUTES sa;
-
-	// Set up the security attributes struct.
-	sa.nLength = sizeof(SECURITY_ATTRIBUTES);
-	sa.lpSecurityDescriptor = NULL;
-	sa.bInheritHandle = TRUE;
-
-	// Create the child output pipe.
-	if (!CreatePipe(&hOutputReadTmp, &hOutputWrite, &sa, 0))
-		ErrorMessage("CreatePipe");
-
-
-	// Create a duplicate of the output write handle for the std error
-	// write handle. This is necessary in case the child application
-	// closes one of its std output handles.
-	if (!DuplicateHandle(GetCurrentProcess(), hOutputWrite,
-		GetCurrentProcess(), &hErrorWrite, 0,
-		TRUE, DUPLICATE_SAME_ACCESS))
-		ErrorMessage("DuplicateHandle");
-
-
-	// Create the child input pipe.
-	if (!CreatePipe(&hInputRead, &hInputWriteTmp, &sa, 0))
-		ErrorMessage("CreatePipe");
-
-
-	// Create new output read handle and the input write handles. Set
-	// the Properties to FALSE. Otherwise, the child inherits the
-	// properties and, as a result, non-closeable handles to the pipes
-	// are created.
-	if (!DuplicateHandle(GetCurrentProcess(), hOutputReadTmp,
-		GetCurrentProcess(),
-		&hOutputRead, // Address of new handle.
-		0, FALSE, // Make it uninheritable.
-		DUPLICATE_SAME_ACCESS))
-		ErrorMessage("DuplicateHandle");
-
-	if (!DuplicateHandle(GetCurrentProcess(), hInputWriteTmp,
-		GetCurrentProcess(),
-		&hInputWrite, // Address of new handle.
-		0, FALSE, // Make it uninheritable.
-		DUPLICATE_SAME_ACCESS))
-		ErrorMessage("DuplicateHandle");
-
-
-	// Close inheritable copies of the handles you do not want to be
-	// inherited.
-	if (!CloseHandle(hOutputReadTmp)) ErrorMessage("CloseHandle");
-	if (!CloseHandle(hInputWriteTmp)) ErrorMessage("CloseHandle");
-
-
-	// Get std input handle so you can close it and force the ReadFile to
-	// fail when you want the input thread to exit.
-	//if ((m_hStdIn = GetStdHandle(STD_INPUT_HANDLE)) ==
-	//	INVALID_HANDLE_VALUE)
-	//	ErrorMessage("GetStdHandle");
-
-	PrepAndLaunchRedirectedChild(hOutputWrite, hInputRead, hErrorWrite);
-
-
-	// Close pipe handles (do not continue to modify the parent).
-	// You need to make sure that no handles to the write end of the
-	// output pipe are maintained in this process or else the pipe will
-	// not close when the child process exits and the ReadFile will hang.
-	if (!CloseHandle(hOutputWrite)) ErrorMessage("CloseHandle");
-	if (!CloseHandle(hInputRead)) ErrorMessage("CloseHandle");
-	if (!CloseHandle(hErrorWrite)) ErrorMessage("CloseHandle");
-
-
-	// Launch the thread that gets the input and sends it to the child.
-	/*
-	hThread = CreateThread(NULL, 0, GetAndSendInputThread,
-		(LPVOID)hInputWrite, 0, &ThreadId);
-	if (hThread == NULL) ErrorMessage(TEXT("CreateThread"));
-	*/
-
-	// Read the child's output.
-	ReadAndHandleOutput(hOutputRead);
-	// Redirection is complete
-
-	// Force the read on the input to return by closing the stdin handle.
-	// if (!CloseHandle(m_hStdIn)) ErrorMessage(TEXT("CloseHandle"));
-
-
-	/*
-	// Tell the thread to exit and wait for thread to die.
-	m_bRunThread = FALSE;
-
-	if (WaitForSingleObject(hThread, INFINITE) == WAIT_FAILED)
-		ErrorMessage(TEXT("WaitForSingleObject"));
-		*/
-
-	if (!CloseHandle(hOutputRead)) ErrorMessage("CloseHandle");
-	if (!CloseHandle(hInputWrite)) ErrorMessage("CloseHandle");
-
-	DWORD exitcode=0;
-	if (!GetExitCodeProcess(m_hChildProcess, &exitcode))
-		ErrorMessage("GetExitCodeProcess");
-
-	if (!CloseHandle(m_hChildProcess))
-		ErrorMessage("CloseHandle");
-
-	if (m_errmsg.size())
-		addOutput(m_errmsg.data());
-
-	// If for some reason the last output wasn't a EOL, then write one, so the caller gets all the output
-	if (m_tmpline.size())
-		addOutput("\n");
-	CZ_CHECK(m_tmpline.size() == 0);
-
-	return m_errmsg.size() ? 1 : exitcode;
-}
-
-int ChildProcessLauncher::PrepAndLaunchRedirectedChild(
-							HANDLE hChildStdOut,
-							HANDLE hChildStdIn,
-							HANDLE hChildStdErr)
-{
-	PROCESS_INFORMATION pi;
-	STARTUPINFO si;
-
-	// Set up the start up info struct.
-	ZeroMemory(&si, sizeof(STARTUPINFO));
-	si.cb = sizeof(STARTUPINFO);
-	si.dwFlags = STARTF_USESTDHANDLES | STARTF_USESHOWWINDOW;
-	si.hStdOutput = hChildStdOut;
-	si.hStdInput = hChildStdIn;
-	si.hStdError = hChildStdErr;
-	// Use this if you want to hide the child:
-	//     si.wShowWindow = SW_HIDE;
-	// Note that dwFlags must include STARTF_USESHOWWINDOW if you want to
-	// use the wShowWindow flags.
-
-	std::string cmdline = std::string("\"") + m_name + "\" " + m_params;
-
-	m_logfunc(true, cmdline + "\n");
-	// Launch the process that you want to redirect (in this case,
-	// Child.exe). Make sure Child.exe is in the same directory as
-	// redirect.c launch redirect from a command line to prevent location
-	// confusion.
-	if (!CreateProcess(NULL, (LPWSTR)widen(cmdline).c_str(), NULL, NULL, TRUE,
-		CREATE_NEW_CONSOLE, NULL, NULL, &si, &pi))
-		ErrorMessage("CreateProcess");
-
-	// Set global child process handle to cause threads to exit.
-	m_hChildProcess = pi.hProcess;
-
-	// Close any unnecessary handles.
-	if (!CloseHandle(pi.hThread)) ErrorMessage("CloseHandle");
-
-	return 0;
-}
-
-/////////////////////////////////////////////////////////////////////// 
-// ReadAndHandleOutput
-// Monitors handle for input. Exits when child exits or pipe breaks.
-/////////////////////////////////////////////////////////////////////// 
-int ChildProcessLauncher::ReadAndHandleOutput(HANDLE hPipeRead)
-{
-  CHAR lpBuffer[256];
-  DWORD nBytesRead;
-  //DWORD nCharsWritten;
-
-  while(TRUE)
-  {
-	 if (!ReadFile(hPipeRead,lpBuffer,sizeof(lpBuffer),
-									  &nBytesRead,NULL) || !nBytesRead)
-	 {
-		if (GetLastError() == ERROR_BROKEN_PIPE)
-		   break; // pipe done - normal exit path.
-		else
-		   ErrorMessage("ReadFile"); // Something bad happened.
-	 }
-
-	 /*
-	 // Display the character read on the screen.
-	 if (!WriteConsole(GetStdHandle(STD_OUTPUT_HANDLE),lpBuffer,
-					   nBytesRead,&nCharsWritten,NULL))
-		ErrorMessage(("WriteConsole"));
-		*/
-	 std::string s(lpBuffer, lpBuffer + nBytesRead);
-	 addOutput(s);
-
-  }
-
-  return 0;
-}
-
-} // namespace cz
+
+#include "vimvsPCH.h"
+#include "ChildProcessLauncher.h"
+#include "Utils.h"
+#include "Trace.h"
+#include "ScopeGuard.h"
+
+#ifndef _WIN32
+	#include <unistd.h>
+	#include <fcntl.h>
+	#include <poll.h>
+	#include <spawn.h>
+	#include <sys/wait.h>
+	#include <string.h>
+	#include <errno.h>
+#endif
+
+namespace cz {
+
+ChildProcessLauncher::ChildProcessLauncher()
+{
+#ifdef _WIN32
+	//m_hStdIn = NULL;
+	m_hChildProcess = NULL;
+	m_bRunThread = TRUE;
+#endif
+}
+
+ChildProcessLauncher::~ChildProcessLauncher()
+{
+	/*
+	std::vector<String> lines;
+	cz::stringSplitIntoLines(m_output.c_str(), m_output.size(), &lines);
+	for(auto &l : lines)
+	{
+		//
+		// Simply doing  CZ_LOG(logDefault, Log, l.c_str())  will crash, if 'l' itself has any printf like stuff.
+		// so, doing this thing below...
+		CZ_LOG(logDefault, Log, "%s", l.c_str());
+	}
+	*/
+}
+
+int ChildProcessLauncher::ErrorMessage(const char* funcname) 
+{ 
+	if (m_errmsg.size())
+		return 1;
+
+	m_errmsg = getLastErrorMsg(funcname);
+
+	return 1;
+}
+
+void ChildProcessLauncher::addOutput(const std::string& str)
+{
+	for(auto c : str)
+	{
+		if (c == 0xA)
+		{
+			if (m_tmpline.size() && m_tmpline.back() == 0xD)
+				m_tmpline.pop_back();
+
+			m_tmpline.push_back(c);
+			m_output += m_tmpline;
+			if (m_logfunc)
+				m_logfunc(false, m_tmpline);
+			m_tmpline.clear();
+		}
+		else
+		{
+			m_tmpline.push_back(c);
+		}
+	}
+}
+
+int ChildProcessLauncher::launch(const std::string& name, const std::string& params, const std::function<void(bool, const std::string& str)>& logfunc)
+{
+	m_name = name;
+	m_params = params;
+	m_logfunc = logfunc;
+
+#ifndef _WIN32
+	return launchPosix();
+#else
+	HANDLE hOutputReadTmp, hOutputRead, hOutputWrite;
+	HANDLE hInputWriteTmp, hInputRead, hInputWrite;
+	HANDLE hErrorWrite;
+	//HANDLE hThread;
+	//DWORD ThreadId;
+	SECURITY_ATTRIBUTES sa;
+
+	// Set up the security attributes struct.
+	sa.nLength = sizeof(SECURITY_ATTRIBUTES);
+	sa.lpSecurityDescriptor = NULL;
+	sa.bInheritHandle = TRUE;
+
+	// Create the child output pipe.
+	if (!CreatePipe(&hOutputReadTmp, &hOutputWrite, &sa, 0))
+		ErrorMessage("CreatePipe");
+
+
+	// Create a duplicate of the output write handle for the std error
+	// write handle. This is necessary in case the child application
+	// closes one of its std output handles.
+	if (!DuplicateHandle(GetCurrentProcess(), hOutputWrite,
+		GetCurrentProcess(), &hErrorWrite, 0,
+		TRUE, DUPLICATE_SAME_ACCESS))
+		ErrorMessage("DuplicateHandle");
+
+
+	// Create the child input pipe.
+	if (!CreatePipe(&hInputRead, &hInputWriteTmp, &sa, 0))
+		ErrorMessage("CreatePipe");
+
+
+	// Create new output read handle and the input write handles. Set
+	// the Properties to FALSE. Otherwise, the child inherits the
+	// properties and, as a result, non-closeable handles to the pipes
+	// are created.
+	if (!DuplicateHandle(GetCurrentProcess(), hOutputReadTmp,
+		GetCurrentProcess(),
+		&hOutputRead, // Address of new handle.
+		0, FALSE, // Make it uninheritable.
+		DUPLICATE_SAME_ACCESS))
+		ErrorMessage("DuplicateHandle");
+
+	if (!DuplicateHandle(GetCurrentProcess(), hInputWriteTmp,
+		GetCurrentProcess(),
+		&hInputWrite, // Address of new handle.
+		0, FALSE, // Make it uninheritable.
+		DUPLICATE_SAME_ACCESS))
+		ErrorMessage("DuplicateHandle");
+
+
+	// Close inheritable copies of the handles you do not want to be
+	// inherited.
+	if (!CloseHandle(hOutputReadTmp)) ErrorMessage("CloseHandle");
+	if (!CloseHandle(hInputWriteTmp)) ErrorMessage("CloseHandle");
+
+
+	// Get std input handle so you can close it and force the ReadFile to
+	// fail when you want the input thread to exit.
+	//if ((m_hStdIn = GetStdHandle(STD_INPUT_HANDLE)) ==
+	//	INVALID_HANDLE_VALUE)
+	//	ErrorMessage("GetStdHandle");
+
+	PrepAndLaunchRedirectedChild(hOutputWrite, hInputRead, hErrorWrite);
+
+
+	// Close pipe handles (do not continue to modify the parent).
+	// You need to make sure that no handles to the write end of the
+	// output pipe are maintained in this process or else the pipe will
+	// not close when the child process exits and the ReadFile will hang.
+	if (!CloseHandle(hOutputWrite)) ErrorMessage("CloseHandle");
+	if (!CloseHandle(hInputRead)) ErrorMessage("CloseHandle");
+	if (!CloseHandle(hErrorWrite)) ErrorMessage("CloseHandle");
+
+
+	// Launch the thread that gets the input and sends it to the child.
+	/*
+	hThread = CreateThread(NULL, 0, GetAndSendInputThread,
+		(LPVOID)hInputWrite, 0, &ThreadId);
+	if (hThread == NULL) ErrorMessage(TEXT("CreateThread"));
+	*/
+
+	// Read the child's output.
+	ReadAndHandleOutput(hOutputRead);
+	// Redirection is complete
+
+	// Force the read on the input to return by closing the stdin handle.
+	// if (!CloseHandle(m_hStdIn)) ErrorMessage(TEXT("CloseHandle"));
+
+
+	/*
+	// Tell the thread to exit and wait for thread to die.
+	m_bRunThread = FALSE;
+
+	if (WaitForSingleObject(hThread, INFINITE) == WAIT_FAILED)
+		ErrorMessage(TEXT("WaitForSingleObject"));
+		*/
+
+	if (!CloseHandle(hOutputRead)) ErrorMessage("CloseHandle");
+	if (!CloseHandle(hInputWrite)) ErrorMessage("CloseHandle");
+
+	DWORD exitcode=0;
+	if (!GetExitCodeProcess(m_hChildProcess, &exitcode))
+		ErrorMessage("GetExitCodeProcess");
+
+	if (!CloseHandle(m_hChildProcess))
+		ErrorMessage("CloseHandle");
+
+	if (m_errmsg.size())
+		addOutput(m_errmsg.data());
+
+	// If for some reason the last output wasn't a EOL, then write one, so the caller gets all the output
+	if (m_tmpline.size())
+		addOutput("\n");
+	CZ_CHECK(m_tmpline.size() == 0);
+
+	return m_errmsg.size() ? 1 : exitcode;
+#endif
+}
+
+#ifdef _WIN32
+
+// Current environment, with our variables added/replaced, in the format CreateProcess expects
+std::wstring ChildProcessLauncher::buildEnvironmentBlock()
+{
+	std::vector<std::wstring> vars;
+	auto env = GetEnvironmentStringsW();
+	for (auto p = env; *p; p += wcslen(p) + 1)
+		vars.push_back(p);
+	FreeEnvironmentStringsW(env);
+
+	for (auto&& e : m_env)
+	{
+		auto prefix = widen(tolower(e.first) + "=");
+		vars.erase(std::remove_if(vars.begin(), vars.end(), [&](const std::wstring& v)
+		{
+			return v.size() >= prefix.size() && _wcsnicmp(v.c_str(), prefix.c_str(), prefix.size()) == 0;
+		}), vars.end());
+		vars.push_back(widen(e.first + "=" + e.second));
+	}
+
+	// The block needs to be sorted (case insensitive), and terminated by an empty string
+	std::sort(vars.begin(), vars.end(), [](const std::wstring& a, const std::wstring& b)
+	{
+		return _wcsicmp(a.c_str(), b.c_str()) < 0;
+	});
+	std::wstring res;
+	for (auto&& v : vars)
+	{
+		res += v;
+		res.push_back(0);
+	}
+	res.push_back(0);
+	return res;
+}
+
+int ChildProcessLauncher::PrepAndLaunchRedirectedChild(
+							HANDLE hChildStdOut,
+							HANDLE hChildStdIn,
+							HANDLE hChildStdErr)
+{
+	PROCESS_INFORMATION pi;
+	STARTUPINFO si;
+
+	// Set up the start up info struct.
+	ZeroMemory(&si, sizeof(STARTUPINFO));
+	si.cb = sizeof(STARTUPINFO);
+	si.dwFlags = STARTF_USESTDHANDLES | STARTF_USESHOWWINDOW;
+	si.hStdOutput = hChildStdOut;
+	si.hStdInput = hChildStdIn;
+	si.hStdError = hChildStdErr;
+	// Use this if you want to hide the child:
+	//     si.wShowWindow = SW_HIDE;
+	// Note that dwFlags must include STARTF_USESHOWWINDOW if you want to
+	// use the wShowWindow flags.
+
+	std::string cmdline = std::string("\"") + m_name + "\" " + m_params;
+
+	m_logfunc(true, cmdline + "\n");
+	// Launch the process that you want to redirect (in this case,
+	// Child.exe). Make sure Child.exe is in the same directory as
+	// redirect.c launch redirect from a command line to prevent location
+	// confusion.
+	std::wstring env;
+	DWORD flags = CREATE_NEW_CONSOLE;
+	if (m_env.size())
+	{
+		env = buildEnvironmentBlock();
+		flags |= CREATE_UNICODE_ENVIRONMENT;
+	}
+	std::wstring workdir = widen(m_workdir);
+	if (!CreateProcess(NULL, (LPWSTR)widen(cmdline).c_str(), NULL, NULL, TRUE,
+		flags, env.size() ? (LPVOID)env.c_str() : NULL, workdir.size() ? workdir.c_str() : NULL, &si, &pi))
+		ErrorMessage("CreateProcess");
+
+	// Set global child process handle to cause threads to exit.
+	m_hChildProcess = pi.hProcess;
+
+	// Close any unnecessary handles.
+	if (!CloseHandle(pi.hThread)) ErrorMessage("CloseHandle");
+
+	return 0;
+}
+
+/////////////////////////////////////////////////////////////////////// 
+// ReadAndHandleOutput
+// Monitors handle for input. Exits when child exits or pipe breaks.
+/////////////////////////////////////////////////////////////////////// 
+int ChildProcessLauncher::ReadAndHandleOutput(HANDLE hPipeRead)
+{
+  // Big reads, since msbuild's output can be huge
+  std::vector<CHAR> lpBuffer(64 * 1024);
+  DWORD nBytesRead;
+
+  while(TRUE)
+  {
+	 {
+		CZ_TRACE_SCOPE("process", "read");
+		if (!ReadFile(hPipeRead,lpBuffer.data(),static_cast<DWORD>(lpBuffer.size()),
+										 &nBytesRead,NULL) || !nBytesRead)
+		{
+		   if (GetLastError() == ERROR_BROKEN_PIPE)
+			  break; // pipe done - normal exit path.
+		   else
+			  ErrorMessage("ReadFile"); // Something bad happened.
+		}
+	 }
+
+	 CZ_TRACE_SCOPE("process", "handleOutput");
+	 std::string s(lpBuffer.data(), lpBuffer.data() + nBytesRead);
+	 addOutput(s);
+
+  }
+
+  return 0;
+}
+
+#else
+
+int ChildProcessLauncher::launchPosix()
+{
+	std::string cmdline = std::string("\"") + m_name + "\" " + m_params;
+	if (m_logfunc)
+		m_logfunc(true, cmdline + "\n");
+
+	int fds[2];
+	if (pipe2(fds, O_CLOEXEC) != 0)
+	{
+		ErrorMessage("pipe2");
+		addOutput(m_errmsg + "\n");
+		return 1;
+	}
+
+	// posix_spawn instead of fork, so the parent's memory doesn't need to be duplicated (even if copy on write) just to
+	// call exec, which matters when launching lots of compilers.
+	// Both stdout and stderr go to the pipe, like on Windows
+	posix_spawn_file_actions_t actions;
+	posix_spawn_file_actions_init(&actions);
+	SCOPE_EXIT{ posix_spawn_file_actions_destroy(&actions); };
+	posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+	posix_spawn_file_actions_adddup2(&actions, fds[1], STDERR_FILENO);
+	posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+	if (m_workdir.size())
+		posix_spawn_file_actions_addchdir_np(&actions, m_workdir.c_str());
+
+	// The environment is the current one, with our variables replacing any with the same name
+	std::vector<std::string> env;
+	for (char** e = environ; *e; e++)
+	{
+		auto it = std::find_if(m_env.begin(), m_env.end(), [e](const std::pair<std::string, std::string>& v)
+		{
+			return strncmp(*e, v.first.c_str(), v.first.size()) == 0 && (*e)[v.first.size()] == '=';
+		});
+		if (it == m_env.end())
+			env.push_back(*e);
+	}
+	for (auto&& e : m_env)
+		env.push_back(e.first + "=" + e.second);
+	std::vector<char*> envp;
+	for (auto&& e : env)
+		envp.push_back(&e[0]);
+	envp.push_back(nullptr);
+
+	const char* argv[] = { "sh", "-c", cmdline.c_str(), nullptr };
+	pid_t pid;
+	int err = posix_spawn(&pid, "/bin/sh", &actions, nullptr, const_cast<char**>(argv), envp.data());
+	close(fds[1]);
+	if (err != 0)
+	{
+		errno = err;
+		ErrorMessage("posix_spawn");
+		close(fds[0]);
+		addOutput(m_errmsg + "\n");
+		return 1;
+	}
+
+	std::vector<char> buf(64 * 1024);
+	while (true)
+	{
+		pollfd pfd = { fds[0], POLLIN, 0 };
+		if (poll(&pfd, 1, -1) < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			ErrorMessage("poll");
+			break;
+		}
+
+		ssize_t n;
+		{
+			CZ_TRACE_SCOPE("process", "read");
+			n = read(fds[0], buf.data(), buf.size());
+		}
+		if (n > 0)
+		{
+			CZ_TRACE_SCOPE("process", "handleOutput");
+			addOutput(std::string(buf.data(), buf.data() + n));
+		}
+		else if (n < 0 && errno == EINTR)
+			continue;
+		else
+			break;
+	}
+	close(fds[0]);
+
+	int status = 0;
+	while (waitpid(pid, &status, 0) < 0)
+	{
+		if (errno != EINTR)
+		{
+			ErrorMessage("waitpid");
+			break;
+		}
+	}
+
+	if (m_errmsg.size())
+		addOutput(m_errmsg + "\n");
+
+	// If for some reason the last output wasn't a EOL, then write one, so the caller gets all the output
+	if (m_tmpline.size())
+		addOutput("\n");
+
+	if (m_errmsg.size())
+		return 1;
+	if (WIFEXITED(status))
+		return WEXITSTATUS(status);
+	return 128 + (WIFSIGNALED(status) ? WTERMSIG(status) : 0);
+}
+
+#endif
+
+} // namespace cz
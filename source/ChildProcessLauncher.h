@@ -1,54 +1,76 @@
-/********************************************************************
-	CrazyGaze (http://www.crazygaze.com)
-	Author : Rui Figueira
-	Email  : rui@crazygaze.com
-	
-	purpose:
-	Code to launch child processes and capture their output	
-*********************************************************************/
-
-#pragma once
-
-namespace cz {
-
-// Child process launcher based on http://support.microsoft.com/kb/190351
-class ChildProcessLauncher
-{
-	enum
-	{
-		BUFSIZE=4096
-	};
-
-public:
-	ChildProcessLauncher();
-	~ChildProcessLauncher();
-	int launch(const std::string& name, const std::string& params, const std::function<void(bool, const std::string& str)>& logfunc=nullptr);
-
-	const std::string& getLaunchErrorMsg()
-	{
-		return m_errmsg;
-	}
-
-	const std::string& getFullOutput() const
-	{
-		return m_output;
-	}
-
-private:
-	int PrepAndLaunchRedirectedChild(HANDLE hChildStdOut, HANDLE hChildStdIn, HANDLE hChildStdErr);
-	int ReadAndHandleOutput(HANDLE hPipeRead);
-	int ErrorMessage(const char* funcnam);
-	void addOutput(const std::string& str);
-	std::string m_errmsg;
-	std::string m_name;
-	//HANDLE m_hStdIn;
-	HANDLE m_hChildProcess;
-	BOOL m_bRunThread;
-	std::string m_params;
-	std::string m_output;
-	std::string m_tmpline;
-	std::function<void(bool isLaunchCmd, const std::string& str)> m_logfunc;
-};
-
-} // namespace cz
-
+/********************************************************************
+	CrazyGaze (http://www.crazygaze.com)
+	Author : Rui Figueira
+	Email  : rui@crazygaze.com
+	
+	purpose:
+	Code to launch child processes and capture their output	
+*********************************************************************/
+
+#pragma once
+
+namespace cz {
+
+// Child process launcher based on http://support.microsoft.com/kb/190351
+// On other platforms, the command line is run with /bin/sh (launched with posix_spawn), so the same quoting rules (double quotes) work.
+class ChildProcessLauncher
+{
+	enum
+	{
+		BUFSIZE=4096
+	};
+
+public:
+	ChildProcessLauncher();
+	~ChildProcessLauncher();
+	int launch(const std::string& name, const std::string& params, const std::function<void(bool, const std::string& str)>& logfunc=nullptr);
+
+	//! Directory the child process runs in. If not set, it uses the current one.
+	void setWorkingDirectory(std::string dir)
+	{
+		m_workdir = std::move(dir);
+	}
+
+	//! Sets an environment variable for the child process, on top of the current environment
+	void setEnvironmentVariable(std::string name, std::string value)
+	{
+		m_env.emplace_back(std::move(name), std::move(value));
+	}
+
+	const std::string& getLaunchErrorMsg()
+	{
+		return m_errmsg;
+	}
+
+	const std::string& getFullOutput() const
+	{
+		return m_output;
+	}
+
+private:
+#ifdef _WIN32
+	int PrepAndLaunchRedirectedChild(HANDLE hChildStdOut, HANDLE hChildStdIn, HANDLE hChildStdErr);
+	int ReadAndHandleOutput(HANDLE hPipeRead);
+	std::wstring buildEnvironmentBlock();
+#else
+	int launchPosix();
+#endif
+	int ErrorMessage(const char* funcnam);
+	void addOutput(const std::string& str);
+	std::string m_errmsg;
+	std::string m_name;
+#ifdef _WIN32
+	//HANDLE m_hStdIn;
+	HANDLE m_hChildProcess;
+	BOOL m_bRunThread;
+#endif
+	std::string m_params;
+	std::string m_workdir;
+	std::vector<std::pair<std::string, std::string>> m_env;
+	std::string m_output;
+	std::string m_tmpline;
+	std::function<void(bool isLaunchCmd, const std::string& str)> m_logfunc;
+};
+
+} // namespace cz
+
@@ -0,0 +1,222 @@
+#include "vimvsPCH.h"
+#include "CompileScheduler.h"
+#include "ChildProcessLauncher.h"
+#include "Logging.h"
+#include "Trace.h"
+#include <atomic>
+#include <string.h>
+
+#ifndef _WIN32
+	#include <unistd.h>
+	#include <fcntl.h>
+	#include <poll.h>
+	#include <errno.h>
+#endif
+
+namespace cz
+{
+
+//////////////////////////////////////////////////////////////////////////
+//		JobServer
+//////////////////////////////////////////////////////////////////////////
+
+JobServer::JobServer()
+{
+	std::string makeflags;
+	if (!getEnvironmentVariable("MAKEFLAGS", makeflags))
+		return;
+
+	// Older versions of make use --jobserver-fds. If both are present, --jobserver-auth is the one to use. For
+	// each, the last one wins, since make appends to the MAKEFLAGS it inherits.
+	std::string auth;
+	for (auto name : { "--jobserver-fds=", "--jobserver-auth=" })
+	{
+		auto pos = makeflags.rfind(name);
+		if (pos == std::string::npos)
+			continue;
+		pos += strlen(name);
+		auth = makeflags.substr(pos, makeflags.find(' ', pos) - pos);
+	}
+
+	if (auth.empty())
+		return;
+
+#ifdef _WIN32
+	m_sem = OpenSemaphoreW(SEMAPHORE_ALL_ACCESS, FALSE, widen(auth).c_str());
+	if (!m_sem)
+		CZ_LOG(logDefault, Warning, "Could not open jobserver semaphore '%s': %s",
+			auth.c_str(), getLastErrorMsg("OpenSemaphoreW").c_str());
+#else
+	std::string fifo;
+	if (beginsWith(auth, "fifo:", &fifo))
+	{
+		m_readFd = m_writeFd = open(fifo.c_str(), O_RDWR);
+		m_ownFds = true;
+		if (m_readFd < 0)
+			CZ_LOG(logDefault, Warning, "Could not open jobserver fifo '%s': %s", fifo.c_str(), strerror(errno));
+	}
+	else if (sscanf(auth.c_str(), "%d,%d", &m_readFd, &m_writeFd) == 2)
+	{
+		// Make doesn't pass the pipe to commands it doesn't think are sub-makes
+		if (fcntl(m_readFd, F_GETFD) < 0 || fcntl(m_writeFd, F_GETFD) < 0)
+		{
+			CZ_LOG(logDefault, Warning, "Jobserver file descriptors '%s' are not open. Is the rule missing a '+'?", auth.c_str());
+			m_readFd = m_writeFd = -1;
+		}
+	}
+	else
+	{
+		CZ_LOG(logDefault, Warning, "Unknown jobserver '%s'", auth.c_str());
+		m_readFd = m_writeFd = -1;
+	}
+#endif
+
+	if (isActive())
+		CZ_LOG(logDefault, Log, "Using jobserver '%s'", auth.c_str());
+}
+
+JobServer::~JobServer()
+{
+#ifdef _WIN32
+	if (m_sem)
+		CloseHandle(m_sem);
+#else
+	// Any tokens we still have go back to make, or its build stalls
+	while (m_tokens.size())
+		release();
+	if (m_ownFds && m_readFd >= 0)
+		close(m_readFd);
+#endif
+}
+
+bool JobServer::isActive() const
+{
+#ifdef _WIN32
+	return m_sem != NULL;
+#else
+	return m_readFd >= 0;
+#endif
+}
+
+bool JobServer::acquire()
+{
+	if (!isActive())
+		return true;
+
+#ifdef _WIN32
+	return WaitForSingleObject(m_sem, INFINITE) == WAIT_OBJECT_0;
+#else
+	char token;
+	while (true)
+	{
+		auto n = read(m_readFd, &token, 1);
+		if (n == 1)
+			break;
+		if (n < 0 && errno == EINTR)
+			continue;
+		// Some versions of make set the pipe as non-blocking
+		if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+		{
+			pollfd pfd = { m_readFd, POLLIN, 0 };
+			poll(&pfd, 1, -1);
+			continue;
+		}
+		CZ_LOG(logDefault, Warning, "Failed to read from the jobserver: %s", strerror(errno));
+		return false;
+	}
+	std::lock_guard<std::mutex> lk(m_mtx);
+	m_tokens.push_back(token);
+	return true;
+#endif
+}
+
+void JobServer::release()
+{
+	if (!isActive())
+		return;
+
+#ifdef _WIN32
+	ReleaseSemaphore(m_sem, 1, NULL);
+#else
+	char token;
+	{
+		std::lock_guard<std::mutex> lk(m_mtx);
+		if (m_tokens.empty())
+			return;
+		token = m_tokens.back();
+		m_tokens.pop_back();
+	}
+	while (write(m_writeFd, &token, 1) < 0 && errno == EINTR)
+	{
+	}
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////
+//		Scheduler
+//////////////////////////////////////////////////////////////////////////
+
+int runCompileJobs(
+	const std::vector<CompileJob>& jobs, int maxJobs, JobServer& jobServer,
+	const std::function<void(const CompileJob& job, int exitCode, const std::string& output)>& onFinished)
+{
+	std::atomic<size_t> next(0);
+	std::atomic<int> failed(0);
+	std::mutex finishedMtx;
+
+	auto worker = [&](bool implicitToken)
+	{
+		if (!implicitToken)
+			trace::setThreadName("Compile worker");
+		while (true)
+		{
+			auto idx = next++;
+			if (idx >= jobs.size())
+				break;
+
+			// Like any make job, we have one token implicitly. Every other concurrent job needs one from the
+			// jobserver.
+			bool gotToken = false;
+			if (!implicitToken)
+			{
+				CZ_TRACE_SCOPE("compile", "acquireToken");
+				gotToken = jobServer.acquire();
+			}
+
+			auto&& job = jobs[idx];
+			CZ_TRACE_SCOPE_DETAIL("compile", "compile", job.file);
+			ChildProcessLauncher launcher;
+			launcher.setWorkingDirectory(job.cmd.workdir);
+			launcher.setEnvironmentVariable("INCLUDE", getIncludeEnvironment(job.cmd.includes));
+			auto exitCode = launcher.launch(job.cmd.compiler, job.cmd.args, [&](bool iscmdline, const std::string& str)
+			{
+				if (iscmdline)
+					CZ_LOG(logDefault, Verbose, "compiler command line: %s", str.c_str());
+			});
+
+			if (gotToken)
+				jobServer.release();
+
+			if (exitCode)
+				failed++;
+
+			CZ_TRACE_SCOPE("compile", "onFinished");
+			std::lock_guard<std::mutex> lk(finishedMtx);
+			onFinished(job, exitCode, launcher.getFullOutput());
+		}
+	};
+
+	int numThreads = std::max(1, std::min(maxJobs, static_cast<int>(jobs.size())));
+	CZ_LOG(logDefault, Log, "Compiling %d files with %d jobs", static_cast<int>(jobs.size()), numThreads);
+	std::vector<std::thread> threads;
+	for (int i = 1; i < numThreads; i++)
+		threads.emplace_back(worker, false);
+	worker(true);
+	for (auto&& t : threads)
+		t.join();
+
+	return failed;
+}
+
+}
+
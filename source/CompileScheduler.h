@@ -0,0 +1,61 @@
+#pragma once
+
+#include "Database.h"
+#include <functional>
+
+namespace cz
+{
+
+//! Client side of the GNU make jobserver.
+// When vimvs is launched from a "make -jN" build, make advertises the jobserver in MAKEFLAGS, and every extra job we
+// run in parallel needs a token from it, so the machine is not oversubscribed.
+// Supported are the pipe (--jobserver-auth=R,W or --jobserver-fds=R,W) and fifo (--jobserver-auth=fifo:PATH)
+// forms on POSIX, and the semaphore form (--jobserver-auth=NAME) on Windows.
+class JobServer
+{
+public:
+	//! Connects to the jobserver in MAKEFLAGS, if there is one
+	JobServer();
+	~JobServer();
+	JobServer(const JobServer&) = delete;
+	JobServer& operator=(const JobServer&) = delete;
+
+	bool isActive() const;
+
+	//! Blocks until a token is available. Returns false if the jobserver failed, in which case the caller should
+	// proceed as if it had the token.
+	bool acquire();
+	//! Gives back a token obtained with acquire
+	void release();
+
+private:
+#ifdef _WIN32
+	HANDLE m_sem = NULL;
+#else
+	int m_readFd = -1;
+	int m_writeFd = -1;
+	bool m_ownFds = false; // True if we opened a fifo, so we need to close it
+	// Tokens read, so we give back the same ones. Make uses the token values in some cases.
+	std::vector<char> m_tokens;
+	std::mutex m_mtx;
+#endif
+};
+
+struct CompileJob
+{
+	std::string file;
+	CompileCommand cmd;
+};
+
+//! Runs the compile jobs, with up to 'maxJobs' compilers running at once.
+// \param onFinished
+//		Called as each job finishes, with the job's exit code and output. Calls are serialized, so it's safe to
+//		access shared state.
+// \return
+//		Number of jobs that failed
+int runCompileJobs(
+	const std::vector<CompileJob>& jobs, int maxJobs, JobServer& jobServer,
+	const std::function<void(const CompileJob& job, int exitCode, const std::string& output)>& onFinished);
+
+}
+
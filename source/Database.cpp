@@ -1,151 +1,678 @@
-#include "vimvsPCH.h"
-#include "Database.h"
-#include "Logging.h"
-#include "Utils.h"
-
-namespace cz
-{
-
-Database::Database()
-{
-}
-
-bool Database::open(const std::string& dbfname)
-{
-	bool createDb = !isExistingFile(dbfname);
-	if (createDb)
-		CZ_LOG(logDefault, Log, "Creating database '%s'", dbfname.c_str());
-	CZ_CHECK(m_sqdb.open(dbfname.c_str(), createDb));
-
-	SqStmt optimize;
-	optimize.init(m_sqdb, "PRAGMA synchronous = OFF");
-	CZ_CHECK(optimize.exec());
-
-	//
-	// Create necessary tables
-	//
-	if (createDb)
-	{
-		SqStmt sql;
-		sql.init(m_sqdb, " \
-			CREATE TABLE files ( \
-				id            INTEGER PRIMARY KEY, \
-				fullpath      VARCHAR COLLATE NOCASE, \
-				name          VARCHAR COLLATE NOCASE, \
-				prjName       VARCHAR, \
-				prjFile       VARCHAR, \
-				configuration VARCHAR, \
-				defines       VARCHAR, \
-				includes      VARCHAR \
-			); \
-		");
-
-		CZ_CHECK(sql.exec());
-	}
-
-	CZ_CHECK(m_sqlGetFile.init(m_sqdb, "SELECT * FROM files WHERE id=?"));
-	CZ_CHECK(m_sqlGetWithBasename.init(m_sqdb, "SELECT * FROM files WHERE name=?"));
-	CZ_CHECK(m_sqlAddFile.init(m_sqdb, "INSERT OR REPLACE INTO files(id,fullpath,name,prjName,prjFile,configuration,defines,includes) VALUES(?,?,?,?,?,?,?,?)"));
-
-	return true;
-}
-
-bool Database::getFile(SourceFile& out)
-{
-	auto fid = out.id;
-	if (!fid)
-	{
-		CZ_CHECK(out.fullpath.size());
-		fid = hash(tolower(out.fullpath));
-	}
-
-	CZ_CHECK(m_sqlGetFile.bindInt64(1, fid));
-
-	bool found = false;
-	m_sqlGetFile.exec<int64_t, const char*, const char*, const char*, const char*, const char*, const char*, const char*>(
-		[&](int64_t id, const char* fullpath, const char* name, const char* prjName, const char* prjFile, const char* configuration, const char* defines, const char* includes)
-	{
-		CZ_ASSERT(fid == id);
-		out.id = id;
-		out.fullpath = fullpath;
-		out.name = name;
-		out.prjName = prjName;
-		out.prjFile = prjFile;
-		out.configuration = configuration;
-		out.defines = defines;
-		out.includes = includes;
-		found = true;
-		return true;
-	});
-
-	return found;
-}
-
-std::vector<SourceFile> Database::getWithBasename(const std::string& filename)
-{
-	std::vector<SourceFile> res;
-
-	CZ_CHECK(m_sqlGetWithBasename.bindText(1, filename));
-
-	m_sqlGetWithBasename.exec<int64_t, const char*, const char*, const char*, const char*, const char*, const char*, const char*>(
-		[&](int64_t id, const char* fullpath, const char* name, const char* prjName, const char* prjFile, const char* configuration, const char* defines, const char* includes)
-	{
-		SourceFile out;
-		out.id = id;
-		out.fullpath = fullpath;
-		out.name = name;
-		out.prjName = prjName;
-		out.prjFile = prjFile;
-		out.configuration = configuration;
-		out.defines = defines;
-		out.includes = includes;
-		res.push_back(std::move(out));
-		return true;
-	});
-
-	return res;
-}
-
-void Database::addFile(
-	const std::string& fullpath,
-	const std::string& prjName, const std::string& prjFile,
-	const std::string& defines,
-	const std::string& includes,
-	bool insertOrReplace)
-{
-	SourceFile src;
-	src.id = hash(tolower(fullpath));
-
-	// If this file was added as part of this vimvs session, then nothing to do
-	// This avoid all the repeated "Adding file ..." logs for header files
-	if (!m_inserted.insert(src.id).second)
-		return;
-
-	if (insertOrReplace || !getFile(src))
-	{
-		auto basename = splitFolderAndFile(fullpath).second;
-		CZ_LOG(logDefault, Log, "Adding file %s to database: id=%llu, fullpath=\"%s\", prj=%s|\"%s\", %s|%s",
-			basename.c_str(), src.id, fullpath.c_str(), prjName.c_str(), prjFile.c_str(),
-			defines.c_str() , includes.c_str());
-		CZ_CHECK(m_sqlAddFile.bindInt64(1, src.id));
-		CZ_CHECK(m_sqlAddFile.bindText(2, fullpath));
-		CZ_CHECK(m_sqlAddFile.bindText(3, basename));
-		CZ_CHECK(m_sqlAddFile.bindText(4, prjName));
-		CZ_CHECK(m_sqlAddFile.bindText(5, prjFile));
-		CZ_CHECK(m_sqlAddFile.bindText(6, "")); // configuration
-		CZ_CHECK(m_sqlAddFile.bindText(7, defines));
-		CZ_CHECK(m_sqlAddFile.bindText(8, includes));
-		CZ_CHECK(m_sqlAddFile.exec());
-	}
-}
-
-SourceFile Database::getFile(const std::string& filename)
-{
-	SourceFile s;
-	s.fullpath = filename;
-	getFile(s);
-	return s;
-}
-
-}
-
+#include "vimvsPCH.h"
+#include "Database.h"
+#include "Logging.h"
+#include "Utils.h"
+#include "Trace.h"
+
+namespace cz
+{
+
+// How long persist waits for readers of the database file to finish their query, if it can't replace the file
+static const int kPersistBusyTimeoutMs = 10000;
+
+int64_t calcFilesStamp(const std::string& files)
+{
+	std::string s;
+	size_t start = 0;
+	while (start < files.size())
+	{
+		auto e = files.find(';', start);
+		if (e == std::string::npos)
+			e = files.size();
+		s += formatString("%lld;", getFileModificationTime(files.substr(start, e - start)));
+		start = e + 1;
+	}
+	return hash(s);
+}
+
+// Converts the system includes in a SourceFile::includes string to what the compiler expects in the INCLUDE
+// environment variable
+std::string getIncludeEnvironment(const std::string& includes)
+{
+	std::string res;
+	size_t start = 0;
+	while (start < includes.size())
+	{
+		auto e = includes.find('|', start);
+		if (e == std::string::npos)
+			e = includes.size();
+		std::string inc;
+		if (beginsWith(includes.substr(start, e - start), "-isystem", &inc))
+			res += (res.size() ? ";" : "") + inc;
+		start = e + 1;
+	}
+	return res;
+}
+
+Database::Database()
+{
+}
+
+bool Database::open(const std::string& dbfname, bool inMemory)
+{
+	m_filename = dbfname;
+	m_inMemory = inMemory;
+	bool createDb = !isExistingFile(dbfname);
+	if (createDb)
+		CZ_LOG(logDefault, Log, "Creating database '%s'", dbfname.c_str());
+
+	if (inMemory)
+	{
+		CZ_CHECK(m_sqdb.open(":memory:", true));
+		// Start with what we have in the file, so things like -incremental still work
+		if (!createDb)
+		{
+			SqDatabase file;
+			CZ_CHECK(file.open(dbfname.c_str(), false));
+			CZ_CHECK(m_sqdb.backupFrom(file));
+		}
+	}
+	else
+	{
+		CZ_CHECK(m_sqdb.open(dbfname.c_str(), createDb));
+	}
+
+	SqStmt optimize;
+	optimize.init(m_sqdb, "PRAGMA synchronous = OFF");
+	CZ_CHECK(optimize.exec());
+
+	//
+	// The database can always be generated again with -builddb, so if it was created by a different version of
+	// vimvs, we just recreate the tables
+	//
+	bool createTables = createDb;
+	if (!createDb)
+	{
+		int version = 0;
+		SqStmt sql;
+		CZ_CHECK(sql.init(m_sqdb, "PRAGMA user_version"));
+		sql.exec<int>([&](int v)
+		{
+			version = v;
+			return true;
+		});
+
+		// Version 4 only differs in how file ids are calculated, and those can be calculated again from the paths,
+		// so there is no need to build the database again
+		if (version == 4 && migrateFileIds())
+			version = 5;
+		// Version 5 only lacks the directory column, which is calculated from the paths too
+		if (version == 5 && migrateDirs())
+			version = 6;
+		// Version 6 only lacks the users table, and the origins are the best we know until the next build
+		if (version == 6 && migrateUsers())
+			version = VIMVS_DB_VERSION;
+
+		if (version != VIMVS_DB_VERSION)
+		{
+			CZ_LOG(logDefault, Log, "Database version is %d. Recreating it with version %d", version, VIMVS_DB_VERSION);
+			for (auto table : { "files", "users", "projects", "settings" })
+			{
+				SqStmt drop;
+				CZ_CHECK(drop.init(m_sqdb, formatString("DROP TABLE IF EXISTS %s", table)));
+				CZ_CHECK(drop.exec());
+			}
+			createTables = true;
+		}
+	}
+
+	//
+	// Create necessary tables
+	//
+	if (createTables)
+	{
+		// Allows giving back free pages with "PRAGMA incremental_vacuum" (see Database::vacuum). On existing
+		// databases, this only takes effect after a VACUUM, which is cheap at this point since the tables were
+		// dropped.
+		SqStmt autoVacuum;
+		CZ_CHECK(autoVacuum.init(m_sqdb, "PRAGMA auto_vacuum = INCREMENTAL"));
+		CZ_CHECK(autoVacuum.exec());
+		if (!createDb)
+		{
+			SqStmt vacuum;
+			CZ_CHECK(vacuum.init(m_sqdb, "VACUUM"));
+			CZ_CHECK(vacuum.exec());
+		}
+
+		SqStmt sql;
+		sql.init(m_sqdb, " \
+			CREATE TABLE files ( \
+				id            INTEGER, \
+				fullpath      VARCHAR COLLATE NOCASE, \
+				name          VARCHAR COLLATE NOCASE, \
+				prjName       VARCHAR, \
+				prjFile       VARCHAR, \
+				configuration VARCHAR, \
+				defines       VARCHAR, \
+				includes      VARCHAR, \
+				origin        VARCHAR, \
+				generation    INTEGER, \
+				compiler      VARCHAR, \
+				args          VARCHAR, \
+				workdir       VARCHAR, \
+				dir           VARCHAR COLLATE NOCASE, \
+				PRIMARY KEY(id, configuration) \
+			); \
+		");
+		CZ_CHECK(sql.exec());
+
+		SqStmt originIdx;
+		originIdx.init(m_sqdb, "CREATE INDEX files_origin ON files(origin, configuration)");
+		CZ_CHECK(originIdx.exec());
+
+		CZ_CHECK(createUsersTable());
+
+		// What was used to generate the database rows of each project, so -builddb -incremental knows what
+		// projects need to be processed again
+		SqStmt prjSql;
+		prjSql.init(m_sqdb, " \
+			CREATE TABLE projects ( \
+				name          VARCHAR, \
+				configuration VARCHAR, \
+				prjFile       VARCHAR, \
+				prjConfiguration VARCHAR, \
+				files         VARCHAR, \
+				stamp         INTEGER, \
+				clHash        INTEGER, \
+				PRIMARY KEY(name, configuration) \
+			); \
+		");
+		CZ_CHECK(prjSql.exec());
+
+		SqStmt settingsSql;
+		settingsSql.init(m_sqdb, " \
+			CREATE TABLE settings ( \
+				name          VARCHAR PRIMARY KEY, \
+				value         INTEGER \
+			); \
+		");
+		CZ_CHECK(settingsSql.exec());
+
+		SqStmt version;
+		CZ_CHECK(version.init(m_sqdb, formatString("PRAGMA user_version = %d", VIMVS_DB_VERSION)));
+		CZ_CHECK(version.exec());
+	}
+
+	// Used by -getalt. Created here instead of with the tables, so databases created before it existed get it too.
+	SqStmt nameIdx;
+	CZ_CHECK(nameIdx.init(m_sqdb, "CREATE INDEX IF NOT EXISTS files_name ON files(name)"));
+	CZ_CHECK(nameIdx.exec());
+	// Used by -getycm, for files not in the database yet
+	SqStmt dirIdx;
+	CZ_CHECK(dirIdx.init(m_sqdb, "CREATE INDEX IF NOT EXISTS files_dir ON files(dir, configuration)"));
+	CZ_CHECK(dirIdx.exec());
+
+	CZ_CHECK(m_sqlGetFile.init(m_sqdb, "SELECT " VIMVS_FILES_COLUMNS " FROM files WHERE id=? AND configuration=?"));
+	CZ_CHECK(m_sqlGetFileAnyConfiguration.init(m_sqdb, "SELECT " VIMVS_FILES_COLUMNS " FROM files WHERE id=? LIMIT 1"));
+	// The same file can be in the database for several configurations, but we only want it once.
+	// DISTINCT uses the column's collation, so this is case insensitive.
+	CZ_CHECK(m_sqlGetFullpathsWithBasename.init(m_sqdb, "SELECT DISTINCT fullpath FROM files WHERE name=?"));
+	// Files with a compile command (sources) first, since headers have the flags of whatever source included them
+	CZ_CHECK(m_sqlGetFileInDirectory.init(m_sqdb, "SELECT " VIMVS_FILES_COLUMNS " FROM files WHERE dir=?1 AND (?2='' OR configuration=?2) ORDER BY compiler='' LIMIT 1"));
+	CZ_CHECK(m_sqlGetAll.init(m_sqdb, "SELECT " VIMVS_FILES_COLUMNS " FROM files WHERE configuration=?"));
+	CZ_CHECK(m_sqlGetCompileCommand.init(m_sqdb, "SELECT compiler,args,workdir,includes FROM files WHERE id=? AND configuration=? AND compiler<>''"));
+	CZ_CHECK(m_sqlAddFile.init(m_sqdb, "INSERT OR REPLACE INTO files(id,fullpath,name,prjName,prjFile,configuration,defines,includes,origin,generation,compiler,args,workdir,dir) VALUES(?,?,?,?,?,?,?,?,?,?,?,?,?,?)"));
+	CZ_CHECK(m_sqlAddUser.init(m_sqdb, "INSERT OR REPLACE INTO users(id,configuration,prjName,generation) VALUES(?,?,?,?)"));
+	CZ_CHECK(m_sqlRemoveStaleUsers.init(m_sqdb, "DELETE FROM users WHERE prjName=? AND configuration=? AND generation<?"));
+	// Any other user will do, but by name so it's deterministic
+	CZ_CHECK(m_sqlReassignOrigin.init(m_sqdb,
+		"UPDATE files SET origin=(SELECT prjName FROM users WHERE users.id=files.id AND users.configuration=files.configuration ORDER BY prjName LIMIT 1) "
+		"WHERE origin=?1 AND configuration=?2 AND generation<?3 "
+		"AND EXISTS(SELECT 1 FROM users WHERE users.id=files.id AND users.configuration=files.configuration)"));
+	CZ_CHECK(m_sqlTouchFile.init(m_sqdb, "UPDATE files SET generation=? WHERE id=? AND configuration=?"));
+	CZ_CHECK(m_sqlRemoveStaleFiles.init(m_sqdb, "DELETE FROM files WHERE origin=? AND configuration=? AND generation<?"));
+	CZ_CHECK(m_sqlRemoveProjectFiles.init(m_sqdb, "DELETE FROM files WHERE origin=? AND configuration=?"));
+	CZ_CHECK(m_sqlGetProjects.init(m_sqdb, "SELECT name,prjFile,prjConfiguration,files,stamp,clHash FROM projects WHERE configuration=?"));
+	CZ_CHECK(m_sqlSetProject.init(m_sqdb, "INSERT OR REPLACE INTO projects(name,configuration,prjFile,prjConfiguration,files,stamp,clHash) VALUES(?,?,?,?,?,?,?)"));
+	CZ_CHECK(m_sqlRemoveProject.init(m_sqdb, "DELETE FROM projects WHERE name=? AND configuration=?"));
+	CZ_CHECK(m_sqlGetSetting.init(m_sqdb, "SELECT value FROM settings WHERE name=?"));
+	CZ_CHECK(m_sqlSetSetting.init(m_sqdb, "INSERT OR REPLACE INTO settings(name,value) VALUES(?,?)"));
+
+	CZ_CHECK(m_sqlGetSetting.bind("generation"));
+	m_sqlGetSetting.exec<int64_t>([&](int64_t v)
+	{
+		m_generation = v;
+		return true;
+	});
+
+	return true;
+}
+
+bool Database::persist()
+{
+	if (!m_inMemory)
+		return true;
+
+	CZ_LOG(logDefault, Log, "Writing in memory database to '%s'", m_filename.c_str());
+	CZ_TRACE_SCOPE("db", "persist");
+
+	// Write to a temporary file first, and replace the real one, so other vimvs instances never see a half written
+	// database
+	auto tmp = m_filename + ".tmp";
+	deleteFile(tmp);
+	{
+		SqDatabase file;
+		if (!file.open(tmp.c_str(), true) || !file.backupFrom(m_sqdb))
+		{
+			CZ_LOG(logDefault, Error, "Failed to write database to '%s'", tmp.c_str());
+			return false;
+		}
+	}
+
+	if (renameFile(tmp, m_filename))
+		return true;
+
+	// On Windows, the file can't be replaced while someone has it open (e.g: the editor's -server). The backup API
+	// writes into it in a single transaction, so its readers still see either the old or the new database. It waits
+	// for readers in the middle of a query to finish.
+	CZ_LOG(logDefault, Warning, "Failed to replace '%s' (%s). Writing into it instead.",
+		m_filename.c_str(), getLastErrorMsg("renameFile").c_str());
+	deleteFile(tmp);
+	SqDatabase file;
+	if (!file.open(m_filename.c_str(), true))
+		return false;
+	sqlite3_busy_timeout(file, kPersistBusyTimeoutMs);
+	if (!file.backupFrom(m_sqdb))
+	{
+		CZ_LOG(logDefault, Error, "Failed to write database to '%s'", m_filename.c_str());
+		return false;
+	}
+	return true;
+}
+
+void Database::beginGeneration()
+{
+	m_generation++;
+	CZ_LOG(logDefault, Log, "Database generation %lld", m_generation);
+	CZ_CHECK(m_sqlSetSetting.bind("generation", m_generation));
+	CZ_CHECK(m_sqlSetSetting.exec());
+	// Files need to be stamped again, even if they were already added in this session
+	m_inserted.clear();
+	m_users.clear();
+}
+
+void Database::setConfiguration(std::string configuration)
+{
+	if (configuration == m_configuration)
+		return;
+	m_configuration = std::move(configuration);
+	// The same files will be added again for the new configuration
+	m_inserted.clear();
+	m_users.clear();
+}
+
+bool Database::getFile(SourceFile& out, bool anyConfiguration)
+{
+	auto fid = out.id;
+	if (!fid)
+	{
+		CZ_CHECK(out.fullpath.size());
+		fid = hashPath(out.fullpath);
+	}
+
+	// If no configuration is specified, any will do
+	anyConfiguration = anyConfiguration || m_configuration.empty();
+
+	bool found = false;
+	auto cb = [&](int64_t id, std::string_view fullpath, std::string_view name, std::string_view prjName, std::string_view prjFile, std::string_view configuration, std::string_view defines, std::string_view includes)
+	{
+		CZ_ASSERT(fid == id);
+		out.id = id;
+		out.fullpath = fullpath;
+		out.name = name;
+		out.prjName = prjName;
+		out.prjFile = prjFile;
+		out.configuration = configuration;
+		out.defines = defines;
+		out.includes = includes;
+		found = true;
+		return true;
+	};
+
+	if (m_configuration.size())
+	{
+		CZ_CHECK(m_sqlGetFile.bind(fid, m_configuration));
+		m_sqlGetFile.exec<int64_t, VIMVS_FILES_COLUMNS_VIEWS>(cb);
+	}
+
+	if (!found && anyConfiguration)
+	{
+		CZ_CHECK(m_sqlGetFileAnyConfiguration.bind(fid));
+		m_sqlGetFileAnyConfiguration.exec<int64_t, VIMVS_FILES_COLUMNS_VIEWS>(cb);
+	}
+
+	return found;
+}
+
+bool Database::getFileInDirectory(const std::string& dir, SourceFile& out)
+{
+	bool found = false;
+	CZ_CHECK(m_sqlGetFileInDirectory.bind(dir, m_configuration));
+	m_sqlGetFileInDirectory.exec<int64_t, VIMVS_FILES_COLUMNS_VIEWS>(
+		[&](int64_t id, std::string_view fullpath, std::string_view name, std::string_view prjName, std::string_view prjFile, std::string_view configuration, std::string_view defines, std::string_view includes)
+	{
+		out = SourceFile{ static_cast<uint64_t>(id), std::string(fullpath), std::string(name), std::string(prjName),
+			std::string(prjFile), std::string(configuration), std::string(defines), std::string(includes) };
+		found = true;
+		return true;
+	});
+	return found;
+}
+
+FileRow prepareFileRow(std::string fullpath, std::shared_ptr<const FileSettings> settings, std::string args)
+{
+	FileRow row;
+	row.id = hashPath(fullpath);
+	auto folderAndFile = splitFolderAndFile(fullpath);
+	row.dir = std::move(folderAndFile.first);
+	row.name = std::move(folderAndFile.second);
+	row.fullpath = std::move(fullpath);
+	row.args = std::move(args);
+	row.settings = std::move(settings);
+	return row;
+}
+
+void Database::addFile(
+	const std::string& fullpath,
+	const std::string& prjName, const std::string& prjFile,
+	const std::string& defines,
+	const std::string& includes,
+	const std::string& origin,
+	bool insertOrReplace,
+	const CompileCommand* cmd)
+{
+	auto settings = std::make_shared<FileSettings>();
+	settings->prjName = prjName;
+	settings->prjFile = prjFile;
+	settings->defines = defines;
+	settings->includes = includes;
+	settings->origin = origin;
+	if (cmd)
+	{
+		settings->hasCmd = true;
+		settings->compiler = cmd->compiler;
+		settings->workdir = cmd->workdir;
+	}
+	addFile(prepareFileRow(fullpath, std::move(settings), cmd ? cmd->args : ""), insertOrReplace);
+}
+
+void Database::addFile(const FileRow& row, bool insertOrReplace)
+{
+	CZ_TRACE_SCOPE("db", "addFile");
+	const FileSettings& s = *row.settings;
+	SourceFile src;
+	src.id = row.id;
+	addUser(src.id, s.origin);
+
+	// If this file was added as part of this vimvs session, then nothing to do
+	// This avoid all the repeated "Adding file ..." logs for header files
+	if (!m_inserted.insert(src.id).second)
+		return;
+
+	if (insertOrReplace || !getFile(src, false))
+	{
+		CZ_LOG(logDefault, Verbose, "Adding file %s to database: id=%llu, fullpath=\"%s\", prj=%s|\"%s\", %s|%s",
+			row.name.c_str(), src.id, row.fullpath.c_str(), s.prjName.c_str(), s.prjFile.c_str(),
+			s.defines.c_str() , s.includes.c_str());
+		std::string_view compiler = "", args = "", workdir = "";
+		if (s.hasCmd)
+		{
+			compiler = s.compiler;
+			args = row.args;
+			workdir = s.workdir;
+		}
+		CZ_CHECK(m_sqlAddFile.bind(src.id, row.fullpath, row.name, s.prjName, s.prjFile, m_configuration, s.defines,
+			s.includes, s.origin, m_generation, compiler, args, workdir, row.dir));
+		CZ_CHECK(m_sqlAddFile.exec());
+	}
+	else
+	{
+		// Still in use, so it must survive removeStaleFiles
+		CZ_CHECK(m_sqlTouchFile.bind(m_generation, src.id, m_configuration));
+		CZ_CHECK(m_sqlTouchFile.exec());
+	}
+}
+
+bool Database::migrateFileIds()
+{
+	CZ_LOG(logDefault, Log, "Recalculating file ids of database version 4");
+
+	std::vector<std::pair<int64_t, std::string>> files;
+	SqStmt select;
+	CZ_CHECK(select.init(m_sqdb, "SELECT rowid,fullpath FROM files"));
+	select.exec<int64_t, std::string_view>([&](int64_t rowid, std::string_view fullpath)
+	{
+		files.emplace_back(rowid, fullpath);
+		return true;
+	});
+
+	SqTransaction transaction(m_sqdb);
+	SqStmt update;
+	CZ_CHECK(update.init(m_sqdb, "UPDATE files SET id=? WHERE rowid=?"));
+	for (auto&& f : files)
+	{
+		CZ_CHECK(update.bind(hashPath(f.second), f.first));
+		if (!update.exec())
+		{
+			// The transaction is rolled back, and the caller recreates the tables
+			CZ_LOG(logDefault, Warning, "Failed to recalculate the id of '%s'", f.second.c_str());
+			return false;
+		}
+	}
+
+	SqStmt version;
+	CZ_CHECK(version.init(m_sqdb, "PRAGMA user_version = 5"));
+	CZ_CHECK(version.exec());
+	transaction.commit();
+	CZ_LOG(logDefault, Log, "Recalculated the ids of %d files", static_cast<int>(files.size()));
+	return true;
+}
+
+bool Database::migrateDirs()
+{
+	CZ_LOG(logDefault, Log, "Adding the directories to database version 5");
+
+	SqTransaction transaction(m_sqdb);
+	SqStmt alter;
+	CZ_CHECK(alter.init(m_sqdb, "ALTER TABLE files ADD COLUMN dir VARCHAR COLLATE NOCASE"));
+	if (!alter.exec())
+		return false;
+
+	std::vector<std::pair<int64_t, std::string>> files;
+	SqStmt select;
+	CZ_CHECK(select.init(m_sqdb, "SELECT rowid,fullpath FROM files"));
+	select.exec<int64_t, std::string_view>([&](int64_t rowid, std::string_view fullpath)
+	{
+		files.emplace_back(rowid, fullpath);
+		return true;
+	});
+
+	SqStmt update;
+	CZ_CHECK(update.init(m_sqdb, "UPDATE files SET dir=? WHERE rowid=?"));
+	for (auto&& f : files)
+	{
+		CZ_CHECK(update.bind(splitFolderAndFile(f.second).first, f.first));
+		if (!update.exec())
+			return false;
+	}
+
+	SqStmt version;
+	CZ_CHECK(version.init(m_sqdb, "PRAGMA user_version = 6"));
+	CZ_CHECK(version.exec());
+	transaction.commit();
+	return true;
+}
+
+bool Database::createUsersTable()
+{
+	// Every project that used each file in the last build of that project. A file's row is only removed once no
+	// project uses it.
+	SqStmt sql;
+	sql.init(m_sqdb, " \
+		CREATE TABLE users ( \
+			id            INTEGER, \
+			configuration VARCHAR, \
+			prjName       VARCHAR, \
+			generation    INTEGER, \
+			PRIMARY KEY(id, configuration, prjName) \
+		); \
+	");
+	if (!sql.exec())
+		return false;
+
+	SqStmt prjIdx;
+	CZ_CHECK(prjIdx.init(m_sqdb, "CREATE INDEX users_prj ON users(prjName, configuration)"));
+	return prjIdx.exec();
+}
+
+bool Database::migrateUsers()
+{
+	CZ_LOG(logDefault, Log, "Adding the users table to database version 6");
+
+	SqTransaction transaction(m_sqdb);
+	if (!createUsersTable())
+		return false;
+	SqStmt fill;
+	CZ_CHECK(fill.init(m_sqdb,
+		"INSERT INTO users(id,configuration,prjName,generation) SELECT id,configuration,origin,generation FROM files WHERE origin<>''"));
+	if (!fill.exec())
+		return false;
+
+	SqStmt version;
+	CZ_CHECK(version.init(m_sqdb, formatString("PRAGMA user_version = %d", VIMVS_DB_VERSION)));
+	CZ_CHECK(version.exec());
+	transaction.commit();
+	return true;
+}
+
+void Database::addUser(uint64_t id, const std::string& prjName)
+{
+	if (prjName.empty() || !m_users.emplace(id, prjName).second)
+		return;
+	CZ_CHECK(m_sqlAddUser.bind(id, m_configuration, prjName, m_generation));
+	CZ_CHECK(m_sqlAddUser.exec());
+}
+
+void Database::addFileUser(const std::string& fullpath, const std::string& prjName)
+{
+	addUser(hashPath(fullpath), prjName);
+}
+
+void Database::reassignSharedFiles(const std::string& prjName, int64_t generation)
+{
+	CZ_CHECK(m_sqlRemoveStaleUsers.bind(prjName, m_configuration, generation));
+	CZ_CHECK(m_sqlRemoveStaleUsers.exec());
+	CZ_CHECK(m_sqlReassignOrigin.bind(prjName, m_configuration, generation));
+	CZ_CHECK(m_sqlReassignOrigin.exec());
+	auto count = m_sqdb.changes();
+	if (count)
+		CZ_LOG(logDefault, Log, "Kept %d files of project '%s' that other projects use", count, prjName.c_str());
+}
+
+void Database::removeProjectFiles(const std::string& prjName)
+{
+	CZ_LOG(logDefault, Log, "Removing files of project %s from the database", prjName.c_str());
+	reassignSharedFiles(prjName, std::numeric_limits<int64_t>::max());
+	CZ_CHECK(m_sqlRemoveProjectFiles.bind(prjName, m_configuration));
+	CZ_CHECK(m_sqlRemoveProjectFiles.exec());
+}
+
+void Database::removeStaleFiles(const std::string& prjName)
+{
+	CZ_TRACE_SCOPE("db", "removeStaleFiles");
+	reassignSharedFiles(prjName, m_generation);
+	CZ_CHECK(m_sqlRemoveStaleFiles.bind(prjName, m_configuration, m_generation));
+	CZ_CHECK(m_sqlRemoveStaleFiles.exec());
+	auto count = m_sqdb.changes();
+	if (count)
+		CZ_LOG(logDefault, Log, "Removed %d stale files of project '%s' from the database", count, prjName.c_str());
+}
+
+void Database::vacuum()
+{
+	// sqlite3_exec steps the pragma until all the free pages are released
+	SqErrMsg errmsg;
+	if (sqlite3_exec(m_sqdb, "PRAGMA incremental_vacuum", nullptr, nullptr, errmsg) != SQLITE_OK)
+	{
+		CZ_LOG(logDefault, Error, "Failed to vacuum the database: %s", errmsg.errmsg);
+		return;
+	}
+	CZ_LOG(logDefault, Log, "Database vacuumed");
+}
+
+void Database::beginChanges()
+{
+	if (m_changesDepth++ == 0)
+		m_changes = std::make_unique<SqTransaction>(m_sqdb);
+}
+
+void Database::commitChanges()
+{
+	CZ_CHECK(m_changesDepth > 0);
+	if (--m_changesDepth == 0)
+	{
+		m_changes->commit();
+		m_changes.reset();
+	}
+}
+
+std::vector<ProjectInfo> Database::getProjects()
+{
+	std::vector<ProjectInfo> res;
+	CZ_CHECK(m_sqlGetProjects.bind(m_configuration));
+	m_sqlGetProjects.exec<std::string_view, std::string_view, std::string_view, std::string_view, int64_t, int64_t>(
+		[&](std::string_view name, std::string_view prjFile, std::string_view prjConfiguration, std::string_view files, int64_t stamp, int64_t clHash)
+	{
+		ProjectInfo prj;
+		prj.name = name;
+		prj.prjFile = prjFile;
+		prj.prjConfiguration = prjConfiguration;
+		prj.files = files;
+		prj.stamp = stamp;
+		prj.clHash = clHash;
+		res.push_back(std::move(prj));
+		return true;
+	});
+	return res;
+}
+
+void Database::setProject(const ProjectInfo& prj)
+{
+	CZ_CHECK(m_sqlSetProject.bind(prj.name, m_configuration, prj.prjFile, prj.prjConfiguration, prj.files, prj.stamp, prj.clHash));
+	CZ_CHECK(m_sqlSetProject.exec());
+}
+
+void Database::removeProject(const std::string& prjName)
+{
+	removeProjectFiles(prjName);
+	CZ_CHECK(m_sqlRemoveProject.bind(prjName, m_configuration));
+	CZ_CHECK(m_sqlRemoveProject.exec());
+}
+
+bool Database::getCompileCommand(const std::string& filename, CompileCommand& out)
+{
+	bool found = false;
+	CZ_CHECK(m_sqlGetCompileCommand.bind(hashPath(filename), m_configuration));
+	m_sqlGetCompileCommand.exec<std::string_view, std::string_view, std::string_view, std::string_view>(
+		[&](std::string_view compiler, std::string_view args, std::string_view workdir, std::string_view includes)
+	{
+		out.compiler = compiler;
+		out.args = args;
+		out.workdir = workdir;
+		out.includes = includes;
+		found = true;
+		return true;
+	});
+	return found;
+}
+
+SourceFile Database::getFile(const std::string& filename, bool anyConfiguration)
+{
+	SourceFile s;
+	s.fullpath = filename;
+	getFile(s, anyConfiguration);
+	return s;
+}
+
+}
+
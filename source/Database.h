@@ -1,73 +1,286 @@
-#pragma once
-
-#include "Utils.h"
-#include "SqLiteWrapper.h"
-#include <vector>
-#include <memory>
-#include <unordered_map>
-#include <set>
-#include "BuildGraph.h"
-
-namespace cz
-{
-
-inline std::string joinParamsDB(const char* prefix, const std::vector<std::string>& v)
-{
-	std::string res;
-	for (auto&& i : v)
-		res += prefix + i + "|";
-	return res;
-}
-
-inline std::string joinDefines(const std::vector<std::string>& v)
-{
-	return joinParamsDB("-D", v);
-}
-
-inline std::string joinSystemIncludes(const std::vector<std::string>& v)
-{
-	return joinParamsDB("-isystem", v);
-}
-
-inline std::string joinUserIncs(const std::vector<std::string>& v)
-{
-	return joinParamsDB("-I", v);
-}
-
-struct SourceFile
-{
-	uint64_t id = 0;
-	std::string fullpath;
-	std::string name;
-	std::string prjName;
-	std::string prjFile;
-	std::string configuration;
-	std::string defines;
-	std::string includes;
-};
-
-class Database
-{
-public:
-	Database();
-	bool open(const std::string& dbfname);
-
-	void addFile(
-		const std::string& fullpath,
-		const std::string& prjName, const std::string& prjFile,
-		const std::string& defines,
-		const std::string& includes,
-		bool insertOrReplace);
-	SourceFile getFile(const std::string& filename);
-	std::vector<SourceFile> getWithBasename(const std::string& filename);
-private:
-	bool getFile(SourceFile& out);
-	SqDatabase m_sqdb;
-	SqStmt m_sqlGetFile;
-	SqStmt m_sqlGetWithBasename;
-	SqStmt m_sqlAddFile;
-	std::set<uint64_t> m_inserted;
-};
-
-}
-
+#pragma once
+
+#include "Utils.h"
+#include "SqLiteWrapper.h"
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <set>
+#include "BuildGraph.h"
+
+namespace cz
+{
+
+inline std::string joinParamsDB(const char* prefix, const std::vector<std::string>& v)
+{
+	std::string res;
+	for (auto&& i : v)
+		res += prefix + i + "|";
+	return res;
+}
+
+inline std::string joinDefines(const std::vector<std::string>& v)
+{
+	return joinParamsDB("-D", v);
+}
+
+inline std::string joinSystemIncludes(const std::vector<std::string>& v)
+{
+	return joinParamsDB("-isystem", v);
+}
+
+inline std::string joinUserIncs(const std::vector<std::string>& v)
+{
+	return joinParamsDB("-I", v);
+}
+
+struct SourceFile
+{
+	uint64_t id = 0;
+	std::string fullpath;
+	std::string name;
+	std::string prjName;
+	std::string prjFile;
+	std::string configuration;
+	std::string defines;
+	std::string includes;
+};
+
+//! Same as SourceFile, but pointing to the database's memory, so only valid while iterating (see
+// Database::iterateFiles)
+struct SourceFileView
+{
+	uint64_t id;
+	std::string_view fullpath;
+	std::string_view name;
+	std::string_view prjName;
+	std::string_view prjFile;
+	std::string_view configuration;
+	std::string_view defines;
+	std::string_view includes;
+};
+
+//! What msbuild used to compile a translation unit, so it can be compiled again without msbuild
+struct CompileCommand
+{
+	std::string compiler; // Full path to the compiler
+	std::string args; // Compiler arguments, including the file to compile
+	std::string workdir; // Directory the compiler runs in. Relative paths in 'args' are relative to this
+	std::string includes; // Same as SourceFile::includes. Needed for the system includes, which are not in 'args'
+};
+
+//! Settings shared by the files of a compiler command line (or by the headers it includes), as used by FileRow
+struct FileSettings
+{
+	std::string prjName;
+	std::string prjFile;
+	std::string defines;
+	std::string includes;
+	std::string origin; // See Database::addFile
+	bool hasCmd = false;
+	std::string compiler; // If hasCmd. See CompileCommand.
+	std::string workdir;
+};
+
+//! A row of the files table, ready to be added with Database::addFile.
+// Preparing it (see prepareFileRow) doesn't need the database, so the parser's worker threads do it, leaving only the
+// inserts to the thread using the database.
+struct FileRow
+{
+	uint64_t id = 0;
+	std::string fullpath;
+	std::string dir; // As splitFolderAndFile returns it
+	std::string name;
+	std::string args; // If settings->hasCmd. See CompileCommand.
+	std::shared_ptr<const FileSettings> settings;
+};
+
+FileRow prepareFileRow(std::string fullpath, std::shared_ptr<const FileSettings> settings, std::string args = "");
+
+//! Converts the system includes in a SourceFile::includes (or CompileCommand::includes) string to what the compiler
+// expects in the INCLUDE environment variable
+std::string getIncludeEnvironment(const std::string& includes);
+
+//! What was used to generate the database rows of a project
+struct ProjectInfo
+{
+	std::string name;
+	std::string prjFile;
+	std::string prjConfiguration; // Configuration|Platform of the project itself, which can differ from the solution's
+	std::string files; // The project file and all the files it imports, separated by ';'
+	int64_t stamp = 0; // Hash of the modification times of 'files' (see calcFilesStamp)
+	// Hash of all the compiler command lines of the project. For the solution's row, hash of the msbuild parameters.
+	int64_t clHash = 0;
+};
+
+//! Calculates a hash of the modification times of the specified files, separated by ';'
+int64_t calcFilesStamp(const std::string& files);
+
+#define VIMVS_FILES_COLUMNS "id,fullpath,name,prjName,prjFile,configuration,defines,includes"
+// Column types (after the id) for SqStmt::exec, when selecting VIMVS_FILES_COLUMNS
+#define VIMVS_FILES_COLUMNS_VIEWS \
+	std::string_view, std::string_view, std::string_view, std::string_view, std::string_view, std::string_view, std::string_view
+
+// Increase this whenever the database schema changes.
+// Databases with a different version are recreated, since they can always be generated again with -builddb, unless
+// Database::open knows how to migrate them.
+// Version 5: File ids calculated with hashPath
+// Version 6: Directory of each file, to find the files near one not in the database
+// Version 7: Projects that use each file (users table), so removing a project's files keeps the shared headers
+#define VIMVS_DB_VERSION 7
+
+//! Builds the key used to identify a Configuration|Platform in the database
+inline std::string getConfigurationKey(const std::string& configuration, const std::string& platform)
+{
+	if (configuration.empty() && platform.empty())
+		return "";
+	return configuration + "|" + platform;
+}
+
+class Database
+{
+public:
+	Database();
+	//! \param inMemory
+	//		If true, the database is loaded into memory and all changes stay there until 'persist' is called.
+	//		This keeps disk I/O out of -builddb, and other vimvs instances keep using the old file until the new
+	//		one is complete.
+	bool open(const std::string& dbfname, bool inMemory = false);
+
+	//! Writes an in memory database to its file. Does nothing if the database is not in memory.
+	bool persist();
+
+	//! Sets the Configuration|Platform (see getConfigurationKey) all the other functions use.
+	// If empty, queries use whatever configuration they find.
+	void setConfiguration(std::string configuration);
+	const std::string& getConfiguration() const
+	{
+		return m_configuration;
+	}
+
+	//! Starts a new generation. All the files added from now on are stamped with it, so files not seen in the
+	// latest generation can be removed with removeStaleFiles
+	void beginGeneration();
+
+	//! \param origin
+	//		Project that was being processed when the file was found. For headers, this is the first project
+	//		found to use the header. It's also recorded as a user of the file (see addFileUser).
+	//! \param cmd
+	//		If not null, how to compile the file (see getCompileCommand). Only 'compiler', 'args' and 'workdir'
+	//		are used.
+	void addFile(
+		const std::string& fullpath,
+		const std::string& prjName, const std::string& prjFile,
+		const std::string& defines,
+		const std::string& includes,
+		const std::string& origin,
+		bool insertOrReplace,
+		const CompileCommand* cmd = nullptr);
+	//! Same as above, with a row already prepared
+	void addFile(const FileRow& row, bool insertOrReplace);
+	//! Records that a project uses the file (e.g: a header shared by several projects), so its row is kept until
+	// no project uses it (see removeStaleFiles and removeProjectFiles)
+	void addFileUser(const std::string& fullpath, const std::string& prjName);
+	//! \param anyConfiguration
+	//		If the file is not found for the current configuration, get it from any other configuration.
+	//		Useful for things that don't depend on the configuration, such as the project a file belongs to.
+	SourceFile getFile(const std::string& filename, bool anyConfiguration = false);
+	//! Gets any file in the specified directory (not in its subdirectories), in the current configuration.
+	// \param dir
+	//		Full path, with the trailing separator (as splitFolderAndFile returns it)
+	bool getFileInDirectory(const std::string& dir, SourceFile& out);
+	//! Gets the compiler command line msbuild used for the file, in the current configuration.
+	// Returns false if not known (e.g: headers, or the database was built with -native)
+	bool getCompileCommand(const std::string& filename, CompileCommand& out);
+	//! Calls f(std::string_view fullpath) for every file with the specified name, from any configuration.
+	// The string_view is only valid during the call.
+	template<typename F>
+	void iterateWithBasename(const std::string& filename, F&& f)
+	{
+		CZ_CHECK(m_sqlGetFullpathsWithBasename.bind(filename));
+		m_sqlGetFullpathsWithBasename.exec<std::string_view>([&](std::string_view fullpath)
+		{
+			f(fullpath);
+			return true;
+		});
+	}
+
+	//! Calls f(const SourceFileView&) for every file of the current configuration
+	template<typename F>
+	void iterateFiles(F&& f)
+	{
+		CZ_CHECK(m_sqlGetAll.bind(m_configuration));
+		m_sqlGetAll.exec<int64_t, VIMVS_FILES_COLUMNS_VIEWS>(
+			[&](int64_t id, std::string_view fullpath, std::string_view name, std::string_view prjName, std::string_view prjFile, std::string_view configuration, std::string_view defines, std::string_view includes)
+		{
+			f(SourceFileView{ static_cast<uint64_t>(id), fullpath, name, prjName, prjFile, configuration, defines, includes });
+			return true;
+		});
+	}
+
+	//
+	// Projects of the current configuration.
+	//
+	std::vector<ProjectInfo> getProjects();
+	void setProject(const ProjectInfo& prj);
+	//! Removes all the files that were added while processing the specified project (see 'origin' in addFile).
+	// Files other projects use too are kept, with one of those as the origin.
+	void removeProjectFiles(const std::string& prjName);
+	//! Removes the files of the specified project (see 'origin' in addFile) that were not seen in the current
+	// generation. Files other projects use too are kept, as in removeProjectFiles.
+	void removeStaleFiles(const std::string& prjName);
+	//! Removes the project and its files
+	void removeProject(const std::string& prjName);
+
+	//! Gives back to the OS the pages freed by removed rows
+	void vacuum();
+
+	//! Makes the changes until commitChanges one transaction, which is much faster than each change being a
+	// transaction of its own. Used by the parser, which adds the rows of the build output in batches.
+	// Calls can be nested, in which case only the outermost ones start and commit the transaction.
+	void beginChanges();
+	void commitChanges();
+private:
+	bool getFile(SourceFile& out, bool anyConfiguration);
+	//! Recalculates the id of every file, for databases created before the ids used hashPath
+	bool migrateFileIds();
+	//! Adds the directory column to databases created before it existed
+	bool migrateDirs();
+	//! Adds the users table to databases created before it existed, with the origin of each file as its only user
+	bool migrateUsers();
+	bool createUsersTable();
+	void addUser(uint64_t id, const std::string& prjName);
+	//! Gives the files of the project that other projects still use another origin, so removing the project's
+	// files keeps them
+	void reassignSharedFiles(const std::string& prjName, int64_t generation);
+	SqDatabase m_sqdb;
+	std::string m_filename;
+	bool m_inMemory = false;
+	std::string m_configuration;
+	SqStmt m_sqlGetFile;
+	SqStmt m_sqlGetFileAnyConfiguration;
+	SqStmt m_sqlGetFullpathsWithBasename;
+	SqStmt m_sqlGetFileInDirectory;
+	SqStmt m_sqlGetAll;
+	SqStmt m_sqlGetCompileCommand;
+	SqStmt m_sqlAddFile;
+	SqStmt m_sqlRemoveProjectFiles;
+	SqStmt m_sqlGetProjects;
+	SqStmt m_sqlSetProject;
+	SqStmt m_sqlRemoveProject;
+	SqStmt m_sqlRemoveStaleFiles;
+	SqStmt m_sqlTouchFile;
+	SqStmt m_sqlAddUser;
+	SqStmt m_sqlRemoveStaleUsers;
+	SqStmt m_sqlReassignOrigin;
+	SqStmt m_sqlGetSetting;
+	SqStmt m_sqlSetSetting;
+	int64_t m_generation = 0;
+	std::unique_ptr<SqTransaction> m_changes;
+	int m_changesDepth = 0;
+	std::set<uint64_t> m_inserted;
+	std::set<std::pair<uint64_t, std::string>> m_users; // Users added in this session, as with m_inserted
+};
+
+}
+
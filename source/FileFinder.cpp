@@ -0,0 +1,480 @@
+#include "vimvsPCH.h"
+#include "FileFinder.h"
+#include "Logging.h"
+#include "Trace.h"
+
+namespace cz
+{
+
+namespace
+{
+
+// Paths are indexed and compared case insensitive, and with any kind of separator
+inline char normalize(char c)
+{
+	if (c >= 'A' && c <= 'Z')
+		return c + ('a' - 'A');
+	return c == '\\' ? '/' : c;
+}
+
+inline uint32_t makeTrigram(const char* s)
+{
+	return (uint32_t(uint8_t(normalize(s[0]))) << 16) | (uint32_t(uint8_t(normalize(s[1]))) << 8) |
+		uint32_t(uint8_t(normalize(s[2])));
+}
+
+//! Trigrams of a path, sorted and without duplicates
+void getTrigrams(std::string_view str, std::vector<uint32_t>& out)
+{
+	out.clear();
+	for (size_t i = 0; i + 3 <= str.size(); i++)
+		out.push_back(makeTrigram(str.data() + i));
+	std::sort(out.begin(), out.end());
+	out.erase(std::unique(out.begin(), out.end()), out.end());
+}
+
+//! True if all the characters of 'needle' appear in 'haystack', in the same order
+bool isSubsequence(std::string_view haystack, std::string_view needle)
+{
+	size_t j = 0;
+	for (size_t i = 0; i < haystack.size() && j < needle.size(); i++)
+	{
+		if (haystack[i] == needle[j])
+			j++;
+	}
+	return j == needle.size();
+}
+
+void writeVarint(std::string& out, uint32_t v)
+{
+	while (v >= 0x80)
+	{
+		out.push_back(static_cast<char>((v & 0x7F) | 0x80));
+		v >>= 7;
+	}
+	out.push_back(static_cast<char>(v));
+}
+
+template<typename T>
+void appendPod(std::string& out, const T* data, size_t count)
+{
+	out.append(reinterpret_cast<const char*>(data), count * sizeof(T));
+}
+
+} // anonymous namespace
+
+FileKind getFileKind(std::string_view path)
+{
+	static const char* sources[] = { "cpp", "c", "cc", "c++", "cxx" };
+	static const char* headers[] = { "h", "hh", "hxx", "hpp", "h++", "inl" };
+	auto dot = path.find_last_of("./\\");
+	if (dot == std::string_view::npos || path[dot] != '.')
+		return FileKind::Other;
+	std::string ext(path.substr(dot + 1));
+	for (auto&& c : ext)
+		c = normalize(c);
+	for (auto e : sources)
+	{
+		if (ext == e)
+			return FileKind::Source;
+	}
+	for (auto e : headers)
+	{
+		if (ext == e)
+			return FileKind::Header;
+	}
+	return FileKind::Other;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//		FindIndexWriter
+//////////////////////////////////////////////////////////////////////////
+
+void FindIndexWriter::add(std::string_view fullpath, std::string_view prjName)
+{
+	// Not something a real path will have, but the index stores lengths in 16 bits
+	if (fullpath.size() > 0xFFFF)
+		return;
+
+	FindIndexFile f;
+	f.path = static_cast<uint32_t>(m_blob.size());
+	f.length = static_cast<uint16_t>(fullpath.size());
+	auto sep = fullpath.find_last_of("/\\");
+	f.nameStart = static_cast<uint16_t>(sep == std::string_view::npos ? 0 : sep + 1);
+	f.kind = getFileKind(fullpath);
+	f.padding = 0;
+	m_blob.append(fullpath.data(), fullpath.size());
+	m_blob.push_back(0);
+
+	std::string prj(prjName);
+	auto it = m_projectIdx.find(prj);
+	if (it == m_projectIdx.end())
+	{
+		CZ_CHECK(m_projects.size() < 0xFFFF);
+		it = m_projectIdx.emplace(prj, static_cast<uint16_t>(m_projects.size())).first;
+		m_projects.push_back(static_cast<uint32_t>(m_blob.size()));
+		m_blob.append(prj);
+		m_blob.push_back(0);
+	}
+	f.project = it->second;
+
+	m_files.push_back(f);
+}
+
+std::string FindIndexWriter::serialize() const
+{
+	CZ_TRACE_SCOPE("find", "serialize");
+
+	// First pass counts the files of each trigram, so the postings can go in one array
+	std::vector<uint32_t> tris;
+	std::unordered_map<uint32_t, uint32_t> slots;
+	for (auto&& f : m_files)
+	{
+		getTrigrams(std::string_view(m_blob.data() + f.path, f.length), tris);
+		for (auto t : tris)
+			slots[t]++;
+	}
+
+	std::vector<FindIndexTrigram> trigrams;
+	trigrams.reserve(slots.size());
+	for (auto&& s : slots)
+		trigrams.push_back(FindIndexTrigram{ s.first, s.second, 0 });
+	std::sort(trigrams.begin(), trigrams.end(), [](const FindIndexTrigram& a, const FindIndexTrigram& b)
+	{
+		return a.trigram < b.trigram;
+	});
+
+	// From now on, 'slots' has where the next file of each trigram goes
+	std::vector<uint32_t> starts(trigrams.size() + 1);
+	for (size_t i = 0; i < trigrams.size(); i++)
+	{
+		starts[i + 1] = starts[i] + trigrams[i].count;
+		slots[trigrams[i].trigram] = starts[i];
+	}
+
+	// Files are visited in order, so each trigram's files end up sorted
+	std::vector<uint32_t> files(starts.back());
+	for (uint32_t idx = 0; idx < m_files.size(); idx++)
+	{
+		auto&& f = m_files[idx];
+		getTrigrams(std::string_view(m_blob.data() + f.path, f.length), tris);
+		for (auto t : tris)
+			files[slots[t]++] = idx;
+	}
+
+	std::string postings;
+	for (size_t i = 0; i < trigrams.size(); i++)
+	{
+		trigrams[i].postings = static_cast<uint32_t>(postings.size());
+		uint32_t previous = 0;
+		for (auto idx = starts[i]; idx < starts[i + 1]; idx++)
+		{
+			writeVarint(postings, files[idx] - previous);
+			previous = files[idx];
+		}
+	}
+
+	FindIndexHeader header;
+	header.magic = VIMVS_FINDINDEX_MAGIC;
+	header.version = VIMVS_FINDINDEX_VERSION;
+	header.numFiles = static_cast<uint32_t>(m_files.size());
+	header.numProjects = static_cast<uint32_t>(m_projects.size());
+	header.numTrigrams = static_cast<uint32_t>(trigrams.size());
+	header.postingsSize = static_cast<uint32_t>(postings.size());
+	header.blobSize = static_cast<uint32_t>(m_blob.size());
+	header.padding = 0;
+
+	std::string out;
+	out.reserve(sizeof(header) + m_files.size() * sizeof(FindIndexFile) + m_projects.size() * sizeof(uint32_t) +
+		trigrams.size() * sizeof(FindIndexTrigram) + postings.size() + m_blob.size());
+	appendPod(out, &header, 1);
+	appendPod(out, m_files.data(), m_files.size());
+	appendPod(out, m_projects.data(), m_projects.size());
+	appendPod(out, trigrams.data(), trigrams.size());
+	out += postings;
+	out += m_blob;
+	return out;
+}
+
+bool FindIndexWriter::write(const std::string& filename) const
+{
+	auto data = serialize();
+	auto tmpname = filename + ".tmp";
+	{
+		std::ofstream out(nativePath(tmpname), std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+		if (!out.is_open())
+		{
+			CZ_LOG(logDefault, Error, "Could not create file '%s'", tmpname.c_str());
+			return false;
+		}
+		out.write(data.data(), data.size());
+		if (!out.good())
+		{
+			CZ_LOG(logDefault, Error, "Error writing to '%s'", tmpname.c_str());
+			return false;
+		}
+	}
+
+	if (!renameFile(tmpname, filename))
+	{
+		CZ_LOG(logDefault, Error, "Could not rename '%s' to '%s'", tmpname.c_str(), filename.c_str());
+		return false;
+	}
+
+	CZ_LOG(logDefault, Log, "Find index '%s' written: %d files, %d bytes", filename.c_str(),
+		static_cast<int>(m_files.size()), static_cast<int>(data.size()));
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//		FindIndex
+//////////////////////////////////////////////////////////////////////////
+
+bool FindIndex::open(const std::string& filename)
+{
+	if (!m_file.open(filename))
+		return false;
+	return setData(filename, m_file.data(), m_file.size());
+}
+
+bool FindIndex::open(const std::string& name, const uint8_t* data, size_t size)
+{
+	return setData(name, data, size);
+}
+
+bool FindIndex::setData(const std::string& name, const uint8_t* data, size_t size)
+{
+	if (size < sizeof(FindIndexHeader))
+		return false;
+
+	auto header = reinterpret_cast<const FindIndexHeader*>(data);
+	if (header->magic != VIMVS_FINDINDEX_MAGIC || header->version != VIMVS_FINDINDEX_VERSION)
+	{
+		CZ_LOG(logDefault, Warning, "Find index '%s' has an unknown format", name.c_str());
+		return false;
+	}
+
+	uint64_t expectedSize = sizeof(FindIndexHeader) + uint64_t(header->numFiles) * sizeof(FindIndexFile) +
+		uint64_t(header->numProjects) * sizeof(uint32_t) + uint64_t(header->numTrigrams) * sizeof(FindIndexTrigram) +
+		header->postingsSize + header->blobSize;
+	if (expectedSize != size || (header->blobSize && data[size - 1] != 0))
+	{
+		CZ_LOG(logDefault, Warning, "Find index '%s' is corrupt", name.c_str());
+		return false;
+	}
+
+	m_numFiles = header->numFiles;
+	m_files = reinterpret_cast<const FindIndexFile*>(data + sizeof(FindIndexHeader));
+	m_numProjects = header->numProjects;
+	m_projects = reinterpret_cast<const uint32_t*>(m_files + m_numFiles);
+	m_numTrigrams = header->numTrigrams;
+	m_trigrams = reinterpret_cast<const FindIndexTrigram*>(m_projects + m_numProjects);
+	m_postingsSize = header->postingsSize;
+	m_postings = reinterpret_cast<const uint8_t*>(m_trigrams + m_numTrigrams);
+	m_blobSize = header->blobSize;
+	m_blob = reinterpret_cast<const char*>(m_postings + m_postingsSize);
+	return true;
+}
+
+std::string_view FindIndex::getString(uint32_t offset) const
+{
+	if (offset >= m_blobSize)
+		return std::string_view();
+	return std::string_view(m_blob + offset);
+}
+
+std::vector<FindMatch> FindIndex::find(const FindQuery& query) const
+{
+	CZ_TRACE_SCOPE_DETAIL("find", "find", query.pattern);
+	std::vector<FindMatch> res;
+	if (!m_files)
+		return res;
+
+	std::vector<std::string> words;
+	std::string joined; // All the words together, to compare with the file name
+	{
+		std::string word;
+		for (auto c : query.pattern + " ")
+		{
+			if (c == ' ' || c == '\t')
+			{
+				if (word.size())
+					words.push_back(std::move(word));
+				word.clear();
+			}
+			else
+			{
+				word += normalize(c);
+				joined += normalize(c);
+			}
+		}
+	}
+	if (words.empty())
+		return res;
+
+	std::vector<uint32_t> tris, wordTris;
+	for (auto&& w : words)
+	{
+		getTrigrams(w, wordTris);
+		tris.insert(tris.end(), wordTris.begin(), wordTris.end());
+	}
+	std::sort(tris.begin(), tris.end());
+	tris.erase(std::unique(tris.begin(), tris.end()), tris.end());
+
+	int projectIdx = -1;
+	if (query.project.size())
+	{
+		auto prj = tolower(query.project);
+		for (uint32_t i = 0; i < m_numProjects; i++)
+		{
+			if (tolower(std::string(getString(m_projects[i]))) == prj)
+				projectIdx = static_cast<int>(i);
+		}
+		if (projectIdx == -1)
+			return res;
+	}
+
+	// How many of the pattern's trigrams each file has.
+	// Too short words don't have trigrams, and any file is a candidate.
+	std::vector<uint32_t> counts;
+	std::vector<uint32_t> candidates;
+	if (tris.size())
+	{
+		std::vector<const FindIndexTrigram*> found;
+		for (auto t : tris)
+		{
+			auto end = m_trigrams + m_numTrigrams;
+			auto it = std::lower_bound(m_trigrams, end, t, [](const FindIndexTrigram& e, uint32_t t)
+			{
+				return e.trigram < t;
+			});
+			if (it != end && it->trigram == t)
+				found.push_back(it);
+		}
+
+		// A typo changes up to 3 trigrams, so we don't require all of them
+		auto threshold = static_cast<uint32_t>(tris.size() - std::min<size_t>(3, tris.size() / 2));
+
+		// Rarest first, so once the trigrams left are not enough for a file not seen yet to reach the threshold,
+		// the common trigrams only update the files we already have.
+		std::sort(found.begin(), found.end(), [](const FindIndexTrigram* a, const FindIndexTrigram* b)
+		{
+			return a->count < b->count;
+		});
+
+		counts.resize(m_numFiles);
+		for (size_t i = 0; i < found.size(); i++)
+		{
+			bool acceptNew = found.size() - i >= threshold;
+			if (!acceptNew && candidates.empty())
+				break;
+
+			auto p = m_postings + std::min(found[i]->postings, m_postingsSize);
+			auto pend = m_postings + m_postingsSize;
+			uint32_t idx = 0;
+			for (uint32_t n = 0; n < found[i]->count && p < pend; n++)
+			{
+				uint32_t delta = 0;
+				for (int shift = 0; p < pend && shift < 32; shift += 7)
+				{
+					delta |= uint32_t(*p & 0x7F) << shift;
+					if (!(*p++ & 0x80))
+						break;
+				}
+				idx += delta;
+				if (idx >= m_numFiles)
+					break;
+				if (counts[idx])
+					counts[idx]++;
+				else if (acceptNew)
+				{
+					counts[idx] = 1;
+					candidates.push_back(idx);
+				}
+			}
+		}
+
+		candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [&](uint32_t idx)
+		{
+			return counts[idx] < threshold;
+		}), candidates.end());
+	}
+
+	std::string normalized;
+	auto scoreFile = [&](uint32_t idx, uint32_t hits)
+	{
+		auto&& f = m_files[idx];
+		if (projectIdx != -1 && f.project != projectIdx)
+			return;
+		if (query.kind != FileKind::Other && f.kind != query.kind)
+			return;
+		if (f.path >= m_blobSize || m_blobSize - f.path <= f.length)
+			return;
+
+		std::string_view path(m_blob + f.path, f.length);
+		normalized.resize(path.size());
+		for (size_t i = 0; i < path.size(); i++)
+			normalized[i] = normalize(path[i]);
+		std::string_view npath(normalized);
+		auto nameStart = std::min<size_t>(f.nameStart, npath.size());
+		auto name = npath.substr(nameStart);
+
+		int score = hits * 8;
+		int found = 0;
+		for (auto&& w : words)
+		{
+			auto pos = name.find(w);
+			if (pos != std::string_view::npos)
+			{
+				score += pos == 0 ? 60 : 40;
+				found++;
+			}
+			else if (npath.find(w) != std::string_view::npos)
+			{
+				score += 15;
+				found++;
+			}
+			else if (isSubsequence(name, w))
+			{
+				score += 5;
+			}
+		}
+
+		// Without trigrams there is nothing fuzzy about the search, so all the words need to be there
+		if (!hits && found != static_cast<int>(words.size()))
+			return;
+
+		if (name.compare(0, joined.size(), joined) == 0 && (name.size() == joined.size() || name[joined.size()] == '.'))
+			score += 30;
+
+		res.push_back(FindMatch{ path, score });
+	};
+
+	if (tris.size())
+	{
+		for (auto idx : candidates)
+			scoreFile(idx, counts[idx]);
+	}
+	else
+	{
+		for (uint32_t idx = 0; idx < m_numFiles; idx++)
+			scoreFile(idx, 0);
+	}
+
+	auto byScore = [](const FindMatch& a, const FindMatch& b)
+	{
+		if (a.score != b.score)
+			return a.score > b.score;
+		if (a.path.size() != b.path.size())
+			return a.path.size() < b.path.size();
+		return a.path < b.path;
+	};
+
+	size_t count = std::min(res.size(), static_cast<size_t>(std::max(0, query.maxResults)));
+	std::partial_sort(res.begin(), res.begin() + count, res.end(), byScore);
+	res.resize(count);
+	return res;
+}
+
+} // namespace cz
+
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "Utils.h"
+
+namespace cz
+{
+
+//
+// Trigram index of the paths in the database, for -find.
+//
+// Each path (case folded, with '\' as '/') is split into all of its 3 character sequences, and the index keeps, for
+// every trigram, the list of files that contain it. A query looks up the trigrams of the pattern, counts how many
+// each file has, and only scores the files that have enough of them. Files don't need to have all the trigrams, so
+// a typo in the pattern still finds the file.
+//
+// Like the flat index (see FlatIndex.h), it's written by -builddb for each configuration, and memory mapped by the
+// queries.
+//
+// File layout (little endian):
+//		FindIndexHeader
+//		FindIndexFile[numFiles]
+//		uint32_t[numProjects] , offsets of the project names in the string blob
+//		FindIndexTrigram[numTrigrams] , sorted by trigram
+//		Postings (postingsSize bytes). For each trigram, the indexes of its files, sorted, as varint encoded deltas
+//		String blob (blobSize bytes), with null terminated strings
+//
+#define VIMVS_FINDINDEX_MAGIC 0x58465656 // "VVFX"
+#define VIMVS_FINDINDEX_VERSION 1
+
+struct FindIndexHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t numFiles;
+	uint32_t numProjects;
+	uint32_t numTrigrams;
+	uint32_t postingsSize;
+	uint32_t blobSize;
+	uint32_t padding;
+};
+
+enum class FileKind : uint8_t
+{
+	Other,
+	Source,
+	Header
+};
+
+FileKind getFileKind(std::string_view path);
+
+struct FindIndexFile
+{
+	uint32_t path; // Offset into the string blob
+	uint16_t length;
+	uint16_t nameStart; // Where the file name starts in the path
+	uint16_t project;
+	FileKind kind;
+	uint8_t padding;
+};
+
+struct FindIndexTrigram
+{
+	uint32_t trigram;
+	uint32_t count; // Number of files
+	uint32_t postings; // Offset into the postings
+};
+
+class FindIndexWriter
+{
+public:
+	void add(std::string_view fullpath, std::string_view prjName);
+
+	//! Builds the index in memory, in the same format as written to disk
+	std::string serialize() const;
+	//! Writes to a temporary file first, and then replaces the destination, so readers never see a partial index
+	bool write(const std::string& filename) const;
+private:
+	std::vector<FindIndexFile> m_files;
+	std::vector<uint32_t> m_projects;
+	std::unordered_map<std::string, uint16_t> m_projectIdx;
+	std::string m_blob;
+};
+
+struct FindQuery
+{
+	//! Words separated by spaces. Files are ranked by how well they match all the words.
+	std::string pattern;
+	//! If not empty, only files of this project. For headers, this is the first project found to use them.
+	std::string project;
+	//! If not Other, only files of this kind
+	FileKind kind = FileKind::Other;
+	int maxResults = 100;
+};
+
+struct FindMatch
+{
+	std::string_view path;
+	int score;
+};
+
+class FindIndex
+{
+public:
+	bool open(const std::string& filename);
+	//! Uses an index kept in memory (see FindIndexWriter::serialize). 'data' needs to outlive the index.
+	bool open(const std::string& name, const uint8_t* data, size_t size);
+
+	//! Returns the matches sorted by score, best first.
+	// The paths point to the index's memory, so are only valid while the index is open.
+	std::vector<FindMatch> find(const FindQuery& query) const;
+
+	uint32_t getNumFiles() const
+	{
+		return m_numFiles;
+	}
+
+private:
+	bool setData(const std::string& name, const uint8_t* data, size_t size);
+	std::string_view getString(uint32_t offset) const;
+	MappedFile m_file;
+	const FindIndexFile* m_files = nullptr;
+	uint32_t m_numFiles = 0;
+	const uint32_t* m_projects = nullptr;
+	uint32_t m_numProjects = 0;
+	const FindIndexTrigram* m_trigrams = nullptr;
+	uint32_t m_numTrigrams = 0;
+	const uint8_t* m_postings = nullptr;
+	uint32_t m_postingsSize = 0;
+	const char* m_blob = nullptr;
+	uint32_t m_blobSize = 0;
+};
+
+} // namespace cz
+
@@ -0,0 +1,485 @@
+#include "vimvsPCH.h"
+#include "FileReader.h"
+#include "Logging.h"
+#include "Trace.h"
+
+#ifdef __linux__
+	#include <errno.h>
+	#include <fcntl.h>
+	#include <string.h>
+	#include <unistd.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <sys/syscall.h>
+	#include <linux/io_uring.h>
+	#define CZ_IO_URING 1
+#else
+	#define CZ_IO_URING 0
+#endif
+
+namespace cz
+{
+
+struct FileReader::Request
+{
+	std::string filename;
+	Callback callback;
+	std::string data;
+#if CZ_IO_URING
+	int fd = -1;
+	size_t done = 0; // Bytes read so far
+#endif
+};
+
+#if CZ_IO_URING
+
+//! Minimal io_uring wrapper, using the system calls directly, so liburing is not needed
+class FileReader::Ring
+{
+public:
+	~Ring()
+	{
+		if (m_sqes != MAP_FAILED)
+			munmap(m_sqes, m_sqesSize);
+		if (m_cqPtr != MAP_FAILED && m_cqPtr != m_sqPtr)
+			munmap(m_cqPtr, m_cqSize);
+		if (m_sqPtr != MAP_FAILED)
+			munmap(m_sqPtr, m_sqSize);
+		if (m_fd >= 0)
+			close(m_fd);
+	}
+
+	//! Returns false if io_uring is not available, or doesn't support the operations we need
+	bool init(unsigned entries)
+	{
+		io_uring_params p;
+		memset(&p, 0, sizeof(p));
+		m_fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &p));
+		if (m_fd < 0)
+			return false;
+		m_capacity = p.sq_entries;
+
+		m_sqSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+		m_cqSize = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+		bool singleMmap = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+		if (singleMmap)
+			m_sqSize = m_cqSize = std::max(m_sqSize, m_cqSize);
+
+		m_sqPtr = mmap(nullptr, m_sqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQ_RING);
+		if (m_sqPtr == MAP_FAILED)
+			return false;
+		if (singleMmap)
+			m_cqPtr = m_sqPtr;
+		else
+		{
+			m_cqPtr = mmap(nullptr, m_cqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_CQ_RING);
+			if (m_cqPtr == MAP_FAILED)
+				return false;
+		}
+		m_sqesSize = p.sq_entries * sizeof(io_uring_sqe);
+		m_sqes = static_cast<io_uring_sqe*>(
+			mmap(nullptr, m_sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQES));
+		if (m_sqes == MAP_FAILED)
+			return false;
+
+		auto sq = static_cast<uint8_t*>(m_sqPtr);
+		m_sqTail = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+		m_sqMask = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+		m_sqArray = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+		auto cq = static_cast<uint8_t*>(m_cqPtr);
+		m_cqHead = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+		m_cqTail = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+		m_cqMask = *reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+		m_cqes = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+
+		// The operations we use need Linux 5.6, which is also the first with probing
+		const unsigned numProbeOps = 256;
+		std::vector<uint8_t> probeBuf(sizeof(io_uring_probe) + numProbeOps * sizeof(io_uring_probe_op));
+		auto probe = reinterpret_cast<io_uring_probe*>(probeBuf.data());
+		if (syscall(__NR_io_uring_register, m_fd, IORING_REGISTER_PROBE, probe, numProbeOps) < 0)
+			return false;
+		for (int op : { IORING_OP_OPENAT, IORING_OP_READ, IORING_OP_CLOSE })
+		{
+			if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED))
+				return false;
+		}
+
+		return true;
+	}
+
+	//! How many operations can be in flight at once
+	unsigned getCapacity() const
+	{
+		return m_capacity;
+	}
+
+	//! Returns a cleared submission entry, which is submitted by the next call to 'submit'
+	io_uring_sqe* getSqe()
+	{
+		// Only we write to the tail, so it can be read without synchronization
+		unsigned idx = (*m_sqTail + m_queued) & m_sqMask;
+		m_queued++;
+		m_sqArray[idx] = idx;
+		io_uring_sqe* sqe = &m_sqes[idx];
+		memset(sqe, 0, sizeof(*sqe));
+		return sqe;
+	}
+
+	//! Submits the entries queued, and waits for at least 'waitFor' completions
+	bool submit(unsigned waitFor)
+	{
+		__atomic_store_n(m_sqTail, *m_sqTail + m_queued, __ATOMIC_RELEASE);
+		m_unsubmitted += m_queued;
+		m_queued = 0;
+		while (true)
+		{
+			int res = static_cast<int>(syscall(__NR_io_uring_enter, m_fd, m_unsubmitted, waitFor,
+				waitFor ? IORING_ENTER_GETEVENTS : 0, nullptr, 0));
+			if (res >= 0)
+			{
+				m_unsubmitted -= res;
+				return true;
+			}
+			// Nothing is submitted if interrupted
+			if (errno != EINTR)
+				return false;
+		}
+	}
+
+	//! Calls f(cqe) for each completion available
+	template<typename F>
+	void reap(F&& f)
+	{
+		unsigned head = *m_cqHead;
+		unsigned tail = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+		while (head != tail)
+		{
+			f(m_cqes[head & m_cqMask]);
+			head++;
+		}
+		__atomic_store_n(m_cqHead, head, __ATOMIC_RELEASE);
+	}
+
+private:
+	int m_fd = -1;
+	unsigned m_capacity = 0;
+	unsigned m_queued = 0; // Entries filled, but not made visible to the kernel yet
+	unsigned m_unsubmitted = 0; // Entries visible to the kernel, but not consumed yet
+	void* m_sqPtr = MAP_FAILED;
+	size_t m_sqSize = 0;
+	void* m_cqPtr = MAP_FAILED;
+	size_t m_cqSize = 0;
+	io_uring_sqe* m_sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+	size_t m_sqesSize = 0;
+	unsigned* m_sqTail = nullptr;
+	unsigned m_sqMask = 0;
+	unsigned* m_sqArray = nullptr;
+	unsigned* m_cqHead = nullptr;
+	unsigned* m_cqTail = nullptr;
+	unsigned m_cqMask = 0;
+	io_uring_cqe* m_cqes = nullptr;
+};
+
+namespace
+{
+
+// Maximum number of operations in flight. Each file has one at a time.
+const unsigned kRingEntries = 256;
+
+// The operation is kept in the lower bits of the user data, with the request in the rest
+enum Op : uint64_t
+{
+	kOpOpen,
+	kOpRead,
+	kOpClose,
+	kOpMask = 3
+};
+
+}
+
+#else
+
+// Not used, but needs to be a complete type for the unique_ptr
+class FileReader::Ring
+{
+};
+
+#endif
+
+FileReader::FileReader(bool useIoUring)
+{
+#if CZ_IO_URING
+	if (useIoUring)
+	{
+		auto ring = std::make_unique<Ring>();
+		if (ring->init(kRingEntries))
+			m_ring = std::move(ring);
+		else
+			CZ_LOG(logDefault, Log, "io_uring not available (%s). Reading files with blocking calls.", strerror(errno));
+	}
+#endif
+
+	int numWorkers = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+	for (int i = 0; i < numWorkers; i++)
+		m_workers.emplace_back([this] { runWorker(); });
+	if (m_ring)
+		m_ringThread = std::thread([this] { runRing(); });
+}
+
+FileReader::~FileReader()
+{
+	wait();
+	{
+		std::lock_guard<std::mutex> lk(m_mtx);
+		m_stop = true;
+	}
+	m_workCv.notify_all();
+	m_ringCv.notify_all();
+	for (auto&& t : m_workers)
+		t.join();
+	if (m_ringThread.joinable())
+		m_ringThread.join();
+}
+
+void FileReader::read(std::string filename, Callback callback)
+{
+	auto req = new Request;
+	req->filename = std::move(filename);
+	req->callback = std::move(callback);
+
+	if (m_ring)
+	{
+		bool wake;
+		{
+			std::lock_guard<std::mutex> lk(m_mtx);
+			m_pending++;
+			m_requests.push_back(req);
+			// If the ring thread is busy, it picks up the new requests once it handles the next completion
+			wake = m_ringIdle;
+		}
+		if (wake)
+			m_ringCv.notify_one();
+	}
+	else
+	{
+		{
+			std::lock_guard<std::mutex> lk(m_mtx);
+			m_pending++;
+		}
+		post([this, req]
+		{
+			bool ok;
+			{
+				CZ_TRACE_SCOPE("filereader", "read");
+				ok = readFile(req->filename, req->data);
+			}
+			complete(req, ok);
+		});
+	}
+}
+
+void FileReader::wait()
+{
+	std::unique_lock<std::mutex> lk(m_mtx);
+	m_doneCv.wait(lk, [this] { return m_pending == 0; });
+}
+
+void FileReader::post(std::function<void()> task)
+{
+	{
+		std::lock_guard<std::mutex> lk(m_mtx);
+		m_work.push_back(std::move(task));
+	}
+	m_workCv.notify_one();
+}
+
+void FileReader::complete(Request* req, bool ok)
+{
+	{
+		std::unique_ptr<Request> r(req);
+		if (!ok)
+			r->data.clear();
+		r->callback(ok, std::move(r->data));
+	}
+
+	std::lock_guard<std::mutex> lk(m_mtx);
+	if (--m_pending == 0)
+		m_doneCv.notify_all();
+}
+
+void FileReader::runWorker()
+{
+	while (true)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lk(m_mtx);
+			m_workCv.wait(lk, [this] { return m_stop || m_work.size(); });
+			if (m_work.empty())
+				return;
+			task = std::move(m_work.front());
+			m_work.pop_front();
+		}
+		task();
+	}
+}
+
+void FileReader::runRing()
+{
+#if CZ_IO_URING
+	trace::setThreadName("FileReader");
+
+	// The callbacks run in the workers, so this thread only deals with the ring. The finished requests are handed
+	// over all at once after handling a batch of completions.
+	std::vector<std::pair<Request*, bool>> finished;
+	auto finish = [&finished](Request* req, bool ok)
+	{
+		finished.emplace_back(req, ok);
+	};
+
+	auto submitRead = [this](Request* req)
+	{
+		io_uring_sqe* sqe = m_ring->getSqe();
+		sqe->opcode = IORING_OP_READ;
+		sqe->fd = req->fd;
+		sqe->addr = reinterpret_cast<uint64_t>(&req->data[req->done]);
+		sqe->len = static_cast<uint32_t>(req->data.size() - req->done);
+		sqe->off = req->done;
+		sqe->user_data = reinterpret_cast<uint64_t>(req) | kOpRead;
+	};
+
+	// The result of the close is not needed, so the request can be finished right away
+	auto submitClose = [this](Request* req)
+	{
+		io_uring_sqe* sqe = m_ring->getSqe();
+		sqe->opcode = IORING_OP_CLOSE;
+		sqe->fd = req->fd;
+		sqe->user_data = kOpClose;
+	};
+
+	unsigned inFlight = 0;
+
+	// Returns how many operations it submitted
+	auto handleCompletion = [&](const io_uring_cqe& cqe) -> unsigned
+	{
+		auto req = reinterpret_cast<Request*>(cqe.user_data & ~uint64_t(kOpMask));
+		switch (cqe.user_data & kOpMask)
+		{
+		case kOpOpen:
+			if (cqe.res < 0)
+			{
+				finish(req, false);
+				return 0;
+			}
+			req->fd = cqe.res;
+			{
+				// Done here instead of with IORING_OP_STATX, since that one is always handed to the kernel's worker
+				// threads, and it doesn't do any I/O once the file is open anyway
+				struct stat st;
+				if (fstat(req->fd, &st) != 0)
+				{
+					submitClose(req);
+					finish(req, false);
+					return 1;
+				}
+				if (st.st_size == 0)
+				{
+					submitClose(req);
+					finish(req, true);
+					return 1;
+				}
+				req->data.resize(static_cast<size_t>(st.st_size));
+			}
+			submitRead(req);
+			return 1;
+
+		case kOpRead:
+			if (cqe.res == -EINTR || cqe.res == -EAGAIN)
+			{
+				submitRead(req);
+				return 1;
+			}
+			if (cqe.res < 0)
+			{
+				submitClose(req);
+				finish(req, false);
+				return 1;
+			}
+			req->done += cqe.res;
+			// If the file got smaller since we got its size, we get 0 (end of file) before reading it all
+			if (cqe.res == 0)
+				req->data.resize(req->done);
+			if (req->done < req->data.size())
+			{
+				submitRead(req);
+				return 1;
+			}
+			submitClose(req);
+			finish(req, true);
+			return 1;
+
+		default:
+			return 0;
+		}
+	};
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lk(m_mtx);
+			if (inFlight == 0)
+			{
+				m_ringIdle = true;
+				m_ringCv.wait(lk, [this] { return m_stop || m_requests.size(); });
+				m_ringIdle = false;
+				if (m_requests.empty())
+					return;
+			}
+
+			while (m_requests.size() && inFlight < m_ring->getCapacity())
+			{
+				Request* req = m_requests.front();
+				m_requests.pop_front();
+
+				io_uring_sqe* sqe = m_ring->getSqe();
+				sqe->opcode = IORING_OP_OPENAT;
+				sqe->fd = AT_FDCWD;
+				sqe->addr = reinterpret_cast<uint64_t>(req->filename.c_str());
+				sqe->open_flags = O_RDONLY | O_CLOEXEC;
+				sqe->user_data = reinterpret_cast<uint64_t>(req) | kOpOpen;
+				inFlight++;
+			}
+		}
+
+		// New reads wait for the next completion, but with lots of operations in flight, that is never long
+		if (!m_ring->submit(1))
+			CZ_LOG(logDefault, Fatal, "io_uring_enter failed: %s", strerror(errno));
+
+		m_ring->reap([&](const io_uring_cqe& cqe)
+		{
+			inFlight--;
+			inFlight += handleCompletion(cqe);
+		});
+
+		if (finished.size())
+		{
+			{
+				std::lock_guard<std::mutex> lk(m_mtx);
+				for (auto&& f : finished)
+				{
+					Request* req = f.first;
+					bool ok = f.second;
+					m_work.push_back([this, req, ok] { complete(req, ok); });
+				}
+			}
+			if (finished.size() == 1)
+				m_workCv.notify_one();
+			else
+				m_workCv.notify_all();
+			finished.clear();
+		}
+	}
+#endif
+}
+
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+
+namespace cz
+{
+
+//! Reads whole files, lots of them at once, and calls a callback with the contents of each.
+//
+// On Linux, if the kernel supports it, the reads are done with io_uring: a thread submits the open and read
+// operations of many files at once, so the storage is always kept busy, and the buffers read are handed to a pool of
+// worker threads that run the callbacks. Everywhere else (or if io_uring is not available), the worker threads do
+// the reads themselves, with blocking calls.
+// Callbacks can call 'read' themselves (e.g: to read the headers a file includes).
+class FileReader
+{
+public:
+	//! Called from one of the worker threads when a read finishes.
+	// \param ok
+	//		False if the file couldn't be read, in which case 'data' is empty
+	using Callback = std::function<void(bool ok, std::string data)>;
+
+	//! \param useIoUring
+	//		If false, io_uring is not used even if available. Used by the benchmarks.
+	explicit FileReader(bool useIoUring = true);
+	~FileReader();
+	FileReader(const FileReader&) = delete;
+	FileReader& operator=(const FileReader&) = delete;
+
+	void read(std::string filename, Callback callback);
+
+	//! Waits for all the reads, and their callbacks (including any reads they started), to finish
+	void wait();
+
+	bool isUsingIoUring() const
+	{
+		return m_ring != nullptr;
+	}
+
+private:
+	struct Request;
+	class Ring;
+
+	//! Runs the callback and deletes the request. Called from a worker thread.
+	void complete(Request* req, bool ok);
+	void post(std::function<void()> task);
+	void runWorker();
+	void runRing();
+
+	std::mutex m_mtx;
+	std::condition_variable m_workCv;
+	std::condition_variable m_ringCv;
+	std::condition_variable m_doneCv;
+	std::deque<std::function<void()>> m_work; // Tasks for the worker threads
+	std::deque<Request*> m_requests; // Reads waiting to be submitted to the ring
+	int m_pending = 0; // Reads not finished yet (including their callback)
+	bool m_stop = false;
+	bool m_ringIdle = false; // If the ring thread is waiting for requests
+	std::vector<std::thread> m_workers;
+	std::unique_ptr<Ring> m_ring;
+	std::thread m_ringThread;
+};
+
+}
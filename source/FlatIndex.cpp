@@ -0,0 +1,144 @@
+#include "vimvsPCH.h"
+#include "FlatIndex.h"
+#include "Logging.h"
+
+namespace cz
+{
+
+//////////////////////////////////////////////////////////////////////////
+//		FlatIndexWriter
+//////////////////////////////////////////////////////////////////////////
+
+uint32_t FlatIndexWriter::addString(std::string_view str, bool dedup)
+{
+	std::string key;
+	if (dedup)
+	{
+		key = str;
+		auto it = m_strings.find(key);
+		if (it != m_strings.end())
+			return it->second;
+	}
+
+	auto offset = static_cast<uint32_t>(m_blob.size());
+	m_blob.append(str.data(), str.size());
+	m_blob.push_back(0);
+	if (dedup)
+		m_strings.emplace(std::move(key), offset);
+	return offset;
+}
+
+void FlatIndexWriter::add(int64_t id, std::string_view fullpath, std::string_view defines, std::string_view includes)
+{
+	FlatIndexEntry e;
+	e.id = id;
+	// Full paths are unique, so no point in trying to deduplicate
+	e.fullpath = addString(fullpath, false);
+	e.defines = addString(defines, true);
+	e.includes = addString(includes, true);
+	e.padding = 0;
+	m_entries.push_back(e);
+}
+
+bool FlatIndexWriter::write(const std::string& filename)
+{
+	std::sort(m_entries.begin(), m_entries.end(), [](const FlatIndexEntry& a, const FlatIndexEntry& b)
+	{
+		return a.id < b.id;
+	});
+
+	FlatIndexHeader header;
+	header.magic = VIMVS_FLATINDEX_MAGIC;
+	header.version = VIMVS_FLATINDEX_VERSION;
+	header.numEntries = static_cast<uint32_t>(m_entries.size());
+	header.blobSize = static_cast<uint32_t>(m_blob.size());
+
+	auto tmpname = filename + ".tmp";
+	{
+		std::ofstream out(nativePath(tmpname), std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+		if (!out.is_open())
+		{
+			CZ_LOG(logDefault, Error, "Could not create file '%s'", tmpname.c_str());
+			return false;
+		}
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		if (m_entries.size())
+			out.write(reinterpret_cast<const char*>(&m_entries[0]), m_entries.size() * sizeof(m_entries[0]));
+		out.write(m_blob.data(), m_blob.size());
+		if (!out.good())
+		{
+			CZ_LOG(logDefault, Error, "Error writing to '%s'", tmpname.c_str());
+			return false;
+		}
+	}
+
+	if (!renameFile(tmpname, filename))
+	{
+		CZ_LOG(logDefault, Error, "Could not rename '%s' to '%s'", tmpname.c_str(), filename.c_str());
+		return false;
+	}
+
+	CZ_LOG(logDefault, Log, "Flat index '%s' written: %u files, %u bytes of strings", filename.c_str(),
+		header.numEntries, header.blobSize);
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//		FlatIndex
+//////////////////////////////////////////////////////////////////////////
+
+bool FlatIndex::open(const std::string& filename)
+{
+	if (!m_file.open(filename))
+		return false;
+
+	auto data = m_file.data();
+	auto size = m_file.size();
+	if (size < sizeof(FlatIndexHeader))
+		return false;
+
+	auto header = reinterpret_cast<const FlatIndexHeader*>(data);
+	if (header->magic != VIMVS_FLATINDEX_MAGIC || header->version != VIMVS_FLATINDEX_VERSION)
+	{
+		CZ_LOG(logDefault, Warning, "Flat index '%s' has an unknown format", filename.c_str());
+		return false;
+	}
+
+	uint64_t expectedSize = sizeof(FlatIndexHeader) + uint64_t(header->numEntries) * sizeof(FlatIndexEntry) + header->blobSize;
+	if (expectedSize != size || (header->blobSize && data[size - 1] != 0))
+	{
+		CZ_LOG(logDefault, Warning, "Flat index '%s' is corrupt", filename.c_str());
+		return false;
+	}
+
+	m_numEntries = header->numEntries;
+	m_entries = reinterpret_cast<const FlatIndexEntry*>(data + sizeof(FlatIndexHeader));
+	m_blobSize = header->blobSize;
+	m_blob = reinterpret_cast<const char*>(m_entries + m_numEntries);
+	return true;
+}
+
+bool FlatIndex::find(int64_t id, FlatIndexFile& out) const
+{
+	if (!m_entries)
+		return false;
+
+	auto end = m_entries + m_numEntries;
+	auto it = std::lower_bound(m_entries, end, id, [](const FlatIndexEntry& e, int64_t id)
+	{
+		return e.id < id;
+	});
+
+	if (it == end || it->id != id)
+		return false;
+	if (it->fullpath >= m_blobSize || it->defines >= m_blobSize || it->includes >= m_blobSize)
+		return false;
+
+	out.fullpath = m_blob + it->fullpath;
+	out.defines = m_blob + it->defines;
+	out.includes = m_blob + it->includes;
+	return true;
+}
+
+} // namespace cz
+
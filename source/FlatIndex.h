@@ -0,0 +1,77 @@
+#pragma once
+
+#include "Utils.h"
+
+namespace cz
+{
+
+//
+// Compact read-only index of the compile flags of each file, so that queries such as -getycm can be answered by
+// memory mapping a file and doing a binary search, without opening the sqlite database.
+//
+// File layout (little endian):
+//		FlatIndexHeader
+//		FlatIndexEntry[numEntries] , sorted by id
+//		String blob (blobSize bytes), with null terminated strings. Equal strings are stored only once.
+//
+// The id of a file is the same as the id used in the database (see Database::addFile), so the index can be used
+// by anything that can calculate that id.
+//
+#define VIMVS_FLATINDEX_MAGIC 0x58495656 // "VVIX"
+#define VIMVS_FLATINDEX_VERSION 2
+
+struct FlatIndexHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t numEntries;
+	uint32_t blobSize;
+};
+
+struct FlatIndexEntry
+{
+	int64_t id;
+	// Offsets into the string blob
+	uint32_t fullpath;
+	uint32_t defines;
+	uint32_t includes;
+	uint32_t padding;
+};
+
+class FlatIndexWriter
+{
+public:
+	void add(int64_t id, std::string_view fullpath, std::string_view defines, std::string_view includes);
+
+	//! Writes to a temporary file first, and then replaces the destination, so readers never see a partial index
+	bool write(const std::string& filename);
+private:
+	uint32_t addString(std::string_view str, bool dedup);
+	std::vector<FlatIndexEntry> m_entries;
+	std::string m_blob;
+	std::unordered_map<std::string, uint32_t> m_strings;
+};
+
+struct FlatIndexFile
+{
+	const char* fullpath = "";
+	const char* defines = "";
+	const char* includes = "";
+};
+
+class FlatIndex
+{
+public:
+	bool open(const std::string& filename);
+	//! The returned strings point to the mapped file, so are only valid while the index is open
+	bool find(int64_t id, FlatIndexFile& out) const;
+private:
+	MappedFile m_file;
+	const FlatIndexEntry* m_entries = nullptr;
+	uint32_t m_numEntries = 0;
+	const char* m_blob = nullptr;
+	uint32_t m_blobSize = 0;
+};
+
+} // namespace cz
+
@@ -1,93 +1,286 @@
-/********************************************************************
-	CrazyGaze (http://www.crazygaze.com)
-	Author : Rui Figueira
-	Email  : rui@crazygaze.com
-	
-	purpose:
-	
-*********************************************************************/
-
-#include "vimvsPCH.h"
-#include "Logging.h"
-
-#define LOG_TIME 1
-#define LOG_VERBOSITY 1
-
-namespace cz
-{
-
-CZ_DEFINE_LOG_CATEGORY(logDefault)
-
-#if CZ_NO_LOGGING
-LogCategoryLogNone logNone;
-#endif
-
-LogCategoryBase::LogCategoryBase(const char* name, LogVerbosity verbosity, LogVerbosity compileTimeVerbosity) : m_name(name)
-, m_verbosity(verbosity)
-, m_compileTimeVerbosity(compileTimeVerbosity)
-{
-
-}
-
-void LogCategoryBase::setVerbosity(LogVerbosity verbosity)
-{
-	// Take into considering the minimum compiled verbosity
-	m_verbosity = LogVerbosity( std::min((int)m_compileTimeVerbosity, (int)verbosity) );
-}
-
-LogOutput::SharedData* LogOutput::getSharedData()
-{
-	// This is thread safe, according to C++11 (aka: Magic Statics)
-	static SharedData data;
-	return &data;
-}
-
-LogOutput::LogOutput()
-{
-	auto data = getSharedData();
-	auto lk = std::unique_lock<std::mutex>(data->mtx);
-	data->outputs.push_back(this);
-}
-
-LogOutput::~LogOutput()
-{
-	auto data = getSharedData();
-	auto lk = std::unique_lock<std::mutex>(data->mtx);
-	data->outputs.erase(std::find(data->outputs.begin(), data->outputs.end(), this));
-}
-
-void LogOutput::logToAll(const char* file, int line, const LogCategoryBase* category, LogVerbosity verbosity, _Printf_format_string_ const char* fmt, ...)
-{
-	va_list args;
-	va_start(args, fmt);
-
-	const char* prefix = "";
-#if LOG_TIME	
-	{
-		time_t t = time(nullptr);
-		struct tm d;
-		localtime_s(&d, &t);
-		#if LOG_VERBOSITY
-			prefix = formatString("%02d:%02d:%02d: %s: ", d.tm_hour, d.tm_min, d.tm_sec, logVerbosityToString(verbosity));
-		#else
-			prefix = formatString("%02d:%02d:%02d: ", d.tm_hour, d.tm_min, d.tm_sec);
-		#endif
-	}
-#else
-	prefix = formatString("%s: ", logVerbosityToString(verbosity));
-#endif
-
-	auto msg = formatStringVA(fmt, args);
-	char buf[1024];
-	_snprintf_s(buf, _countof(buf), _TRUNCATE, "%s%s", prefix, msg);
-
-	auto data = getSharedData();
-	auto lk = std::unique_lock<std::mutex>(data->mtx);
-	for (auto&& out : data->outputs)
-	{
-		out->log(file, line, category, verbosity, buf);
-	}
-}
-
-
-}
+/********************************************************************
+	CrazyGaze (http://www.crazygaze.com)
+	Author : Rui Figueira
+	Email  : rui@crazygaze.com
+	
+	purpose:
+	
+*********************************************************************/
+
+#include "vimvsPCH.h"
+#include "Logging.h"
+
+#define LOG_TIME 1
+#define LOG_VERBOSITY 1
+
+namespace cz
+{
+
+CZ_DEFINE_LOG_CATEGORY(logDefault)
+
+#if CZ_NO_LOGGING
+LogCategoryLogNone logNone;
+#endif
+
+// Categories are global objects in several translation units, so this can't be a global itself
+static std::vector<LogCategoryBase*>& getCategories()
+{
+	static std::vector<LogCategoryBase*> categories;
+	return categories;
+}
+
+LogCategoryBase::LogCategoryBase(const char* name, LogVerbosity verbosity, LogVerbosity compileTimeVerbosity) : m_name(name)
+, m_verbosity(verbosity)
+, m_compileTimeVerbosity(compileTimeVerbosity)
+{
+	getCategories().push_back(this);
+}
+
+void LogCategoryBase::setVerbosity(LogVerbosity verbosity)
+{
+	// Take into considering the minimum compiled verbosity
+	m_verbosity = LogVerbosity( std::min((int)m_compileTimeVerbosity, (int)verbosity) );
+}
+
+LogCategoryBase* LogCategoryBase::find(const std::string& name)
+{
+	auto n = tolower(name);
+	for (auto&& c : getCategories())
+	{
+		if (tolower(c->getName()) == n)
+			return c;
+	}
+	return nullptr;
+}
+
+void LogCategoryBase::iterate(const std::function<void(LogCategoryBase&)>& f)
+{
+	for (auto&& c : getCategories())
+		f(*c);
+}
+
+bool logVerbosityFromString(const std::string& str, LogVerbosity& dst)
+{
+	auto s = tolower(trim(str));
+	for (auto v : { LogVerbosity::None, LogVerbosity::Fatal, LogVerbosity::Error, LogVerbosity::Warning, LogVerbosity::Log, LogVerbosity::Verbose })
+	{
+		static const char* names[] = { "none", "fatal", "error", "warning", "log", "verbose" };
+		if (s == names[static_cast<int>(v)])
+		{
+			dst = v;
+			return true;
+		}
+	}
+	return false;
+}
+
+LogOutput::SharedData* LogOutput::getSharedData()
+{
+	// This is thread safe, according to C++11 (aka: Magic Statics)
+	static SharedData data;
+	return &data;
+}
+
+LogOutput::LogOutput()
+{
+	auto data = getSharedData();
+	auto lk = std::unique_lock<std::shared_mutex>(data->mtx);
+	data->outputs.push_back(this);
+}
+
+LogOutput::~LogOutput()
+{
+	auto data = getSharedData();
+	auto lk = std::unique_lock<std::shared_mutex>(data->mtx);
+	data->outputs.erase(std::find(data->outputs.begin(), data->outputs.end(), this));
+}
+
+void LogOutput::logToAll(const char* file, int line, const LogCategoryBase* category, LogVerbosity verbosity, _Printf_format_string_ const char* fmt, ...)
+{
+	va_list args;
+	va_start(args, fmt);
+
+	const char* prefix = "";
+#if LOG_TIME	
+	{
+		time_t t = time(nullptr);
+		struct tm d;
+#ifdef _WIN32
+		localtime_s(&d, &t);
+#else
+		localtime_r(&t, &d);
+#endif
+		#if LOG_VERBOSITY
+			prefix = formatString("%02d:%02d:%02d: %s: ", d.tm_hour, d.tm_min, d.tm_sec, logVerbosityToString(verbosity));
+		#else
+			prefix = formatString("%02d:%02d:%02d: ", d.tm_hour, d.tm_min, d.tm_sec);
+		#endif
+	}
+#else
+	prefix = formatString("%s: ", logVerbosityToString(verbosity));
+#endif
+
+	auto msg = formatStringVA(fmt, args);
+	char buf[1024];
+	snprintf(buf, sizeof(buf), "%s%s", prefix, msg);
+
+	auto data = getSharedData();
+	auto lk = std::shared_lock<std::shared_mutex>(data->mtx);
+	for (auto&& out : data->outputs)
+	{
+		out->log(file, line, category, verbosity, buf);
+		// We are about to assert, so make sure the message gets somewhere
+		if (verbosity == LogVerbosity::Fatal)
+			out->flush();
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+//		LogRingBuffer
+//////////////////////////////////////////////////////////////////////////
+
+LogRingBuffer::LogRingBuffer(size_t capacity)
+	: m_slots(new Slot[capacity])
+	, m_mask(capacity - 1)
+	, m_enqueuePos(0)
+	, m_dequeuePos(0)
+{
+	CZ_ASSERT((capacity & m_mask) == 0);
+	for (size_t i = 0; i < capacity; i++)
+		m_slots[i].seq.store(i, std::memory_order_relaxed);
+}
+
+void LogRingBuffer::push(std::string msg)
+{
+	auto pos = m_enqueuePos.load(std::memory_order_relaxed);
+	while (true)
+	{
+		auto& slot = m_slots[pos & m_mask];
+		auto seq = slot.seq.load(std::memory_order_acquire);
+		auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+		if (diff == 0)
+		{
+			if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+			{
+				slot.msg = std::move(msg);
+				slot.seq.store(pos + 1, std::memory_order_release);
+				return;
+			}
+		}
+		else if (diff < 0)
+		{
+			// Full. Give the writer thread a chance to catch up
+			std::this_thread::yield();
+			pos = m_enqueuePos.load(std::memory_order_relaxed);
+		}
+		else
+		{
+			pos = m_enqueuePos.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+bool LogRingBuffer::pop(std::string& msg)
+{
+	auto pos = m_dequeuePos.load(std::memory_order_relaxed);
+	while (true)
+	{
+		auto& slot = m_slots[pos & m_mask];
+		auto seq = slot.seq.load(std::memory_order_acquire);
+		auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+		if (diff == 0)
+		{
+			if (m_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+			{
+				msg = std::move(slot.msg);
+				slot.seq.store(pos + m_mask + 1, std::memory_order_release);
+				return true;
+			}
+		}
+		else if (diff < 0)
+		{
+			return false; // Empty
+		}
+		else
+		{
+			pos = m_dequeuePos.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+//		AsyncLogOutput
+//////////////////////////////////////////////////////////////////////////
+
+AsyncLogOutput::AsyncLogOutput()
+	: m_queue(4096)
+	, m_pushed(0)
+	, m_written(0)
+	, m_stop(false)
+{
+}
+
+AsyncLogOutput::~AsyncLogOutput()
+{
+	CZ_ASSERT(!m_thread.joinable()); // Derived classes need to call stop()
+}
+
+void AsyncLogOutput::log(const char* /*file*/, int /*line*/, const LogCategoryBase* /*category*/, LogVerbosity /*verbosity*/, const char* msg)
+{
+	std::string str(msg);
+	str += '\n';
+	// Started here instead of the constructor, so 'write' is never called on a partially constructed object
+	std::call_once(m_started, [this] { m_thread = std::thread([this] { run(); }); });
+	m_queue.push(std::move(str));
+	m_pushed++;
+}
+
+void AsyncLogOutput::run()
+{
+	std::string batch;
+	std::string msg;
+	while (true)
+	{
+		// Checked before draining, so anything pushed before stop() is still written
+		bool stopping = m_stop.load();
+		uint64_t count = 0;
+		while (m_queue.pop(msg))
+		{
+			batch += msg;
+			count++;
+		}
+
+		if (count)
+		{
+			write(batch);
+			batch.clear();
+			m_written += count;
+		}
+		else if (stopping)
+		{
+			break;
+		}
+		else
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		}
+	}
+}
+
+void AsyncLogOutput::flush()
+{
+	auto target = m_pushed.load();
+	while (m_written.load() < target && m_thread.joinable())
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+void AsyncLogOutput::stop()
+{
+	if (!m_thread.joinable())
+		return;
+	m_stop = true;
+	m_thread.join();
+}
+
+
+}
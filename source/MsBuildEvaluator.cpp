@@ -0,0 +1,1486 @@
+#include "vimvsPCH.h"
+#include "MsBuildEvaluator.h"
+#include "Database.h"
+#include "Xml.h"
+#include "Logging.h"
+#include "Trace.h"
+
+CZ_DECLARE_LOG_CATEGORY(logMsBuild, Log, Log)
+CZ_DEFINE_LOG_CATEGORY(logMsBuild)
+
+namespace cz
+{
+
+namespace
+{
+
+bool iequals(std::string_view a, std::string_view b)
+{
+	if (a.size() != b.size())
+		return false;
+	for (size_t i = 0; i < a.size(); i++)
+	{
+		if (::tolower(static_cast<unsigned char>(a[i])) != ::tolower(static_cast<unsigned char>(b[i])))
+			return false;
+	}
+	return true;
+}
+
+//! Splits a ';' separated list, trimming the elements, and dropping the empty ones
+std::vector<std::string> splitList(const std::string& str)
+{
+	std::vector<std::string> res;
+	size_t start = 0;
+	while (start <= str.size())
+	{
+		auto e = str.find(';', start);
+		if (e == std::string::npos)
+			e = str.size();
+		auto s = trim(str.substr(start, e - start));
+		if (s.size())
+			res.push_back(std::move(s));
+		start = e + 1;
+	}
+	return res;
+}
+
+bool isAbsolutePath(const std::string& path)
+{
+	return (path.size() >= 2 && path[1] == ':') || (path.size() && (path[0] == '\\' || path[0] == '/'));
+}
+
+bool toNumber(const std::string& str, double& dst)
+{
+	auto s = trim(str);
+	if (s.empty())
+		return false;
+	char* end = nullptr;
+	if (s.size() > 2 && s[0] == '0' && (s[1] == 'x' || s[1] == 'X'))
+		dst = static_cast<double>(strtoll(s.c_str() + 2, &end, 16));
+	else
+		dst = strtod(s.c_str(), &end);
+	return *end == 0;
+}
+
+std::string numberToString(double v)
+{
+	if (v == static_cast<double>(static_cast<int64_t>(v)))
+		return std::to_string(static_cast<int64_t>(v));
+	return formatString("%g", v);
+}
+
+//! Compares two versions (e.g: "10.0.16299.0"). Returns <0, 0, >0
+int compareVersions(const std::string& a, const std::string& b)
+{
+	const char* pa = a.c_str();
+	const char* pb = b.c_str();
+	while (*pa || *pb)
+	{
+		char* ea;
+		char* eb;
+		auto va = strtol(pa, &ea, 10);
+		auto vb = strtol(pb, &eb, 10);
+		if (va != vb)
+			return va < vb ? -1 : 1;
+		pa = *ea == '.' ? ea + 1 : ea;
+		pb = *eb == '.' ? eb + 1 : eb;
+		// Anything that is not a number ends the comparison
+		if (pa == ea && pb == eb)
+			break;
+	}
+	return 0;
+}
+
+//! Finds the ')' that closes the '(' at 'open', skipping quoted strings
+size_t findClosingParen(const std::string& s, size_t open)
+{
+	int depth = 0;
+	char quote = 0;
+	for (size_t i = open; i < s.size(); i++)
+	{
+		char c = s[i];
+		if (quote)
+		{
+			if (c == quote)
+				quote = 0;
+		}
+		else if (c == '\'' || c == '"' || c == '`')
+			quote = c;
+		else if (c == '(')
+			depth++;
+		else if (c == ')')
+		{
+			if (--depth == 0)
+				return i;
+		}
+	}
+	return std::string::npos;
+}
+
+//! Splits function arguments by the top level commas
+std::vector<std::string> splitArgs(const std::string& s)
+{
+	std::vector<std::string> res;
+	if (trim(s).empty())
+		return res;
+	int depth = 0;
+	char quote = 0;
+	size_t start = 0;
+	for (size_t i = 0; i < s.size(); i++)
+	{
+		char c = s[i];
+		if (quote)
+		{
+			if (c == quote)
+				quote = 0;
+		}
+		else if (c == '\'' || c == '"' || c == '`')
+			quote = c;
+		else if (c == '(')
+			depth++;
+		else if (c == ')')
+			depth--;
+		else if (c == ',' && depth == 0)
+		{
+			res.push_back(trim(s.substr(start, i - start)));
+			start = i + 1;
+		}
+	}
+	res.push_back(trim(s.substr(start)));
+	return res;
+}
+
+// Metadata names (lower case) to values
+using Metadata = std::unordered_map<std::string, std::string>;
+
+class ProjectEvaluator
+{
+public:
+	ProjectEvaluator(const std::string& slnFile, const SlnProject& prj, const std::map<std::string, std::string>& globals)
+		: m_prj(prj)
+	{
+		m_prjDir = splitFolderAndFile(prj.path).first;
+		std::string prjName;
+		auto prjExt = getExtension(splitFolderAndFile(prj.path).second, &prjName);
+		auto sln = splitFolderAndFile(slnFile);
+		std::string slnName;
+		auto slnExt = getExtension(sln.second, &slnName);
+
+		setGlobal("Configuration", prj.configuration);
+		setGlobal("Platform", prj.platform);
+		setGlobal("SolutionDir", sln.first);
+		setGlobal("SolutionPath", slnFile);
+		setGlobal("SolutionFileName", sln.second);
+		setGlobal("SolutionName", slnName);
+		setGlobal("SolutionExt", "." + slnExt);
+		setGlobal("BuildingInsideVisualStudio", "");
+		setGlobal("MSBuildProjectFullPath", prj.path);
+		setGlobal("MSBuildProjectDirectory", removeTrailingSlash(m_prjDir));
+		setGlobal("MSBuildProjectFile", splitFolderAndFile(prj.path).second);
+		setGlobal("MSBuildProjectName", prjName);
+		setGlobal("MSBuildProjectExtension", "." + prjExt);
+		for (auto&& g : globals)
+			setGlobal(g.first, g.second);
+	}
+
+	EvaluatedProject run()
+	{
+		EvaluatedProject res;
+		res.name = m_prj.name;
+		res.prjFile = m_prj.path;
+		res.configuration = m_prj.configuration;
+		res.platform = m_prj.platform;
+
+		// Pass 1: Properties and imports
+		if (!importFile(m_prj.path))
+			return res;
+
+		// Pass 2: Item definitions, now that all the properties are known
+		for (auto&& d : m_itemDefinitionGroups)
+		{
+			m_thisFile = d.file;
+			if (evalCondition(d.el))
+				evalItemDefinitionGroup(*d.el);
+		}
+
+		// Pass 3: Items
+		for (auto&& d : m_itemGroups)
+		{
+			m_thisFile = d.file;
+			if (evalCondition(d.el))
+				evalItemGroup(*d.el);
+		}
+
+		res.files = m_files;
+		collectSources(res);
+		res.ok = true;
+		return res;
+	}
+
+private:
+
+	struct Deferred
+	{
+		const XmlElement* el;
+		std::string file;
+	};
+
+	struct Item
+	{
+		std::string type; // Lower case
+		std::string include; // Full path
+		Metadata md;
+	};
+
+	void setGlobal(const std::string& name, const std::string& value)
+	{
+		auto key = tolower(name);
+		m_props[key] = value;
+		m_globals.insert(key);
+	}
+
+	void setProperty(const std::string& name, const std::string& value)
+	{
+		auto key = tolower(name);
+		// Global properties can't be changed by the projects
+		if (m_globals.count(key))
+			return;
+		m_props[key] = value;
+	}
+
+	std::string getProperty(const std::string& name)
+	{
+		auto key = tolower(name);
+		if (key == "msbuildthisfile")
+			return splitFolderAndFile(m_thisFile).second;
+		else if (key == "msbuildthisfiledirectory")
+			return splitFolderAndFile(m_thisFile).first;
+		else if (key == "msbuildthisfilefullpath")
+			return m_thisFile;
+		else if (key == "msbuildthisfilename")
+		{
+			std::string name;
+			getExtension(splitFolderAndFile(m_thisFile).second, &name);
+			return name;
+		}
+		else if (key == "msbuildthisfileextension")
+		{
+			auto ext = getExtension(m_thisFile);
+			return ext.size() ? "." + ext : "";
+		}
+
+		auto it = m_props.find(key);
+		if (it != m_props.end())
+			return it->second;
+
+		// Like msbuild, environment variables are available as properties
+		std::string value;
+		if (getEnvironmentVariable(name, value))
+			return value;
+		return "";
+	}
+
+	std::string thisDir() const
+	{
+		return splitFolderAndFile(m_thisFile).first;
+	}
+
+	std::string makeFullPath(const std::string& path, const std::string& root)
+	{
+		std::string res;
+		if (!fullPath(res, path, root))
+			return path;
+		return res;
+	}
+
+	//
+	// Expansion of $(...), %(...) and property functions
+	//
+
+	std::string expand(const std::string& s, const Metadata* md = nullptr)
+	{
+		if (s.find('(') == std::string::npos)
+			return s;
+
+		std::string res;
+		size_t i = 0;
+		while (i < s.size())
+		{
+			char c = s[i];
+			if ((c == '$' || c == '%' || c == '@') && i + 1 < s.size() && s[i + 1] == '(')
+			{
+				auto close = findClosingParen(s, i + 1);
+				if (close == std::string::npos)
+				{
+					res += s.substr(i);
+					break;
+				}
+
+				auto body = s.substr(i + 2, close - i - 2);
+				if (c == '$')
+				{
+					res += evalProperty(trim(body), md);
+				}
+				else if (c == '%')
+				{
+					// Outside of items, metadata references are left as-is
+					if (md)
+						res += getMetadata(*md, body);
+					else
+						res += s.substr(i, close - i + 1);
+				}
+				// Item lists (@(...)) are only used by targets, so they expand to nothing
+
+				i = close + 1;
+			}
+			else
+			{
+				res += c;
+				i++;
+			}
+		}
+
+		return res;
+	}
+
+	std::string getMetadata(const Metadata& md, std::string name)
+	{
+		// Qualified form: %(ClCompile.PreprocessorDefinitions)
+		auto dot = name.find('.');
+		if (dot != std::string::npos)
+			name = name.substr(dot + 1);
+		auto it = md.find(tolower(trim(name)));
+		return it == md.end() ? "" : it->second;
+	}
+
+	std::string evalArg(const std::string& arg, const Metadata* md)
+	{
+		if (arg.size() >= 2 && (arg[0] == '\'' || arg[0] == '"' || arg[0] == '`') && arg.back() == arg[0])
+			return expand(arg.substr(1, arg.size() - 2), md);
+		return expand(arg, md);
+	}
+
+	std::vector<std::string> evalArgs(const std::string& args, const Metadata* md)
+	{
+		std::vector<std::string> res;
+		for (auto&& a : splitArgs(args))
+			res.push_back(evalArg(a, md));
+		return res;
+	}
+
+	//! Evaluates what is inside $(...)
+	std::string evalProperty(const std::string& body, const Metadata* md)
+	{
+		std::string value;
+		size_t pos = 0;
+
+		if (body.size() && body[0] == '[')
+		{
+			// Static function. E.g: [System.IO.Path]::Combine(a, b)
+			auto typeEnd = body.find("]::");
+			auto open = typeEnd == std::string::npos ? std::string::npos : body.find('(', typeEnd);
+			auto close = open == std::string::npos ? std::string::npos : findClosingParen(body, open);
+			if (close == std::string::npos)
+			{
+				CZ_LOG(logMsBuild, Warning, "%s: Invalid property function '%s'", m_prj.name.c_str(), body.c_str());
+				return "";
+			}
+			auto type = tolower(body.substr(1, typeEnd - 1));
+			auto method = trim(body.substr(typeEnd + 3, open - typeEnd - 3));
+			value = callStatic(type, method, evalArgs(body.substr(open + 1, close - open - 1), md));
+			pos = close + 1;
+		}
+		else if (beginsWith(body, "Registry:"))
+		{
+			return "";
+		}
+		else
+		{
+			while (pos < body.size() && (isalnum(static_cast<unsigned char>(body[pos])) || body[pos] == '_' || body[pos] == '-'))
+				pos++;
+			value = getProperty(body.substr(0, pos));
+		}
+
+		// Instance methods. E.g: $(Foo.Replace('a', 'b').ToLower())
+		while (pos < body.size())
+		{
+			while (pos < body.size() && isSpace(static_cast<unsigned char>(body[pos])))
+				pos++;
+			if (pos == body.size())
+				break;
+			if (body[pos] != '.')
+			{
+				CZ_LOG(logMsBuild, Warning, "%s: Invalid property function '%s'", m_prj.name.c_str(), body.c_str());
+				return "";
+			}
+			pos++;
+			auto start = pos;
+			while (pos < body.size() && (isalnum(static_cast<unsigned char>(body[pos])) || body[pos] == '_'))
+				pos++;
+			auto method = body.substr(start, pos - start);
+			std::vector<std::string> args;
+			if (pos < body.size() && body[pos] == '(')
+			{
+				auto close = findClosingParen(body, pos);
+				if (close == std::string::npos)
+				{
+					CZ_LOG(logMsBuild, Warning, "%s: Invalid property function '%s'", m_prj.name.c_str(), body.c_str());
+					return "";
+				}
+				args = evalArgs(body.substr(pos + 1, close - pos - 1), md);
+				pos = close + 1;
+			}
+			value = callInstance(value, method, args);
+		}
+
+		return value;
+	}
+
+	static const std::string& arg(const std::vector<std::string>& args, size_t index)
+	{
+		static const std::string empty;
+		return index < args.size() ? args[index] : empty;
+	}
+
+	static std::string boolToString(bool v)
+	{
+		return v ? "true" : "false";
+	}
+
+	std::string combinePaths(const std::vector<std::string>& args)
+	{
+		std::string res;
+		for (auto&& a : args)
+		{
+			if (a.empty())
+				continue;
+			if (isAbsolutePath(a) || res.empty())
+				res = a;
+			else
+			{
+				if (res.back() != '\\' && res.back() != '/')
+					res += '\\';
+				res += a;
+			}
+		}
+		return res;
+	}
+
+	std::string callStatic(const std::string& type, const std::string& method, const std::vector<std::string>& args)
+	{
+		auto m = tolower(method);
+		auto& a0 = arg(args, 0);
+		auto& a1 = arg(args, 1);
+
+		if (type == "system.io.path")
+		{
+			if (m == "combine")
+				return combinePaths(args);
+			else if (m == "getfullpath")
+				return makeFullPath(a0, m_prjDir);
+			else if (m == "getdirectoryname")
+				return removeTrailingSlash(splitFolderAndFile(a0).first);
+			else if (m == "getfilename")
+				return splitFolderAndFile(a0).second;
+			else if (m == "getfilenamewithoutextension")
+			{
+				std::string name;
+				getExtension(splitFolderAndFile(a0).second, &name);
+				return name;
+			}
+			else if (m == "getextension")
+			{
+				auto ext = getExtension(a0);
+				return ext.size() ? "." + ext : "";
+			}
+		}
+		else if (type == "msbuild")
+		{
+			if (m == "getdirectorynameoffileabove" || m == "getpathoffileabove")
+			{
+				// GetPathOfFileAbove(file, [startingDirectory]), GetDirectoryNameOfFileAbove(startingDirectory, file)
+				bool getPath = m == "getpathoffileabove";
+				auto file = getPath ? a0 : a1;
+				auto dir = removeTrailingSlash(getPath ? (a1.empty() ? thisDir() : a1) : a0);
+				while (dir.size())
+				{
+					if (isExistingFile(dir + "\\" + file))
+						return getPath ? dir + "\\" + file : dir;
+					auto parent = removeTrailingSlash(splitFolderAndFile(dir).first);
+					if (parent == dir)
+						break;
+					dir = parent;
+				}
+				return "";
+			}
+			else if (m == "valueordefault")
+				return a0.empty() ? a1 : a0;
+			else if (m == "ensuretrailingslash")
+				return (a0.empty() || a0.back() == '\\' || a0.back() == '/') ? a0 : a0 + "\\";
+			else if (m == "normalizedirectory")
+			{
+				auto res = makeFullPath(combinePaths(args), m_prjDir);
+				ensureTrailingSlash(res);
+				return res;
+			}
+			else if (m == "normalizepath")
+				return makeFullPath(combinePaths(args), m_prjDir);
+			else if (m == "add" || m == "subtract" || m == "multiply" || m == "divide")
+			{
+				double v0 = 0, v1 = 0;
+				toNumber(a0, v0);
+				toNumber(a1, v1);
+				if (m == "add")
+					return numberToString(v0 + v1);
+				else if (m == "subtract")
+					return numberToString(v0 - v1);
+				else if (m == "multiply")
+					return numberToString(v0 * v1);
+				else
+					return numberToString(v1 == 0 ? 0 : v0 / v1);
+			}
+			else if (m == "versionequals")
+				return boolToString(compareVersions(a0, a1) == 0);
+			else if (m == "versionnotequals")
+				return boolToString(compareVersions(a0, a1) != 0);
+			else if (m == "versiongreaterthan")
+				return boolToString(compareVersions(a0, a1) > 0);
+			else if (m == "versiongreaterthanorequals")
+				return boolToString(compareVersions(a0, a1) >= 0);
+			else if (m == "versionlessthan")
+				return boolToString(compareVersions(a0, a1) < 0);
+			else if (m == "versionlessthanorequals")
+				return boolToString(compareVersions(a0, a1) <= 0);
+			else if (m == "isosplatform")
+				return boolToString(iequals(a0, "windows"));
+			else if (m == "isrunningfromvisualstudio")
+				return "false";
+			else if (m == "getregistryvalue" || m == "getregistryvaluefromview")
+				return "";
+			else if (m == "getmsbuildextensionspath")
+				return getProperty("MSBuildExtensionsPath");
+			else if (m == "escape" || m == "unescape")
+				return a0;
+		}
+		else if (type == "system.string")
+		{
+			if (m == "isnullorempty")
+				return boolToString(a0.empty());
+			else if (m == "isnullorwhitespace")
+				return boolToString(trim(a0).empty());
+			else if (m == "copy")
+				return a0;
+			else if (m == "concat")
+			{
+				std::string res;
+				for (auto&& a : args)
+					res += a;
+				return res;
+			}
+		}
+		else if (type == "system.io.file")
+		{
+			if (m == "exists")
+				return boolToString(isExistingFile(makeFullPath(a0, m_prjDir)));
+		}
+		else if (type == "system.io.directory")
+		{
+			if (m == "exists")
+				return boolToString(isExistingDirectory(makeFullPath(a0, m_prjDir)));
+		}
+		else if (type == "system.environment")
+		{
+			if (m == "getenvironmentvariable")
+			{
+				std::string value;
+				getEnvironmentVariable(a0, value);
+				return value;
+			}
+			else if (m == "is64bitoperatingsystem")
+				return "true";
+			else if (m == "expandenvironmentvariables")
+				return a0;
+			else if (m == "getfolderpath")
+				return "";
+		}
+
+		CZ_LOG(logMsBuild, Warning, "%s: Property function [%s]::%s not supported",
+			m_prj.name.c_str(), type.c_str(), method.c_str());
+		return "";
+	}
+
+	static std::string trimChars(const std::string& s, const std::string& chars, bool start, bool end)
+	{
+		auto isTrimmed = [&](char c)
+		{
+			return chars.empty() ? isSpace(static_cast<unsigned char>(c)) : chars.find(c) != std::string::npos;
+		};
+		size_t b = 0;
+		size_t e = s.size();
+		if (start)
+			while (b < e && isTrimmed(s[b]))
+				b++;
+		if (end)
+			while (e > b && isTrimmed(s[e - 1]))
+				e--;
+		return s.substr(b, e - b);
+	}
+
+	std::string callInstance(const std::string& value, const std::string& method, const std::vector<std::string>& args)
+	{
+		auto m = tolower(method);
+		auto& a0 = arg(args, 0);
+		auto& a1 = arg(args, 1);
+
+		if (m == "replace")
+			return a0.empty() ? value : replace(value, a0, a1);
+		else if (m == "tolower" || m == "tolowerinvariant")
+			return tolower(value);
+		else if (m == "toupper" || m == "toupperinvariant")
+		{
+			auto res = value;
+			for (auto&& c : res)
+				c = static_cast<char>(::toupper(static_cast<unsigned char>(c)));
+			return res;
+		}
+		else if (m == "trim")
+			return trimChars(value, a0, true, true);
+		else if (m == "trimstart")
+			return trimChars(value, a0, true, false);
+		else if (m == "trimend")
+			return trimChars(value, a0, false, true);
+		else if (m == "startswith")
+			return boolToString(beginsWith(value, a0));
+		else if (m == "endswith")
+			return boolToString(endsWith(value, a0));
+		else if (m == "contains")
+			return boolToString(value.find(a0) != std::string::npos);
+		else if (m == "equals")
+			return boolToString(value == a0);
+		else if (m == "length")
+			return std::to_string(value.size());
+		else if (m == "indexof" || m == "lastindexof")
+		{
+			auto p = m == "indexof" ? value.find(a0) : value.rfind(a0);
+			return p == std::string::npos ? "-1" : std::to_string(p);
+		}
+		else if (m == "substring")
+		{
+			auto start = static_cast<size_t>(std::max(0, atoi(a0.c_str())));
+			if (start > value.size())
+				return "";
+			return args.size() > 1 ? value.substr(start, std::max(0, atoi(a1.c_str()))) : value.substr(start);
+		}
+
+		CZ_LOG(logMsBuild, Warning, "%s: Property function '%s' not supported", m_prj.name.c_str(), method.c_str());
+		return value;
+	}
+
+	//
+	// Conditions
+	//
+
+	struct CondToken
+	{
+		enum class Type
+		{
+			String, // Quoted string, or a $(...)/%(...) reference
+			Word, // Unquoted things, such as and/or, function names, numbers
+			Op,
+			LParen,
+			RParen,
+			Comma,
+			End
+		};
+		Type type;
+		std::string text;
+	};
+
+	struct CondValue
+	{
+		std::string str;
+		bool isBool = false;
+		bool b = false;
+	};
+
+	class ConditionParser
+	{
+	public:
+		ConditionParser(ProjectEvaluator& outer, const std::string& cond, const Metadata* md)
+			: m_outer(outer), m_cond(cond), m_md(md)
+		{
+			tokenize();
+		}
+
+		bool eval(bool& res)
+		{
+			auto v = parseOr();
+			if (!m_ok || peek().type != CondToken::Type::End)
+				return false;
+			res = toBool(v);
+			return m_ok;
+		}
+
+	private:
+
+		void tokenize()
+		{
+			size_t i = 0;
+			const auto& s = m_cond;
+			while (i < s.size())
+			{
+				char c = s[i];
+				if (isSpace(static_cast<unsigned char>(c)))
+				{
+					i++;
+				}
+				else if (c == '\'')
+				{
+					// Quoted string, which can contain property functions with quotes inside
+					size_t j = i + 1;
+					while (j < s.size() && s[j] != '\'')
+					{
+						if ((s[j] == '$' || s[j] == '%' || s[j] == '@') && j + 1 < s.size() && s[j + 1] == '(')
+						{
+							auto close = findClosingParen(s, j + 1);
+							j = close == std::string::npos ? s.size() : close + 1;
+						}
+						else
+						{
+							j++;
+						}
+					}
+					m_tokens.push_back({ CondToken::Type::String, s.substr(i + 1, j - i - 1) });
+					i = j + 1;
+				}
+				else if ((c == '$' || c == '%' || c == '@') && i + 1 < s.size() && s[i + 1] == '(')
+				{
+					auto close = findClosingParen(s, i + 1);
+					if (close == std::string::npos)
+						close = s.size() - 1;
+					m_tokens.push_back({ CondToken::Type::String, s.substr(i, close - i + 1) });
+					i = close + 1;
+				}
+				else if (c == '(')
+				{
+					m_tokens.push_back({ CondToken::Type::LParen, "(" });
+					i++;
+				}
+				else if (c == ')')
+				{
+					m_tokens.push_back({ CondToken::Type::RParen, ")" });
+					i++;
+				}
+				else if (c == ',')
+				{
+					m_tokens.push_back({ CondToken::Type::Comma, "," });
+					i++;
+				}
+				else if (c == '=' || c == '!' || c == '<' || c == '>')
+				{
+					if (i + 1 < s.size() && s[i + 1] == '=')
+					{
+						m_tokens.push_back({ CondToken::Type::Op, s.substr(i, 2) });
+						i += 2;
+					}
+					else
+					{
+						m_tokens.push_back({ CondToken::Type::Op, s.substr(i, 1) });
+						i++;
+					}
+				}
+				else
+				{
+					size_t j = i;
+					while (j < s.size() && !isSpace(static_cast<unsigned char>(s[j])) &&
+						std::string("()=!<>,'").find(s[j]) == std::string::npos)
+						j++;
+					m_tokens.push_back({ CondToken::Type::Word, s.substr(i, j - i) });
+					i = j;
+				}
+			}
+			m_tokens.push_back({ CondToken::Type::End, "" });
+		}
+
+		const CondToken& peek() const
+		{
+			return m_tokens[m_pos];
+		}
+
+		CondToken next()
+		{
+			auto t = m_tokens[m_pos];
+			if (m_pos + 1 < m_tokens.size())
+				m_pos++;
+			return t;
+		}
+
+		CondValue fail()
+		{
+			m_ok = false;
+			return CondValue();
+		}
+
+		static CondValue makeBool(bool v)
+		{
+			CondValue res;
+			res.isBool = true;
+			res.b = v;
+			res.str = boolToString(v);
+			return res;
+		}
+
+		bool toBool(const CondValue& v)
+		{
+			if (v.isBool)
+				return v.b;
+			auto s = tolower(trim(v.str));
+			if (s == "true" || s == "on" || s == "yes" || s == "!false")
+				return true;
+			if (s == "false" || s == "off" || s == "no" || s == "!true")
+				return false;
+			m_ok = false;
+			return false;
+		}
+
+		CondValue parseOr()
+		{
+			auto v = parseAnd();
+			while (m_ok && peek().type == CondToken::Type::Word && iequals(peek().text, "or"))
+			{
+				next();
+				auto r = parseAnd();
+				v = makeBool(toBool(v) | toBool(r));
+			}
+			return v;
+		}
+
+		CondValue parseAnd()
+		{
+			auto v = parseNot();
+			while (m_ok && peek().type == CondToken::Type::Word && iequals(peek().text, "and"))
+			{
+				next();
+				auto r = parseNot();
+				v = makeBool(toBool(v) & toBool(r));
+			}
+			return v;
+		}
+
+		CondValue parseNot()
+		{
+			if (peek().type == CondToken::Type::Op && peek().text == "!")
+			{
+				next();
+				return makeBool(!toBool(parseNot()));
+			}
+			return parseCompare();
+		}
+
+		CondValue parseCompare()
+		{
+			auto l = parseTerm();
+			if (!m_ok || peek().type != CondToken::Type::Op || peek().text == "!")
+				return l;
+
+			auto op = next().text;
+			auto r = parseTerm();
+			if (!m_ok)
+				return r;
+
+			double ln, rn;
+			bool numbers = toNumber(l.str, ln) && toNumber(r.str, rn);
+			if (op == "==")
+				return makeBool(numbers ? ln == rn : iequals(l.str, r.str));
+			else if (op == "!=")
+				return makeBool(numbers ? ln != rn : !iequals(l.str, r.str));
+
+			if (!numbers)
+				return fail();
+			if (op == "<")
+				return makeBool(ln < rn);
+			else if (op == ">")
+				return makeBool(ln > rn);
+			else if (op == "<=")
+				return makeBool(ln <= rn);
+			else if (op == ">=")
+				return makeBool(ln >= rn);
+			return fail();
+		}
+
+		CondValue parseTerm()
+		{
+			auto t = next();
+			if (t.type == CondToken::Type::LParen)
+			{
+				auto v = parseOr();
+				if (next().type != CondToken::Type::RParen)
+					return fail();
+				return v;
+			}
+			else if (t.type == CondToken::Type::String)
+			{
+				CondValue v;
+				v.str = m_outer.expand(t.text, m_md);
+				return v;
+			}
+			else if (t.type == CondToken::Type::Word)
+			{
+				if (peek().type != CondToken::Type::LParen)
+				{
+					CondValue v;
+					v.str = t.text;
+					return v;
+				}
+
+				// Function call
+				next();
+				std::vector<std::string> args;
+				while (m_ok && peek().type != CondToken::Type::RParen && peek().type != CondToken::Type::End)
+				{
+					args.push_back(parseTerm().str);
+					if (peek().type == CondToken::Type::Comma)
+						next();
+				}
+				if (next().type != CondToken::Type::RParen)
+					return fail();
+				return callFunction(t.text, args);
+			}
+			return fail();
+		}
+
+		CondValue callFunction(const std::string& name, const std::vector<std::string>& args)
+		{
+			auto& a0 = arg(args, 0);
+			if (iequals(name, "Exists"))
+			{
+				auto path = trim(a0);
+				if (path.empty())
+					return makeBool(false);
+				// Relative paths are relative to the file the condition is in
+				path = m_outer.makeFullPath(path, m_outer.thisDir());
+				return makeBool(isExistingFile(path) || isExistingDirectory(path));
+			}
+			else if (iequals(name, "HasTrailingSlash"))
+			{
+				return makeBool(a0.size() && (a0.back() == '\\' || a0.back() == '/'));
+			}
+
+			CZ_LOG(logMsBuild, Warning, "%s: Condition function '%s' not supported",
+				m_outer.m_prj.name.c_str(), name.c_str());
+			return fail();
+		}
+
+		ProjectEvaluator& m_outer;
+		const std::string& m_cond;
+		const Metadata* m_md;
+		std::vector<CondToken> m_tokens;
+		size_t m_pos = 0;
+		bool m_ok = true;
+	};
+
+	bool evalCondition(const XmlElement* el, const Metadata* md = nullptr)
+	{
+		auto cond = el->getAttribute("Condition");
+		if (!cond || trim(*cond).empty())
+			return true;
+
+		bool res = false;
+		ConditionParser parser(*this, *cond, md);
+		if (!parser.eval(res))
+		{
+			CZ_LOG(logMsBuild, Warning, "%s: Failed to evaluate condition \"%s\" in '%s'. Assuming false.",
+				m_prj.name.c_str(), cond->c_str(), m_thisFile.c_str());
+			return false;
+		}
+		return res;
+	}
+
+	//
+	// Pass 1: Properties and imports
+	//
+
+	bool importFile(const std::string& filename)
+	{
+		auto key = tolower(filename);
+		// Like msbuild, ignore repeated imports
+		if (!m_imported.insert(key).second)
+			return true;
+
+		auto doc = loadXml(filename);
+		if (!doc)
+			return false;
+		if (!iequals(doc->name, "Project"))
+		{
+			CZ_LOG(logMsBuild, Error, "'%s' is not an msbuild file", filename.c_str());
+			return false;
+		}
+
+		m_files.push_back(filename);
+		auto previousFile = m_thisFile;
+		m_thisFile = filename;
+		evalProjectElement(*doc);
+		m_thisFile = previousFile;
+		m_docs.push_back(std::move(doc));
+		return true;
+	}
+
+	void evalImport(const XmlElement& el)
+	{
+		if (!evalCondition(&el))
+			return;
+
+		auto project = el.getAttribute("Project");
+		if (!project)
+			return;
+
+		auto path = trim(expand(*project));
+		if (path.empty())
+			return;
+		path = makeFullPath(path, thisDir());
+
+		if (path.find('*') != std::string::npos || path.find('?') != std::string::npos)
+		{
+			for (auto&& f : findFiles(path))
+				importFile(f);
+		}
+		else if (isExistingFile(path))
+		{
+			importFile(path);
+		}
+		else
+		{
+			CZ_LOG(logMsBuild, Log, "%s: Import '%s' not found", m_prj.name.c_str(), path.c_str());
+		}
+	}
+
+	void evalPropertyGroup(const XmlElement& el)
+	{
+		for (auto&& p : el.children)
+		{
+			if (evalCondition(p.get()))
+				setProperty(p->name, trim(expand(p->text)));
+		}
+	}
+
+	void evalProjectElement(const XmlElement& el)
+	{
+		for (auto&& child : el.children)
+		{
+			auto&& name = child->name;
+			if (iequals(name, "PropertyGroup"))
+			{
+				if (evalCondition(child.get()))
+					evalPropertyGroup(*child);
+			}
+			else if (iequals(name, "Import"))
+			{
+				evalImport(*child);
+			}
+			else if (iequals(name, "ImportGroup"))
+			{
+				if (evalCondition(child.get()))
+				{
+					for (auto&& i : child->children)
+					{
+						if (iequals(i->name, "Import"))
+							evalImport(*i);
+					}
+				}
+			}
+			else if (iequals(name, "Choose"))
+			{
+				for (auto&& w : child->children)
+				{
+					if (iequals(w->name, "When") && evalCondition(w.get()))
+					{
+						evalProjectElement(*w);
+						break;
+					}
+					else if (iequals(w->name, "Otherwise"))
+					{
+						evalProjectElement(*w);
+						break;
+					}
+				}
+			}
+			else if (iequals(name, "ItemDefinitionGroup"))
+			{
+				m_itemDefinitionGroups.push_back({ child.get(), m_thisFile });
+			}
+			else if (iequals(name, "ItemGroup"))
+			{
+				m_itemGroups.push_back({ child.get(), m_thisFile });
+			}
+			// Anything else (Targets, UsingTask, ProjectExtensions, ...) is not relevant for us
+		}
+	}
+
+	//
+	// Pass 2: Item definitions
+	//
+
+	void evalItemDefinitionGroup(const XmlElement& el)
+	{
+		for (auto&& item : el.children)
+		{
+			if (!evalCondition(item.get()))
+				continue;
+			auto& md = m_itemDefs[tolower(item->name)];
+			for (auto&& m : item->children)
+			{
+				// %(Foo) in a definition refers to the value defined so far
+				if (evalCondition(m.get(), &md))
+					md[tolower(m->name)] = trim(expand(m->text, &md));
+			}
+		}
+	}
+
+	//
+	// Pass 3: Items
+	//
+
+	void setWellKnownMetadata(Metadata& md, const std::string& fullpath)
+	{
+		auto parts = splitFolderAndFile(fullpath);
+		std::string name;
+		auto ext = getExtension(parts.second, &name);
+		md["fullpath"] = fullpath;
+		md["identity"] = fullpath;
+		md["filename"] = name;
+		md["extension"] = ext.size() ? "." + ext : "";
+		md["directory"] = parts.first.size() > 3 ? parts.first.substr(3) : "";
+		md["rootdir"] = parts.first.substr(0, 3);
+		md["relativedir"] = parts.first;
+	}
+
+	std::vector<std::string> expandItemSpec(const std::string& spec)
+	{
+		std::vector<std::string> res;
+		for (auto&& s : splitList(expand(spec)))
+		{
+			auto path = makeFullPath(s, m_prjDir);
+			if (path.find('*') != std::string::npos || path.find('?') != std::string::npos)
+			{
+				auto found = findFiles(path);
+				res.insert(res.end(), found.begin(), found.end());
+			}
+			else
+			{
+				res.push_back(std::move(path));
+			}
+		}
+		return res;
+	}
+
+	void applyItemMetadata(const XmlElement& itemEl, Item& item)
+	{
+		for (auto&& m : itemEl.children)
+		{
+			if (evalCondition(m.get(), &item.md))
+				item.md[tolower(m->name)] = trim(expand(m->text, &item.md));
+		}
+	}
+
+	void evalItemGroup(const XmlElement& el)
+	{
+		for (auto&& itemEl : el.children)
+		{
+			if (!evalCondition(itemEl.get()))
+				continue;
+
+			auto type = tolower(itemEl->name);
+			auto include = itemEl->getAttribute("Include");
+			auto remove = itemEl->getAttribute("Remove");
+			auto update = itemEl->getAttribute("Update");
+
+			if (include)
+			{
+				for (auto&& path : expandItemSpec(*include))
+				{
+					Item item;
+					item.type = type;
+					item.include = path;
+					auto it = m_itemDefs.find(type);
+					if (it != m_itemDefs.end())
+						item.md = it->second;
+					setWellKnownMetadata(item.md, path);
+					applyItemMetadata(*itemEl, item);
+					m_items.push_back(std::move(item));
+				}
+			}
+			else if (remove || update)
+			{
+				std::set<std::string> paths;
+				for (auto&& path : expandItemSpec(remove ? *remove : *update))
+					paths.insert(tolower(path));
+
+				for (auto it = m_items.begin(); it != m_items.end(); )
+				{
+					if (it->type == type && paths.count(tolower(it->include)))
+					{
+						if (remove)
+						{
+							it = m_items.erase(it);
+							continue;
+						}
+						applyItemMetadata(*itemEl, *it);
+					}
+					++it;
+				}
+			}
+		}
+	}
+
+	//
+	// Results
+	//
+
+	void collectSources(EvaluatedProject& res)
+	{
+		std::vector<std::string> systemIncs;
+		for (auto&& s : splitList(getProperty("IncludePath")))
+			systemIncs.push_back(makeFullPath(s, m_prjDir));
+
+		// Without the Visual C++ props, we don't know the system include paths, so use whatever the environment has
+		// (e.g: When running from a Visual Studio command prompt)
+		if (systemIncs.empty())
+		{
+			std::string env;
+			getEnvironmentVariable("INCLUDE", env);
+			for (auto&& s : splitList(env))
+				systemIncs.push_back(makeFullPath(s, m_prjDir));
+		}
+
+		std::unordered_map<std::string, std::shared_ptr<const CompileSettings>> shared;
+		for (auto&& item : m_items)
+		{
+			if (item.type != "clcompile")
+				continue;
+			if (iequals(getMetadata(item.md, "ExcludedFromBuild"), "true"))
+				continue;
+
+			auto settings = std::make_shared<CompileSettings>();
+			for (auto&& d : splitList(getMetadata(item.md, "PreprocessorDefinitions")))
+			{
+				// Leftovers of metadata that doesn't exist
+				if (d.find("%(") == std::string::npos)
+					settings->defines.push_back(d);
+			}
+			for (auto&& i : splitList(getMetadata(item.md, "AdditionalIncludeDirectories")))
+			{
+				if (i.find("%(") == std::string::npos)
+					settings->userIncs.push_back(makeFullPath(i, m_prjDir));
+			}
+			settings->systemIncs = systemIncs;
+
+			auto key = joinParams(settings->defines) + "\n" + joinParams(settings->userIncs);
+			auto it = shared.find(key);
+			if (it == shared.end())
+				it = shared.emplace(key, std::move(settings)).first;
+			res.sources.emplace_back(item.include, it->second);
+		}
+	}
+
+	static std::string joinParams(const std::vector<std::string>& v)
+	{
+		std::string res;
+		for (auto&& s : v)
+			res += s + "|";
+		return res;
+	}
+
+	const SlnProject& m_prj;
+	std::string m_prjDir;
+	std::string m_thisFile;
+	std::unordered_map<std::string, std::string> m_props; // Lower case names
+	std::unordered_set<std::string> m_globals;
+	std::unordered_set<std::string> m_imported;
+	std::vector<std::string> m_files;
+	std::vector<std::unique_ptr<XmlElement>> m_docs;
+	std::vector<Deferred> m_itemDefinitionGroups;
+	std::vector<Deferred> m_itemGroups;
+	std::unordered_map<std::string, Metadata> m_itemDefs; // Per item type (lower case)
+	std::vector<Item> m_items;
+};
+
+} // anonymous namespace
+
+//////////////////////////////////////////////////////////////////////////
+//		Solution
+//////////////////////////////////////////////////////////////////////////
+
+bool parseSolution(
+	const std::string& slnFile, const std::string& configuration, const std::string& platform,
+	std::vector<SlnProject>& out)
+{
+	std::ifstream file(nativePath(slnFile));
+	if (!file.is_open())
+	{
+		CZ_LOG(logMsBuild, Error, "Could not open solution '%s'", slnFile.c_str());
+		return false;
+	}
+
+	auto slnDir = splitFolderAndFile(slnFile).first;
+	std::string slnConfiguration = getConfigurationKey(configuration, platform);
+
+	//                                 1:Type               2:Name          3:Path           4:Guid
+	static std::regex prjRgx("Project\\(\"\\{([^}]*)\\}\"\\)\\s*=\\s*\"([^\"]*)\"\\s*,\\s*\"([^\"]*)\"\\s*,\\s*\"\\{([^}]*)\\}\".*",
+		std::regex::optimize);
+
+	enum class Section
+	{
+		None,
+		SolutionConfigurations,
+		ProjectConfigurations
+	} section = Section::None;
+
+	struct ProjectCfg
+	{
+		std::string activeCfg;
+		bool build = false;
+	};
+	std::unordered_map<std::string, ProjectCfg> cfgs; // Per project guid (lower case)
+
+	std::string line;
+	while (std::getline(file, line))
+	{
+		line = trim(line);
+		std::smatch matches;
+		if (std::regex_match(line, matches, prjRgx))
+		{
+			auto path = matches[3].str();
+			if (!iequals(getExtension(path), "vcxproj"))
+				continue;
+			SlnProject prj;
+			prj.name = matches[2].str();
+			if (!fullPath(prj.path, path, slnDir))
+				continue;
+			prj.guid = tolower(matches[4].str());
+			out.push_back(std::move(prj));
+		}
+		else if (beginsWith(line, "GlobalSection(SolutionConfigurationPlatforms)"))
+		{
+			section = Section::SolutionConfigurations;
+		}
+		else if (beginsWith(line, "GlobalSection(ProjectConfigurationPlatforms)"))
+		{
+			section = Section::ProjectConfigurations;
+		}
+		else if (beginsWith(line, "EndGlobalSection"))
+		{
+			section = Section::None;
+		}
+		else if (section == Section::SolutionConfigurations)
+		{
+			// If no configuration was specified, use the first one (e.g: "Debug|x64 = Debug|x64")
+			if (slnConfiguration.empty())
+				slnConfiguration = trim(line.substr(0, line.find('=')));
+		}
+		else if (section == Section::ProjectConfigurations)
+		{
+			// {GUID}.Debug|x64.ActiveCfg = Debug|Win32
+			// {GUID}.Debug|x64.Build.0 = Debug|Win32
+			auto eq = line.find('=');
+			auto close = line.find('}');
+			if (eq == std::string::npos || close == std::string::npos || line[0] != '{')
+				continue;
+			auto guid = tolower(line.substr(1, close - 1));
+			auto key = trim(line.substr(close + 2, eq - close - 2));
+			auto value = trim(line.substr(eq + 1));
+			std::string cfg;
+			if (beginsWith(key, slnConfiguration + ".", &cfg))
+			{
+				if (cfg == "ActiveCfg")
+					cfgs[guid].activeCfg = value;
+				else if (cfg == "Build.0")
+					cfgs[guid].build = true;
+			}
+		}
+	}
+
+	CZ_LOG(logMsBuild, Log, "Solution configuration '%s'", slnConfiguration.c_str());
+	for (auto&& prj : out)
+	{
+		auto it = cfgs.find(prj.guid);
+		auto cfg = it == cfgs.end() ? slnConfiguration : it->second.activeCfg;
+		auto sep = cfg.find('|');
+		prj.configuration = cfg.substr(0, sep);
+		prj.platform = sep == std::string::npos ? "" : cfg.substr(sep + 1);
+		prj.build = it != cfgs.end() && it->second.build;
+	}
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//		Projects
+//////////////////////////////////////////////////////////////////////////
+
+EvaluatedProject evaluateProject(
+	const std::string& slnFile, const SlnProject& prj, const std::map<std::string, std::string>& globals)
+{
+	CZ_TRACE_SCOPE_DETAIL("evaluator", "evaluateProject", prj.name);
+	CZ_LOG(logMsBuild, Log, "Evaluating project '%s' (%s|%s)",
+		prj.name.c_str(), prj.configuration.c_str(), prj.platform.c_str());
+	ProjectEvaluator evaluator(slnFile, prj, globals);
+	return evaluator.run();
+}
+
+bool evaluateSolution(
+	const std::string& slnFile, const std::string& configuration, const std::string& platform,
+	const std::map<std::string, std::string>& globals,
+	const std::set<std::string>& filter,
+	std::vector<EvaluatedProject>& out)
+{
+	std::vector<SlnProject> projects;
+	if (!parseSolution(slnFile, configuration, platform, projects))
+		return false;
+
+	std::vector<const SlnProject*> todo;
+	for (auto&& prj : projects)
+	{
+		if (prj.build && (filter.empty() || filter.count(prj.name)))
+			todo.push_back(&prj);
+	}
+
+	// Projects are independent of each other, so evaluate them in parallel, with as many threads as cores. The
+	// calling thread is one of them.
+	std::vector<EvaluatedProject> results(todo.size());
+	std::atomic<size_t> next(0);
+	auto worker = [&](bool isCaller)
+	{
+		if (!isCaller)
+			trace::setThreadName("Evaluator");
+		while (true)
+		{
+			auto idx = next++;
+			if (idx >= todo.size())
+				break;
+			results[idx] = evaluateProject(slnFile, *todo[idx], globals);
+		}
+	};
+	int numWorkers = std::min(
+		std::max(1, static_cast<int>(std::thread::hardware_concurrency())), static_cast<int>(todo.size()));
+	std::vector<std::thread> threads;
+	for (int i = 1; i < numWorkers; i++)
+		threads.emplace_back(worker, false);
+	worker(true);
+	for (auto&& t : threads)
+		t.join();
+
+	bool ok = true;
+	for (auto&& res : results)
+	{
+		if (!res.ok)
+		{
+			CZ_LOG(logMsBuild, Error, "Failed to evaluate project '%s'", res.prjFile.c_str());
+			ok = false;
+		}
+		out.push_back(std::move(res));
+	}
+
+	return ok;
+}
+
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "Utils.h"
+#include <map>
+
+//
+// Native evaluation of solutions and C++ projects, so the database can be built without running msbuild.
+//
+// This is not a full msbuild implementation. It only does what is needed to get the compile settings of each
+// source file:
+//	- Properties, imports (with wildcards), Choose/When/Otherwise
+//	- Conditions, and the property functions in common use
+//	- Item definition groups, and ClCompile items (with metadata)
+//	- Targets and tasks are ignored, so anything computed by targets is missed.
+//
+// Properties not found in the projects fall back to environment variables, like msbuild does. The system include
+// paths come from $(IncludePath), which requires the Visual C++ props ($(VCTargetsPath)) to be found. If that is
+// not possible, the INCLUDE environment variable is used.
+//
+
+namespace cz
+{
+
+//! A C++ project listed in a solution file
+struct SlnProject
+{
+	std::string name;
+	std::string path; // Full path
+	std::string guid;
+	// Configuration and Platform the project is built with, for the solution configuration requested
+	std::string configuration;
+	std::string platform;
+	// False if the requested solution configuration doesn't build this project
+	bool build = true;
+};
+
+//! Parses a solution file, returning the C++ projects in it.
+bool parseSolution(
+	const std::string& slnFile, const std::string& configuration, const std::string& platform,
+	std::vector<SlnProject>& out);
+
+//! Compile settings for source files. Files with the same settings share the same instance.
+struct CompileSettings
+{
+	std::vector<std::string> defines;
+	std::vector<std::string> userIncs;
+	std::vector<std::string> systemIncs;
+};
+
+struct EvaluatedProject
+{
+	std::string name;
+	std::string prjFile;
+	std::string configuration;
+	std::string platform;
+	bool ok = false;
+	// The project file and all the files imported, in the order they were imported
+	std::vector<std::string> files;
+	// Source files (full paths) and their compile settings
+	std::vector<std::pair<std::string, std::shared_ptr<const CompileSettings>>> sources;
+};
+
+//! Evaluates a project
+// \param globals
+//		Extra global properties (e.g: VCTargetsPath), which the projects can't change
+EvaluatedProject evaluateProject(
+	const std::string& slnFile, const SlnProject& prj, const std::map<std::string, std::string>& globals);
+
+//! Evaluates all the projects of a solution that are built by the specified configuration, in parallel
+// \param filter
+//		If not empty, only projects with these names are evaluated
+bool evaluateSolution(
+	const std::string& slnFile, const std::string& configuration, const std::string& platform,
+	const std::map<std::string, std::string>& globals,
+	const std::set<std::string>& filter,
+	std::vector<EvaluatedProject>& out);
+
+}
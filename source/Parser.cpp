@@ -1,463 +1,1160 @@
-#include "vimvsPCH.h"
-#include "Parser.h"
-
-namespace cz
-{
-
-static const bool gAsync = true;
-
-//////////////////////////////////////////////////////////////////////////
-//		Parser
-//////////////////////////////////////////////////////////////////////////
-Parser::Parser(Database& db, bool updatedb, bool parseErrors, bool fastParser)
-	: m_db(db)
-	, m_updatedb(updatedb)
-	, m_parseErrors(parseErrors)
-	, m_fastParser(fastParser)
-{
-	m_clNameRgx = std::regex(
-		formatString(".*\\\\%s\\.exe .*", fastParser ? VIMVS_FAST_PARSER_CL : "CL"),
-		std::regex_constants::egrep | std::regex::optimize);
-}
-
-void Parser::inject(const std::string& data)
-{
-	// New lines format are:
-	// Unix		: 0xA
-	// Mac		: 0xD
-	// Windows	: 0xD 0xA
-	size_t line = 1;
-	for(auto c : data)
-	{
-		if (c == 0xA || c == 0xD)
-		{
-			if (m_line.size())
-			{
-				bool consumed = false;
-				if (m_updatedb)
-				{
-					printf("%s\n", m_line.c_str());
-					consumed = parse(m_line);
-				}
-				else
-					printf("%s\n", m_line.c_str());
-
-				if (!consumed && m_parseErrors)
-					tryError(m_line);
-				m_line.clear();
-			}
-			line++;
-		}
-		else
-		{
-			m_line += c;
-		}
-	}
-}
-
-void Parser::finishWork()
-{
-	if (m_fastParser)
-	{
-		m_graph.finishWork();
-		m_graph.iterate([&](const std::shared_ptr<buildgraph::Node>& n)
-		{
-			if (n->getType() != buildgraph::Node::Type::Header)
-				return;
-			auto incDirs = n->getIncludeDirs();
-			m_db.addFile(n->getName(), "", "",
-				joinDefines(n->getDefines()),
-				joinUserIncs(incDirs->getUserIncs()) + joinSystemIncludes(incDirs->getSystemIncs()),
-				true);
-
-		});
-	}
-}
-
-bool Parser::tryVimVsBegin(std::string& line)
-{
-	static std::regex rgx(
-		"[[:space:]]*rem vim-vs-begin: ProjectName=\"(.+)\", ProjectPath=\"(.+)\", IncludePath=(.+)",
-		std::regex_constants::egrep | std::regex::optimize);
-	std::smatch matches;
-	if (!std::regex_match(line, matches, rgx))
-		return false;
-
-	std::vector<std::string> systemIncs;
-	auto projectName = matches[1].str();
-	auto projectPath = matches[2].str();
-	auto includePath = matches[3].str();
-
-	size_t s = 0;
-	size_t e = 0;
-	while (e != std::string::npos)
-	{
-		e = includePath.find(';', s);
-		std::string str;
-		if (e == std::string::npos)
-			str = includePath.substr(s);
-		else
-		{
-			str = includePath.substr(s, e - s);
-			e++;
-		}
-		str = trim(str);
-		if (str.size())
-		{
-			CZ_CHECK(fullPath(str, str, ""));
-			systemIncs.push_back(str);
-		}
-		s = e;
-	}
-
-	if (!m_mp)
-		m_currNode++;
-	auto node = std::make_shared<NodeParser>(*this);
-	m_nodes[m_currNode] = node;
-	node->init(projectName, projectPath, std::move(systemIncs));
-
-	return true;
-}
-
-bool Parser::tryVimVsEnd(std::string& line)
-{
-	static std::regex rgx(
-		"[[:space:]]*rem vim-vs-end: ProjectName=\"(.+)\"",
-		std::regex_constants::egrep | std::regex::optimize);
-	std::smatch matches;
-	if (!std::regex_match(line, matches, rgx))
-		return false;
-
-	auto projectName = matches[1].str();
-	auto it = m_nodes.find(m_currNode);
-	CZ_CHECK(it != m_nodes.end() && it->second->getName() == projectName);
-
-	it->second->finish();
-
-	return true;
-}
-
-bool Parser::tryError(const std::string& line)
-{
-	static std::regex rgx(
-		//                1         <2:File >|3:|  4:line    |       |    5        | |       6         |  |7 |
-		"[[:space:]]*([[:digit:]]*>)?(.*)(\\(([[:digit:]]+)\\)): (fatal error|error|warning) ([A-Z][[:digit:]]*): (.+)",
-		std::regex::optimize);
-
-	static std::regex rgx2(
-		//1                         2             3                4
-		"(.*) : Command line (error|warning) ([A-Z][[:digit:]]*): (.*)",
-		std::regex::optimize
-	);
-
-	// This one is used to retrieve the project after we know it's an error message e.g:
-	// 6>..\..\src\tiff\libtiff\tif_pixarlog.c(908): warning C4244: '=': conversion from 'tmsize_t' to 'uInt', possible loss of data [B:\temp\wxWidgets.3.1.0\build\msw\wx_wxtiff.vcxproj]
-	static std::regex rgx3(
-		// 1   2   3
-		"(.+)(\\[(.*)\\])",
-		std::regex::optimize);
-
-	std::smatch matches;
-	Error err;
-	if (std::regex_match(line, matches, rgx))
-	{
-		err.file = matches[2].str();
-		err.line = std::stoi(matches[4].str());
-		err.type = matches[5].str();
-		err.code = matches[6].str();
-		err.msg = matches[7].str();
-	}
-	else if (std::regex_match(line, matches, rgx2))
-	{
-		err.type = matches[2].str();
-		err.code = matches[3].str();
-		err.msg = matches[4].str();
-	}
-	else
-	{
-		return false;
-	}
-
-	// If we can get the project from the message, then we can resolve relative file paths
-	if (std::regex_match(err.msg, matches, rgx3))
-	{
-		auto prjFile = matches[3].str();
-		auto prjDir = splitFolderAndFile(prjFile).first;
-		fullPath(err.file, err.file, prjDir);
-	}
-
-	// Look for repeated errors/warnings
-	for (auto&& e : m_errors)
-	{
-		if (e.line == err.line && e.file == err.file && e.code == err.code)
-			return true;
-	}
-
-	m_errors.push_back(std::move(err));
-
-
-	return true;
-}
-
-bool Parser::parse(std::string line)
-{
-	if (m_currNode==0)
-	{
-		static std::regex rgx("[[:space:]]*(1>)?Project \".*\" on node 1.*", std::regex_constants::egrep | std::regex::optimize);
-		std::smatch matches;
-		if (!std::regex_match(line, matches, rgx))
-			return false;
-		m_mp = matches[1].matched;
-		m_currNode = 1;
-		return true;
-	}
-
-	// Detect what node to pass this to
-	// Remove the "N>" if present
-	static std::regex rgx("[[:space:]]*(([[:digit:]]+)>)?(.*)", std::regex_constants::egrep | std::regex::optimize);
-	std::smatch matches;
-	CZ_CHECK(std::regex_match(line, matches, rgx));
-	if (matches[2].matched) // The node number
-	{
-		auto n = std::stoi(matches[2].str()); // # TODO : Remove this
-		m_currNode = std::stoi(matches[2].str());
-	}
-
-	line = matches[3].str();
-	if (tryVimVsBegin(line))
-		return true;
-	if (tryVimVsEnd(line))
-		return true;
-
-	auto it = m_nodes.find(m_currNode);
-	if (it != m_nodes.end() && !it->second->isFinished())
-	{
-		return it->second->parseLine(line);
-	}
-
-	return false;
-
-}
-
-//////////////////////////////////////////////////////////////////////////
-//		NodeParser
-//////////////////////////////////////////////////////////////////////////
-NodeParser::NodeParser(Parser& outer) : m_outer(outer)
-{
-}
-
-void NodeParser::init(std::string prjName, std::string prjFile, std::vector<std::string> systemIncs)
-{
-	auto s = splitFolderAndFile(prjFile);
-	m_prjName = prjName;
-	m_prjDir = s.first;
-	m_prjFile = prjFile;
-	m_systemIncs = systemIncs;
-}
-
-void NodeParser::finish()
-{
-	m_state = State::Finished;
-}
-
-bool NodeParser::isFinished() const
-{
-	return m_state == State::Finished;
-}
-
-const std::string& NodeParser::getName() const
-{
-	return m_prjName;
-}
-
-bool NodeParser::parseLine(const std::string& line)
-{
-	if (tryCompile(line))
-		return true;
-
-	if (!m_outer.m_fastParser && tryInclude(line))
-		return true;
-
-	return false;
-}
-
-bool NodeParser::tryCompile(const std::string& line)
-{
-	if (trim(line) == "ClCompile:")
-	{
-		m_state = State::ClCompile;
-		return true;
-	}
-	if (m_state != State::ClCompile)
-		return false;
-
-	// Check if its a call to cl.exe
-	{
-		std::smatch matches;
-		if (!std::regex_match(line, matches, m_outer.m_clNameRgx))
-			return false;
-	}
-
-	m_currDefines.clear();
-	m_currUserIncs.clear();
-
-	//
-	// Extract all defines
-	//
-	{
-		static std::regex rgx("\\/D \"?([[:graph:]]*)\"?", std::regex::optimize);
-		for (
-			std::sregex_iterator i = std::sregex_iterator(line.begin(), line.end(), rgx);
-			i != std::sregex_iterator();
-			++i)
-		{
-			auto&& m = (*i)[1];
-
-			// CMake generated projects can add a macro CMAKE_INTDIR="Debug" to the preprocessor defines, 
-			// which msbuild will log as:
-			//		/D "CMAKE_INTDIR=\"Debug\"" 
-			// The regular expression being used leaves the " at the end (if using "). I'm not an expert at regular
-			// expressions, so no idea how to remove that, so removing it manually
-			auto s = m.str();
-			if (s.back() == '"')
-				s.pop_back();
-			s = replace(s, "\\\"", "\"");
-			m_currDefines.push_back(std::move(s));
-		}
-	}
-
-	//
-	// Extract all includes
-	//
-	auto addInc = [&](std::string s)
-	{
-		s = trim(s);
-		CZ_CHECK(fullPath(s, s, m_prjDir));
-		m_currUserIncs.push_back(std::move(s));
-	};
-
-	{
-		static std::regex rgx("[[:space:]]\\/I\"([^\"]+)\"", std::regex::optimize);
-		for (
-			std::sregex_iterator i = std::sregex_iterator(line.begin(), line.end(), rgx);
-			i != std::sregex_iterator();
-			++i)
-		{
-			addInc((*i)[1]);
-		}
-	}
-	{
-		static std::regex rgx("[[:space:]]\\/I([^\\s,^\"]+)", std::regex::optimize);
-		for (
-			std::sregex_iterator i = std::sregex_iterator(line.begin(), line.end(), rgx);
-			i != std::sregex_iterator();
-			++i)
-		{
-			addInc((*i)[1]);
-		}
-	}
-
-	//
-	// Extract the files to compile. Those are always at the end of the line
-	// We extract them from the end until we find something is is not a file.
-	//
-	std::vector<std::string> tokens;
-	{
-		// e : points to the last char in the token
-		auto e = line.end() - 1;
-		while (true)
-		{
-			while (*e == ' ') e--; // remove spaces
-			bool quoted = *e == '"' ? true : false;
-			if (quoted) e--; // Remove the "
-
-			// s : Points to one character behind the token start
-			std::string::const_iterator s;
-			if (quoted)
-			{
-				s = line.begin() + line.rfind('"', e - line.begin());
-				// msbuild outputs some parameters such as:  /Fd"UnitTest++.dir\Debug\UnitTest++.pdb"
-				// , so  keep processing until we find the space, so we take all that as 1 token
-				if (*(s - 1) != ' ')
-				{
-					s--;
-					while (*s != ' ') s--;
-				}
-			}
-			else
-			{
-				s = line.begin() + line.rfind(' ', e - line.begin());
-			}
-
-			auto token = std::string(s + 1, e + 1);
-
-			// Exit conditions are:
-			// - Token starts with /
-			//		- Additional, if token is a /D, then also drop the previously processor token (which is the macro)
-			//printf("*%s*\n", token.c_str());
-			if (*token.begin() == '/')
-			{
-				if (token == "/D")
-					tokens.pop_back();
-				break;
-			}
-			tokens.push_back(std::move(token));
-			e = s - 1;
-		}
-	}
-
-	if (m_outer.m_updatedb)
-	{
-		for (auto it = tokens.rbegin(); it != tokens.rend(); ++it)
-		{
-			std::string fullpath;
-			CZ_CHECK(fullPath(fullpath, *it, m_prjDir));
-			if (m_outer.m_fastParser)
-				triggerFastParser(fullpath);
-			m_outer.m_db.addFile(
-				fullpath, m_prjName, m_prjFile,
-				joinDefines(m_currDefines),
-				joinUserIncs(m_currUserIncs) + joinSystemIncludes(m_systemIncs),
-				true);
-		}
-
-	}
-
-	return true;
-}
-
-void NodeParser::triggerFastParser(const std::string& fullpath)
-{
-	auto includeDirs = std::make_shared<buildgraph::IncludeDirs>();
-	includeDirs->addSystemInc(m_systemIncs);
-	includeDirs->addUserInc(m_currUserIncs);
-	includeDirs->pushParent(splitFolderAndFile(fullpath).first);
-	m_outer.m_graph.processIncludes(
-		buildgraph::Node::Type::Source, fullpath, includeDirs, m_currDefines, gAsync);
-}
-
-bool NodeParser::tryInclude(const std::string& line)
-{
-	if (m_state != State::ClCompile)
-		return false;
-
-	static std::regex rgx("Note: including file:[[:space:]]*(.*)", std::regex_constants::egrep | std::regex::optimize);
-	std::smatch matches;
-	if (!std::regex_match(line, matches, rgx))
-		return false;
-
-	auto fname = matches[1].str();
-
-	if (!m_outer.m_updatedb)
-		return true;
-
-	CZ_CHECK(fullPath(fname, fname, m_prjDir));
-	m_outer.m_db.addFile(
-		fname, "", "" ,
-		joinDefines(m_currDefines),
-		joinUserIncs(m_currUserIncs) + joinSystemIncludes(m_systemIncs), true);
-	return true;
-}
-
-} // namespace cz
-
+#include "vimvsPCH.h"
+#include "Parser.h"
+#include "Trace.h"
+#include "FileFinder.h"
+#include "ScopeGuard.h"
+
+namespace cz
+{
+
+//! The database rows of source files that share the same compile settings. Doesn't use the parser, so it's called by
+// the worker threads too.
+static std::vector<FileRow> prepareTranslationUnits(
+	const std::string& prjName, const std::string& prjFile,
+	const std::vector<std::string>& files,
+	const std::vector<std::string>& defines,
+	const std::vector<std::string>& userIncs,
+	const std::vector<std::string>& systemIncs,
+	const CompileCommand* cmd)
+{
+	auto settings = std::make_shared<FileSettings>();
+	settings->prjName = prjName;
+	settings->prjFile = prjFile;
+	settings->defines = joinDefines(defines);
+	settings->includes = joinUserIncs(userIncs) + joinSystemIncludes(systemIncs);
+	settings->origin = prjName;
+	if (cmd)
+	{
+		settings->hasCmd = true;
+		settings->compiler = cmd->compiler;
+		settings->workdir = cmd->workdir;
+	}
+
+	std::vector<FileRow> rows;
+	rows.reserve(files.size());
+	for (auto&& fullpath : files)
+		rows.push_back(prepareFileRow(fullpath, settings, cmd ? cmd->args + " \"" + fullpath + "\"" : ""));
+	return rows;
+}
+
+// How often the progress summary is written, in progress mode
+static const auto kProgressInterval = std::chrono::seconds(1);
+// Stdout is fully buffered during builds (see cmd_build), so it's flushed every so often, for the editor to see the
+// build progressing
+static const auto kFlushInterval = std::chrono::milliseconds(250);
+// Lines are sent to the workers at the end of each inject call, or once a node has this many lines waiting
+static const size_t kMaxBatchLines = 256;
+
+//! Compiler options whose value can be the next argument (e.g: "/D X", "/Fo out\"), so the value is not taken for
+// a file to compile
+// \param opt
+//		Option without the '/' or '-'
+static bool isClOptionWithValue(std::string opt)
+{
+	// "/Fo: out\" is the same as "/Fo out\"
+	if (opt.size() > 1 && opt.back() == ':')
+		opt.pop_back();
+	static const std::unordered_set<std::string> opts = {
+		"D", "U", "I", "FI", "FU", "AI", "Fo", "Fe", "Fp", "external:I", "sourceDependencies" };
+	return opts.count(opt) != 0;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//		QuickfixWriter
+//////////////////////////////////////////////////////////////////////////
+bool QuickfixWriter::open(const std::string& filename)
+{
+	m_out.open(nativePath(filename), std::ofstream::out | std::ofstream::trunc);
+	return m_out.is_open();
+}
+
+void QuickfixWriter::write(const Error& e)
+{
+	m_out << e.file << '|' << e.line << '|' << e.col << '|' << e.type << '|' << e.code << '|' << e.msg << '\n';
+	m_out.flush();
+}
+
+//////////////////////////////////////////////////////////////////////////
+//		Parser
+//////////////////////////////////////////////////////////////////////////
+Parser::Parser(Database& db, bool updatedb, bool parseErrors, bool fastParser)
+	: m_db(db)
+	, m_updatedb(updatedb)
+	, m_parseErrors(parseErrors)
+	, m_fastParser(fastParser)
+{
+	m_clNameRgx = std::regex(
+		formatString(".*\\\\%s\\.exe .*", fastParser ? VIMVS_FAST_PARSER_CL : "CL"),
+		std::regex_constants::egrep | std::regex::optimize);
+}
+
+Parser::~Parser()
+{
+	for (auto&& w : m_workers)
+	{
+		{
+			std::lock_guard<std::mutex> lk(w->mtx);
+			w->stop = true;
+		}
+		w->cv.notify_one();
+	}
+	for (auto&& w : m_workers)
+		w->thread.join();
+}
+
+void Parser::inject(const std::string& data)
+{
+	CZ_TRACE_SCOPE("parser", "inject");
+	if (m_updatedb)
+		m_db.beginChanges();
+	SCOPE_EXIT{ if (m_updatedb) m_db.commitChanges(); };
+	// New lines format are:
+	// Unix		: 0xA
+	// Mac		: 0xD
+	// Windows	: 0xD 0xA
+	size_t line = 1;
+	for(auto c : data)
+	{
+		if (c == 0xA || c == 0xD)
+		{
+			if (m_line.size())
+			{
+				if (!m_progress)
+					printf("%s\n", m_line.c_str());
+
+				bool consumed = false;
+				if (m_updatedb)
+					consumed = parse(m_line);
+				if (!consumed)
+				{
+					if (m_order.empty())
+					{
+						finishLine(m_line);
+					}
+					else
+					{
+						m_order.push_back(nullptr);
+						m_unrouted.push_back(std::move(m_line));
+					}
+				}
+				m_line.clear();
+			}
+			line++;
+		}
+		else
+		{
+			m_line += c;
+		}
+	}
+
+	if (m_workers.size())
+	{
+		sendPending();
+		mergeResults(false);
+	}
+	if (m_channel)
+		processToolMessages(false);
+
+	auto now = std::chrono::steady_clock::now();
+	if (m_progress && now - m_lastProgress >= kProgressInterval)
+		writeProgress();
+	else if (now - m_lastFlush >= kFlushInterval)
+	{
+		fflush(stdout);
+		m_lastFlush = now;
+	}
+}
+
+void Parser::setProgressMode(int totalProjects)
+{
+	m_progress = true;
+	m_totalProjects = totalProjects;
+	m_lastProgress = std::chrono::steady_clock::now();
+}
+
+void Parser::writeProgress()
+{
+	if (m_totalProjects)
+		printf("Progress: %d/%d projects", static_cast<int>(m_doneProjects.size()), m_totalProjects);
+	else
+		printf("Progress: %d projects", static_cast<int>(m_doneProjects.size()));
+	printf(", %d source files, %d errors, %d warnings\n", m_numFiles, m_numErrors, m_numWarnings);
+	fflush(stdout);
+	m_lastProgress = m_lastFlush = std::chrono::steady_clock::now();
+}
+
+void Parser::trackProgress(const std::string& line)
+{
+	// Remove the "N>" msbuild adds when building in parallel
+	size_t start = line.find_first_not_of(" \t");
+	if (start == std::string::npos)
+		return;
+	auto nodeEnd = line.find_first_not_of("0123456789", start);
+	if (nodeEnd != std::string::npos && nodeEnd > start && line[nodeEnd] == '>')
+		start = nodeEnd + 1;
+	auto str = trim(line.substr(start));
+
+	// Msbuild logs this every time it finishes targets of a project, so we count the project files seen
+	std::string prjFile;
+	if (beginsWith(str, "Done Building Project \"", &prjFile))
+	{
+		prjFile = prjFile.substr(0, prjFile.find('"'));
+		if (tolower(getExtension(prjFile)) == "vcxproj")
+			m_doneProjects.insert(tolower(prjFile));
+		return;
+	}
+
+	// The compiler logs the name of each file it compiles. When updating the database, files are counted as
+	// they are added instead, since the fast parser's dummy compiler doesn't log anything.
+	if (!m_updatedb && getFileKind(str) == FileKind::Source && str.find_first_of("/\\:( ") == std::string::npos)
+	{
+		m_numFiles++;
+		return;
+	}
+
+	// Errors tryError doesn't know about (e.g: msbuild errors without a line number), and the build result
+	if (str.find(": error ") != std::string::npos || str.find(": fatal error ") != std::string::npos)
+	{
+		m_numErrors++;
+		printf("%s\n", line.c_str());
+	}
+	else if (beginsWith(str, "Build succeeded") || beginsWith(str, "Build FAILED"))
+	{
+		printf("%s\n", line.c_str());
+	}
+}
+
+void Parser::finishLine(const std::string& line)
+{
+	bool consumed = false;
+	if (m_parseErrors)
+		consumed = tryError(line);
+	if (!consumed && m_progress)
+		trackProgress(line);
+}
+
+void Parser::route(int node, const std::shared_ptr<NodeParser>& parser, std::string line, size_t start)
+{
+	if (m_workers.empty())
+	{
+		// The thread calling inject keeps busy reading and splitting the lines, so it doesn't count
+		int numWorkers = std::max(1, static_cast<int>(std::thread::hardware_concurrency()) - 1);
+		for (int i = 0; i < numWorkers; i++)
+		{
+			m_workers.push_back(std::make_unique<Worker>());
+			Worker* w = m_workers.back().get();
+			w->thread = std::thread([this, w] { runWorker(*w); });
+		}
+	}
+
+	// Without /m, each project gets a new node number (see tryVimVsBegin), so the nodes that map to the same worker
+	// share a queue, instead of having one per project, which the worker would go through on every wake up
+	int key = m_mp ? node : node % static_cast<int>(m_workers.size());
+	auto& q = m_queues[key];
+	if (!q)
+	{
+		q = std::make_unique<NodeQueue>();
+		q->worker = m_workers[key % m_workers.size()].get();
+		std::lock_guard<std::mutex> lk(q->worker->mtx);
+		q->worker->queues.push_back(q.get());
+	}
+
+	// A batch only has lines of one project
+	if (q->pending.parser != parser)
+	{
+		send(*q);
+		q->pending.parser = parser;
+	}
+	q->pending.lines.emplace_back(std::move(line), start);
+	m_order.push_back(q.get());
+	if (q->pending.lines.size() >= kMaxBatchLines)
+		send(*q);
+}
+
+void Parser::send(NodeQueue& q)
+{
+	if (q.pending.lines.empty())
+		return;
+	NodeBatch batch;
+	batch.parser = q.pending.parser;
+	std::swap(batch.lines, q.pending.lines);
+	q.in.push(std::move(batch));
+	{
+		std::lock_guard<std::mutex> lk(q.worker->mtx);
+		q.worker->signaled = true;
+	}
+	q.worker->cv.notify_one();
+}
+
+void Parser::sendPending()
+{
+	for (auto&& q : m_queues)
+		send(*q.second);
+}
+
+void Parser::mergeResults(bool wait)
+{
+	CZ_TRACE_SCOPE("parser", "mergeResults");
+	while (m_order.size())
+	{
+		NodeQueue* q = m_order.front();
+		if (!q)
+		{
+			std::string line = std::move(m_unrouted.front());
+			m_unrouted.pop_front();
+			m_order.pop_front();
+			finishLine(line);
+			continue;
+		}
+
+		if (q->resultsPos == q->results.size())
+		{
+			q->results.clear();
+			q->resultsPos = 0;
+			if (!q->out.pop(q->results))
+			{
+				if (!wait)
+					return;
+				std::unique_lock<std::mutex> lk(m_resultsMtx);
+				m_resultsCv.wait(lk, [q] { return q->out.pop(q->results); });
+			}
+		}
+
+		ParsedLine& res = q->results[q->resultsPos++];
+		m_order.pop_front();
+		if (res.apply)
+			res.apply();
+		if (!res.consumed)
+			finishLine(res.line);
+	}
+}
+
+void Parser::runWorker(Worker& w)
+{
+	trace::setThreadName("Parser");
+	std::vector<NodeQueue*> queues;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lk(w.mtx);
+			w.cv.wait(lk, [&w] { return w.signaled || w.stop; });
+			if (w.stop)
+				return;
+			w.signaled = false;
+			queues = w.queues;
+		}
+
+		for (NodeQueue* q : queues)
+		{
+			NodeBatch batch;
+			while (q->in.pop(batch))
+			{
+				CZ_TRACE_SCOPE("parser", "parseBatch");
+				std::vector<ParsedLine> results(batch.lines.size());
+				for (size_t i = 0; i < batch.lines.size(); i++)
+				{
+					auto& line = batch.lines[i];
+					ParsedLine& res = results[i];
+					res.consumed = batch.parser->parseLine(line.first.substr(line.second), res);
+					if (!res.consumed)
+						res.line = std::move(line.first);
+				}
+				q->out.push(std::move(results));
+				{
+					std::lock_guard<std::mutex> lk(m_resultsMtx);
+				}
+				m_resultsCv.notify_one();
+			}
+		}
+	}
+}
+
+void Parser::waitForLines()
+{
+	if (m_updatedb)
+		m_db.beginChanges();
+	SCOPE_EXIT{ if (m_updatedb) m_db.commitChanges(); };
+	if (m_workers.size())
+	{
+		sendPending();
+		mergeResults(true);
+	}
+	if (m_channel)
+	{
+		processToolMessages(true);
+		addMissingToolCommands();
+	}
+}
+
+void Parser::processToolMessages(bool flush)
+{
+	m_channel->receive(m_toolMessages, flush);
+	size_t kept = 0;
+	for (auto&& msg : m_toolMessages)
+	{
+		if (!processToolMessage(msg, flush))
+			m_toolMessages[kept++] = std::move(msg);
+	}
+	m_toolMessages.resize(kept);
+}
+
+void Parser::addMissingToolCommands()
+{
+	int missing = 0;
+	for (auto&& c : m_logCompiles)
+	{
+		std::vector<std::string> files;
+		for (auto&& f : c.files)
+		{
+			if (!m_channelFiles.count(tolower(f)))
+				files.push_back(f);
+		}
+		if (files.empty())
+			continue;
+		missing++;
+		c.apply(files);
+	}
+	m_logCompiles.clear();
+
+	if (missing)
+	{
+		m_numMissingToolCommands += missing;
+		CZ_LOG(logDefault, Warning, "%d compiler command lines not received from the dummy tools", missing);
+		printf("vim-vs: %d compiler command lines were not received from the dummy tools. Used msbuild's output for them.\n",
+			missing);
+	}
+}
+
+bool Parser::processToolMessage(const ToolMessage& msg, bool flush)
+{
+	CZ_TRACE_SCOPE("parser", "toolMessage");
+	// The librarian and linker don't tell us anything we need
+	if (tolower(msg.tool) != VIMVS_FAST_PARSER_CL)
+		return true;
+
+	std::vector<std::string> args;
+	std::string prjFile;
+	for (auto&& a : msg.args)
+	{
+		if (a.size() > 1 && a[0] == '@')
+		{
+			auto it = std::find_if(msg.responseFiles.begin(), msg.responseFiles.end(),
+				[&a](const std::pair<std::string, std::string>& f) { return f.first == a.c_str() + 1; });
+			if (it == msg.responseFiles.end())
+			{
+				CZ_LOG(logDefault, Warning, "%s: Response file '%s' not received", msg.tool.c_str(), a.c_str() + 1);
+				continue;
+			}
+			auto rspArgs = splitCommandLine(it->second);
+			moveAppend(rspArgs, args);
+		}
+		else
+		{
+			args.push_back(a);
+		}
+	}
+
+	for (auto it = args.begin(); it != args.end(); ++it)
+	{
+		if (beginsWith(*it, VIMVS_FAST_PARSER_PROJECT_OPTION, &prjFile))
+		{
+			args.erase(it);
+			break;
+		}
+	}
+	if (prjFile.empty())
+	{
+		CZ_LOG(logDefault, Warning, "Ignoring compiler command line without a project, from '%s'", msg.workdir.c_str());
+		return true;
+	}
+
+	auto it = m_prjParsers.find(tolower(prjFile));
+	if (it == m_prjParsers.end())
+	{
+		if (!flush)
+			return false;
+		CZ_LOG(logDefault, Warning, "Ignoring compiler command line for unknown project '%s'", prjFile.c_str());
+		return true;
+	}
+
+	it->second->addToolCommand(msg.workdir, args);
+	return true;
+}
+
+void Parser::finishWork()
+{
+	waitForLines();
+
+	if (m_fastParser)
+	{
+		{
+			CZ_TRACE_SCOPE("parser", "waitForScans");
+			m_graph.finishWork();
+		}
+
+		CZ_TRACE_SCOPE("parser", "addHeaders");
+		m_db.beginChanges();
+		SCOPE_EXIT{ m_db.commitChanges(); };
+
+		// The origin of a header is the first project (by name, so it's deterministic) that uses it, but all the
+		// projects that use it are recorded, so the header is kept while any of them still does
+		std::unordered_map<PathId, const std::string*> origins;
+		std::vector<std::pair<const buildgraph::Node*, const std::string*>> users;
+		for (auto&& prj : m_prjTUs)
+		{
+			std::unordered_set<PathId> used;
+			for (auto&& f : prj.second)
+			{
+				auto tu = m_graph.getNode(buildgraph::Node::Type::Source, f);
+				if (!tu)
+					continue;
+				for (auto&& n : m_graph.getIncludeClosure(tu))
+				{
+					if (n->getType() != buildgraph::Node::Type::Header || !used.insert(n->getId()).second)
+						continue;
+					origins.emplace(n->getId(), &prj.first);
+					users.emplace_back(n.get(), &prj.first);
+				}
+			}
+		}
+		for (auto&& u : users)
+			m_db.addFileUser(u.first->getName(), *u.second);
+
+		// Defines are shared by lots of headers, so only join each list once
+		std::unordered_map<const std::vector<std::string>*, std::string> joinedDefines;
+		m_graph.iterate([&](const std::shared_ptr<buildgraph::Node>& n)
+		{
+			if (n->getType() != buildgraph::Node::Type::Header)
+				return;
+			auto origin = origins.find(n->getId());
+			auto incDirs = n->getIncludeDirs();
+			auto defines = n->getDefines();
+			auto it = joinedDefines.find(defines.get());
+			if (it == joinedDefines.end())
+				it = joinedDefines.emplace(defines.get(), joinDefines(*defines)).first;
+			m_db.addFile(n->getName(), "", "",
+				it->second,
+				joinUserIncs(incDirs->getUserIncs()) + joinSystemIncludes(incDirs->getSystemIncs()),
+				origin == origins.end() ? "" : *origin->second,
+				true);
+
+		});
+	}
+}
+
+void Parser::addTranslationUnits(
+	const std::string& prjName, const std::string& prjFile,
+	const std::vector<std::string>& files,
+	const std::vector<std::string>& defines,
+	const std::vector<std::string>& userIncs,
+	const std::vector<std::string>& systemIncs,
+	const CompileCommand* cmd)
+{
+	CZ_CHECK(m_updatedb);
+
+	if (m_fastParser)
+	{
+		// Interned once for all the files, since they share the same settings
+		auto sharedDefines = m_graph.internDefines(defines);
+		buildgraph::IncludeDirs sharedIncludeDirs;
+		sharedIncludeDirs.addSystemInc(systemIncs);
+		sharedIncludeDirs.addUserInc(userIncs);
+		for (auto&& fullpath : files)
+		{
+			auto includeDirs = std::make_shared<buildgraph::IncludeDirs>(sharedIncludeDirs);
+			includeDirs->pushParent(splitFolderAndFile(fullpath).first);
+			m_prjTUs[prjName].push_back(fullpath);
+			m_graph.processIncludes(
+				buildgraph::Node::Type::Source, fullpath, includeDirs, sharedDefines, m_asyncScan);
+		}
+	}
+
+	addFileRows(prepareTranslationUnits(prjName, prjFile, files, defines, userIncs, systemIncs, cmd));
+}
+
+void Parser::addFileRows(const std::vector<FileRow>& rows)
+{
+	m_db.beginChanges();
+	SCOPE_EXIT{ m_db.commitChanges(); };
+	m_numFiles += static_cast<int>(rows.size());
+	for (auto&& row : rows)
+		m_db.addFile(row, true);
+}
+
+std::vector<PchProjectReport> Parser::calcPchReport(int minPercent)
+{
+	CZ_CHECK(m_fastParser);
+	return cz::calcPchReport(m_graph, m_prjTUs, minPercent);
+}
+
+bool Parser::tryVimVsBegin(std::string& line)
+{
+	static std::regex rgx(
+		"[[:space:]]*rem vim-vs-begin: ProjectName=\"(.+)\", ProjectPath=\"(.+)\", ProjectConfiguration=\"(.*)\", ProjectPlatform=\"(.*)\", AllProjects=\"(.*)\", ExecutablePath=\"(.*)\", IncludePath=(.+)",
+		std::regex_constants::egrep | std::regex::optimize);
+	std::smatch matches;
+	if (!std::regex_match(line, matches, rgx))
+		return false;
+
+	std::vector<std::string> systemIncs;
+	auto projectName = matches[1].str();
+	auto projectPath = matches[2].str();
+	auto executablePath = matches[6].str();
+	auto includePath = matches[7].str();
+
+	// The project file and anything it imports. If any of these changes, the project needs to be parsed again
+	std::string files = projectPath;
+	{
+		std::set<std::string> added;
+		added.insert(tolower(projectPath));
+		auto allProjects = matches[5].str();
+		size_t start = 0;
+		while (start < allProjects.size())
+		{
+			auto e = allProjects.find(';', start);
+			if (e == std::string::npos)
+				e = allProjects.size();
+			auto f = trim(allProjects.substr(start, e - start));
+			if (f.size() && added.insert(tolower(f)).second)
+				files += ";" + f;
+			start = e + 1;
+		}
+	}
+
+	ProjectInfo& prj = m_projects[projectName];
+	prj.name = projectName;
+	prj.prjFile = projectPath;
+	prj.prjConfiguration = getConfigurationKey(matches[3].str(), matches[4].str());
+	prj.files = std::move(files);
+
+	size_t s = 0;
+	size_t e = 0;
+	while (e != std::string::npos)
+	{
+		e = includePath.find(';', s);
+		std::string str;
+		if (e == std::string::npos)
+			str = includePath.substr(s);
+		else
+		{
+			str = includePath.substr(s, e - s);
+			e++;
+		}
+		str = trim(str);
+		if (str.size())
+		{
+			CZ_CHECK(fullPath(str, str, ""));
+			systemIncs.push_back(str);
+		}
+		s = e;
+	}
+
+	if (!m_mp)
+		m_currNode++;
+	auto node = std::make_shared<NodeParser>(*this);
+	m_nodes[m_currNode] = node;
+	node->init(projectName, projectPath, std::move(systemIncs), executablePath);
+	if (m_channel)
+		m_prjParsers[tolower(projectPath)] = node;
+
+	return true;
+}
+
+bool Parser::tryVimVsEnd(std::string& line)
+{
+	static std::regex rgx(
+		"[[:space:]]*rem vim-vs-end: ProjectName=\"(.+)\"",
+		std::regex_constants::egrep | std::regex::optimize);
+	std::smatch matches;
+	if (!std::regex_match(line, matches, rgx))
+		return false;
+
+	auto projectName = matches[1].str();
+	auto it = m_nodes.find(m_currNode);
+	CZ_CHECK(it != m_nodes.end() && it->second->getName() == projectName);
+
+	// Lines already sent to the worker keep the parser alive until parsed
+	m_nodes.erase(it);
+
+	return true;
+}
+
+bool Parser::tryError(const std::string& line)
+{
+	static std::regex rgx(
+		//                1         <2:File >|3:|  4:line    |       |    5        | |       6         |  |7 |
+		"[[:space:]]*([[:digit:]]*>)?(.*)(\\(([[:digit:]]+)\\)): (fatal error|error|warning) ([A-Z][[:digit:]]*): (.+)",
+		std::regex::optimize);
+
+	static std::regex rgx2(
+		//1                         2             3                4
+		"(.*) : Command line (error|warning) ([A-Z][[:digit:]]*): (.*)",
+		std::regex::optimize
+	);
+
+	// This one is used to retrieve the project after we know it's an error message e.g:
+	// 6>..\..\src\tiff\libtiff\tif_pixarlog.c(908): warning C4244: '=': conversion from 'tmsize_t' to 'uInt', possible loss of data [B:\temp\wxWidgets.3.1.0\build\msw\wx_wxtiff.vcxproj]
+	static std::regex rgx3(
+		// 1   2   3
+		"(.+)(\\[(.*)\\])",
+		std::regex::optimize);
+
+	std::smatch matches;
+	Error err;
+	if (std::regex_match(line, matches, rgx))
+	{
+		err.file = matches[2].str();
+		err.line = std::stoi(matches[4].str());
+		err.type = matches[5].str();
+		err.code = matches[6].str();
+		err.msg = matches[7].str();
+	}
+	else if (std::regex_match(line, matches, rgx2))
+	{
+		err.type = matches[2].str();
+		err.code = matches[3].str();
+		err.msg = matches[4].str();
+	}
+	else
+	{
+		return false;
+	}
+
+	// If we can get the project from the message, then we can resolve relative file paths
+	if (std::regex_match(err.msg, matches, rgx3))
+	{
+		auto prjFile = matches[3].str();
+		auto prjDir = splitFolderAndFile(prjFile).first;
+		fullPath(err.file, err.file, prjDir);
+	}
+
+	// Repeated errors/warnings are common (e.g: Warnings in headers), so skip those
+	if (!m_errorKeys.insert(hash(formatString("%s|%d|%s", err.file.c_str(), err.line, err.code.c_str()))).second)
+		return true;
+
+	if (m_quickfix)
+		m_quickfix->write(err);
+
+	if (err.type == "warning")
+		m_numWarnings++;
+	else
+		m_numErrors++;
+	if (m_progress)
+		printf("%s\n", line.c_str());
+
+
+	return true;
+}
+
+bool Parser::parse(std::string& line)
+{
+	CZ_TRACE_SCOPE("parser", "parseLine");
+	if (m_currNode==0)
+	{
+		static std::regex rgx("[[:space:]]*(1>)?Project \".*\" on node 1.*", std::regex_constants::egrep | std::regex::optimize);
+		std::smatch matches;
+		if (!std::regex_match(line, matches, rgx))
+			return false;
+		m_mp = matches[1].matched;
+		m_currNode = 1;
+		return true;
+	}
+
+	// Detect what node to pass this to, and skip the "N>" if present. This is all this thread does with most
+	// lines, so no regular expressions here.
+	size_t start = line.find_first_not_of(" \t\v\f");
+	if (start == std::string::npos)
+		start = line.size();
+	auto digitsEnd = line.find_first_not_of("0123456789", start);
+	if (digitsEnd != std::string::npos && digitsEnd > start && line[digitsEnd] == '>')
+	{
+		m_currNode = atoi(line.c_str() + start);
+		start = digitsEnd + 1;
+	}
+
+	if (line.find("rem vim-vs-", start) != std::string::npos)
+	{
+		auto str = line.substr(start);
+		if (tryVimVsBegin(str))
+			return true;
+		if (tryVimVsEnd(str))
+			return true;
+	}
+
+	auto it = m_nodes.find(m_currNode);
+	if (it == m_nodes.end())
+		return false;
+	route(m_currNode, it->second, std::move(line), start);
+	return true;
+
+}
+
+//////////////////////////////////////////////////////////////////////////
+//		NodeParser
+//////////////////////////////////////////////////////////////////////////
+NodeParser::NodeParser(Parser& outer) : m_outer(outer)
+{
+}
+
+void NodeParser::init(std::string prjName, std::string prjFile, std::vector<std::string> systemIncs, const std::string& executablePath)
+{
+	auto s = splitFolderAndFile(prjFile);
+	m_prjName = prjName;
+	m_prjDir = s.first;
+	m_prjFile = prjFile;
+	m_systemIncs = systemIncs;
+
+	// With the fast parser, the command lines msbuild logs are for the dummy tool, so we need to find the real
+	// compiler ourselves, the same way msbuild's CL task would.
+	if (m_outer.m_fastParser)
+	{
+		size_t start = 0;
+		while (start < executablePath.size() && m_realCompiler.empty())
+		{
+			auto e = executablePath.find(';', start);
+			if (e == std::string::npos)
+				e = executablePath.size();
+			auto dir = trim(executablePath.substr(start, e - start));
+			if (dir.size())
+			{
+				ensureTrailingSlash(dir);
+				if (isExistingFile(dir + "cl.exe"))
+					fullPath(m_realCompiler, dir + "cl.exe", m_prjDir);
+			}
+			start = e + 1;
+		}
+		if (m_realCompiler.empty())
+			CZ_LOG(logDefault, Warning, "%s: cl.exe not found in ExecutablePath. Files can only be compiled with msbuild.", prjName.c_str());
+	}
+}
+
+const std::string& NodeParser::getName() const
+{
+	return m_prjName;
+}
+
+bool NodeParser::parseLine(const std::string& line, ParsedLine& res)
+{
+	if (tryCompile(line, res))
+		return true;
+
+	if (!m_outer.m_fastParser && tryInclude(line, res))
+		return true;
+
+	return false;
+}
+
+bool NodeParser::tryCompile(const std::string& line, ParsedLine& res)
+{
+	if (trim(line) == "ClCompile:")
+	{
+		m_state = State::ClCompile;
+		return true;
+	}
+	if (m_state != State::ClCompile)
+		return false;
+
+	// Check if its a call to cl.exe
+	{
+		std::smatch matches;
+		if (!std::regex_match(line, matches, m_outer.m_clNameRgx))
+			return false;
+	}
+
+	m_currDefines.clear();
+	m_currUserIncs.clear();
+	m_currIncludeSettings.reset();
+
+	//
+	// Extract all defines
+	//
+	{
+		static std::regex rgx("\\/D \"?([[:graph:]]*)\"?", std::regex::optimize);
+		for (
+			std::sregex_iterator i = std::sregex_iterator(line.begin(), line.end(), rgx);
+			i != std::sregex_iterator();
+			++i)
+		{
+			auto&& m = (*i)[1];
+
+			// CMake generated projects can add a macro CMAKE_INTDIR="Debug" to the preprocessor defines, 
+			// which msbuild will log as:
+			//		/D "CMAKE_INTDIR=\"Debug\"" 
+			// The regular expression being used leaves the " at the end (if using "). I'm not an expert at regular
+			// expressions, so no idea how to remove that, so removing it manually
+			auto s = m.str();
+			if (s.back() == '"')
+				s.pop_back();
+			s = replace(s, "\\\"", "\"");
+			m_currDefines.push_back(std::move(s));
+		}
+	}
+
+	//
+	// Extract all includes
+	//
+	auto addInc = [&](std::string s)
+	{
+		s = trim(s);
+		CZ_CHECK(fullPath(s, s, m_prjDir));
+		m_currUserIncs.push_back(std::move(s));
+	};
+
+	{
+		static std::regex rgx("[[:space:]]\\/I\"([^\"]+)\"", std::regex::optimize);
+		for (
+			std::sregex_iterator i = std::sregex_iterator(line.begin(), line.end(), rgx);
+			i != std::sregex_iterator();
+			++i)
+		{
+			addInc((*i)[1]);
+		}
+	}
+	{
+		static std::regex rgx("[[:space:]]\\/I([^\\s,^\"]+)", std::regex::optimize);
+		for (
+			std::sregex_iterator i = std::sregex_iterator(line.begin(), line.end(), rgx);
+			i != std::sregex_iterator();
+			++i)
+		{
+			addInc((*i)[1]);
+		}
+	}
+
+	//
+	// Extract the files to compile. Those are always at the end of the line
+	// We extract them from the end until we find something is is not a file.
+	//
+	std::vector<std::string> tokens;
+	size_t filesStart = line.size();
+	{
+		// e : points to the last char in the token
+		auto e = line.end() - 1;
+		while (true)
+		{
+			while (*e == ' ') e--; // remove spaces
+			bool quoted = *e == '"' ? true : false;
+			if (quoted) e--; // Remove the "
+
+			// s : Points to one character behind the token start
+			std::string::const_iterator s;
+			if (quoted)
+			{
+				s = line.begin() + line.rfind('"', e - line.begin());
+				// msbuild outputs some parameters such as:  /Fd"UnitTest++.dir\Debug\UnitTest++.pdb"
+				// , so  keep processing until we find the space, so we take all that as 1 token
+				if (*(s - 1) != ' ')
+				{
+					s--;
+					while (*s != ' ') s--;
+				}
+			}
+			else
+			{
+				s = line.begin() + line.rfind(' ', e - line.begin());
+			}
+
+			auto token = std::string(s + 1, e + 1);
+
+			// Exit conditions are:
+			// - Token starts with /
+			//		- Additional, if the option takes a separate value (e.g: /D), then also drop the previously
+			//		processed token (which is the value)
+			//printf("*%s*\n", token.c_str());
+			if (*token.begin() == '/')
+			{
+				if (isClOptionWithValue(token.substr(1)) && tokens.size())
+					tokens.pop_back();
+				break;
+			}
+			tokens.push_back(std::move(token));
+			filesStart = s + 1 - line.begin();
+			e = s - 1;
+		}
+	}
+
+	std::vector<std::string> files;
+	for (auto it = tokens.rbegin(); it != tokens.rend(); ++it)
+	{
+		std::string fullpath;
+		CZ_CHECK(fullPath(fullpath, *it, m_prjDir));
+		files.push_back(std::move(fullpath));
+	}
+	CompileCommand cmd;
+	bool hasCmd = getCompileCommand(line, filesStart, cmd);
+
+	// Without the fast parser, the rows are all that's needed, so they are prepared here, and the thread applying the
+	// results only inserts them
+	if (!m_outer.m_fastParser)
+	{
+		auto rows = prepareTranslationUnits(
+			m_prjName, m_prjFile, files, m_currDefines, m_currUserIncs, m_systemIncs, hasCmd ? &cmd : nullptr);
+		res.apply = [outer = &m_outer, line, prjName = m_prjName, rows = std::move(rows)]()
+		{
+			ProjectInfo& prj = outer->m_projects[prjName];
+			prj.clHash = hash(std::to_string(prj.clHash) + line);
+			outer->addFileRows(rows);
+		};
+		return true;
+	}
+
+	// Captures copies, since this parser might be gone by the time it's called
+	auto apply = [outer = &m_outer, line, prjName = m_prjName, prjFile = m_prjFile,
+		defines = m_currDefines, userIncs = m_currUserIncs, systemIncs = m_systemIncs, hasCmd, cmd = std::move(cmd)](
+		const std::vector<std::string>& files)
+	{
+		ProjectInfo& prj = outer->m_projects[prjName];
+		prj.clHash = hash(std::to_string(prj.clHash) + line);
+		outer->addTranslationUnits(prjName, prjFile, files, defines, userIncs, systemIncs, hasCmd ? &cmd : nullptr);
+	};
+
+	// The tool channel gives us the exact command line (see Parser::processToolMessages), so this is only used for
+	// the files whose message never arrives (see Parser::addMissingToolCommands)
+	if (m_outer.m_channel)
+		res.apply = [outer = &m_outer, files, apply]() { outer->m_logCompiles.push_back({ files, apply }); };
+	else
+		res.apply = [files = std::move(files), apply = std::move(apply)]() { apply(files); };
+
+	return true;
+}
+
+void NodeParser::addToolCommand(const std::string& workdir, const std::vector<std::string>& args)
+{
+	std::string dir = workdir;
+	ensureTrailingSlash(dir);
+
+	std::vector<std::string> files;
+	std::vector<std::string> defines;
+	std::vector<std::string> userIncs;
+	std::string cmdArgs;
+	auto addArg = [&cmdArgs](const std::string& a)
+	{
+		if (cmdArgs.size())
+			cmdArgs += ' ';
+		cmdArgs += quoteArg(a);
+	};
+
+	for (size_t i = 0; i < args.size(); i++)
+	{
+		const std::string& a = args[i];
+		if (a.size() < 2 || (a[0] != '/' && a[0] != '-'))
+		{
+			std::string fullpath;
+			CZ_CHECK(fullPath(fullpath, a, dir));
+			m_outer.m_channelFiles.insert(tolower(fullpath));
+			files.push_back(std::move(fullpath));
+			continue;
+		}
+
+		// We don't want the includes list when compiling a single file
+		auto opt = a.substr(1);
+		if (opt == "showIncludes")
+			continue;
+		addArg(a);
+
+		std::string value;
+		if (isClOptionWithValue(opt))
+		{
+			if (i + 1 == args.size())
+				break;
+			value = args[++i];
+			addArg(value);
+		}
+		else if (opt[0] == 'D' || opt[0] == 'I')
+		{
+			value = opt.substr(1);
+		}
+		else
+		{
+			continue;
+		}
+
+		if (opt[0] == 'D')
+		{
+			defines.push_back(std::move(value));
+		}
+		else if (opt[0] == 'I')
+		{
+			CZ_CHECK(fullPath(value, trim(value), dir));
+			userIncs.push_back(std::move(value));
+		}
+	}
+
+	CompileCommand cmd;
+	cmd.compiler = m_realCompiler;
+	cmd.args = cmdArgs;
+	cmd.workdir = dir;
+
+	ProjectInfo& prj = m_outer.m_projects[m_prjName];
+	std::string line = cmdArgs;
+	for (auto&& f : files)
+		line += " " + quoteArg(f);
+	prj.clHash = hash(std::to_string(prj.clHash) + line);
+	m_outer.addTranslationUnits(m_prjName, m_prjFile, files, defines, userIncs, m_systemIncs,
+		m_realCompiler.size() ? &cmd : nullptr);
+}
+
+bool NodeParser::getCompileCommand(const std::string& line, size_t filesStart, CompileCommand& cmd)
+{
+	// The compiler path is not quoted, and can have spaces, so look for the executable name
+	auto exeName = std::string("\\") + (m_outer.m_fastParser ? VIMVS_FAST_PARSER_CL : "CL") + ".exe ";
+	auto pos = line.find(exeName);
+	if (pos == std::string::npos || pos + exeName.size() > filesStart)
+		return false;
+
+	if (m_outer.m_fastParser)
+	{
+		if (m_realCompiler.empty())
+			return false;
+		cmd.compiler = m_realCompiler;
+	}
+	else
+	{
+		cmd.compiler = trim(line.substr(0, pos + exeName.size() - 1));
+	}
+
+	// We don't want the includes list when compiling a single file
+	cmd.args = " " + line.substr(pos + exeName.size(), filesStart - pos - exeName.size()) + " ";
+	cmd.args = trim(replace(cmd.args, " /showIncludes ", " "));
+	// msbuild runs the compiler from the project's directory
+	cmd.workdir = m_prjDir;
+	return true;
+}
+
+bool NodeParser::tryInclude(const std::string& line, ParsedLine& res)
+{
+	if (m_state != State::ClCompile)
+		return false;
+	CZ_TRACE_SCOPE("parser", "tryInclude");
+
+	static std::regex rgx("Note: including file:[[:space:]]*(.*)", std::regex_constants::egrep | std::regex::optimize);
+	std::smatch matches;
+	if (!std::regex_match(line, matches, rgx))
+		return false;
+
+	auto fname = matches[1].str();
+	CZ_CHECK(fullPath(fname, fname, m_prjDir));
+	if (!m_includes.insert(hashPath(fname)).second)
+		return true;
+	auto row = prepareFileRow(std::move(fname), nullptr);
+
+	// A compile has lots of includes, all with the same settings, so only join them once
+	if (!m_currIncludeSettings)
+	{
+		auto settings = std::make_shared<FileSettings>();
+		settings->defines = joinDefines(m_currDefines);
+		settings->includes = joinUserIncs(m_currUserIncs) + joinSystemIncludes(m_systemIncs);
+		settings->origin = m_prjName;
+		m_currIncludeSettings = std::move(settings);
+	}
+	row.settings = m_currIncludeSettings;
+
+	res.apply = [outer = &m_outer, row = std::move(row)]()
+	{
+		outer->m_db.addFile(row, true);
+	};
+	return true;
+}
+
+} // namespace cz
+
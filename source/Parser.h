@@ -1,91 +1,307 @@
-#pragma once
-
-#include "Database.h"
-#include "BuildGraph.h"
-
-#define VIMVS_FAST_PARSER_CL "vimvs-dummy-cl"
-#define VIMVS_FAST_PARSER_LIB "vimvs-dummy-lib"
-#define VIMVS_FAST_PARSER_LINK "vimvs-dummy-link"
-
-namespace cz
-{
-
-struct Error
-{
-	std::string file;
-	int line = 0;
-	int col = 0;
-	std::string type; // error/warning
-	std::string code;
-	std::string msg;
-};
-
-class NodeParser;
-class Parser
-{
-public:
-	Parser(Database& db, bool updatedb, bool parseErrors, bool fastParser);
-	void inject(const std::string& data);
-	
-	void finishWork();
-	const std::vector<Error>& getErrors() const
-	{
-		return m_errors;
-	}
-private:
-
-	bool parse(std::string line);
-	bool tryVimVsBegin(std::string& line);
-	bool tryVimVsEnd(std::string& line);
-	bool tryError(const std::string& line);
-
-	friend class NodeParser;
-	Database& m_db;
-	std::unordered_map<int, std::shared_ptr<NodeParser>> m_nodes;
-	int m_currNode = 0;
-	bool m_mp = false;
-	bool m_updatedb = false;
-	bool m_parseErrors = false;
-	bool m_fastParser = false;
-	std::vector<Error> m_errors;
-	std::string m_line;
-	std::regex m_clNameRgx;
-	buildgraph::Graph m_graph; // Used when using fast parsing
-};
-
-class NodeParser
-{
-public:
-
-	NodeParser(Parser& outer);
-	void init(std::string prjName, std::string prjFile, std::vector<std::string> systemIncs);
-	void finish();
-	bool isFinished() const;
-	const std::string& getName() const;
-	bool parseLine(const std::string& line);
-private:
-	bool tryCompile(const std::string& line);
-	bool tryInclude(const std::string& line);
-	void triggerFastParser(const std::string& fullpath);
-
-	enum class State
-	{
-		Initial,
-		ClCompile,
-		Finished
-	};
-
-	Parser& m_outer;
-	State m_state = State::Initial;
-	std::vector<std::string> m_currDefines;
-	std::vector<std::string> m_currUserIncs;
-	std::vector<std::string> m_systemIncs;
-	std::string m_prjFile; // Full path to the project file
-	std::string m_prjDir;
-	std::string m_prjName;
-};
-
-
-}
-
-
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include "Database.h"
+#include "BuildGraph.h"
+#include "PchReport.h"
+#include "ToolChannel.h"
+
+#define VIMVS_FAST_PARSER_CL "vimvs-dummy-cl"
+#define VIMVS_FAST_PARSER_LIB "vimvs-dummy-lib"
+#define VIMVS_FAST_PARSER_LINK "vimvs-dummy-link"
+// What gen_fastparser.props adds to the compiler's arguments when there is a tool channel, followed by the project
+// file, so we know what project the command line we receive is for. It's not passed on to the real compiler.
+#define VIMVS_FAST_PARSER_PROJECT_OPTION "/vimvs-project:"
+
+namespace cz
+{
+
+struct Error
+{
+	std::string file;
+	int line = 0;
+	int col = 0;
+	std::string type; // error/warning
+	std::string code;
+	std::string msg;
+};
+
+//! Writes errors to the quickfix file as they are found, flushing each one, so the editor can load them while the
+// build is still running.
+// Each line is "File|Line|Col|Type|Code|Message", which vim loads with :cgetfile (see vimvs#LoadQuickfix)
+class QuickfixWriter
+{
+public:
+	bool open(const std::string& filename);
+	void write(const Error& e);
+private:
+	std::ofstream m_out;
+};
+
+//! Result of a line of a project's output, parsed by one of the parser's worker threads
+struct ParsedLine
+{
+	bool consumed = false;
+	std::string line; // The whole line, if not consumed, so it can still be checked for errors
+	//! Changes to the database and projects, if any. Called by the thread calling Parser::inject, in the order the
+	// lines were received, so the results don't depend on how the workers are scheduled.
+	std::function<void()> apply;
+};
+
+class NodeParser;
+class Parser
+{
+public:
+	Parser(Database& db, bool updatedb, bool parseErrors, bool fastParser);
+	~Parser();
+	Parser(const Parser&) = delete;
+	Parser& operator=(const Parser&) = delete;
+	void inject(const std::string& data);
+
+	//! Waits for the worker threads to parse all the lines received so far, and applies the results.
+	// Called by finishWork, but it should also be called before writing the final progress.
+	void waitForLines();
+	void finishWork();
+
+	//! With the fast parser, gets the compiler command lines from the dummy tools through this channel, instead of
+	// from msbuild's output. It needs to be set before the first call to inject.
+	void setToolChannel(ToolChannel* channel)
+	{
+		m_channel = channel;
+	}
+
+	//! With the fast parser, reads the files for the include scan in the background, many at once (see FileReader),
+	// instead of one at a time as they are found. Only worth it when the files are not in the OS cache.
+	void setAsyncScan(bool async)
+	{
+		m_asyncScan = async;
+	}
+
+	//! Where to write the errors found. Repeated errors are only written once.
+	void setQuickfix(QuickfixWriter* quickfix)
+	{
+		m_quickfix = quickfix;
+	}
+
+	//! Instead of echoing every line of the build output, only echo the errors and warnings (once each), and every
+	// so often a summary of the progress (see writeProgress).
+	// \param totalProjects
+	//		How many projects the build is expected to go through, or 0 if not known
+	void setProgressMode(int totalProjects);
+	//! Writes a summary of the build progress. Called periodically by inject, and it should be called at the end.
+	void writeProgress();
+
+	//! Only available when using the fast parser, since it needs the include graph
+	// \param minPercent
+	//		Minimum percentage of a project's translation units that need to include a header for it to be a candidate
+	std::vector<PchProjectReport> calcPchReport(int minPercent);
+
+	//! Projects found while parsing. The 'stamp' field is not set, since that's not something we parse.
+	const std::map<std::string, ProjectInfo>& getProjects() const
+	{
+		return m_projects;
+	}
+
+	//! Source files compiled (or parsed when updating the database)
+	int getNumFiles() const
+	{
+		return m_numFiles;
+	}
+
+	//! Compiler command lines taken from msbuild's output because the tool channel didn't give us them
+	int getNumMissingToolCommands() const
+	{
+		return m_numMissingToolCommands;
+	}
+
+	//! Sets the information of a project, as if found in msbuild's output.
+	// Used to feed what the native evaluator (see MsBuildEvaluator.h) finds.
+	void setProject(ProjectInfo prj)
+	{
+		auto name = prj.name;
+		m_projects[name] = std::move(prj);
+	}
+
+	//! Adds source files that share the same compile settings to the database (and to the fast parser if enabled)
+	// \param files
+	//		Full paths
+	// \param cmd
+	//		If not null, the compiler command line shared by the files. Its 'args' don't include the files, since
+	//		each file gets its own command line.
+	void addTranslationUnits(
+		const std::string& prjName, const std::string& prjFile,
+		const std::vector<std::string>& files,
+		const std::vector<std::string>& defines,
+		const std::vector<std::string>& userIncs,
+		const std::vector<std::string>& systemIncs,
+		const CompileCommand* cmd = nullptr);
+private:
+	//! Adds the rows of source files (see prepareTranslationUnits)
+	void addFileRows(const std::vector<FileRow>& rows);
+
+	//
+	// When updating the database, the lines of each msbuild node (the "N>" prefix when building in parallel) are
+	// parsed by a worker thread, which also prepares the database rows (see FileRow), so the thread reading msbuild's
+	// output only splits the lines by node, and inserts the rows in order, in one transaction per batch. Each node has
+	// its own queues to and from its worker, and a worker handles several nodes. Without /m, where each project is a
+	// new node, the queues are reused (see route).
+	//
+	//! Lines of one node, sent to its worker in batches
+	struct NodeBatch
+	{
+		std::shared_ptr<NodeParser> parser;
+		std::vector<std::pair<std::string, size_t>> lines; // The whole line, and where the project's output starts
+	};
+	struct Worker;
+	struct NodeQueue
+	{
+		Worker* worker = nullptr;
+		SpscQueue<NodeBatch> in;
+		SpscQueue<std::vector<ParsedLine>> out;
+		NodeBatch pending; // Lines not sent yet
+		std::vector<ParsedLine> results; // Results being applied
+		size_t resultsPos = 0;
+	};
+	struct Worker
+	{
+		std::thread thread;
+		std::mutex mtx;
+		std::condition_variable cv;
+		std::vector<NodeQueue*> queues;
+		bool signaled = false;
+		bool stop = false;
+	};
+
+	//! Returns true if the line was consumed, or sent to a worker
+	bool parse(std::string& line);
+	bool tryVimVsBegin(std::string& line);
+	bool tryVimVsEnd(std::string& line);
+	bool tryError(const std::string& line);
+	//! Progress mode: Counts what the build does, and echoes the lines about the result of the build
+	void trackProgress(const std::string& line);
+	//! What is done with the lines not consumed when updating the database
+	void finishLine(const std::string& line);
+
+	//! Sends a line to the worker of the specified node
+	// \param start
+	//		Where the project's output starts in the line (after the node prefix)
+	void route(int node, const std::shared_ptr<NodeParser>& parser, std::string line, size_t start);
+	void send(NodeQueue& q);
+	void sendPending();
+	//! Applies the results of the lines, in the order they were received
+	// \param wait
+	//		If true, waits for all the lines to be parsed. Otherwise, stops at the first one not parsed yet.
+	void mergeResults(bool wait);
+	void runWorker(Worker& w);
+
+	//! Adds the compiler command lines received from the tool channel
+	// \param flush
+	//		If true, waits for all the tools that finished, and warns about the command lines of projects we didn't
+	//		see starting. Otherwise, those are kept until the project's start is parsed.
+	void processToolMessages(bool flush);
+	//! Returns false if the project the message is for was not seen yet
+	bool processToolMessage(const ToolMessage& msg, bool flush);
+	//! Adds the files of the compiler command lines in msbuild's output that the tool channel didn't give us (e.g: a
+	// dummy tool timed out connecting), so those are not silently lost. Called once the channel is flushed.
+	void addMissingToolCommands();
+
+	friend class NodeParser;
+	Database& m_db;
+	std::unordered_map<int, std::shared_ptr<NodeParser>> m_nodes; // Projects in progress in each node
+	// All the projects seen, by lower case project file, for the tool channel's messages, which can arrive after the
+	// project finished
+	std::unordered_map<std::string, std::shared_ptr<NodeParser>> m_prjParsers;
+	ToolChannel* m_channel = nullptr;
+	std::vector<ToolMessage> m_toolMessages; // Received from the channel, for projects not seen yet
+	struct LogCompile
+	{
+		std::vector<std::string> files;
+		std::function<void(const std::vector<std::string>&)> apply; // Adds the given files, with the line's settings
+	};
+	// Compiler command lines found in msbuild's output when using the tool channel, for addMissingToolCommands
+	std::vector<LogCompile> m_logCompiles;
+	std::unordered_set<std::string> m_channelFiles; // Lower case files received from the tool channel
+	int m_numMissingToolCommands = 0; // Command lines taken from msbuild's output, because no tool sent them
+	std::unordered_map<int, std::unique_ptr<NodeQueue>> m_queues;
+	std::vector<std::unique_ptr<Worker>> m_workers;
+	// Once a line is sent to a worker, every line received after it waits for its turn, so the results are applied
+	// in order. Null for the lines that were not sent to a worker, which are in m_unrouted.
+	std::deque<NodeQueue*> m_order;
+	std::deque<std::string> m_unrouted;
+	std::mutex m_resultsMtx;
+	std::condition_variable m_resultsCv;
+	int m_currNode = 0;
+	bool m_mp = false;
+	bool m_updatedb = false;
+	bool m_parseErrors = false;
+	bool m_fastParser = false;
+	bool m_asyncScan = false;
+	QuickfixWriter* m_quickfix = nullptr;
+	bool m_progress = false;
+	int m_totalProjects = 0;
+	std::unordered_set<std::string> m_doneProjects;
+	int m_numFiles = 0; // Source files compiled (or parsed when updating the database)
+	int m_numErrors = 0;
+	int m_numWarnings = 0;
+	std::chrono::steady_clock::time_point m_lastProgress;
+	std::chrono::steady_clock::time_point m_lastFlush;
+	std::unordered_set<int64_t> m_errorKeys; // Hash of (file, line, code) of the errors found, to skip repeated ones
+	std::string m_line;
+	std::regex m_clNameRgx;
+	buildgraph::Graph m_graph; // Used when using fast parsing
+	std::map<std::string, std::vector<std::string>> m_prjTUs; // Translation units of each project, when using fast parsing
+	std::map<std::string, ProjectInfo> m_projects;
+};
+
+class NodeParser
+{
+public:
+
+	NodeParser(Parser& outer);
+	void init(std::string prjName, std::string prjFile, std::vector<std::string> systemIncs, const std::string& executablePath);
+	const std::string& getName() const;
+	//! Called from a worker thread. Anything that changes the parser or database goes in 'res.apply'.
+	bool parseLine(const std::string& line, ParsedLine& res);
+	//! Adds the files a compiler command line received from the tool channel compiles.
+	// Called from the thread calling Parser::inject. It only uses what 'init' set, so the node's worker can be
+	// parsing lines at the same time.
+	// \param args
+	//		Arguments, with the response files already expanded
+	void addToolCommand(const std::string& workdir, const std::vector<std::string>& args);
+private:
+	bool tryCompile(const std::string& line, ParsedLine& res);
+	bool tryInclude(const std::string& line, ParsedLine& res);
+	//! Builds the compile command from a compiler command line msbuild logged, without the files
+	// \param filesStart
+	//		Where the files to compile start in 'line'
+	bool getCompileCommand(const std::string& line, size_t filesStart, CompileCommand& cmd);
+
+	enum class State
+	{
+		Initial,
+		ClCompile
+	};
+
+	Parser& m_outer;
+	State m_state = State::Initial;
+	std::vector<std::string> m_currDefines;
+	std::vector<std::string> m_currUserIncs;
+	// m_currDefines and m_currUserIncs+m_systemIncs joined, as the database wants them. Null until needed.
+	// Shared by the rows of all the includes of a compile.
+	std::shared_ptr<const FileSettings> m_currIncludeSettings;
+	// Ids of the headers the project's compiles included so far. Only the first time a project includes a header
+	// changes the database (see Database::addFile), so the other times don't need a result.
+	std::unordered_set<uint64_t> m_includes;
+	std::vector<std::string> m_systemIncs;
+	std::string m_prjFile; // Full path to the project file
+	std::string m_prjDir;
+	std::string m_prjName;
+	// Compiler msbuild would use if not replaced by the fast parser's dummy tool (found in $(ExecutablePath))
+	std::string m_realCompiler;
+};
+
+
+}
+
+
@@ -0,0 +1,267 @@
+#include "vimvsPCH.h"
+#include "PathRank.h"
+
+namespace cz
+{
+
+namespace
+{
+
+inline unsigned char foldCase(char c)
+{
+	return (c >= 'A' && c <= 'Z') ? static_cast<unsigned char>(c - 'A' + 'a') : static_cast<unsigned char>(c);
+}
+
+bool equalsNoCase(std::string_view a, std::string_view b)
+{
+	if (a.size() != b.size())
+		return false;
+	for (size_t i = 0; i < a.size(); i++)
+	{
+		if (foldCase(a[i]) != foldCase(b[i]))
+			return false;
+	}
+	return true;
+}
+
+// Bit-parallel edit distance. 'pattern' needs to have between 1 and 64 characters
+int editDistanceBitParallel(std::string_view pattern, std::string_view text, int limit)
+{
+	// Bit i of peq[c] is set if pattern[i]==c. Only the entries used are set, and they are cleared at the end, so
+	// the table doesn't need to be initialized for every call
+	thread_local uint64_t peq[256] = {};
+	const int m = static_cast<int>(pattern.size());
+	for (int i = 0; i < m; i++)
+		peq[foldCase(pattern[i])] |= uint64_t(1) << i;
+
+	const uint64_t last = uint64_t(1) << (m - 1);
+	uint64_t pv = ~uint64_t(0);
+	uint64_t mv = 0;
+	int score = m;
+	const int n = static_cast<int>(text.size());
+	for (int j = 0; j < n; j++)
+	{
+		uint64_t eq = peq[foldCase(text[j])];
+		uint64_t xv = eq | mv;
+		uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+		uint64_t ph = mv | ~(xh | pv);
+		uint64_t mh = pv & xh;
+		if (ph & last)
+			score++;
+		else if (mh & last)
+			score--;
+		// Shifting a 1 in, since the first row of the matrix increases by one per column
+		ph = (ph << 1) | 1;
+		mh <<= 1;
+		pv = mh | ~(xv | ph);
+		mv = ph & xv;
+
+		// Each remaining column can lower the score by at most 1
+		if (score - (n - j - 1) > limit)
+		{
+			score = limit + 1;
+			break;
+		}
+	}
+
+	for (int i = 0; i < m; i++)
+		peq[foldCase(pattern[i])] = 0;
+	return score;
+}
+
+// Classic dynamic programming, for strings too long for editDistanceBitParallel
+int editDistanceDP(std::string_view a, std::string_view b)
+{
+	std::vector<int> row(a.size() + 1);
+	for (size_t i = 0; i <= a.size(); i++)
+		row[i] = static_cast<int>(i);
+	for (size_t j = 1; j <= b.size(); j++)
+	{
+		int diagonal = row[0];
+		row[0] = static_cast<int>(j);
+		for (size_t i = 1; i <= a.size(); i++)
+		{
+			int above = row[i];
+			row[i] = std::min({ row[i] + 1, row[i - 1] + 1, diagonal + (foldCase(a[i - 1]) == foldCase(b[j - 1]) ? 0 : 1) });
+			diagonal = above;
+		}
+	}
+	return row[a.size()];
+}
+
+//
+// Component costs. Names are compared with editDistance, capped, so the structure always counts more.
+//
+const int kMaxNameCost = 255;
+const int kComponentCost = (kMaxNameCost + 1) * 2; // Inserting, removing, or substituting a component
+const int kRoleSwapCost = kMaxNameCost + 1; // Substituting a folder for another with the same role
+
+bool isRoleFolder(std::string_view name)
+{
+	static const std::string_view roles[] = {
+		"src", "source", "sources", "include", "includes", "inc", "public", "private", "internal", "interface" };
+	for (auto r : roles)
+	{
+		if (equalsNoCase(name, r))
+			return true;
+	}
+	return false;
+}
+
+int substitutionCost(const PathComponent& a, const PathComponent& b)
+{
+	if (equalsNoCase(a.name, b.name))
+		return 0;
+	if (a.role && b.role)
+		return kRoleSwapCost;
+	return kComponentCost + editDistance(a.name, b.name, kMaxNameCost - 1);
+}
+
+int insertionCost(const PathComponent& a)
+{
+	return kComponentCost + std::min(static_cast<int>(a.name.size()), kMaxNameCost);
+}
+
+// Splits the directories of a path into components. The file name is left out.
+void splitDirs(std::string_view path, std::vector<PathComponent>& out)
+{
+	out.clear();
+	size_t start = 0;
+	for (size_t i = 0; i < path.size(); i++)
+	{
+		if (path[i] == '\\' || path[i] == '/')
+		{
+			if (i > start)
+			{
+				auto name = path.substr(start, i - start);
+				out.push_back(PathComponent{ name, isRoleFolder(name) });
+			}
+			start = i + 1;
+		}
+	}
+}
+
+} // anonymous namespace
+
+int editDistance(std::string_view a, std::string_view b, int limit)
+{
+	if (a.size() > b.size())
+		std::swap(a, b);
+	if (a.empty())
+		return static_cast<int>(b.size()) > limit ? limit + 1 : static_cast<int>(b.size());
+	// The distance is at least the difference in length
+	if (static_cast<int>(b.size() - a.size()) > limit)
+		return limit + 1;
+	if (a.size() <= 64)
+		return editDistanceBitParallel(a, b, limit);
+	int res = editDistanceDP(a, b);
+	return res > limit ? limit + 1 : res;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//		PathRanker
+//////////////////////////////////////////////////////////////////////////
+
+PathRanker::PathRanker(std::string_view reference)
+	: m_reference(reference)
+{
+	splitDirs(m_reference, m_refDirs);
+}
+
+int PathRanker::calcCost(std::string_view path, bool compareNames, int limit)
+{
+	splitDirs(path, m_dirs);
+
+	size_t common = 0;
+	while (common < m_refDirs.size() && common < m_dirs.size() && equalsNoCase(m_refDirs[common].name, m_dirs[common].name))
+		common++;
+
+	// Without comparing names, a change costs the minimum it can, so the result is a lower bound of the real cost
+	auto insertion = [compareNames](const PathComponent& a)
+	{
+		return compareNames ? insertionCost(a) : kComponentCost;
+	};
+	auto substitution = [compareNames](const PathComponent& a, const PathComponent& b)
+	{
+		if (compareNames)
+			return substitutionCost(a, b);
+		if (equalsNoCase(a.name, b.name))
+			return 0;
+		return (a.role && b.role) ? kRoleSwapCost : kComponentCost;
+	};
+
+	// Edit distance between the remaining components, with one row of the matrix at a time
+	const size_t a = m_refDirs.size() - common;
+	const size_t b = m_dirs.size() - common;
+	m_row.resize(a + 1);
+	m_row[0] = 0;
+	for (size_t i = 1; i <= a; i++)
+		m_row[i] = m_row[i - 1] + insertion(m_refDirs[common + i - 1]);
+
+	for (size_t j = 1; j <= b; j++)
+	{
+		auto&& dir = m_dirs[common + j - 1];
+		int diagonal = m_row[0];
+		m_row[0] += insertion(dir);
+		int rowMin = m_row[0];
+		for (size_t i = 1; i <= a; i++)
+		{
+			int above = m_row[i];
+			m_row[i] = std::min({
+				m_row[i] + insertion(dir),
+				m_row[i - 1] + insertion(m_refDirs[common + i - 1]),
+				diagonal + substitution(m_refDirs[common + i - 1], dir) });
+			diagonal = above;
+			rowMin = std::min(rowMin, m_row[i]);
+		}
+
+		// Costs only grow, so if the whole row is already above the limit, so is the result
+		if (rowMin > limit)
+			return rowMin;
+	}
+
+	return m_row[a];
+}
+
+void PathRanker::add(std::string candidate)
+{
+	m_candidates.push_back(Candidate{ std::move(candidate), 0 });
+}
+
+std::vector<std::string> PathRanker::getRanked()
+{
+	auto byCost = [](const Candidate& a, const Candidate& b)
+	{
+		if (a.cost != b.cost)
+			return a.cost < b.cost;
+		// Shorter paths first, so it's deterministic, whatever order the database gives us the files
+		if (a.path.size() != b.path.size())
+			return a.path.size() < b.path.size();
+		return a.path < b.path;
+	};
+
+	// A lower bound for each candidate first, which is cheap since it doesn't compare folder names
+	for (auto&& c : m_candidates)
+		c.cost = calcCost(c.path, false, INT_MAX);
+	std::sort(m_candidates.begin(), m_candidates.end(), byCost);
+
+	// Then the real cost, most promising candidates first, until the rest can't win. The rest stay sorted by their
+	// lower bound.
+	int best = INT_MAX;
+	auto it = m_candidates.begin();
+	for (; it != m_candidates.end() && it->cost <= best; ++it)
+	{
+		it->cost = calcCost(it->path, true, best);
+		best = std::min(best, it->cost);
+	}
+	std::sort(m_candidates.begin(), it, byCost);
+
+	std::vector<std::string> res;
+	res.reserve(m_candidates.size());
+	for (auto&& c : m_candidates)
+		res.push_back(std::move(c.path));
+	m_candidates.clear();
+	return res;
+}
+
+}
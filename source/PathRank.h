@@ -0,0 +1,67 @@
+#pragma once
+
+#include <climits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace cz
+{
+
+//! A directory of a path, as used by PathRanker
+struct PathComponent
+{
+	std::string_view name;
+	bool role; // True if it's a folder such as "src" or "include", which are interchangeable for ranking
+};
+
+//! Edit distance (Levenshtein) between two strings, ignoring ASCII case.
+// Uses the bit-parallel algorithm of Myers (as formulated by Hyyrö) when the shorter string has up to 64
+// characters, which is O(n) for the lengths we deal with (path components).
+// \param limit
+//		If the distance is found to be greater than this, it stops early and returns limit+1
+int editDistance(std::string_view a, std::string_view b, int limit = INT_MAX);
+
+//! Ranks candidate paths by how close they are to a reference path. Used to find the alternate file (e.g: the
+// header of a source file) among all the files with the same base name.
+//
+// Paths are compared by directory component, from where they diverge:
+//	- A component can be substituted, inserted or removed, like characters in an edit distance.
+//	- Swapping folders with the same role in a layout (e.g: "src" for "include", or "Private" for "Public") is
+//	  cheaper than any other change, so "Foo/src/a.cpp" prefers "Foo/include/a.h" to "Foo/src/Bar/a.h".
+//	- Other substitutions are broken by the edit distance between the two names.
+// The file names are not compared, since the candidates are expected to have the same base name.
+class PathRanker
+{
+public:
+	explicit PathRanker(std::string_view reference);
+
+	void add(std::string candidate);
+
+	//! Returns the candidates, best first.
+	// Candidates that can't beat the best are not fully ranked, and are placed after the ones that are.
+	std::vector<std::string> getRanked();
+
+private:
+	struct Candidate
+	{
+		std::string path;
+		int cost;
+	};
+
+	//! Cost of changing the reference path's folders into the specified path's
+	// \param compareNames
+	//		If false, folder names that differ are not compared, which gives a lower bound of the cost
+	// \param limit
+	//		If the cost is found to be greater than this, it stops early, returning a lower bound
+	int calcCost(std::string_view path, bool compareNames, int limit);
+
+	std::string m_reference;
+	std::vector<PathComponent> m_refDirs;
+	std::vector<Candidate> m_candidates;
+	// Reused by every candidate, so there are no allocations once they are big enough
+	std::vector<PathComponent> m_dirs;
+	std::vector<int> m_row;
+};
+
+}
@@ -0,0 +1,101 @@
+#include "vimvsPCH.h"
+#include "PathTable.h"
+#include "Utils.h"
+
+namespace cz
+{
+
+namespace
+{
+
+// Only ASCII is folded, which is much cheaper than ::tolower, and enough for the paths we deal with
+inline unsigned char foldCase(char c)
+{
+	return (c >= 'A' && c <= 'Z') ? static_cast<unsigned char>(c - 'A' + 'a') : static_cast<unsigned char>(c);
+}
+
+}
+
+size_t PathTable::CaseInsensitiveHash::operator()(std::string_view s) const
+{
+	return static_cast<size_t>(hashPath(s));
+}
+
+bool PathTable::CaseInsensitiveEqual::operator()(std::string_view a, std::string_view b) const
+{
+	if (a.size() != b.size())
+		return false;
+	for (size_t i = 0; i < a.size(); i++)
+	{
+		if (foldCase(a[i]) != foldCase(b[i]))
+			return false;
+	}
+	return true;
+}
+
+PathId PathTable::intern(std::string_view path)
+{
+	{
+		std::shared_lock<std::shared_mutex> lk(m_mtx);
+		auto it = m_ids.find(path);
+		if (it != m_ids.end())
+			return it->second;
+	}
+
+	std::unique_lock<std::shared_mutex> lk(m_mtx);
+	// Another thread might have added it since we checked
+	auto it = m_ids.find(path);
+	if (it != m_ids.end())
+		return it->second;
+	m_entries.emplace_back(path);
+	auto id = static_cast<PathId>(m_entries.size());
+	m_ids.emplace(m_entries.back().path, id);
+	return id;
+}
+
+PathId PathTable::find(std::string_view path) const
+{
+	std::shared_lock<std::shared_mutex> lk(m_mtx);
+	auto it = m_ids.find(path);
+	return it == m_ids.end() ? kInvalidPathId : it->second;
+}
+
+const std::string& PathTable::get(PathId id) const
+{
+	std::shared_lock<std::shared_mutex> lk(m_mtx);
+	CZ_CHECK(id != kInvalidPathId && id <= m_entries.size());
+	return m_entries[id - 1].path;
+}
+
+bool PathTable::isExistingFile(PathId id)
+{
+	Entry* e;
+	{
+		std::shared_lock<std::shared_mutex> lk(m_mtx);
+		CZ_CHECK(id != kInvalidPathId && id <= m_entries.size());
+		e = &m_entries[id - 1];
+	}
+
+	// Several threads might check the filesystem at the same time for the same path, but that's harmless
+	int exists = e->exists.load();
+	if (exists < 0)
+	{
+		exists = cz::isExistingFile(e->path) ? 1 : 0;
+		e->exists = exists;
+	}
+	return exists == 1;
+}
+
+size_t PathTable::size() const
+{
+	std::shared_lock<std::shared_mutex> lk(m_mtx);
+	return m_entries.size();
+}
+
+PathTable& getPathTable()
+{
+	static PathTable table;
+	return table;
+}
+
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <deque>
+#include <shared_mutex>
+#include <string_view>
+#include <unordered_map>
+
+namespace cz
+{
+
+//! Id of a path in a PathTable. 0 is never used, so it can be used as "no path".
+using PathId = uint32_t;
+constexpr PathId kInvalidPathId = 0;
+
+//! Interns canonical paths, so each distinct path is stored once, and can be compared and hashed by id.
+// Paths that only differ in case get the same id, since the Windows filesystem is case insensitive. The path kept is
+// the first spelling seen.
+// Also caches if the file exists, since the same headers are probed over and over by the build graph.
+// All methods are thread safe.
+class PathTable
+{
+public:
+	//! Returns the id of the path, adding it if necessary
+	// \param path
+	//		Canonical full path (see canonicalizePath)
+	PathId intern(std::string_view path);
+
+	//! Returns the id of the path, or kInvalidPathId if not in the table
+	PathId find(std::string_view path) const;
+
+	//! Returns the path with the specified id. The reference is valid for the lifetime of the table.
+	const std::string& get(PathId id) const;
+
+	//! Same as cz::isExistingFile, but the result is cached, so the filesystem is only checked once per path
+	bool isExistingFile(PathId id);
+
+	size_t size() const;
+
+private:
+	struct Entry
+	{
+		explicit Entry(std::string_view path) : path(path) { }
+		std::string path;
+		std::atomic<int> exists{ -1 }; // -1 if not known yet
+	};
+
+	struct CaseInsensitiveHash
+	{
+		size_t operator()(std::string_view s) const;
+	};
+	struct CaseInsensitiveEqual
+	{
+		bool operator()(std::string_view a, std::string_view b) const;
+	};
+
+	mutable std::shared_mutex m_mtx;
+	// A deque, so entries never move, and the keys in m_ids can point to them
+	std::deque<Entry> m_entries;
+	std::unordered_map<std::string_view, PathId, CaseInsensitiveHash, CaseInsensitiveEqual> m_ids;
+};
+
+//! Paths used by the parser and build graph
+PathTable& getPathTable();
+
+}
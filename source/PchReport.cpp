@@ -0,0 +1,82 @@
+#include "vimvsPCH.h"
+#include "PchReport.h"
+
+namespace cz
+{
+
+std::vector<PchProjectReport> calcPchReport(
+	buildgraph::Graph& graph, const std::map<std::string, std::vector<std::string>>& prjTUs, int minPercent)
+{
+	std::vector<PchProjectReport> res;
+	for (auto&& prj : prjTUs)
+	{
+		PchProjectReport report;
+		report.prjName = prj.first;
+
+		// How many translation units include each header
+		std::unordered_map<PathId, std::pair<std::shared_ptr<buildgraph::Node>, int>> counts;
+		std::unordered_set<PathId> tus;
+		for (auto&& f : prj.second)
+		{
+			auto tu = graph.getNode(buildgraph::Node::Type::Source, f);
+			// Ignore files we didn't parse (e.g: not found), or listed more than once
+			if (!tu || !tus.insert(tu->getId()).second)
+				continue;
+			for (auto&& n : graph.getIncludeClosure(tu))
+			{
+				if (n->getType() != buildgraph::Node::Type::Header)
+					continue;
+				auto& c = counts[n->getId()];
+				c.first = n;
+				c.second++;
+			}
+		}
+
+		report.numTUs = static_cast<int>(tus.size());
+		// A PCH doesn't make sense if there is only 1 translation unit
+		if (report.numTUs < 2)
+			continue;
+
+		for (auto&& c : counts)
+		{
+			if (c.second.second * 100 < report.numTUs * minPercent)
+				continue;
+			PchCandidate candidate;
+			candidate.header = c.second.first->getName();
+			candidate.numTUs = c.second.second;
+			candidate.size = std::max(getFileSize(candidate.header), int64_t(0));
+			report.bytesSaved += candidate.size * (candidate.numTUs - 1);
+			report.candidates.push_back(std::move(candidate));
+		}
+
+		std::sort(report.candidates.begin(), report.candidates.end(), [](const PchCandidate& a, const PchCandidate& b)
+		{
+			if (a.numTUs != b.numTUs)
+				return a.numTUs > b.numTUs;
+			if (a.size != b.size)
+				return a.size > b.size;
+			return a.header < b.header;
+		});
+
+		res.push_back(std::move(report));
+	}
+
+	return res;
+}
+
+void writePchReport(std::ostream& out, const std::vector<PchProjectReport>& report)
+{
+	for (auto&& prj : report)
+	{
+		out << formatString("Project '%s': %d translation units, %d candidates, ~%lld bytes saved\n",
+			prj.prjName.c_str(), prj.numTUs, static_cast<int>(prj.candidates.size()), static_cast<long long>(prj.bytesSaved));
+		for (auto&& c : prj.candidates)
+		{
+			out << formatString("\t%d/%d (%d%%)\t%lld bytes\t%s\n",
+				c.numTUs, prj.numTUs, c.numTUs * 100 / prj.numTUs, static_cast<long long>(c.size), c.header.c_str());
+		}
+	}
+}
+
+} // namespace cz
+
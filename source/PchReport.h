@@ -0,0 +1,38 @@
+#pragma once
+
+#include "BuildGraph.h"
+#include <map>
+
+namespace cz
+{
+
+struct PchCandidate
+{
+	std::string header;
+	int numTUs = 0; // How many translation units of the project include this header
+	int64_t size = 0; // Size of the header file, in bytes
+};
+
+struct PchProjectReport
+{
+	std::string prjName;
+	int numTUs = 0;
+	std::vector<PchCandidate> candidates;
+	// Estimate of how many bytes the compiler doesn't need to preprocess if all the candidates are moved to a PCH.
+	// Each candidate is then only parsed once (when building the PCH), instead of once per translation unit.
+	int64_t bytesSaved = 0;
+};
+
+//! Suggests precompiled header candidates for each project, using the include closure of each translation unit.
+// This needs the graph built by the fast parser.
+// \param prjTUs
+//		Full path of the translation units of each project
+// \param minPercent
+//		A header is a candidate if it's included by at least this percentage of the project's translation units
+std::vector<PchProjectReport> calcPchReport(
+	buildgraph::Graph& graph, const std::map<std::string, std::vector<std::string>>& prjTUs, int minPercent);
+
+void writePchReport(std::ostream& out, const std::vector<PchProjectReport>& report);
+
+} // namespace cz
+
@@ -0,0 +1,39 @@
+#pragma once
+
+//
+// What differs between platforms.
+//
+// The OS specific parts of the file system, environment and process functions declared in Utils.h are implemented
+// in PlatformWin32.cpp or PlatformLinux.cpp, and only the one for the current platform is compiled. Code elsewhere
+// should call those functions instead of the OS directly, so the parser, build graph and database build (and can be
+// benchmarked) everywhere.
+// Launching child processes (see ChildProcessLauncher.cpp) and the jobserver (see CompileScheduler.cpp) are still
+// done in their own files, since they are specific to those classes.
+//
+
+#ifndef _MSC_VER
+	// MSVC specific keywords and annotations used in the code
+	#define _Printf_format_string_
+	#define __forceinline inline __attribute__((always_inline))
+#endif
+
+namespace cz
+{
+
+//! Command line arguments of the process (including the executable), as UTF-8
+std::vector<std::string> getCommandLineArgs();
+
+//! Breaks into the debugger if there is one attached, or crashes the process otherwise
+void debugBreak();
+
+#ifdef _WIN32
+	//! Path to pass to the standard library (e.g: std::ofstream), which on Windows needs wchar_t to support UTF-8
+	std::wstring nativePath(const std::string& path);
+#else
+	inline const std::string& nativePath(const std::string& path)
+	{
+		return path;
+	}
+#endif
+
+}
@@ -0,0 +1,414 @@
+#include "vimvsPCH.h"
+#include "Utils.h"
+#include "Logging.h"
+#include "ScopeGuard.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+//
+// Linux implementation of what is in Platform.h, and of the file system, environment and process functions in
+// Utils.h
+//
+// Files are queried with fstatat/openat relative to a cached descriptor of their directory. The build graph and the
+// evaluator probe lots of files in the same few directories (the include paths), so most lookups hit the cache. A
+// descriptor is only used while its path still leads to the same directory. Checking that takes a stat of the
+// directory, so it's only done once per generation (see newFileSystemGeneration), or if the descriptor is stale.
+//
+
+namespace cz
+{
+
+namespace
+{
+
+//! O_PATH descriptors of the directories files were looked up in
+class DirCache
+{
+public:
+	//! Calls f(dirfd, name) with 'dirfd' being the directory of 'path', and 'name' the file in it, as with the *at
+	// functions (e.g: fstatat). Returns what 'f' returns, which needs to be < 0 on error, with errno set.
+	template<typename F>
+	int at(const std::string& path, F&& f)
+	{
+		auto slash = path.rfind('/');
+		// Relative paths and directories with a trailing slash are used as they are
+		if (slash == std::string::npos || slash + 1 == path.size())
+			return f(AT_FDCWD, path.c_str());
+		std::string_view dir(path.data(), slash ? slash : 1);
+		const char* name = path.c_str() + slash + 1;
+
+		for (int attempt = 0; attempt < 2; attempt++)
+		{
+			auto d = get(dir);
+			if (!d)
+				break;
+
+			// Already checked in this generation.
+			// Files not found (ENOENT) are trusted too, since most lookups are header probes that don't find the file,
+			// and checking the directory again would make those slower than not having the cache.
+			auto generation = m_generation.load(std::memory_order_relaxed);
+			if (d->generation.load(std::memory_order_relaxed) == generation)
+			{
+				int res = f(d->fd, name);
+				if (res >= 0 || errno != ESTALE)
+					return res;
+			}
+
+			// If the directory was renamed, or deleted and created again, since it was cached, the descriptor still
+			// points to the old one, so it's only used if the path still leads to the same directory
+			struct stat st;
+			if (stat(d->path.c_str(), &st) == 0 && st.st_dev == d->dev && st.st_ino == d->ino)
+			{
+				d->generation.store(generation, std::memory_order_relaxed);
+				return f(d->fd, name);
+			}
+			remove(d);
+		}
+
+		return f(AT_FDCWD, path.c_str());
+	}
+
+	void newGeneration()
+	{
+		m_generation.fetch_add(1, std::memory_order_relaxed);
+	}
+
+private:
+	struct Dir
+	{
+		explicit Dir(std::string_view path, int fd, const struct stat& st, unsigned generation)
+			: path(path), fd(fd), dev(st.st_dev), ino(st.st_ino), generation(generation) { }
+		~Dir()
+		{
+			close(fd);
+		}
+		std::string path;
+		int fd;
+		// What the descriptor points to
+		dev_t dev;
+		ino_t ino;
+		// Last generation it was checked in
+		std::atomic<unsigned> generation;
+	};
+
+	std::shared_ptr<Dir> get(std::string_view dir)
+	{
+		{
+			std::shared_lock<std::shared_mutex> lk(m_mtx);
+			auto it = m_dirs.find(dir);
+			if (it != m_dirs.end())
+				return it->second;
+			// Each entry keeps a descriptor open, so the number of entries is limited. Once full, the paths not
+			// cached are used as they are.
+			if (m_dirs.size() >= kMaxDirs)
+				return nullptr;
+		}
+
+		std::string path(dir);
+		int fd = open(path.c_str(), O_PATH | O_DIRECTORY | O_CLOEXEC);
+		if (fd < 0)
+			return nullptr;
+		struct stat st;
+		if (fstat(fd, &st) != 0)
+		{
+			close(fd);
+			return nullptr;
+		}
+		auto d = std::make_shared<Dir>(dir, fd, st, m_generation.load(std::memory_order_relaxed));
+
+		std::unique_lock<std::shared_mutex> lk(m_mtx);
+		// Another thread might have added it since we checked
+		auto res = m_dirs.emplace(d->path, d);
+		return res.first->second;
+	}
+
+	void remove(const std::shared_ptr<Dir>& d)
+	{
+		std::unique_lock<std::shared_mutex> lk(m_mtx);
+		auto it = m_dirs.find(d->path);
+		if (it != m_dirs.end() && it->second == d)
+			m_dirs.erase(it);
+	}
+
+	static constexpr size_t kMaxDirs = 256;
+	std::atomic<unsigned> m_generation{ 0 };
+	std::shared_mutex m_mtx;
+	// The keys point to the path in the value
+	std::unordered_map<std::string_view, std::shared_ptr<Dir>> m_dirs;
+};
+
+DirCache& getDirCache()
+{
+	static DirCache cache;
+	return cache;
+}
+
+bool statFile(const std::string& filename, struct stat& st)
+{
+	return getDirCache().at(filename, [&st](int dirfd, const char* name)
+	{
+		return fstatat(dirfd, name, &st, 0);
+	}) == 0;
+}
+
+//! Same matching as FindFirstFile, which is case insensitive, and only supports '*' and '?'
+bool matchesWildcard(const char* name, const char* pattern)
+{
+	const char* star = nullptr;
+	const char* starName = nullptr;
+	while (*name)
+	{
+		if (*pattern == '*')
+		{
+			star = pattern++;
+			starName = name;
+		}
+		else if (*pattern == '?' || (*pattern && ::tolower(*pattern) == ::tolower(*name)))
+		{
+			pattern++;
+			name++;
+		}
+		else if (star)
+		{
+			// Backtrack, with the last '*' taking one more character
+			pattern = star + 1;
+			name = ++starName;
+		}
+		else
+		{
+			return false;
+		}
+	}
+	while (*pattern == '*')
+		pattern++;
+	return *pattern == 0;
+}
+
+// The glibc versions we support don't have a wrapper for getdents64, so this is the kernel's struct
+struct LinuxDirent64
+{
+	uint64_t d_ino;
+	int64_t d_off;
+	unsigned short d_reclen;
+	unsigned char d_type;
+	char d_name[];
+};
+
+} // anonymous namespace
+
+std::string getLastErrorMsg(const char* funcname)
+{
+	return formatString("%s failed with error %d: %s", funcname ? funcname : "", errno, strerror(errno));
+}
+
+std::vector<std::string> getCommandLineArgs()
+{
+	// The arguments are null terminated, one after the other
+	std::vector<std::string> res;
+	std::ifstream file("/proc/self/cmdline", std::ifstream::in | std::ifstream::binary);
+	std::string arg;
+	while (std::getline(file, arg, '\0'))
+		res.push_back(std::move(arg));
+	return res;
+}
+
+void debugBreak()
+{
+	raise(SIGTRAP);
+}
+
+std::string getCWD()
+{
+	std::vector<char> buf(1024);
+	while (!getcwd(buf.data(), buf.size()))
+	{
+		CZ_CHECK(errno == ERANGE);
+		buf.resize(buf.size() * 2);
+	}
+	std::string res(buf.data());
+	ensureTrailingSlash(res);
+	return res;
+}
+
+void newFileSystemGeneration()
+{
+	getDirCache().newGeneration();
+}
+
+bool isExistingFile(const std::string& filename)
+{
+	struct stat st;
+	return statFile(filename, st) && !S_ISDIR(st.st_mode);
+}
+
+bool isExistingDirectory(const std::string& path)
+{
+	struct stat st;
+	return statFile(path, st) && S_ISDIR(st.st_mode);
+}
+
+int64_t getFileSize(const std::string& filename)
+{
+	struct stat st;
+	if (!statFile(filename, st))
+		return -1;
+	return st.st_size;
+}
+
+int64_t getFileModificationTime(const std::string& filename)
+{
+	struct stat st;
+	if (!statFile(filename, st))
+		return -1;
+	return int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+}
+
+bool renameFile(const std::string& from, const std::string& to)
+{
+	return rename(from.c_str(), to.c_str()) == 0;
+}
+
+bool deleteFile(const std::string& filename)
+{
+	return unlink(filename.c_str()) == 0;
+}
+
+bool createDirectory(const std::string& path)
+{
+	return mkdir(path.c_str(), 0777) == 0;
+}
+
+bool removeDirectory(const std::string& path)
+{
+	return rmdir(path.c_str()) == 0;
+}
+
+std::vector<std::string> findFiles(const std::string& pattern)
+{
+	std::vector<std::string> res;
+	auto folderAndFile = splitFolderAndFile(pattern);
+	const std::string& folder = folderAndFile.first;
+	// Without the trailing slash, so the folder is opened relative to its parent, which is likely cached
+	std::string dir = removeTrailingSlash(folder);
+	if (dir.empty())
+		dir = folder.size() ? "/" : ".";
+	int fd = getDirCache().at(dir, [](int dirfd, const char* name)
+	{
+		return openat(dirfd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	});
+	if (fd < 0)
+		return res;
+	SCOPE_EXIT{ close(fd); };
+
+	std::vector<char> buf(32 * 1024);
+	while (true)
+	{
+		auto n = syscall(SYS_getdents64, fd, buf.data(), buf.size());
+		if (n <= 0)
+			break;
+		for (long pos = 0; pos < n;)
+		{
+			auto e = reinterpret_cast<const LinuxDirent64*>(buf.data() + pos);
+			pos += e->d_reclen;
+			if (!matchesWildcard(e->d_name, folderAndFile.second.c_str()))
+				continue;
+			bool isDir = e->d_type == DT_DIR;
+			// Not all file systems fill d_type
+			if (e->d_type == DT_UNKNOWN)
+			{
+				struct stat st;
+				isDir = fstatat(fd, e->d_name, &st, 0) == 0 && S_ISDIR(st.st_mode);
+			}
+			if (!isDir)
+				res.push_back(folder + e->d_name);
+		}
+	}
+
+	std::sort(res.begin(), res.end());
+	return res;
+}
+
+bool getEnvironmentVariable(const std::string& name, std::string& dst)
+{
+	const char* value = getenv(name.c_str());
+	if (!value)
+		return false;
+	dst = value;
+	return true;
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+bool MappedFile::open(const std::string& filename)
+{
+	close();
+
+	int fd = getDirCache().at(filename, [](int dirfd, const char* name)
+	{
+		return openat(dirfd, name, O_RDONLY | O_CLOEXEC);
+	});
+	if (fd < 0)
+		return false;
+	// The mapping keeps the file alive, so the descriptor is not needed after mapping it.
+	// Renaming over the file (see renameFile) doesn't affect the mapping either.
+	SCOPE_EXIT{ ::close(fd); };
+
+	struct stat st;
+	// Mapping an empty file fails, so treat it as an error too
+	if (fstat(fd, &st) != 0 || st.st_size == 0)
+		return false;
+
+	void* data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+	if (data == MAP_FAILED)
+		return false;
+
+	m_data = static_cast<const uint8_t*>(data);
+	m_size = static_cast<size_t>(st.st_size);
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (m_data)
+		munmap(const_cast<uint8_t*>(m_data), m_size);
+	m_data = nullptr;
+	m_size = 0;
+}
+
+std::string getProcessPath(std::string* fname)
+{
+	std::vector<char> buf(1024);
+	while (true)
+	{
+		auto n = readlink("/proc/self/exe", buf.data(), buf.size());
+		if (n < 0)
+			return "";
+		if (static_cast<size_t>(n) < buf.size())
+		{
+			buf.resize(n);
+			break;
+		}
+		buf.resize(buf.size() * 2);
+	}
+
+	std::string result(buf.begin(), buf.end());
+	auto index = result.rfind('/');
+	if (index == std::string::npos)
+		return "";
+	if (fname)
+		*fname = result.substr(index + 1);
+	return result.substr(0, index + 1);
+}
+
+} // namespace cz
@@ -0,0 +1,330 @@
+#include "vimvsPCH.h"
+#include "Utils.h"
+#include "Logging.h"
+#include "ScopeGuard.h"
+
+//
+// Windows implementation of what is in Platform.h, and of the file system, environment and process functions in
+// Utils.h
+//
+
+namespace cz
+{
+
+std::string getLastErrorMsg(const char* funcname)
+{
+	LPVOID lpMsgBuf;
+	LPVOID lpDisplayBuf;
+	DWORD dw = GetLastError();
+
+	FormatMessageW(FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS,
+	               NULL,
+	               dw,
+	               MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT),
+	               (LPTSTR)&lpMsgBuf,
+	               0,
+	               NULL);
+	SCOPE_EXIT{ LocalFree(lpMsgBuf); };
+
+	int funcnameLength = funcname ? lstrlen((LPCTSTR)funcname) : 0;
+	lpDisplayBuf =
+	    (LPVOID)LocalAlloc(LMEM_ZEROINIT, (lstrlen((LPCTSTR)lpMsgBuf) + funcnameLength + 50) * sizeof(wchar_t));
+	if (lpDisplayBuf == NULL)
+		return "Win32ErrorMsg failed";
+	SCOPE_EXIT{ LocalFree(lpDisplayBuf); };
+
+	auto wfuncname = funcname ? widen(funcname) : L"";
+
+	StringCchPrintfW((LPTSTR)lpDisplayBuf,
+	                 LocalSize(lpDisplayBuf) / sizeof(wchar_t),
+	                 L"%s failed with error %lu: %s",
+	                 wfuncname.c_str(),
+	                 dw,
+	                 (LPTSTR)lpMsgBuf);
+
+	std::wstring ret = (LPTSTR)lpDisplayBuf;
+
+	// Remove the \r\n at the end
+	while (ret.size() && ret.back() < ' ')
+		ret.pop_back();
+
+	assert(0);
+	return narrow(ret);
+}
+
+std::vector<std::string> getCommandLineArgs()
+{
+	std::vector<std::string> res;
+	int argc;
+	LPWSTR* argv = ::CommandLineToArgvW(::GetCommandLineW(), &argc);
+	for (int i = 0; i < argc; i++)
+		res.push_back(narrow(argv[i]));
+	LocalFree(argv);
+	return res;
+}
+
+void debugBreak()
+{
+	__debugbreak(); // This will break in all builds
+}
+
+std::wstring nativePath(const std::string& path)
+{
+	return widen(path);
+}
+
+std::string getCWD()
+{
+	// The size returned includes the null terminator
+	DWORD size = GetCurrentDirectoryW(0, NULL);
+	CZ_CHECK(size != 0);
+	std::wstring buf(size, 0);
+	CZ_CHECK(GetCurrentDirectoryW(size, &buf[0]) != 0);
+	buf.resize(size - 1);
+	return narrow(buf) + "\\";
+}
+
+void newFileSystemGeneration()
+{
+	// Nothing is cached
+}
+
+bool isExistingFile(const std::string& filename)
+{
+	DWORD dwAttrib = GetFileAttributesW(widen(filename).c_str());
+	return (dwAttrib != INVALID_FILE_ATTRIBUTES &&
+		!(dwAttrib & FILE_ATTRIBUTE_DIRECTORY));
+}
+
+bool isExistingDirectory(const std::string& path)
+{
+	DWORD dwAttrib = GetFileAttributesW(widen(path).c_str());
+	return (dwAttrib != INVALID_FILE_ATTRIBUTES &&
+		(dwAttrib & FILE_ATTRIBUTE_DIRECTORY));
+}
+
+int64_t getFileSize(const std::string& filename)
+{
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	if (!GetFileAttributesExW(widen(filename).c_str(), GetFileExInfoStandard, &data))
+		return -1;
+	LARGE_INTEGER size;
+	size.HighPart = data.nFileSizeHigh;
+	size.LowPart = data.nFileSizeLow;
+	return size.QuadPart;
+}
+
+int64_t getFileModificationTime(const std::string& filename)
+{
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	if (!GetFileAttributesExW(widen(filename).c_str(), GetFileExInfoStandard, &data))
+		return -1;
+	LARGE_INTEGER time;
+	time.HighPart = data.ftLastWriteTime.dwHighDateTime;
+	time.LowPart = data.ftLastWriteTime.dwLowDateTime;
+	return time.QuadPart;
+}
+
+bool renameFile(const std::string& from, const std::string& to)
+{
+	return MoveFileExW(widen(from).c_str(), widen(to).c_str(), MOVEFILE_REPLACE_EXISTING) ? true : false;
+}
+
+bool deleteFile(const std::string& filename)
+{
+	return DeleteFileW(widen(filename).c_str()) ? true : false;
+}
+
+bool createDirectory(const std::string& path)
+{
+	return CreateDirectoryW(widen(path).c_str(), NULL) ? true : false;
+}
+
+bool removeDirectory(const std::string& path)
+{
+	return RemoveDirectoryW(widen(path).c_str()) ? true : false;
+}
+
+std::vector<std::string> findFiles(const std::string& pattern)
+{
+	std::vector<std::string> res;
+	auto folder = splitFolderAndFile(pattern).first;
+	WIN32_FIND_DATAW fd;
+	HANDLE h = FindFirstFileW(widen(pattern).c_str(), &fd);
+	if (h == INVALID_HANDLE_VALUE)
+		return res;
+	do
+	{
+		if (!(fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+			res.push_back(folder + narrow(fd.cFileName));
+	} while (FindNextFileW(h, &fd));
+	FindClose(h);
+	std::sort(res.begin(), res.end());
+	return res;
+}
+
+bool getEnvironmentVariable(const std::string& name, std::string& dst)
+{
+	auto wname = widen(name);
+	DWORD size = GetEnvironmentVariableW(wname.c_str(), NULL, 0);
+	if (size == 0)
+		return false;
+	std::wstring buf(size, 0);
+	size = GetEnvironmentVariableW(wname.c_str(), &buf[0], size);
+	buf.resize(size);
+	dst = narrow(buf);
+	return true;
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+bool MappedFile::open(const std::string& filename)
+{
+	close();
+
+	// FILE_SHARE_DELETE so the file can be replaced (see renameFile) while we have it open
+	m_file = CreateFileW(widen(filename).c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (m_file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	// Mapping an empty file fails, so treat it as an error too
+	if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0)
+	{
+		close();
+		return false;
+	}
+
+	m_mapping = CreateFileMappingW(m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!m_mapping)
+	{
+		close();
+		return false;
+	}
+
+	m_data = static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+	if (!m_data)
+	{
+		close();
+		return false;
+	}
+
+	m_size = static_cast<size_t>(size.QuadPart);
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (m_data)
+		UnmapViewOfFile(m_data);
+	if (m_mapping)
+		CloseHandle(m_mapping);
+	if (m_file != INVALID_HANDLE_VALUE)
+		CloseHandle(m_file);
+	m_data = nullptr;
+	m_size = 0;
+	m_mapping = NULL;
+	m_file = INVALID_HANDLE_VALUE;
+}
+
+std::string getProcessPath(std::string* fname)
+{
+	wchar_t buf[MAX_PATH];
+	GetModuleFileNameW(NULL, buf, MAX_PATH);
+
+	auto result = narrow(buf);
+	std::string::size_type index = result.rfind("\\");
+
+	if (index != std::string::npos)
+	{
+		if (fname)
+			*fname = result.substr(index + 1);
+		result = result.substr(0, index + 1);
+	}
+	else
+		return "";
+
+	return result;
+}
+
+std::wstring widen(const std::string& utf8)
+{
+	if (utf8.empty())
+		return std::wstring();
+
+	// Get length (in wchar_t's), so we can reserve the size we need before the
+	// actual conversion
+	const int length = ::MultiByteToWideChar(CP_UTF8,             // convert from UTF-8
+		0,                   // default flags
+		utf8.data(),         // source UTF-8 string
+		(int)utf8.length(),  // length (in chars) of source UTF-8 string
+		NULL,                // unused - no conversion done in this step
+		0                    // request size of destination buffer, in wchar_t's
+	);
+	if (length == 0)
+		throw std::runtime_error("Can't get length of UTF-16 string");
+
+	std::wstring utf16;
+	utf16.resize(length);
+
+	// Do the actual conversion
+	if (!::MultiByteToWideChar(CP_UTF8,             // convert from UTF-8
+		0,                   // default flags
+		utf8.data(),         // source UTF-8 string
+		(int)utf8.length(),  // length (in chars) of source UTF-8 string
+		&utf16[0],           // destination buffer
+		(int)utf16.length()  // size of destination buffer, in wchar_t's
+	))
+	{
+		throw std::runtime_error("Can't convert string from UTF-8 to UTF-16");
+	}
+
+	return utf16;
+}
+
+
+std::string narrow(const std::wstring& str)
+{
+	if (str.empty())
+		return std::string();
+
+	// Get length (in wchar_t's), so we can reserve the size we need before the
+	// actual conversion
+	const int utf8_length = ::WideCharToMultiByte(CP_UTF8,              // convert to UTF-8
+		0,                    // default flags
+		str.data(),           // source UTF-16 string
+		(int)str.length(),  // source string length, in wchar_t's,
+		NULL,                 // unused - no conversion required in this step
+		0,                    // request buffer size
+		NULL,
+		NULL  // unused
+	);
+
+	if (utf8_length == 0)
+		throw "Can't get length of UTF-8 string";
+
+	std::string utf8;
+	utf8.resize(utf8_length);
+
+	// Do the actual conversion
+	if (!::WideCharToMultiByte(CP_UTF8,              // convert to UTF-8
+		0,                    // default flags
+		str.data(),           // source UTF-16 string
+		(int)str.length(),    // source string length, in wchar_t's,
+		&utf8[0],             // destination buffer
+		(int)utf8.length(),   // destination buffer size, in chars
+		NULL,
+		NULL  // unused
+	))
+	{
+		throw "Can't convert from UTF-16 to UTF-8";
+	}
+
+	return utf8;
+}
+
+} // namespace cz
@@ -0,0 +1,297 @@
+#include "vimvsPCH.h"
+#include "ToolChannel.h"
+#include "Logging.h"
+#include "Trace.h"
+#include "ScopeGuard.h"
+
+#ifndef _WIN32
+	#include <errno.h>
+	#include <poll.h>
+	#include <string.h>
+	#include <unistd.h>
+	#include <sys/eventfd.h>
+	#include <sys/socket.h>
+	#include <sys/time.h>
+	#include <sys/un.h>
+#endif
+
+namespace cz
+{
+
+// A tool that connects and doesn't send everything in this time is dropped, so it doesn't block the others
+static const int kReadTimeoutMs = 10000;
+
+ToolChannel::ToolChannel()
+{
+}
+
+ToolChannel::~ToolChannel()
+{
+	if (m_thread.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lk(m_mtx);
+			m_stop = true;
+		}
+		wake();
+		m_thread.join();
+	}
+
+#ifdef _WIN32
+	if (m_pipe != INVALID_HANDLE_VALUE)
+		CloseHandle(m_pipe);
+	if (m_wakeEvent)
+		CloseHandle(m_wakeEvent);
+#else
+	if (m_listenFd >= 0)
+		close(m_listenFd);
+	if (m_wakeFd >= 0)
+		close(m_wakeFd);
+#endif
+}
+
+void ToolChannel::receive(std::vector<ToolMessage>& dst, bool flush)
+{
+	std::unique_lock<std::mutex> lk(m_mtx);
+	if (flush && m_thread.joinable())
+	{
+		int request = ++m_flushRequested;
+		lk.unlock();
+		wake();
+		lk.lock();
+		m_flushCv.wait(lk, [this, request] { return m_flushDone >= request; });
+	}
+
+	moveAppend(m_msgs, dst);
+	m_msgs.clear();
+}
+
+void ToolChannel::add(const std::string& data)
+{
+	ToolMessage msg;
+	if (!decodeToolMessage(data, msg))
+	{
+		CZ_LOG(logDefault, Warning, "Ignoring invalid message (%d bytes) from a tool", static_cast<int>(data.size()));
+		return;
+	}
+	std::lock_guard<std::mutex> lk(m_mtx);
+	m_msgs.push_back(std::move(msg));
+}
+
+#ifdef _WIN32
+
+bool ToolChannel::open()
+{
+	static std::atomic<int> counter;
+	m_name = formatString("\\\\.\\pipe\\vimvs-%u-%d", GetCurrentProcessId(), ++counter);
+
+	// Only one instance, which is reused for each tool. The others wait for it (see dummy.cpp).
+	m_pipe = CreateNamedPipeW(
+		widen(m_name).c_str(),
+		PIPE_ACCESS_INBOUND | FILE_FLAG_OVERLAPPED | FILE_FLAG_FIRST_PIPE_INSTANCE,
+		PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+		1, 0, 64 * 1024, 0, NULL);
+	if (m_pipe == INVALID_HANDLE_VALUE)
+	{
+		CZ_LOG(logDefault, Warning, "Failed to create tool channel: %s", getLastErrorMsg("CreateNamedPipe").c_str());
+		return false;
+	}
+	m_wakeEvent = CreateEventW(NULL, FALSE, FALSE, NULL);
+	CZ_CHECK(m_wakeEvent);
+
+	m_thread = std::thread([this] { run(); });
+	return true;
+}
+
+void ToolChannel::wake()
+{
+	SetEvent(m_wakeEvent);
+}
+
+void ToolChannel::run()
+{
+	trace::setThreadName("ToolChannel");
+	OVERLAPPED ov = {};
+	ov.hEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+	CZ_CHECK(ov.hEvent);
+	SCOPE_EXIT{ CloseHandle(ov.hEvent); };
+
+	std::vector<char> buf(64 * 1024);
+	while (true)
+	{
+		ResetEvent(ov.hEvent);
+		bool connected = ConnectNamedPipe(m_pipe, &ov) != FALSE;
+		if (!connected)
+		{
+			auto err = GetLastError();
+			if (err == ERROR_PIPE_CONNECTED)
+				connected = true;
+			else if (err != ERROR_IO_PENDING)
+				CZ_LOG(logDefault, Fatal, "%s", getLastErrorMsg("ConnectNamedPipe").c_str());
+		}
+
+		while (!connected)
+		{
+			HANDLE handles[2] = { ov.hEvent, m_wakeEvent };
+			if (WaitForMultipleObjects(2, handles, FALSE, INFINITE) != WAIT_OBJECT_0)
+			{
+				int flushRequested;
+				{
+					std::lock_guard<std::mutex> lk(m_mtx);
+					if (m_stop)
+					{
+						CancelIo(m_pipe);
+						return;
+					}
+					flushRequested = m_flushRequested;
+				}
+
+				// Checked after getting the request, so a tool that connected before it is received first
+				if (WaitForSingleObject(ov.hEvent, 0) != WAIT_OBJECT_0)
+				{
+					// No tool connected, so everything is received
+					std::lock_guard<std::mutex> lk(m_mtx);
+					m_flushDone = flushRequested;
+					m_flushCv.notify_all();
+					continue;
+				}
+			}
+
+			DWORD n;
+			connected = GetOverlappedResult(m_pipe, &ov, &n, FALSE) != FALSE;
+			break;
+		}
+
+		std::string data;
+		while (connected)
+		{
+			CZ_TRACE_SCOPE("toolchannel", "read");
+			ResetEvent(ov.hEvent);
+			DWORD n = 0;
+			BOOL ok = ReadFile(m_pipe, buf.data(), static_cast<DWORD>(buf.size()), NULL, &ov);
+			if (!ok && GetLastError() == ERROR_IO_PENDING)
+			{
+				if (WaitForSingleObject(ov.hEvent, kReadTimeoutMs) != WAIT_OBJECT_0)
+				{
+					CancelIo(m_pipe);
+					GetOverlappedResult(m_pipe, &ov, &n, TRUE);
+					CZ_LOG(logDefault, Warning, "Timed out reading from a tool");
+					data.clear();
+					break;
+				}
+				ok = TRUE;
+			}
+			if (!ok || !GetOverlappedResult(m_pipe, &ov, &n, FALSE))
+				break; // ERROR_BROKEN_PIPE once the tool closes its end
+			data.append(buf.data(), n);
+		}
+
+		if (data.size())
+			add(data);
+		DisconnectNamedPipe(m_pipe);
+	}
+}
+
+#else
+
+bool ToolChannel::open()
+{
+	static std::atomic<int> counter;
+	// Abstract socket, so there is no file to remove. The '@' is the null character the address starts with.
+	m_name = formatString("@vimvs-%d-%d", static_cast<int>(getpid()), ++counter);
+
+	m_listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (m_listenFd < 0)
+	{
+		CZ_LOG(logDefault, Warning, "Failed to create tool channel: %s", getLastErrorMsg("socket").c_str());
+		return false;
+	}
+
+	sockaddr_un addr = {};
+	addr.sun_family = AF_UNIX;
+	memcpy(addr.sun_path + 1, m_name.c_str() + 1, m_name.size() - 1);
+	auto addrLen = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + m_name.size());
+	if (bind(m_listenFd, reinterpret_cast<sockaddr*>(&addr), addrLen) != 0 || listen(m_listenFd, SOMAXCONN) != 0)
+	{
+		CZ_LOG(logDefault, Warning, "Failed to create tool channel: %s", getLastErrorMsg("bind").c_str());
+		return false;
+	}
+
+	m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	CZ_CHECK(m_wakeFd >= 0);
+
+	m_thread = std::thread([this] { run(); });
+	return true;
+}
+
+void ToolChannel::wake()
+{
+	uint64_t one = 1;
+	CZ_CHECK(write(m_wakeFd, &one, sizeof(one)) == sizeof(one));
+}
+
+void ToolChannel::run()
+{
+	trace::setThreadName("ToolChannel");
+	std::vector<char> buf(64 * 1024);
+	while (true)
+	{
+		pollfd fds[2] = { { m_listenFd, POLLIN, 0 }, { m_wakeFd, POLLIN, 0 } };
+		if (poll(fds, 2, -1) < 0 && errno != EINTR)
+			CZ_LOG(logDefault, Fatal, "%s", getLastErrorMsg("poll").c_str());
+
+		int flushRequested;
+		{
+			std::lock_guard<std::mutex> lk(m_mtx);
+			if (m_stop)
+				return;
+			flushRequested = m_flushRequested;
+		}
+		uint64_t count;
+		(void)!read(m_wakeFd, &count, sizeof(count));
+
+		// Tools that connected are in the listen queue, even if they already exited, so accepting until there are
+		// none left receives all of them
+		while (true)
+		{
+			// The accepted sockets are blocking, even if the listening one is not
+			int fd = accept4(m_listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+			if (fd < 0)
+			{
+				if (errno == EINTR || errno == ECONNABORTED)
+					continue;
+				break;
+			}
+			SCOPE_EXIT{ close(fd); };
+			CZ_TRACE_SCOPE("toolchannel", "read");
+
+			timeval tv = { kReadTimeoutMs / 1000, (kReadTimeoutMs % 1000) * 1000 };
+			setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+			std::string data;
+			while (true)
+			{
+				auto n = ::read(fd, buf.data(), buf.size());
+				if (n < 0 && errno == EINTR)
+					continue;
+				if (n < 0)
+				{
+					CZ_LOG(logDefault, Warning, "Failed to read from a tool: %s", strerror(errno));
+					data.clear();
+				}
+				if (n <= 0)
+					break;
+				data.append(buf.data(), n);
+			}
+			if (data.size())
+				add(data);
+		}
+
+		std::lock_guard<std::mutex> lk(m_mtx);
+		m_flushDone = flushRequested;
+		m_flushCv.notify_all();
+	}
+}
+
+#endif
+
+}
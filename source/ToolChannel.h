@@ -0,0 +1,62 @@
+#pragma once
+
+#include <condition_variable>
+#include "ToolMessage.h"
+
+namespace cz
+{
+
+//! Receives what the fast parser's dummy tools were called with (see ToolMessage.h), so the parser doesn't need to
+// find the command lines in msbuild's output, which depends on the verbosity, and has no quoting.
+//
+// On Windows this is a named pipe, and on Linux an abstract unix socket. A thread accepts the tools, one at a time,
+// and keeps the messages until 'receive' is called. The tools find the channel through the VIMVS_CHANNEL_ENV
+// environment variable, which needs to be set for msbuild.
+class ToolChannel
+{
+public:
+	ToolChannel();
+	~ToolChannel();
+	ToolChannel(const ToolChannel&) = delete;
+	ToolChannel& operator=(const ToolChannel&) = delete;
+
+	//! Creates the channel, and starts accepting tools
+	bool open();
+
+	//! What to set VIMVS_CHANNEL_ENV to
+	const std::string& getName() const
+	{
+		return m_name;
+	}
+
+	//! Appends the messages received so far to 'dst', in the order received
+	// \param flush
+	//		If true, it first waits for the tools that already connected (e.g: all of them, once msbuild finished) to
+	//		be received.
+	void receive(std::vector<ToolMessage>& dst, bool flush);
+
+	//! Called by the channel's thread with what a tool sent. It can also be called directly, as if a tool sent 'data'.
+	void add(const std::string& data);
+
+private:
+	void run();
+	void wake();
+
+	std::string m_name;
+	std::mutex m_mtx;
+	std::condition_variable m_flushCv;
+	std::vector<ToolMessage> m_msgs;
+	int m_flushRequested = 0;
+	int m_flushDone = 0;
+	bool m_stop = false;
+#ifdef _WIN32
+	HANDLE m_pipe = INVALID_HANDLE_VALUE;
+	HANDLE m_wakeEvent = NULL;
+#else
+	int m_listenFd = -1;
+	int m_wakeFd = -1;
+#endif
+	std::thread m_thread;
+};
+
+}
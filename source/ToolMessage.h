@@ -0,0 +1,125 @@
+#pragma once
+
+//
+// What the fast parser's dummy tools (see dummy/dummy.cpp) send to vim-vs through the tool channel (see
+// ToolChannel.h).
+// This is shared by both, so it only depends on the standard library.
+//
+// Each tool connects, sends one message and disconnects. A message is a sequence of strings, each one a 32 bits
+// little endian length followed by the bytes (UTF-8):
+//		"vimvs-tool-1", tool, workdir, number of args, args..., number of response files, (path, contents)...
+// The counts are strings too, so everything is read the same way.
+//
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Environment variable the dummy tools get the channel's name from
+#define VIMVS_CHANNEL_ENV "VIMVS_CHANNEL"
+
+namespace cz
+{
+
+struct ToolMessage
+{
+	std::string tool; // Executable name, without the path and extension (e.g: vimvs-dummy-cl)
+	std::string workdir;
+	std::vector<std::string> args; // Not including the executable
+	// Contents of the response files passed in the args ("@file"), read by the tool before they are deleted. The
+	// path is as it appears in the args, without the '@'.
+	std::vector<std::pair<std::string, std::string>> responseFiles;
+};
+
+namespace toolmessage
+{
+	static const char* const kMagic = "vimvs-tool-1";
+
+	inline void writeString(std::string& dst, const std::string& str)
+	{
+		uint32_t size = static_cast<uint32_t>(str.size());
+		for (int i = 0; i < 4; i++)
+			dst += static_cast<char>((size >> (i * 8)) & 0xFF);
+		dst += str;
+	}
+
+	inline bool readString(const std::string& src, size_t& pos, std::string& dst)
+	{
+		if (src.size() - pos < 4)
+			return false;
+		uint32_t size = 0;
+		for (int i = 0; i < 4; i++)
+			size |= static_cast<uint32_t>(static_cast<uint8_t>(src[pos++])) << (i * 8);
+		if (src.size() - pos < size)
+			return false;
+		dst.assign(src, pos, size);
+		pos += size;
+		return true;
+	}
+
+	inline bool readCount(const std::string& src, size_t& pos, size_t& dst)
+	{
+		std::string str;
+		if (!readString(src, pos, str) || str.empty() || str.size() > 9 ||
+			str.find_first_not_of("0123456789") != std::string::npos)
+			return false;
+		dst = std::stoul(str);
+		return true;
+	}
+}
+
+inline std::string encodeToolMessage(const ToolMessage& msg)
+{
+	using namespace toolmessage;
+	std::string res;
+	writeString(res, kMagic);
+	writeString(res, msg.tool);
+	writeString(res, msg.workdir);
+	writeString(res, std::to_string(msg.args.size()));
+	for (auto&& a : msg.args)
+		writeString(res, a);
+	writeString(res, std::to_string(msg.responseFiles.size()));
+	for (auto&& f : msg.responseFiles)
+	{
+		writeString(res, f.first);
+		writeString(res, f.second);
+	}
+	return res;
+}
+
+//! Returns false if 'data' is not a whole message
+inline bool decodeToolMessage(const std::string& data, ToolMessage& msg)
+{
+	using namespace toolmessage;
+	size_t pos = 0;
+	std::string magic;
+	if (!readString(data, pos, magic) || magic != kMagic)
+		return false;
+	if (!readString(data, pos, msg.tool) || !readString(data, pos, msg.workdir))
+		return false;
+
+	size_t count;
+	if (!readCount(data, pos, count))
+		return false;
+	msg.args.clear();
+	for (size_t i = 0; i < count; i++)
+	{
+		msg.args.emplace_back();
+		if (!readString(data, pos, msg.args.back()))
+			return false;
+	}
+
+	if (!readCount(data, pos, count))
+		return false;
+	msg.responseFiles.clear();
+	for (size_t i = 0; i < count; i++)
+	{
+		msg.responseFiles.emplace_back();
+		if (!readString(data, pos, msg.responseFiles.back().first) ||
+			!readString(data, pos, msg.responseFiles.back().second))
+			return false;
+	}
+	return pos == data.size();
+}
+
+}
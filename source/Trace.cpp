@@ -0,0 +1,144 @@
+#include "vimvsPCH.h"
+#include "Trace.h"
+#include "Logging.h"
+
+namespace cz
+{
+namespace trace
+{
+
+std::atomic<bool> gEnabled(false);
+
+namespace
+{
+
+struct Event
+{
+	const char* category;
+	const char* name;
+	int64_t start;
+	int64_t duration;
+	std::string detail;
+};
+
+// Each thread records to its own buffer, so threads don't contend with each other. The mutex is only contended
+// when stopping.
+struct ThreadBuffer
+{
+	int tid = 0;
+	std::string name;
+	std::mutex mtx;
+	std::vector<Event> events;
+};
+
+struct SharedData
+{
+	std::mutex mtx;
+	// Buffers are kept after their threads finish, since those threads' events are still needed
+	std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+	std::chrono::steady_clock::time_point startTime;
+};
+
+SharedData& getSharedData()
+{
+	static SharedData data;
+	return data;
+}
+
+thread_local ThreadBuffer* tBuffer = nullptr;
+
+ThreadBuffer& getThreadBuffer()
+{
+	if (!tBuffer)
+	{
+		auto&& data = getSharedData();
+		std::lock_guard<std::mutex> lk(data.mtx);
+		data.buffers.push_back(std::make_unique<ThreadBuffer>());
+		tBuffer = data.buffers.back().get();
+		tBuffer->tid = static_cast<int>(data.buffers.size());
+	}
+	return *tBuffer;
+}
+
+void writeEvent(std::ofstream& out, bool& first, int tid, const Event& e)
+{
+	// Chrome traces are in microseconds
+	out << (first ? "\n" : ",\n");
+	first = false;
+	out << "{\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+		<< ",\"cat\":" << nlohmann::json(e.category).dump()
+		<< ",\"name\":" << nlohmann::json(e.name).dump()
+		<< formatString(",\"ts\":%.3f,\"dur\":%.3f", e.start / 1000.0, e.duration / 1000.0);
+	if (e.detail.size())
+		out << ",\"args\":{\"detail\":" << nlohmann::json(e.detail).dump() << "}";
+	out << "}";
+}
+
+} // anonymous namespace
+
+void start()
+{
+	getSharedData().startTime = std::chrono::steady_clock::now();
+	gEnabled = true;
+}
+
+int64_t now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now() - getSharedData().startTime).count();
+}
+
+void record(const char* category, const char* name, int64_t start, std::string detail)
+{
+	auto&& buf = getThreadBuffer();
+	auto end = now();
+	std::lock_guard<std::mutex> lk(buf.mtx);
+	buf.events.push_back(Event{ category, name, start, end - start, std::move(detail) });
+}
+
+void setThreadName(const char* name)
+{
+	if (!isEnabled())
+		return;
+	auto&& buf = getThreadBuffer();
+	std::lock_guard<std::mutex> lk(buf.mtx);
+	buf.name = name;
+}
+
+bool stop(const std::string& filename)
+{
+	gEnabled = false;
+
+	std::ofstream out(nativePath(filename), std::ofstream::out | std::ofstream::trunc);
+	if (!out.is_open())
+	{
+		CZ_LOG(logDefault, Error, "Could not open trace file '%s'", filename.c_str());
+		return false;
+	}
+
+	auto&& data = getSharedData();
+	std::lock_guard<std::mutex> lk(data.mtx);
+	size_t count = 0;
+	bool first = true;
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	for (auto&& buf : data.buffers)
+	{
+		std::lock_guard<std::mutex> bufLk(buf->mtx);
+		auto name = buf->name.size() ? buf->name : formatString("Thread %d", buf->tid);
+		out << (first ? "\n" : ",\n");
+		first = false;
+		out << "{\"ph\":\"M\",\"pid\":1,\"tid\":" << buf->tid
+			<< ",\"name\":\"thread_name\",\"args\":{\"name\":" << nlohmann::json(name).dump() << "}}";
+		for (auto&& e : buf->events)
+			writeEvent(out, first, buf->tid, e);
+		count += buf->events.size();
+		buf->events.clear();
+	}
+	out << "\n]}\n";
+
+	CZ_LOG(logDefault, Log, "Trace with %d events written to '%s'", static_cast<int>(count), filename.c_str());
+	return out.good();
+}
+
+} // namespace trace
+} // namespace cz
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+
+//
+// Instrumentation to see where time is spent, per thread.
+// Nothing is recorded unless tracing is started (-trace=<FILE>), in which case the spans recorded are written as a
+// Chrome trace, which can be opened with chrome://tracing or https://ui.perfetto.dev
+//
+// CZ_TRACE_SCOPE(category, name)
+//		Records the time spent in the enclosing scope. Only the pointers are kept, so both need to be string
+//		literals.
+// CZ_TRACE_SCOPE_DETAIL(category, name, detail)
+//		Same as CZ_TRACE_SCOPE, but also records a string shown in the trace's arguments (e.g: the file being
+//		processed). 'detail' is only evaluated if tracing is enabled.
+//
+// When tracing is not enabled, a scope costs a relaxed atomic load. Defining CZ_NO_TRACE removes them completely.
+//
+
+namespace cz
+{
+namespace trace
+{
+
+//! Starts recording
+void start();
+
+//! Stops recording, and writes what was recorded to the specified file
+bool stop(const std::string& filename);
+
+//! Names the calling thread in the trace. Does nothing if tracing is not enabled.
+void setThreadName(const char* name);
+
+extern std::atomic<bool> gEnabled;
+
+inline bool isEnabled()
+{
+	return gEnabled.load(std::memory_order_relaxed);
+}
+
+//! Nanoseconds since tracing started
+int64_t now();
+void record(const char* category, const char* name, int64_t start, std::string detail);
+
+class Scope
+{
+public:
+	Scope(const char* category, const char* name)
+	{
+		if (isEnabled())
+		{
+			m_category = category;
+			m_name = name;
+			m_start = now();
+		}
+	}
+	~Scope()
+	{
+		if (m_name)
+			record(m_category, m_name, m_start, std::string());
+	}
+	Scope(const Scope&) = delete;
+	Scope& operator=(const Scope&) = delete;
+
+private:
+	const char* m_category = nullptr;
+	const char* m_name = nullptr;
+	int64_t m_start = 0;
+};
+
+class DetailScope
+{
+public:
+	template<typename F>
+	DetailScope(const char* category, const char* name, F&& detail)
+	{
+		if (isEnabled())
+		{
+			m_category = category;
+			m_name = name;
+			m_detail = detail();
+			m_start = now();
+		}
+	}
+	~DetailScope()
+	{
+		if (m_name)
+			record(m_category, m_name, m_start, std::move(m_detail));
+	}
+	DetailScope(const DetailScope&) = delete;
+	DetailScope& operator=(const DetailScope&) = delete;
+
+private:
+	const char* m_category = nullptr;
+	const char* m_name = nullptr;
+	int64_t m_start = 0;
+	std::string m_detail;
+};
+
+} // namespace trace
+} // namespace cz
+
+#define CZ_TRACE_CONCAT_IMPL(a, b) a##b
+#define CZ_TRACE_CONCAT(a, b) CZ_TRACE_CONCAT_IMPL(a, b)
+
+#if CZ_NO_TRACE
+	#define CZ_TRACE_SCOPE(CATEGORY, NAME)
+	#define CZ_TRACE_SCOPE_DETAIL(CATEGORY, NAME, DETAIL)
+#else
+	#define CZ_TRACE_SCOPE(CATEGORY, NAME) \
+		::cz::trace::Scope CZ_TRACE_CONCAT(czTraceScope, __LINE__)(CATEGORY, NAME);
+	#define CZ_TRACE_SCOPE_DETAIL(CATEGORY, NAME, DETAIL) \
+		::cz::trace::DetailScope CZ_TRACE_CONCAT(czTraceScope, __LINE__)(CATEGORY, NAME, [&]() { return std::string(DETAIL); });
+#endif
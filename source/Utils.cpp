@@ -1,444 +1,555 @@
-#include "vimvsPCH.h"
-#include "Utils.h"
-#include "Logging.h"
-#include "ScopeGuard.h"
-
-#define MURMUR_SEED 'vivs'
-
-namespace cz
-{
-
-std::string getWin32Error(const char* funcname)
-{
-	LPVOID lpMsgBuf;
-	LPVOID lpDisplayBuf;
-	DWORD dw = GetLastError();
-
-	FormatMessageW(FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS,
-	               NULL,
-	               dw,
-	               MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT),
-	               (LPTSTR)&lpMsgBuf,
-	               0,
-	               NULL);
-	SCOPE_EXIT{ LocalFree(lpMsgBuf); };
-
-	int funcnameLength = funcname ? lstrlen((LPCTSTR)funcname) : 0;
-	lpDisplayBuf =
-	    (LPVOID)LocalAlloc(LMEM_ZEROINIT, (lstrlen((LPCTSTR)lpMsgBuf) + funcnameLength + 50) * sizeof(wchar_t));
-	if (lpDisplayBuf == NULL)
-		return "Win32ErrorMsg failed";
-	SCOPE_EXIT{ LocalFree(lpDisplayBuf); };
-
-	auto wfuncname = funcname ? widen(funcname) : L"";
-
-	StringCchPrintfW((LPTSTR)lpDisplayBuf,
-	                 LocalSize(lpDisplayBuf) / sizeof(wchar_t),
-	                 L"%s failed with error %lu: %s",
-	                 wfuncname.c_str(),
-	                 dw,
-	                 (LPTSTR)lpMsgBuf);
-
-	std::wstring ret = (LPTSTR)lpDisplayBuf;
-
-	// Remove the \r\n at the end
-	while (ret.size() && ret.back() < ' ')
-		ret.pop_back();
-
-	assert(0);
-	return narrow(ret);
-}
-
-void _doAssert(const char* file, int line, _Printf_format_string_ const char* fmt, ...)
-{
-	static bool executing;
-
-	// Detect reentrancy, since we call a couple of things from here, that might end up asserting
-	if (executing)
-		__debugbreak();
-	executing = true;
-
-	char buf[1024];
-	va_list args;
-	va_start(args, fmt);
-	_vsnprintf_s(buf, 1024, _TRUNCATE, fmt, args);
-	va_end(args);
-
-	CZ_LOG(logDefault, Fatal, "ASSERT: %s,%d: %s\n", file, line, buf);
-
-	if (::IsDebuggerPresent())
-	{
-		__debugbreak(); // This will break in all builds
-	}
-	else
-	{
-		//_wassert(wbuf, wfile, line);
-		//DebugBreak();
-		__debugbreak(); // This will break in all builds
-	}
-}
-
-char* getTemporaryString()
-{
-	// Use several static strings, and keep picking the next one, so that callers can hold the string for a while
-	// without risk of it being changed by another call.
-	__declspec(thread) static char bufs[kTemporaryStringMaxNesting][kTemporaryStringMaxSize];
-	__declspec(thread) static int nBufIndex = 0;
-	char* buf = bufs[nBufIndex];
-	nBufIndex++;
-	if (nBufIndex == kTemporaryStringMaxNesting)
-		nBufIndex = 0;
-	return buf;
-}
-
-const char* formatString(_Printf_format_string_ const char* format, ...)
-{
-	va_list args;
-	va_start(args, format);
-	const char* str = formatStringVA(format, args);
-	va_end(args);
-	return str;
-}
-
-const char* formatStringVA(const char* format, va_list argptr)
-{
-	char* buf = getTemporaryString();
-	_vsnprintf_s(buf, kTemporaryStringMaxSize, _TRUNCATE, format, argptr);
-	return buf;
-}
-
-void ensureTrailingSlash(std::string& str)
-{
-	if (str.size() && !(str[str.size() - 1] == '\\' || str[str.size() - 1] == '/'))
-		str += '\\';
-}
-
-std::string removeTrailingSlash(std::string str)
-{
-	while (str.size() && (str[str.size() - 1] == '\\' || str[str.size() - 1] == '/'))
-		str.pop_back();
-	return str;
-}
-
-std::string getCWD()
-{
-	wchar_t buf[MAX_PATH];
-	CZ_CHECK(GetCurrentDirectoryW(MAX_PATH, buf) != 0);
-	return narrow(buf) + "\\";
-}
-
-bool isExistingFile(const std::string& filename)
-{
-	DWORD dwAttrib = GetFileAttributesW(widen(filename).c_str());
-	return (dwAttrib != INVALID_FILE_ATTRIBUTES &&
-		!(dwAttrib & FILE_ATTRIBUTE_DIRECTORY));
-}
-
-std::string getProcessPath(std::string* fname)
-{
-	wchar_t buf[MAX_PATH];
-	GetModuleFileNameW(NULL, buf, MAX_PATH);
-
-	auto result = narrow(buf);
-	std::string::size_type index = result.rfind("\\");
-
-	if (index != std::string::npos)
-	{
-		if (fname)
-			*fname = result.substr(index + 1);
-		result = result.substr(0, index + 1);
-	}
-	else
-		return "";
-
-	return result;
-}
-
-bool fullPath(std::string& dst, const std::string& path, std::string root)
-{
-	wchar_t fullpathbuf[MAX_PATH];
-	wchar_t srcfullpath[MAX_PATH];
-	if (root.empty())
-		root = getCWD();
-	ensureTrailingSlash(root);
-
-	auto wpath = widen(path);
-	auto wroot = widen(root);
-
-	std::wstring tmp = PathIsRelativeW(wpath.c_str()) ? wroot + wpath : wpath;
-	wcscpy(srcfullpath, tmp.c_str());
-	wchar_t* d = srcfullpath;
-	wchar_t* s = srcfullpath;
-	while (*s)
-	{
-		if (*s == '/')
-			*s = '\\';
-		*d++ = *s;
-
-		// Skip any repeated separator
-		if (*s == '\\')
-		{
-			s++;
-			while (*s && (*s == '\\' || *s == '/'))
-				s++;
-		}
-		else
-		{
-			s++;
-		}
-	}
-	*d = 0;
-
-	bool res = PathCanonicalizeW(fullpathbuf, srcfullpath) ? true : false;
-	if (res)
-		dst = narrow(fullpathbuf);
-	return res;
-}
-
-std::string replace(const std::string& s, char from, char to)
-{
-	std::string res = s;
-	for (auto&& ch : res)
-	{
-		if (ch == from)
-			ch = to;
-	}
-	return res;
-}
-
-std::string replace(const std::string& str, const std::string& from, const std::string& to)
-{
-	if (from.empty())
-		return "";
-	size_t start_pos = 0;
-	auto res = str;
-	while ((start_pos = res.find(from, start_pos)) != std::string::npos)
-	{
-		res.replace(start_pos, from.length(), to);
-		start_pos += to.length();  // In case 'to' contains 'from', like replacing 'x' with 'yx'
-	}
-	return res;
-}
-
-std::pair<std::string, std::string> splitFolderAndFile(const std::string& str)
-{
-	auto i = std::find_if(str.rbegin(), str.rend(), [](const char& ch)
-	{
-		return ch == '/' || ch == '\\';
-	});
-
-	std::pair < std::string, std::string> res;
-	res.first = std::string(str.begin(), i.base());
-	res.second = std::string(i.base(), str.end());
-	return res;
-}
-
-std::string getExtension(const std::string& fname, std::string* name)
-{
-	auto slashpos = fname.find_last_of("/\\");
-	auto p = fname.find_last_of(".");
-
-	if (p == std::string::npos || (slashpos != std::string::npos && p < slashpos))
-	{
-		if (name)
-			*name = fname;
-		return "";
-	}
-	else
-	{
-		auto res = fname.substr(p + 1);
-		if (name)
-			*name = fname.substr(0, p);
-		return res;
-	}
-}
-
-std::string removeQuotes(const std::string& str)
-{
-	std::string res = str;
-	while (res.size() && (res[0] == '"' || res[0] == '\''))
-		res.erase(res.begin());
-	while (res.size() && (res.back() == '"' || res.back() == '\''))
-		res.pop_back();
-	return res;
-}
-
-// From https://en.wikibooks.org/wiki/Algorithm_Implementation/Strings/Levenshtein_distance#C.2B.2B
-int levenshtein_distance(const std::string& s1, const std::string& s2)
-{
-	// To change the type this function manipulates and returns, change
-	// the return type and the types of the two variables below.
-	int s1len = static_cast<int>(s1.size());
-	int s2len = static_cast<int>(s2.size());
-
-	auto column_start = (decltype(s1len))1;
-
-	auto column = new decltype(s1len)[s1len + 1];
-	std::iota(column + column_start, column + s1len + 1, column_start);
-
-	for (auto x = column_start; x <= s2len; x++)
-	{
-		column[0] = x;
-		auto last_diagonal = x - column_start;
-		for (auto y = column_start; y <= s1len; y++)
-		{
-			auto old_diagonal = column[y];
-			auto possibilities = {column[y] + 1, column[y - 1] + 1, last_diagonal + (s1[y - 1] == s2[x - 1] ? 0 : 1)};
-			column[y] = std::min(possibilities);
-			last_diagonal = old_diagonal;
-		}
-	}
-	auto result = column[s1len];
-	delete[] column;
-	return result;
-}
-
-std::wstring widen(const std::string& utf8)
-{
-	if (utf8.empty())
-		return std::wstring();
-
-	// Get length (in wchar_t's), so we can reserve the size we need before the
-	// actual conversion
-	const int length = ::MultiByteToWideChar(CP_UTF8,             // convert from UTF-8
-		0,                   // default flags
-		utf8.data(),         // source UTF-8 string
-		(int)utf8.length(),  // length (in chars) of source UTF-8 string
-		NULL,                // unused - no conversion done in this step
-		0                    // request size of destination buffer, in wchar_t's
-	);
-	if (length == 0)
-		throw std::exception("Can't get length of UTF-16 string");
-
-	std::wstring utf16;
-	utf16.resize(length);
-
-	// Do the actual conversion
-	if (!::MultiByteToWideChar(CP_UTF8,             // convert from UTF-8
-		0,                   // default flags
-		utf8.data(),         // source UTF-8 string
-		(int)utf8.length(),  // length (in chars) of source UTF-8 string
-		&utf16[0],           // destination buffer
-		(int)utf16.length()  // size of destination buffer, in wchar_t's
-	))
-	{
-		throw std::exception("Can't convert string from UTF-8 to UTF-16");
-	}
-
-	return utf16;
-}
-
-
-std::string narrow(const std::wstring& str)
-{
-	if (str.empty())
-		return std::string();
-
-	// Get length (in wchar_t's), so we can reserve the size we need before the
-	// actual conversion
-	const int utf8_length = ::WideCharToMultiByte(CP_UTF8,              // convert to UTF-8
-		0,                    // default flags
-		str.data(),           // source UTF-16 string
-		(int)str.length(),  // source string length, in wchar_t's,
-		NULL,                 // unused - no conversion required in this step
-		0,                    // request buffer size
-		NULL,
-		NULL  // unused
-	);
-
-	if (utf8_length == 0)
-		throw "Can't get length of UTF-8 string";
-
-	std::string utf8;
-	utf8.resize(utf8_length);
-
-	// Do the actual conversion
-	if (!::WideCharToMultiByte(CP_UTF8,              // convert to UTF-8
-		0,                    // default flags
-		str.data(),           // source UTF-16 string
-		(int)str.length(),    // source string length, in wchar_t's,
-		&utf8[0],             // destination buffer
-		(int)utf8.length(),   // destination buffer size, in chars
-		NULL,
-		NULL  // unused
-	))
-	{
-		throw "Can't convert from UTF-16 to UTF-8";
-	}
-
-	return utf8;
-}
-
-bool isSpace(int a)
-{
-	return a == ' ' || a == '\t' || a == 0xA || a == 0xD;
-}
-
-bool notSpace(int a)
-{
-	return !isSpace(a);
-}
-
-bool endsWith(const std::string& str, const std::string& ending)
-{
-	if (str.length() >= ending.length()) {
-		return (0 == str.compare(str.length() - ending.length(), ending.length(), ending));
-	}
-	else {
-		return false;
-	}
-}
-
-bool endsWith(const std::string& str, const char* ending)
-{
-	const size_t endingLength = strlen(ending);
-	if (str.length() >= endingLength) {
-		return (0 == str.compare(str.length() - endingLength, endingLength, ending));
-	}
-	else {
-		return false;
-	}
-}
-
-bool beginsWith(const std::string& str, const std::string& begins, std::string* dst)
-{
-	if (str.length() >= begins.length()) {
-		bool res = (0 == str.compare(0, begins.length(), begins));
-		if (res && dst)
-			*dst = str.substr(begins.length());
-		return res;
-	}
-	else {
-		return false;
-	}
-}
-
-bool beginsWith(const std::string& str, const char* begins, std::string* dst)
-{
-	const size_t beginsLength = strlen(begins);
-	if (str.length() >= beginsLength) {
-		bool res = (0 == str.compare(0, beginsLength, begins));
-		if (res && dst)
-			*dst = str.substr(beginsLength);
-		return res;
-	}
-	else {
-		return false;
-	}
-}
-
-int64_t hash(const std::string& s)
-{
-	int64_t out[2]; 
-	MurmurHash3_x64_128(s.data(), static_cast<int>(s.size() * sizeof(s[0])), MURMUR_SEED, out);
-	return out[0];
-}
-
-int64_t hash(const std::vector<std::string>& v)
-{
-	std::string s;
-	for(auto&& i: v) s+=i; 
-	return hash(s);
-}
-
-}
+#include "vimvsPCH.h"
+#include "Utils.h"
+#include "Logging.h"
+#include "ScopeGuard.h"
+#include <string.h>
+
+#define MURMUR_SEED 'vivs'
+
+#if defined(_M_X64) || defined(__SSE2__)
+	#include <emmintrin.h>
+	#define CZ_HASH_SSE2 1
+#else
+	#define CZ_HASH_SSE2 0
+#endif
+
+namespace cz
+{
+
+void _doAssert(const char* file, int line, _Printf_format_string_ const char* fmt, ...)
+{
+	static bool executing;
+
+	// Detect reentrancy, since we call a couple of things from here, that might end up asserting
+	if (executing)
+		debugBreak();
+	executing = true;
+
+	char buf[1024];
+	va_list args;
+	va_start(args, fmt);
+	vsnprintf(buf, sizeof(buf), fmt, args);
+	va_end(args);
+
+	CZ_LOG(logDefault, Fatal, "ASSERT: %s,%d: %s\n", file, line, buf);
+
+	debugBreak();
+}
+
+char* getTemporaryString()
+{
+	// Use several static strings, and keep picking the next one, so that callers can hold the string for a while
+	// without risk of it being changed by another call.
+	thread_local static char bufs[kTemporaryStringMaxNesting][kTemporaryStringMaxSize];
+	thread_local static int nBufIndex = 0;
+	char* buf = bufs[nBufIndex];
+	nBufIndex++;
+	if (nBufIndex == kTemporaryStringMaxNesting)
+		nBufIndex = 0;
+	return buf;
+}
+
+const char* formatString(_Printf_format_string_ const char* format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	const char* str = formatStringVA(format, args);
+	va_end(args);
+	return str;
+}
+
+const char* formatStringVA(const char* format, va_list argptr)
+{
+	char* buf = getTemporaryString();
+	vsnprintf(buf, kTemporaryStringMaxSize, format, argptr);
+	return buf;
+}
+
+void ensureTrailingSlash(std::string& str)
+{
+	if (str.size() && !(str[str.size() - 1] == '\\' || str[str.size() - 1] == '/'))
+		str += kPathSeparator;
+}
+
+std::string removeTrailingSlash(std::string str)
+{
+	while (str.size() && (str[str.size() - 1] == '\\' || str[str.size() - 1] == '/'))
+		str.pop_back();
+	return str;
+}
+
+namespace
+{
+
+bool isPathSeparator(char c)
+{
+	return c == '\\' || c == '/';
+}
+
+// Size of the root part of a path ("C:\", "C:", "\\server\share\", or "\"), or 0 if the path is relative
+size_t getPathRootSize(std::string_view p)
+{
+	if (p.size() >= 2 && isalpha(static_cast<unsigned char>(p[0])) && p[1] == ':')
+		return (p.size() > 2 && isPathSeparator(p[2])) ? 3 : 2;
+
+	if (p.size() >= 2 && isPathSeparator(p[0]) && isPathSeparator(p[1]))
+	{
+		// UNC path. The server and share names are part of the root
+		size_t pos = 2;
+		for (int i = 0; i < 2 && pos < p.size(); i++)
+		{
+			while (pos < p.size() && !isPathSeparator(p[pos]))
+				pos++;
+			if (pos < p.size())
+				pos++;
+		}
+		return pos;
+	}
+
+	if (p.size() && isPathSeparator(p[0]))
+		return 1;
+
+	return 0;
+}
+
+void appendPathRoot(std::string& dst, std::string_view root)
+{
+	for (auto c : root)
+		dst += isPathSeparator(c) ? kPathSeparator : c;
+	// A drive without a separator (e.g: "C:foo") is relative to that drive's current directory, so it stays as-is
+	bool driveOnly = dst.size() == 2 && dst[1] == ':';
+	if (!driveOnly && !isPathSeparator(dst.back()))
+		dst += kPathSeparator;
+}
+
+// Appends the components of 'p' to 'dst', resolving "." and "..". Every component is followed by a separator.
+// \param rootSize
+//		Size of the root in 'dst', which ".." can't remove
+void appendPathComponents(std::string& dst, size_t rootSize, std::string_view p)
+{
+	size_t i = 0;
+	while (i < p.size())
+	{
+		while (i < p.size() && isPathSeparator(p[i]))
+			i++;
+		size_t start = i;
+		while (i < p.size() && !isPathSeparator(p[i]))
+			i++;
+		auto component = p.substr(start, i - start);
+
+		if (component.empty() || component == ".")
+			continue;
+
+		if (component == "..")
+		{
+			if (dst.size() > rootSize)
+			{
+				dst.pop_back();
+				while (dst.size() > rootSize && !isPathSeparator(dst.back()))
+					dst.pop_back();
+			}
+			continue;
+		}
+
+		dst.append(component.data(), component.size());
+		dst += kPathSeparator;
+	}
+}
+
+}
+
+bool canonicalizePath(std::string& dst, std::string_view path, std::string_view root)
+{
+	dst.clear();
+
+	size_t rootSize = getPathRootSize(path);
+	if (rootSize)
+	{
+		appendPathRoot(dst, path.substr(0, rootSize));
+		path.remove_prefix(rootSize);
+		rootSize = dst.size();
+	}
+	else
+	{
+		auto rootRootSize = getPathRootSize(root);
+		if (!rootRootSize)
+			return false;
+		appendPathRoot(dst, root.substr(0, rootRootSize));
+		rootSize = dst.size();
+		appendPathComponents(dst, rootSize, root.substr(rootRootSize));
+	}
+
+	appendPathComponents(dst, rootSize, path);
+
+	// Like PathCanonicalize, the trailing separator is only kept if there was one
+	auto last = path.size() ? path : root;
+	if (dst.size() > rootSize && !(last.size() && isPathSeparator(last.back())))
+		dst.pop_back();
+
+	return true;
+}
+
+bool fullPath(std::string& dst, const std::string& path, const std::string& root)
+{
+	// A thread local buffer, since 'dst' is often the same string as 'path', and this way there are no allocations
+	// once the buffer is big enough
+	thread_local std::string tmp;
+	bool res;
+	if (root.empty())
+		res = canonicalizePath(tmp, path, getCWD());
+	else
+		res = canonicalizePath(tmp, path, root);
+	if (res)
+		dst = tmp;
+	return res;
+}
+
+bool readFile(const std::string& filename, std::string& dst)
+{
+	std::ifstream file(nativePath(filename), std::ifstream::in | std::ifstream::binary);
+	if (!file.is_open())
+		return false;
+	file.seekg(0, std::ios::end);
+	auto size = static_cast<size_t>(file.tellg());
+	file.seekg(0, std::ios::beg);
+	dst.resize(size);
+	file.read(&dst[0], size);
+	// In case the file got smaller since we got its size
+	dst.resize(static_cast<size_t>(file.gcount()));
+	return true;
+}
+
+std::string replace(const std::string& s, char from, char to)
+{
+	std::string res = s;
+	for (auto&& ch : res)
+	{
+		if (ch == from)
+			ch = to;
+	}
+	return res;
+}
+
+std::string replace(const std::string& str, const std::string& from, const std::string& to)
+{
+	if (from.empty())
+		return "";
+	size_t start_pos = 0;
+	auto res = str;
+	while ((start_pos = res.find(from, start_pos)) != std::string::npos)
+	{
+		res.replace(start_pos, from.length(), to);
+		start_pos += to.length();  // In case 'to' contains 'from', like replacing 'x' with 'yx'
+	}
+	return res;
+}
+
+std::pair<std::string, std::string> splitFolderAndFile(const std::string& str)
+{
+	auto i = std::find_if(str.rbegin(), str.rend(), [](const char& ch)
+	{
+		return ch == '/' || ch == '\\';
+	});
+
+	std::pair < std::string, std::string> res;
+	res.first = std::string(str.begin(), i.base());
+	res.second = std::string(i.base(), str.end());
+	return res;
+}
+
+std::string getExtension(const std::string& fname, std::string* name)
+{
+	auto slashpos = fname.find_last_of("/\\");
+	auto p = fname.find_last_of(".");
+
+	if (p == std::string::npos || (slashpos != std::string::npos && p < slashpos))
+	{
+		if (name)
+			*name = fname;
+		return "";
+	}
+	else
+	{
+		auto res = fname.substr(p + 1);
+		if (name)
+			*name = fname.substr(0, p);
+		return res;
+	}
+}
+
+std::string removeQuotes(const std::string& str)
+{
+	std::string res = str;
+	while (res.size() && (res[0] == '"' || res[0] == '\''))
+		res.erase(res.begin());
+	while (res.size() && (res.back() == '"' || res.back() == '\''))
+		res.pop_back();
+	return res;
+}
+
+std::vector<std::string> splitCommandLine(const std::string& str)
+{
+	std::vector<std::string> res;
+	size_t i = 0;
+	while (true)
+	{
+		while (i < str.size() && isSpace(str[i]))
+			i++;
+		if (i == str.size())
+			break;
+
+		std::string arg;
+		bool quoted = false;
+		for (; i < str.size() && (quoted || !isSpace(str[i])); i++)
+		{
+			if (str[i] == '\\')
+			{
+				// Backslashes are only special before a quote: 2N+1 give N and a literal quote, 2N give N and the
+				// quote is processed as usual
+				size_t n = 0;
+				while (i < str.size() && str[i] == '\\')
+				{
+					n++;
+					i++;
+				}
+				if (i < str.size() && str[i] == '"')
+				{
+					arg.append(n / 2, '\\');
+					if (n % 2)
+					{
+						arg += '"';
+						continue;
+					}
+				}
+				else
+				{
+					arg.append(n, '\\');
+				}
+				i--;
+			}
+			else if (str[i] == '"')
+			{
+				// "" inside quotes is a literal quote
+				if (quoted && i + 1 < str.size() && str[i + 1] == '"')
+				{
+					arg += '"';
+					i++;
+				}
+				else
+				{
+					quoted = !quoted;
+				}
+			}
+			else
+			{
+				arg += str[i];
+			}
+		}
+		res.push_back(std::move(arg));
+	}
+	return res;
+}
+
+std::string quoteArg(const std::string& arg)
+{
+	if (arg.size() && arg.find_first_of(" \t\"") == std::string::npos)
+		return arg;
+
+	std::string res = "\"";
+	size_t backslashes = 0;
+	for (auto c : arg)
+	{
+		if (c == '\\')
+		{
+			backslashes++;
+			continue;
+		}
+		// Backslashes before a quote need escaping, and so does the quote
+		res.append(c == '"' ? backslashes * 2 + 1 : backslashes, '\\');
+		backslashes = 0;
+		res += c;
+	}
+	// Same for the closing quote
+	res.append(backslashes * 2, '\\');
+	res += '"';
+	return res;
+}
+
+bool isSpace(int a)
+{
+	return a == ' ' || a == '\t' || a == 0xA || a == 0xD;
+}
+
+bool notSpace(int a)
+{
+	return !isSpace(a);
+}
+
+bool endsWith(const std::string& str, const std::string& ending)
+{
+	if (str.length() >= ending.length()) {
+		return (0 == str.compare(str.length() - ending.length(), ending.length(), ending));
+	}
+	else {
+		return false;
+	}
+}
+
+bool endsWith(const std::string& str, const char* ending)
+{
+	const size_t endingLength = strlen(ending);
+	if (str.length() >= endingLength) {
+		return (0 == str.compare(str.length() - endingLength, endingLength, ending));
+	}
+	else {
+		return false;
+	}
+}
+
+bool beginsWith(const std::string& str, const std::string& begins, std::string* dst)
+{
+	if (str.length() >= begins.length()) {
+		bool res = (0 == str.compare(0, begins.length(), begins));
+		if (res && dst)
+			*dst = str.substr(begins.length());
+		return res;
+	}
+	else {
+		return false;
+	}
+}
+
+bool beginsWith(const std::string& str, const char* begins, std::string* dst)
+{
+	const size_t beginsLength = strlen(begins);
+	if (str.length() >= beginsLength) {
+		bool res = (0 == str.compare(0, beginsLength, begins));
+		if (res && dst)
+			*dst = str.substr(beginsLength);
+		return res;
+	}
+	else {
+		return false;
+	}
+}
+
+int64_t hash(const std::string& s)
+{
+	int64_t out[2]; 
+	MurmurHash3_x64_128(s.data(), static_cast<int>(s.size() * sizeof(s[0])), MURMUR_SEED, out);
+	return out[0];
+}
+
+int64_t hash(const std::vector<std::string>& v)
+{
+	std::string s;
+	for(auto&& i: v) s+=i; 
+	return hash(s);
+}
+
+namespace
+{
+
+constexpr uint64_t kHashPrime1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t kHashPrime2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t kHashPrime3 = 0x165667B19E3779F9ULL;
+// "vivs", the value of MURMUR_SEED, which hashPath used before. Keeps the file ids of the databases created since
+// hashPath exists (version 5 and later) the same. Older databases have their ids recalculated (see Database::open).
+constexpr uint64_t kHashPathSeed = 0x76697673;
+
+inline uint64_t rotl64(uint64_t x, int r)
+{
+	return (x << r) | (x >> (64 - r));
+}
+
+// Lowercases the bytes in 'A'..'Z', 8 at a time. Bytes outside ASCII are left alone.
+inline uint64_t foldCase8(uint64_t x)
+{
+	constexpr uint64_t ones = 0x0101010101010101ULL;
+	uint64_t low7 = x & (ones * 0x7F);
+	// Adding to the low 7 bits can't carry into the next byte, and sets the high bit if the byte is >= 'A' (or > 'Z')
+	uint64_t geA = low7 + ones * (0x80 - 'A');
+	uint64_t gtZ = low7 + ones * (0x80 - 'Z' - 1);
+	uint64_t upper = (geA ^ gtZ) & ~x & (ones * 0x80);
+	return x | (upper >> 2);
+}
+
+// Same rounds and finalization as xxHash64, with a single accumulator
+inline uint64_t hashRound(uint64_t acc, uint64_t word)
+{
+	acc += word * kHashPrime2;
+	acc = rotl64(acc, 31);
+	return acc * kHashPrime1;
+}
+
+inline uint64_t hashAvalanche(uint64_t h)
+{
+	h ^= h >> 33;
+	h *= kHashPrime2;
+	h ^= h >> 29;
+	h *= kHashPrime3;
+	h ^= h >> 32;
+	return h;
+}
+
+}
+
+//! \param simd
+//		If false, only the scalar code is used, which gives the same result
+static int64_t hashPathImpl(std::string_view path, bool simd)
+{
+	const char* p = path.data();
+	size_t n = path.size();
+	uint64_t acc = kHashPathSeed + kHashPrime3 + n;
+
+	// Both paths feed exactly the same words to hashRound, so the result doesn't depend on which one is used
+#if CZ_HASH_SSE2
+	const __m128i beforeA = _mm_set1_epi8('A' - 1);
+	const __m128i afterZ = _mm_set1_epi8('Z' + 1);
+	const __m128i caseBit = _mm_set1_epi8(0x20);
+	while (simd && n >= 16)
+	{
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		// The comparisons are signed, so bytes outside ASCII are never considered upper case
+		__m128i upper = _mm_and_si128(_mm_cmpgt_epi8(v, beforeA), _mm_cmplt_epi8(v, afterZ));
+		v = _mm_or_si128(v, _mm_and_si128(upper, caseBit));
+		uint64_t words[2];
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(words), v);
+		acc = hashRound(acc, words[0]);
+		acc = hashRound(acc, words[1]);
+		p += 16;
+		n -= 16;
+	}
+#endif
+
+	while (n >= 8)
+	{
+		uint64_t word;
+		memcpy(&word, p, 8);
+		acc = hashRound(acc, foldCase8(word));
+		p += 8;
+		n -= 8;
+	}
+
+	if (n)
+	{
+		// Zero padded. The length is part of the seed, so trailing zeros don't collide with the padding.
+		uint64_t word = 0;
+		memcpy(&word, p, n);
+		acc = hashRound(acc, foldCase8(word));
+	}
+
+	return static_cast<int64_t>(hashAvalanche(acc));
+}
+
+int64_t hashPath(std::string_view path)
+{
+	return hashPathImpl(path, true);
+}
+
+int64_t hashPathScalar(std::string_view path)
+{
+	return hashPathImpl(path, false);
+}
+
+}
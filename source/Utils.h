@@ -1,171 +1,313 @@
-#pragma once
-
-#define WIDEN2(x) L ## x
-#define WIDEN(x) WIDEN2(x)
-#define __WFILE__ WIDEN(__FILE__)
-
-
-#if NDEBUG
-	#define CZ_ASSERT(expression) ((void)0)
-	#define CZ_ASSERT_F(expression, fmt, ...) ((void)0)
-	#define CZ_UNEXPECTED() ::cz::_doAssert(__FILE__, __LINE__, "Unexpected code path")
-#else
-
-/*! Checks if the expression is true/false and causes an assert if it's false.
- @hideinitializer
- Depending on the build configuration, asserts might be enabled for release build too
- */
-	#define CZ_ASSERT(expression) if (!(expression)) { ::cz::_doAssert(__FILE__, __LINE__, #expression); }
-	//#define CZ_ASSERT(expression) (void(0))
-
-/*! Checks if the expression is true/false and causes an assert if it's false.
-@hideinitializer
-The difference between this and \link CZ_ASSERT \endlink is that it's suitable to display meaningful messages.
-\param expression Expression to check
-\param fmt printf style format string
-*/
-	#define CZ_ASSERT_F(expression, fmt, ...) if (!(expression)) { ::cz::_doAssert(__FILE__, __LINE__, fmt, ##__VA_ARGS__); } // By using ##__VA_ARGS__ , it will remove the last comma, if __VA_ARGS__ is empty
-
-	#define CZ_UNEXPECTED() ::cz::_doAssert(__FILE__, __LINE__, "Unexpected code path")
-	#define CZ_UNEXPECTED_F(fmt, ...) ::cz::_doAssert(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
-#endif
-
-/*! Evaluates the expression, and asserts if asserts are enabled.
- @hideinitializer
- Note that even if asserts are disabled, it still evaluates the expression (it's not compiled-out like the standard 'assert' for release builds),
- so can be used to check if for example a function returned a specific value:
- \code
- CZ_CHECK( doSomethingCritical()==true );
- \endcode
- */
-#define CZ_CHECK(expression) if (!(expression)) { ::cz::_doAssert(__FILE__, __LINE__, #expression); }
-
-namespace cz
-{
-
-inline std::string tolower(const std::string& s)
-{
-	std::string r;
-	std::transform(s.begin(), s.end(), std::back_inserter(r), ::tolower);
-	return r;
-}
-
-inline void tolower_inplace(std::string& s)
-{
-	std::transform(s.begin(), s.end(), s.begin(), ::tolower);
-}
-
-std::string getWin32Error(const char* funcname);
-
-void _doAssert(const char* file, int line, _Printf_format_string_ const char* fmt, ...);
-
-enum
-{
-	kTemporaryStringMaxNesting = 20,
-	kTemporaryStringMaxSize = 16000
-};
-
-static char* getTemporaryString();
-
-const char* formatString(_Printf_format_string_ const char* format, ...);
-const char* formatStringVA(const char* format, va_list argptr);
-
-void ensureTrailingSlash(std::string& str);
-std::string removeTrailingSlash(std::string str);
-
-std::string getCWD();
-
-bool isExistingFile(const std::string& filename);
-
-std::string getProcessPath(std::string* fname = nullptr);
-
-
-// Canonicalizes a path (converts relative to absolute, and converts all '/' characters to '\'
-// "root" is used to process relative paths. If it's not specified, it will assume the current working Directory
-bool fullPath(std::string& dst, const std::string& path, std::string root);
-
-std::string replace(const std::string& s, char from, char to);
-std::string replace(const std::string& str, const std::string& from, const std::string& to);
-std::pair<std::string, std::string> splitFolderAndFile(const std::string& str);
-std::string getExtension(const std::string& fname, std::string* name = nullptr);
-std::string removeQuotes(const std::string& str);
-int levenshtein_distance(const std::string& s1, const std::string& s2);
-
-//! Converts a string from UTF-8 to UTF-16.
-std::wstring widen(const std::string& str);
-//! Converts a string from UTF-16 to UTF-8.
-std::string narrow(const std::wstring& str);
-
-bool isSpace(int a);
-bool notSpace(int a);
-
-// trim from start
-template<class StringType>
-static inline StringType ltrim(const StringType &s_) {
-	StringType s = s_;
-	s.erase(s.begin(), std::find_if(s.begin(), s.end(), notSpace));
-	return s;
-}
-
-// trim from end
-template<class StringType>
-static inline StringType rtrim(const StringType &s_) {
-	StringType s = s_;
-	s.erase(std::find_if(s.rbegin(), s.rend(), notSpace).base(), s.end());
-	return s;
-}
-
-// trim from both ends
-template<class StringType>
-static inline StringType trim(const StringType &s) {
-	return ltrim(rtrim(s));
-}
-
-bool endsWith(const std::string& str, const std::string& ending);
-bool endsWith(const std::string& str, const char* ending);
-
-// \param dst
-//		If not nullptr, it will contain the string with the specified begin stripped (if the function returned true)
-bool beginsWith(const std::string& str, const std::string& begins, std::string* dst = nullptr);
-bool beginsWith(const std::string& str, const char* begins, std::string* dst = nullptr);
-
-int64_t hash(const std::string& s);
-int64_t hash(const std::vector<std::string>& v);
-
-template <class T, class MTX=std::mutex>
-class Monitor
-{
-private:
-	mutable T m_t;
-	mutable MTX m_mtx;
-
-public:
-	using Type = T;
-	Monitor() {}
-	Monitor(T t_) : m_t(std::move(t_)) {}
-	template <typename F>
-	auto operator()(F f) const -> decltype(f(m_t))
-	{
-		std::lock_guard<std::mutex> hold{ m_mtx };
-		return f(m_t);
-	}
-};
-
-template<class T>
-void moveAppend(std::vector<T>& src, std::vector<T>& dst)
-{
-	assert(&dst != &src);
-	if (dst.empty())
-	{
-		dst = std::move(src);
-	}
-	else
-	{
-		dst.reserve(dst.size() + src.size());
-		std::move(std::begin(src), std::end(src), std::back_inserter(dst));
-	}
-	src.clear();
-}
-
-} // namesapce cz
-
+#pragma once
+
+#define WIDEN2(x) L ## x
+#define WIDEN(x) WIDEN2(x)
+#define __WFILE__ WIDEN(__FILE__)
+
+
+#if NDEBUG
+	#define CZ_ASSERT(expression) ((void)0)
+	#define CZ_ASSERT_F(expression, fmt, ...) ((void)0)
+	#define CZ_UNEXPECTED() ::cz::_doAssert(__FILE__, __LINE__, "Unexpected code path")
+#else
+
+/*! Checks if the expression is true/false and causes an assert if it's false.
+ @hideinitializer
+ Depending on the build configuration, asserts might be enabled for release build too
+ */
+	#define CZ_ASSERT(expression) if (!(expression)) { ::cz::_doAssert(__FILE__, __LINE__, #expression); }
+	//#define CZ_ASSERT(expression) (void(0))
+
+/*! Checks if the expression is true/false and causes an assert if it's false.
+@hideinitializer
+The difference between this and \link CZ_ASSERT \endlink is that it's suitable to display meaningful messages.
+\param expression Expression to check
+\param fmt printf style format string
+*/
+	#define CZ_ASSERT_F(expression, fmt, ...) if (!(expression)) { ::cz::_doAssert(__FILE__, __LINE__, fmt, ##__VA_ARGS__); } // By using ##__VA_ARGS__ , it will remove the last comma, if __VA_ARGS__ is empty
+
+	#define CZ_UNEXPECTED() ::cz::_doAssert(__FILE__, __LINE__, "Unexpected code path")
+	#define CZ_UNEXPECTED_F(fmt, ...) ::cz::_doAssert(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
+#endif
+
+/*! Evaluates the expression, and asserts if asserts are enabled.
+ @hideinitializer
+ Note that even if asserts are disabled, it still evaluates the expression (it's not compiled-out like the standard 'assert' for release builds),
+ so can be used to check if for example a function returned a specific value:
+ \code
+ CZ_CHECK( doSomethingCritical()==true );
+ \endcode
+ */
+#define CZ_CHECK(expression) if (!(expression)) { ::cz::_doAssert(__FILE__, __LINE__, #expression); }
+
+namespace cz
+{
+
+inline std::string tolower(const std::string& s)
+{
+	std::string r;
+	std::transform(s.begin(), s.end(), std::back_inserter(r), ::tolower);
+	return r;
+}
+
+inline void tolower_inplace(std::string& s)
+{
+	std::transform(s.begin(), s.end(), s.begin(), ::tolower);
+}
+
+//! Returns a message with the last error of an OS call (GetLastError on Windows, errno on others)
+std::string getLastErrorMsg(const char* funcname);
+
+void _doAssert(const char* file, int line, _Printf_format_string_ const char* fmt, ...);
+
+enum
+{
+	kTemporaryStringMaxNesting = 20,
+	kTemporaryStringMaxSize = 16000
+};
+
+static char* getTemporaryString();
+
+const char* formatString(_Printf_format_string_ const char* format, ...);
+const char* formatStringVA(const char* format, va_list argptr);
+
+void ensureTrailingSlash(std::string& str);
+std::string removeTrailingSlash(std::string str);
+
+std::string getCWD();
+
+//! Directories renamed, or deleted and created again, before this are noticed by the file functions below.
+// File lookups can cache what directories the paths lead to (see PlatformLinux.cpp), and only check them once per
+// generation, so long running commands (e.g: -server) call this before each request.
+// Files being added, removed or changed are always seen.
+void newFileSystemGeneration();
+
+bool isExistingFile(const std::string& filename);
+bool isExistingDirectory(const std::string& path);
+
+//! Returns the size of the file in bytes, or -1 if the file doesn't exist
+int64_t getFileSize(const std::string& filename);
+
+//! Returns the last write time of the file, or -1 if the file doesn't exist
+int64_t getFileModificationTime(const std::string& filename);
+
+//! Renames a file, replacing the destination if it exists
+bool renameFile(const std::string& from, const std::string& to);
+
+//! Deletes the specified file. Returns false if it doesn't exist or can't be deleted
+bool deleteFile(const std::string& filename);
+
+//! Creates a directory. Its parent needs to exist already.
+bool createDirectory(const std::string& path);
+
+//! Deletes an empty directory
+bool removeDirectory(const std::string& path);
+
+//! Reads the whole file into 'dst', as it is (no conversion of line endings). Returns false if it can't be opened.
+bool readFile(const std::string& filename, std::string& dst);
+
+//! Returns the full paths of the files (not folders) that match the specified pattern, sorted.
+// Wildcards are only supported in the file name part (e.g: C:\Foo\*.props)
+std::vector<std::string> findFiles(const std::string& pattern);
+
+//! Gets the value of an environment variable. Returns false if it doesn't exist
+bool getEnvironmentVariable(const std::string& name, std::string& dst);
+
+//! Read-only memory mapped file
+class MappedFile
+{
+public:
+	MappedFile() {}
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool open(const std::string& filename);
+	void close();
+
+	const uint8_t* data() const { return m_data; }
+	size_t size() const { return m_size; }
+
+private:
+	const uint8_t* m_data = nullptr;
+	size_t m_size = 0;
+#ifdef _WIN32
+	HANDLE m_file = INVALID_HANDLE_VALUE;
+	HANDLE m_mapping = NULL;
+#endif
+};
+
+std::string getProcessPath(std::string* fname = nullptr);
+
+
+#ifdef _WIN32
+	constexpr char kPathSeparator = '\\';
+#else
+	constexpr char kPathSeparator = '/';
+#endif
+
+//! Canonicalizes a path, without touching the filesystem or the OS.
+// - Relative paths are made absolute, using 'root', which needs to be absolute itself
+// - Both '/' and '\' are accepted, and converted to kPathSeparator. Repeated separators are collapsed
+// - "." and ".." are resolved. ".." never goes above the root ("C:\", "\\server\share\", or "\")
+// - A trailing separator is only kept if 'path' has one, or if the result is the root itself
+// 'dst' can't be the same string as 'path' or 'root'.
+// Returns false if 'path' is relative and 'root' is not absolute.
+bool canonicalizePath(std::string& dst, std::string_view path, std::string_view root);
+
+// Canonicalizes a path (converts relative to absolute, and converts all '/' characters to '\'
+// "root" is used to process relative paths. If it's not specified, it will assume the current working Directory
+bool fullPath(std::string& dst, const std::string& path, const std::string& root);
+
+std::string replace(const std::string& s, char from, char to);
+std::string replace(const std::string& str, const std::string& from, const std::string& to);
+std::pair<std::string, std::string> splitFolderAndFile(const std::string& str);
+std::string getExtension(const std::string& fname, std::string* name = nullptr);
+std::string removeQuotes(const std::string& str);
+
+//! Splits a command line (or the contents of a response file) into arguments, with the same quoting rules as the
+// Microsoft C runtime, which is what cl.exe uses. New lines separate arguments too.
+std::vector<std::string> splitCommandLine(const std::string& str);
+//! Quotes an argument if needed, so splitCommandLine gets it back as it is
+std::string quoteArg(const std::string& arg);
+
+#ifdef _WIN32
+//! Converts a string from UTF-8 to UTF-16.
+std::wstring widen(const std::string& str);
+//! Converts a string from UTF-16 to UTF-8.
+std::string narrow(const std::wstring& str);
+#endif
+
+bool isSpace(int a);
+bool notSpace(int a);
+
+// trim from start
+template<class StringType>
+static inline StringType ltrim(const StringType &s_) {
+	StringType s = s_;
+	s.erase(s.begin(), std::find_if(s.begin(), s.end(), notSpace));
+	return s;
+}
+
+// trim from end
+template<class StringType>
+static inline StringType rtrim(const StringType &s_) {
+	StringType s = s_;
+	s.erase(std::find_if(s.rbegin(), s.rend(), notSpace).base(), s.end());
+	return s;
+}
+
+// trim from both ends
+template<class StringType>
+static inline StringType trim(const StringType &s) {
+	return ltrim(rtrim(s));
+}
+
+bool endsWith(const std::string& str, const std::string& ending);
+bool endsWith(const std::string& str, const char* ending);
+
+// \param dst
+//		If not nullptr, it will contain the string with the specified begin stripped (if the function returned true)
+bool beginsWith(const std::string& str, const std::string& begins, std::string* dst = nullptr);
+bool beginsWith(const std::string& str, const char* begins, std::string* dst = nullptr);
+
+int64_t hash(const std::string& s);
+int64_t hash(const std::vector<std::string>& v);
+
+//! Case insensitive (ASCII only) hash of a path, without creating a lowercase copy.
+// Used for the file ids in the database and flat index, so changing it requires a database migration (see
+// Database::open) and a new flat index version.
+int64_t hashPath(std::string_view path);
+//! hashPath without the SSE2 code, which needs to give the same result. Only used by the self checks.
+int64_t hashPathScalar(std::string_view path);
+
+template <class T, class MTX=std::mutex>
+class Monitor
+{
+private:
+	mutable T m_t;
+	mutable MTX m_mtx;
+
+public:
+	using Type = T;
+	Monitor() {}
+	Monitor(T t_) : m_t(std::move(t_)) {}
+	template <typename F>
+	auto operator()(F f) const -> decltype(f(m_t))
+	{
+		std::lock_guard<std::mutex> hold{ m_mtx };
+		return f(m_t);
+	}
+};
+
+//! Unbounded lock free queue, for one producer thread and one consumer thread.
+// Each push allocates, so push batches of work instead of lots of small items.
+template<class T>
+class SpscQueue
+{
+private:
+	struct Node
+	{
+		T value;
+		std::atomic<Node*> next{ nullptr };
+	};
+	Node* m_head; // Consumer side. Always a node already consumed (or the initial empty one).
+	Node* m_tail; // Producer side
+
+public:
+	SpscQueue()
+	{
+		m_head = m_tail = new Node;
+	}
+	~SpscQueue()
+	{
+		while (m_head)
+		{
+			Node* next = m_head->next.load(std::memory_order_relaxed);
+			delete m_head;
+			m_head = next;
+		}
+	}
+	SpscQueue(const SpscQueue&) = delete;
+	SpscQueue& operator=(const SpscQueue&) = delete;
+
+	//! Only called from the producer thread
+	void push(T value)
+	{
+		Node* n = new Node;
+		n->value = std::move(value);
+		m_tail->next.store(n, std::memory_order_release);
+		m_tail = n;
+	}
+
+	//! Only called from the consumer thread. Returns false if empty.
+	bool pop(T& dst)
+	{
+		Node* next = m_head->next.load(std::memory_order_acquire);
+		if (!next)
+			return false;
+		dst = std::move(next->value);
+		delete m_head;
+		m_head = next;
+		return true;
+	}
+};
+
+template<class T>
+void moveAppend(std::vector<T>& src, std::vector<T>& dst)
+{
+	assert(&dst != &src);
+	if (dst.empty())
+	{
+		dst = std::move(src);
+	}
+	else
+	{
+		dst.reserve(dst.size() + src.size());
+		std::move(std::begin(src), std::end(src), std::back_inserter(dst));
+	}
+	src.clear();
+}
+
+} // namesapce cz
+
@@ -0,0 +1,379 @@
+#include "vimvsPCH.h"
+#include "Xml.h"
+#include "Logging.h"
+#include "Utils.h"
+#include <string.h>
+
+namespace cz
+{
+
+const std::string* XmlElement::getAttribute(const char* attrName) const
+{
+	for (auto&& a : attributes)
+	{
+		if (a.first == attrName)
+			return &a.second;
+	}
+	return nullptr;
+}
+
+namespace
+{
+
+void appendUtf8(std::string& dst, uint32_t cp)
+{
+	if (cp < 0x80)
+	{
+		dst += static_cast<char>(cp);
+	}
+	else if (cp < 0x800)
+	{
+		dst += static_cast<char>(0xC0 | (cp >> 6));
+		dst += static_cast<char>(0x80 | (cp & 0x3F));
+	}
+	else if (cp < 0x10000)
+	{
+		dst += static_cast<char>(0xE0 | (cp >> 12));
+		dst += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+		dst += static_cast<char>(0x80 | (cp & 0x3F));
+	}
+	else
+	{
+		dst += static_cast<char>(0xF0 | (cp >> 18));
+		dst += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+		dst += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+		dst += static_cast<char>(0x80 | (cp & 0x3F));
+	}
+}
+
+class XmlReader
+{
+public:
+	XmlReader(const std::string& content, const std::string& filename)
+		: m_p(content.c_str())
+		, m_begin(content.c_str())
+		, m_end(content.c_str() + content.size())
+		, m_filename(filename)
+	{
+	}
+
+	std::unique_ptr<XmlElement> parseDocument()
+	{
+		// Skip UTF-8 BOM
+		if (m_end - m_p >= 3 && memcmp(m_p, "\xEF\xBB\xBF", 3) == 0)
+			m_p += 3;
+
+		if (!skipMisc())
+			return nullptr;
+		if (m_p == m_end || *m_p != '<')
+		{
+			error("Root element not found");
+			return nullptr;
+		}
+
+		auto root = std::make_unique<XmlElement>();
+		if (!parseElement(*root))
+			return nullptr;
+		return root;
+	}
+
+private:
+
+	//! Logs the error, and returns false, for convenience
+	bool error(const char* msg)
+	{
+		// Calculate the line for the error message
+		int line = 1;
+		for (auto p = m_begin; p < m_p && p < m_end; p++)
+		{
+			if (*p == '\n')
+				line++;
+		}
+		CZ_LOG(logDefault, Error, "%s(%d): XML error: %s", m_filename.c_str(), line, msg);
+		return false;
+	}
+
+	bool startsWith(const char* s) const
+	{
+		auto len = strlen(s);
+		return static_cast<size_t>(m_end - m_p) >= len && memcmp(m_p, s, len) == 0;
+	}
+
+	void skipSpaces()
+	{
+		while (m_p < m_end && isSpace(static_cast<unsigned char>(*m_p)))
+			m_p++;
+	}
+
+	//! Skips until after the specified terminator
+	bool skipPast(const char* terminator)
+	{
+		auto len = strlen(terminator);
+		while (m_p < m_end)
+		{
+			if (startsWith(terminator))
+			{
+				m_p += len;
+				return true;
+			}
+			m_p++;
+		}
+		error(formatString("'%s' not found", terminator));
+		return false;
+	}
+
+	//! Skips whitespace, comments, processing instructions and DTDs
+	bool skipMisc()
+	{
+		while (true)
+		{
+			skipSpaces();
+			if (startsWith("<?"))
+			{
+				if (!skipPast("?>"))
+					return false;
+			}
+			else if (startsWith("<!--"))
+			{
+				if (!skipPast("-->"))
+					return false;
+			}
+			else if (startsWith("<!DOCTYPE"))
+			{
+				if (!skipPast(">"))
+					return false;
+			}
+			else
+			{
+				return true;
+			}
+		}
+	}
+
+	bool isNameChar(char c) const
+	{
+		return !isSpace(static_cast<unsigned char>(c)) && c != '/' && c != '>' && c != '=' && c != '<';
+	}
+
+	std::string parseName()
+	{
+		auto start = m_p;
+		while (m_p < m_end && isNameChar(*m_p))
+			m_p++;
+		return std::string(start, m_p);
+	}
+
+	//! Decodes text until the specified terminator character (not consumed)
+	bool parseText(std::string& dst, char terminator)
+	{
+		while (m_p < m_end && *m_p != terminator)
+		{
+			if (*m_p != '&')
+			{
+				dst += *m_p++;
+				continue;
+			}
+
+			auto semicolon = static_cast<const char*>(memchr(m_p, ';', m_end - m_p));
+			if (!semicolon)
+			{
+				error("Invalid entity");
+				return false;
+			}
+
+			std::string entity(m_p + 1, semicolon);
+			if (entity == "lt")
+				dst += '<';
+			else if (entity == "gt")
+				dst += '>';
+			else if (entity == "amp")
+				dst += '&';
+			else if (entity == "quot")
+				dst += '"';
+			else if (entity == "apos")
+				dst += '\'';
+			else if (entity.size() > 1 && entity[0] == '#')
+			{
+				bool hex = entity[1] == 'x' || entity[1] == 'X';
+				auto cp = strtoul(entity.c_str() + (hex ? 2 : 1), nullptr, hex ? 16 : 10);
+				appendUtf8(dst, static_cast<uint32_t>(cp));
+			}
+			else
+			{
+				// Unknown entity, so keep it as-is
+				dst.append(m_p, semicolon + 1);
+			}
+			m_p = semicolon + 1;
+		}
+		return true;
+	}
+
+	bool parseElement(XmlElement& el)
+	{
+		CZ_ASSERT(*m_p == '<');
+		m_p++;
+		el.name = parseName();
+		if (el.name.empty())
+			return error("Invalid element name");
+
+		// Attributes
+		while (true)
+		{
+			skipSpaces();
+			if (m_p == m_end)
+				return error("Unexpected end of file");
+
+			if (startsWith("/>"))
+			{
+				m_p += 2;
+				return true;
+			}
+
+			if (*m_p == '>')
+			{
+				m_p++;
+				break;
+			}
+
+			auto attrName = parseName();
+			skipSpaces();
+			if (attrName.empty() || m_p == m_end || *m_p != '=')
+				return error("Invalid attribute");
+			m_p++;
+			skipSpaces();
+			if (m_p == m_end || (*m_p != '"' && *m_p != '\''))
+				return error("Invalid attribute value");
+			char quote = *m_p++;
+			std::string value;
+			if (!parseText(value, quote))
+				return false;
+			if (m_p == m_end)
+				return error("Unexpected end of file");
+			m_p++;
+			el.attributes.emplace_back(std::move(attrName), std::move(value));
+		}
+
+		// Contents
+		while (true)
+		{
+			if (!parseText(el.text, '<'))
+				return false;
+			if (m_p == m_end)
+				return error(formatString("Element '%s' not closed", el.name.c_str()));
+
+			if (startsWith("</"))
+			{
+				m_p += 2;
+				auto name = parseName();
+				skipSpaces();
+				if (name != el.name || m_p == m_end || *m_p != '>')
+					return error(formatString("Invalid closing tag for element '%s'", el.name.c_str()));
+				m_p++;
+				return true;
+			}
+			else if (startsWith("<!--"))
+			{
+				if (!skipPast("-->"))
+					return false;
+			}
+			else if (startsWith("<![CDATA["))
+			{
+				m_p += 9;
+				auto start = m_p;
+				if (!skipPast("]]>"))
+					return false;
+				el.text.append(start, m_p - 3);
+			}
+			else if (startsWith("<?"))
+			{
+				if (!skipPast("?>"))
+					return false;
+			}
+			else
+			{
+				auto child = std::make_unique<XmlElement>();
+				if (!parseElement(*child))
+					return false;
+				el.children.push_back(std::move(child));
+			}
+		}
+	}
+
+	const char* m_p;
+	const char* m_begin;
+	const char* m_end;
+	const std::string& m_filename;
+};
+
+//! Converts UTF-16 (little endian) to UTF-8
+std::string utf16ToUtf8(const char* data, size_t size)
+{
+	auto get = [data](size_t i)
+	{
+		return static_cast<uint32_t>(static_cast<uint8_t>(data[i]) | (static_cast<uint8_t>(data[i + 1]) << 8));
+	};
+
+	std::string res;
+	res.reserve(size / 2);
+	for (size_t i = 0; i + 1 < size; i += 2)
+	{
+		uint32_t c = get(i);
+		if (c >= 0xD800 && c <= 0xDBFF && i + 3 < size && get(i + 2) >= 0xDC00 && get(i + 2) <= 0xDFFF)
+		{
+			c = 0x10000 + ((c - 0xD800) << 10) + (get(i + 2) - 0xDC00);
+			i += 2;
+		}
+
+		if (c < 0x80)
+		{
+			res += static_cast<char>(c);
+		}
+		else if (c < 0x800)
+		{
+			res += static_cast<char>(0xC0 | (c >> 6));
+			res += static_cast<char>(0x80 | (c & 0x3F));
+		}
+		else if (c < 0x10000)
+		{
+			res += static_cast<char>(0xE0 | (c >> 12));
+			res += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+			res += static_cast<char>(0x80 | (c & 0x3F));
+		}
+		else
+		{
+			res += static_cast<char>(0xF0 | (c >> 18));
+			res += static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+			res += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+			res += static_cast<char>(0x80 | (c & 0x3F));
+		}
+	}
+	return res;
+}
+
+} // anonymous namespace
+
+std::unique_ptr<XmlElement> parseXml(const std::string& content, const std::string& filename)
+{
+	XmlReader reader(content, filename);
+	return reader.parseDocument();
+}
+
+std::unique_ptr<XmlElement> loadXml(const std::string& filename)
+{
+	std::ifstream file(nativePath(filename), std::ifstream::in | std::ifstream::binary);
+	if (!file.is_open())
+	{
+		CZ_LOG(logDefault, Error, "Could not open file '%s'", filename.c_str());
+		return nullptr;
+	}
+
+	std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	// Visual Studio can save project files as UTF-16
+	if (content.size() >= 2 && static_cast<uint8_t>(content[0]) == 0xFF && static_cast<uint8_t>(content[1]) == 0xFE)
+		content = utf16ToUtf8(content.data() + 2, content.size() - 2);
+
+	return parseXml(content, filename);
+}
+
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+
+namespace cz
+{
+
+//! Minimal XML DOM, with just what is needed to read MSBuild files.
+// DTDs are skipped, and namespace prefixes are kept as part of the names.
+struct XmlElement
+{
+	std::string name;
+	std::vector<std::pair<std::string, std::string>> attributes;
+	// All the text directly inside the element (not inside children), with entities decoded
+	std::string text;
+	std::vector<std::unique_ptr<XmlElement>> children;
+
+	//! Returns the attribute value, or nullptr if the attribute doesn't exist. Names are case sensitive.
+	const std::string* getAttribute(const char* attrName) const;
+};
+
+//! Parses an xml document, and returns the root element, or nullptr on error (which is logged)
+// \param filename
+//		Only used for error messages
+std::unique_ptr<XmlElement> parseXml(const std::string& content, const std::string& filename);
+
+//! Loads and parses an xml file. UTF-8 (with or without BOM) and UTF-16LE (with BOM) files are supported.
+std::unique_ptr<XmlElement> loadXml(const std::string& filename);
+
+}
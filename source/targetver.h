@@ -1,17 +1,17 @@
-#pragma once
-
-// Including SDKDDKVer.h defines the highest available Windows platform.
-
-/*
-// If you wish to build your application for a previous Windows platform, include WinSDKVer.h and
-// set the _WIN32_WINNT macro to the platform you wish to support before including SDKDDKVer.h.
-#include <SDKDDKVer.h>
-*/
-
-#include <WinSDKVer.h>
-// 0x0600 = Windows Vista
-#define WINVER                  0x0600
-#define _WIN32_WINDOWS          0x0600
-#define _WIN32_WINNT            0x0600
-#include <SDKDDKVer.h>
-
+#pragma once
+
+// Including SDKDDKVer.h defines the highest available Windows platform.
+
+/*
+// If you wish to build your application for a previous Windows platform, include WinSDKVer.h and
+// set the _WIN32_WINNT macro to the platform you wish to support before including SDKDDKVer.h.
+#include <SDKDDKVer.h>
+*/
+
+#include <WinSDKVer.h>
+// 0x0600 = Windows Vista
+#define WINVER                  0x0600
+#define _WIN32_WINDOWS          0x0600
+#define _WIN32_WINNT            0x0600
+#include <SDKDDKVer.h>
+
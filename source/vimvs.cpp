@@ -1,573 +1,1765 @@
-#include "vimvsPCH.h"
-#include "Parser.h"
-#include "Parameters.h"
-#include "IniFile.h"
-#include "Logging.h"
-#include "ChildProcessLauncher.h"
-#include "ScopeGuard.h"
-#include "SqLiteWrapper.h"
-#include "BuildGraph.h"
-
-#define VIMVS_CFG_FILE			".vimvs.ini"
-#define VIMVS_LOG_FILE			".vimvs-tmp.log"
-#define VIMVS_MSBUILDLOG_FILE	".vimvs-tmp.msbuild.log"
-#define VIMVS_QUICKFIX_FILE		".vimvs-tmp.quickfix"
-#define VIMVS_DB_FILE			".vimvs-tmp.sqlite"
-
-//
-// -DCINTERFACE
-//		To let Clang parse VS's combaseapi.h, otherwise we get an error "unknown type name 'IUnknown'
-// -x c++
-//		Tell clang to use c++ if it can't figure out the type by the extension.
-//		For example, system headers have no extension, but still need to be parsed as c++
-//
-#define VIMVS_FIXED_YCM_PARAMS "-DCINTERFACE|-x|c++|"
-
-/*
-Links with information about msbuild
-	https://msdn.microsoft.com/en-us/library/ms164311.aspx
-Good regular expression builder
-	//https://regex101.com/
-*/
-
-namespace cz
-{
-
-class ConsoleLogger : LogOutput
-{
-private:
-	virtual void log(const char* /*file*/, int /*line*/, const LogCategoryBase* /*category*/, LogVerbosity /*verbosity*/, const char* msg) override
-	{
-		printf("%s\n", msg);
-	}
-};
-
-class FileLogger : LogOutput
-{
-public:
-	// According to "http://utf8everywhere.org/", Passing a char* to MSVC CRT will not treat it as UTF8, so we need to use
-	// the wchar_t version
-	FileLogger(const std::string& filename)
-		: m_out(widen(filename), std::ofstream::out | std::ofstream::app)
-		, m_filename(filename)
-	{
-	}
-
-	bool isOpen() const
-	{
-		return m_out.is_open();
-	}
-	
-	const std::string getFilename() const
-	{
-		return m_filename;
-	}
-private:
-
-	virtual void log(const char* /*file*/, int /*line*/, const LogCategoryBase* /*category*/, LogVerbosity /*verbosity*/, const char* msg) override
-	{
-		m_out << msg << std::endl;
-	}
-
-	std::ofstream m_out;
-	std::string m_filename;
-};
-
-struct Config
-{
-	std::string exeRoot;
-	std::string root;
-	std::string slnfile; // full path to the solution file to use
-	std::unique_ptr<FileLogger> fileLogger;
-	std::string commonYcmParams;
-
-	std::string getUtilityPath(const char* name, bool quote=false)
-	{
-		// First look in the the process's directory
-		auto s = exeRoot + name;
-		if (!isExistingFile(s))
-		{
-			// If the file can't be found where vimvs's executable is, then look as if running under the debugger.
-			// This assumes that we have the following folders (with the cmake created projects):
-			// root
-			//     \-bin
-			//          ... various utilities ...
-			//     \-build
-			//          \-bin
-			//               ... various utilities ...
-			// 
-			s = exeRoot + "../../bin/" + name;
-		}
-
-		fullPath(s, s, "");
-		if (!isExistingFile(s))
-		{
-			CZ_LOG(logDefault, Fatal, "vim-vs utility '%s' not found", name);
-			return "";
-		}
-		if (quote)
-			return std::string("\"") + s + "\"";
-		else
-			return s;
-	}
-
-	bool load()
-	{
-		exeRoot = getProcessPath();
-
-		auto found = findConfigFile(root);
-		if (!found)
-		{
-			fprintf(stderr, "Could not find a '%s' file in current working directory or any of the parents\n", VIMVS_CFG_FILE);
-			return false;
-		}
-
-		// Create/open our log file before doing anything else, since we know where the config file is
-		fileLogger = std::make_unique<FileLogger>(root + VIMVS_LOG_FILE);
-		if (!fileLogger->isOpen())
-		{
-			fprintf(stderr, "Could not open log file '%s'\n", fileLogger->getFilename().c_str());
-			return false;
-		}
-
-		IniFile cfg;
-		cfg.open((root + VIMVS_CFG_FILE).c_str());
-		std::string str = cfg.getValue<const char*>("General", "solution", "");
-		if (!fullPath(slnfile, str, root) || !isExistingFile(slnfile))
-		{
-			CZ_LOG(logDefault, Fatal, "Invalid solution path (%s)", str.c_str());
-			fprintf(stderr, "Invalid solution path (%s)\n", str.c_str());
-			return false;
-		}
-		CZ_LOG(logDefault, Log, "Using solution file '%s'", slnfile.c_str());
-
-		str = cfg.getValue<const char*>("General", "common_ycm_params", "");
-		commonYcmParams = VIMVS_FIXED_YCM_PARAMS;
-		if (str.size())
-		{
-			commonYcmParams += str;
-		}
-		else
-		{
-			CZ_LOG(logDefault, Log, "common_ycm_params option not found in the config file");
-		}
-		CZ_LOG(logDefault, Log, "Using '%s' as common_ycm_params", commonYcmParams.c_str());
-
-		return true;
-	}
-
-	static bool findConfigFile(std::string& dir)
-	{
-		std::string d = getCWD();
-		std::string previous;
-		std::string f;
-		do
-		{
-			ensureTrailingSlash(d);
-			if (isExistingFile(d + VIMVS_CFG_FILE))
-			{
-				dir = d;
-				return true;
-			}
-			previous = d;
-		} while (fullPath(d, d + "..", "") && d != previous);
-		return false;
-	}
-};
-
-Parameters gParams(Parameters::Auto);
-std::unique_ptr<Config> gCfg;
-std::unique_ptr<Database> gDb;
-
-std::string genParams(std::vector<std::string> p)
-{
-	std::string res;
-	for (auto s : p)
-	{
-		res += "\"";
-		res += s;
-		res += "\" ";
-	}
-	return res;
-}
-
-
-struct Cmd
-{
-	const char* cmd;
-	bool(*func)(const Cmd&, const std::string&);
-	const char* help;
-};
-
-struct Options
-{
-	std::string configuration;
-	std::string platform;
-};
-Options gOptions;
-
-bool cmd_help(const Cmd& cmd, const std::string& val);
-
-bool cmd_getroot(const Cmd& cmd, const std::string& val)
-{
-	printf("ROOT:%s\n", gCfg->root.c_str());
-	return true;
-}
-
-bool cmd_getycm(const Cmd& cmd, const std::string& val)
-{
-	std::string out;
-	bool res;
-	auto v = val;
-	fullPath(v, val, getCWD());
-
-	SourceFile f = gDb->getFile(v);
-	if (!f.id)
-	{
-		out = "Not found";
-		res = false;
-	}
-	else
-	{
-		out = formatString("YCM_CMD:|%s|%s|%s", gCfg->commonYcmParams.c_str(), f.defines.c_str(), f.includes.c_str());
-		res = true;
-	}
-
-	CZ_LOG(logDefault, Log, "%s=%s", res ? "Success" : "Error", out.c_str());
-	printf("%s\n", out.c_str());
-	return res;
-}
-
-bool cmd_getalt(const Cmd& cmd, const std::string& val)
-{
-	auto v = removeQuotes(val);
-	fullPath(v, v, getCWD());
-	static std::vector<const char*> sources = { "cpp", "c", "cc", "c++", "cxx"};
-	static std::vector<const char*> headers = { "h", "hh", "hxx", "hpp", "h++", "inl"};
-	auto isIn = [](auto&& ext, auto&& c) -> bool
-	{
-		for (auto&& e : c)
-		{
-			if (ext == e)
-				return true;
-		}
-		return false;
-	};
-
-	auto ext = tolower(getExtension(v));
-	if (!isIn(ext, sources) && !isIn(ext, headers))
-	{
-		auto msg = formatString( "File '%s' doesn't have a known source/header extension", v.c_str());
-		CZ_LOG(logDefault, Error, msg);
-		fprintf(stderr,"%s\n", msg);
-		return false;
-	}
-
-	SourceFile src = gDb->getFile(v);
-	if (!src.id)
-	{
-		auto msg = formatString(
-			"File '%s' not found in the database. Do a full build (-builddb) first to update the database",
-			v.c_str());
-		CZ_LOG(logDefault, Error, msg);
-		fprintf(stderr,"%s\n", msg);
-		return false;
-	}
-
-	auto basename = src.name;
-	ext = tolower(getExtension(basename, &basename));
-
-	const std::vector<const char*>* altext;
-	if (isIn(ext, sources))
-		altext = &headers;
-	else if (isIn(ext, headers))
-		altext = &sources;
-	else
-	{
-		const char* out = "File extension not recognized as a C/C++ extension";
-		CZ_LOG(logDefault, Log, out);
-		fprintf(stderr, "%s\n", out);
-		return false;
-	}
-
-	std::vector<SourceFile> alts;
-	for (auto&& e : *altext)
-	{
-		auto res = gDb->getWithBasename(basename + "." + e);
-		alts.insert(alts.end(), res.begin(), res.end());
-	}
-
-	std::vector<std::pair<int,std::string>> dists;
-	for (auto&& a : alts)
-		dists.emplace_back(levenshtein_distance(src.fullpath, a.fullpath), a.fullpath);
-	std::sort(
-		dists.begin(), dists.end(),
-		[](auto&& a, auto && b)
-		{
-			return a.first < b.first;
-		});
-	
-	if (!dists.size())
-	{
-		const char* out = "No alt file found\n";
-		CZ_LOG(logDefault, Log, out);
-		fprintf(stderr, "%s\n", out);
-		return false;
-	}
-
-	printf("ALT:%s\n", dists[0].second.c_str());
-	CZ_LOG(logDefault, Log, "ALT:%s", dists[0].second.c_str());
-	for (auto it = dists.begin() + 1; it < dists.end(); ++it)
-	{
-		CZ_LOG(logDefault, Log, "OTHER:%s", it->second.c_str());
-		printf("OTHER:%s\n", it->second.c_str());
-	}
-
-	return true;
-}
-
-// Good tips on how invoke msbuild to build, clean, rebuild a specific project
-// http://stackoverflow.com/questions/13915636/specify-project-file-of-a-solution-using-msbuild
-// http://stackoverflow.com/questions/9285756/how-do-i-compile-a-single-source-file-within-an-msvc-project-from-the-command-li
-bool cmd_build(const Cmd& cmd, const std::string& val)
-{
-	bool builddb = std::string(cmd.cmd) == "builddb";
-	auto fastParser = gParams.has("fastparser");
-	std::ofstream quickfix(widen(gCfg->root + VIMVS_QUICKFIX_FILE), std::ofstream::out);
-	std::ofstream msbuildlog(widen(gCfg->root + VIMVS_MSBUILDLOG_FILE), std::ofstream::out);
-
-	if (builddb)
-		CZ_LOG(logDefault, Log, "Generating compile database");
-
-	std::vector<std::string> launchParams;
-	auto v = val;
-	if (val == "")
-	{
-		launchParams.push_back(gCfg->slnfile);
-	}
-	else if (beginsWith(v, "prj:", &v))
-	{
-		launchParams.push_back(gCfg->slnfile);
-		launchParams.push_back("/t:" + v);
-	}
-	else if (beginsWith(v, "file:", &v))
-	{
-		v = removeQuotes(v);
-		SourceFile src = gDb->getFile(v);
-		if (!src.id)
-		{
-			auto msg = formatString(
-				"File '%s' not found in the database. Do a full build (-builddb) first to update the database",
-				v.c_str());
-			CZ_LOG(logDefault, Error, msg);
-			fprintf(stderr, "%s\n", msg);
-			return false;
-		}
-
-		launchParams.push_back(formatString("\"%s\"", src.prjFile.c_str()));
-		launchParams.push_back("/t:clCompile");
-		launchParams.push_back(formatString("/p:SelectedFiles=\"%s\"", src.fullpath.c_str()));
-	}
-	else
-	{
-		auto msg = formatString("Invalid -build parameter (%s)", val.c_str());
-		CZ_LOG(logDefault, Error, msg);
-		fprintf(stderr, "%s\n", msg);
-		return false;
-	}
-
-	auto configuration = gParams.get("configuration");
-	auto platform = gParams.get("platform");
-	if (configuration != "")
-		launchParams.push_back(formatString("/p:Configuration=\"%s\"", configuration.c_str()));
-	if (platform != "")
-		launchParams.push_back(formatString("/p:Platform=\"%s\"", platform.c_str()));
-
-	Parser parser(*gDb, builddb, true, fastParser);
-	if (builddb)
-	{
-		if (fastParser)
-		{
-			launchParams.push_back("/p:TrackFileAccess=false");
-			launchParams.push_back(formatString("/p:CLToolExe=%s.exe", VIMVS_FAST_PARSER_CL));
-			launchParams.push_back(formatString("/p:LIBToolExe=%s.exe", VIMVS_FAST_PARSER_LIB));
-			launchParams.push_back(formatString("/p:LINKToolExe=%s.exe", VIMVS_FAST_PARSER_LINK));
-			auto dummyPath = splitFolderAndFile(gCfg->getUtilityPath((std::string(VIMVS_FAST_PARSER_CL) + ".exe").c_str())).first;
-			dummyPath = removeTrailingSlash(dummyPath);
-			launchParams.push_back("/p:CLToolPath=" + dummyPath);
-			launchParams.push_back("/p:LIBToolPath=" + dummyPath);
-			launchParams.push_back("/p:LINKToolPath=" + dummyPath);
-			launchParams.push_back(std::string("/p:ForceImportBeforeCppTargets=") + gCfg->getUtilityPath("gen_fastparser.props", true));
-		}
-		else
-		{
-			launchParams.push_back(std::string("/p:ForceImportBeforeCppTargets=") + gCfg->getUtilityPath("gen.props", true));
-		}
-	}
-
-	launchParams.push_back("/maxcpucount");
-
-	ChildProcessLauncher launcher;
-	auto exitCode = launcher.launch(
-		gCfg->getUtilityPath("vimvs.msbuild.bat"),
-		genParams(launchParams),
-		[&](bool iscmdline, const std::string& str)
-	{
-		if (iscmdline)
-		{
-			CZ_LOG(logDefault, Log, "msbuild command line: %s\n", str.c_str());
-		}
-		else
-		{
-			parser.inject(str);
-			msbuildlog << str;
-		}
-	});
-
-	if (fastParser)
-		printf("Parsing for header dependencies...\n");
-	parser.finishWork();
-	printf("Done!");
-
-	for (auto&& e : parser.getErrors())
-	{
-		quickfix << formatString("%s|%d|%d|%s|%s|%s\n",
-			e.file.c_str(), e.line, e.col, e.type.c_str(), e.code.c_str(), e.msg.c_str());
-	}
-
-	if (exitCode)
-	{
-		CZ_LOG(logDefault, Error, "build failed");
-		//printf("%s\n", launcher.getFullOutput().c_str());
-		fprintf(stderr, "VIMVS: Build failed\n");
-		return false;
-		//return EXIT_FAILURE;
-	}
-
-	return true;
-}
-
-Cmd gCmds[] =
-{
-
-{
-"help", &cmd_help,
-"\
-Vim-vs by Rui Figueira (http://bitbucket.org/ruifig/vim-vs)\n\
-\n\
--help\n\
-Shows this help\n\
-"
-},
-
-{
-"getroot", &cmd_getroot,
-"\
--getroot\n\
-Gets the project root (aka: The folder where vimvs configuration file is located)\n\
-"
-},
-{
-"getycm", &cmd_getycm,
-"\
--getycm=<FILE>\n\
-Gets the command line required to parse the file FILE with YouCompleteMe\n\
-"
-},
-{
-"getalt", &cmd_getalt,
-"\
--getalt=<FILE>\n\
-Gets the file considered the best alternate (e.g: Given an header file, it returns the source file)\n\
-"
-},
-{
-"build", &cmd_build,
-"\
--build[ = ( <prj:PROJECT> | <file:FILE> ) ]\n\
-Builds the entire solution, one project, or compiles 1 single file\n\
-Examples:\n\
--build\n\
-	Build the entire solution\n\
--build=prj:Foo\n\
-	Build the project 'Foo'\n\
--build=file:bar.cpp\n\
-	Compiles the file 'bar.cpp'\n\
-"
-},
-{
-"builddb", &cmd_build,
-"\
-Same as '-build', but adds compile parameters to the sqlite database.\n\
-"
-},
-{ nullptr, nullptr, nullptr }
-};
-
-bool cmd_help(const Cmd& cmd, const std::string& val)
-{
-	auto c = &gCmds[0];
-	while (c->cmd)
-	{
-		printf("%s\n", c->help);
-		c++;
-	}
-
-	return true;
-}
-
-} // namespace cz
-
-
-int wmain(int argc, wchar_t *argv[], wchar_t *envp[])
-{
-	using namespace cz;
-
-	// If we want to just show the help, then don't try to load the configuration
-	if (!gParams.has("help"))
-	{
-		gCfg = std::make_unique<Config>();
-		if (!gCfg->load())
-			return EXIT_FAILURE;
-		gDb = std::make_unique<Database>();
-		if (!gDb->open(gCfg->root + VIMVS_DB_FILE))
-			return EXIT_FAILURE;
-	}
-	SCOPE_EXIT{ gCfg.reset(); };
-	SCOPE_EXIT{ gDb.reset(); };
-
-	if (gParams.has("test"))
-	{
-#if 0
-		buildgraph::Graph graph;
-		auto includeDirs = std::make_shared<buildgraph::IncludeDirs>();
-		includeDirs->addI("C:/Program Files (x86)/Microsoft Visual Studio 14.0/VC/include/");
-		includeDirs->addI("C:/Program Files (x86)/Microsoft Visual Studio 14.0/VC/atlmfc/include/");
-		includeDirs->addI("C:/Program Files (x86)/Windows Kits/10/Include/10.0.14393.0/ucrt/");
-		includeDirs->addI("C:/Program Files (x86)/Windows Kits/10/Include/10.0.14393.0/um/");
-		includeDirs->addI("C:/Program Files (x86)/Windows Kits/10/Include/10.0.14393.0/shared/");
-		includeDirs->addI("C:/Program Files (x86)/Windows Kits/10/Include/10.0.14393.0/winrt/");
-		includeDirs->addI("C:/Program Files (x86)/Windows Kits/NETFXSDK/4.6.2/Include/um/");
-		includeDirs->addI("C:\\Work\\crazygaze\\vim-vs\\dummy\\..\\dummy\\d0\\d1\\d2\\d3\\");
-		std::string f("C:\\Work\\crazygaze\\vim-vs\\dummy\\dummy.cpp");
-		includeDirs->pushParent(splitFolderAndFile(f).first);
-		graph.processIncludes(buildgraph::Node::Type::Source, f, includeDirs, true);
-		graph.finishWork();
-#endif
-		return EXIT_SUCCESS;
-	}
-
-	auto cmd = &gCmds[0];
-	while (cmd->cmd)
-	{
-		if (gParams.has(cmd->cmd))
-		{
-			auto val = gParams.get(cmd->cmd);
-			CZ_LOG(logDefault, Log, "Executing -%s=%s", cmd->cmd, val.c_str());
-			return cmd->func(*cmd, val) ? EXIT_SUCCESS : EXIT_FAILURE;
-		}
-		cmd++;
-	}
-
-	return EXIT_SUCCESS;
-}
+#include "vimvsPCH.h"
+#include "Parser.h"
+#include "Parameters.h"
+#include "IniFile.h"
+#include "Logging.h"
+#include "ChildProcessLauncher.h"
+#include "ScopeGuard.h"
+#include "SqLiteWrapper.h"
+#include "BuildGraph.h"
+#include "FlatIndex.h"
+#include "FileFinder.h"
+#include "Benchmarks.h"
+#include "Checks.h"
+#include "MsBuildEvaluator.h"
+#include "CompileScheduler.h"
+#include "Trace.h"
+#include "PathRank.h"
+#include <iostream>
+
+#define VIMVS_CFG_FILE			".vimvs.ini"
+#define VIMVS_LOG_FILE			".vimvs-tmp.log"
+#define VIMVS_MSBUILDLOG_FILE	".vimvs-tmp.msbuild.log"
+#define VIMVS_QUICKFIX_FILE		".vimvs-tmp.quickfix"
+#define VIMVS_DB_FILE			".vimvs-tmp.sqlite"
+#define VIMVS_PCHREPORT_FILE	".vimvs-tmp.pch"
+#define VIMVS_INDEX_FILE		".vimvs-tmp.index"
+#define VIMVS_FIND_FILE		".vimvs-tmp.find"
+#define VIMVS_INCREMENTAL_FILE	".vimvs-tmp.incremental.proj"
+
+// Name used to keep track of the solution file in the database's projects table
+#define VIMVS_SOLUTION_PRJNAME	"<solution>"
+
+// How long -server waits for requests before closing the database and indexes
+static const auto kServerIdleTime = std::chrono::milliseconds(500);
+
+//
+// -DCINTERFACE
+//		To let Clang parse VS's combaseapi.h, otherwise we get an error "unknown type name 'IUnknown'
+// -x c++
+//		Tell clang to use c++ if it can't figure out the type by the extension.
+//		For example, system headers have no extension, but still need to be parsed as c++
+//
+#define VIMVS_FIXED_YCM_PARAMS "-DCINTERFACE|-x|c++|"
+
+/*
+Links with information about msbuild
+	https://msdn.microsoft.com/en-us/library/ms164311.aspx
+Good regular expression builder
+	//https://regex101.com/
+*/
+
+namespace cz
+{
+
+class ConsoleLogger : LogOutput
+{
+private:
+	virtual void log(const char* /*file*/, int /*line*/, const LogCategoryBase* /*category*/, LogVerbosity /*verbosity*/, const char* msg) override
+	{
+		printf("%s\n", msg);
+	}
+};
+
+class FileLogger : AsyncLogOutput
+{
+public:
+	// According to "http://utf8everywhere.org/", Passing a char* to MSVC CRT will not treat it as UTF8, so we need to use
+	// the wchar_t version
+	FileLogger(const std::string& filename)
+		: m_out(nativePath(filename), std::ofstream::out | std::ofstream::app)
+		, m_filename(filename)
+	{
+	}
+
+	~FileLogger()
+	{
+		stop();
+	}
+
+	bool isOpen() const
+	{
+		return m_out.is_open();
+	}
+	
+	const std::string getFilename() const
+	{
+		return m_filename;
+	}
+private:
+
+	virtual void write(const std::string& batch) override
+	{
+		// Flushed once per batch, so the file is still readable while vimvs is running
+		m_out.write(batch.data(), batch.size());
+		m_out.flush();
+	}
+
+	std::ofstream m_out;
+	std::string m_filename;
+};
+
+struct Config
+{
+	std::string exeRoot;
+	std::string root;
+	std::string slnfile; // full path to the solution file to use
+	std::unique_ptr<FileLogger> fileLogger;
+	std::string commonYcmParams;
+	// Extra global properties for the native project evaluator (-native), from the [MSBuildProperties] section
+	std::map<std::string, std::string> msbuildProperties;
+
+	std::string getUtilityPath(const char* name, bool quote=false)
+	{
+		// First look in the the process's directory
+		auto s = exeRoot + name;
+		if (!isExistingFile(s))
+		{
+			// If the file can't be found where vimvs's executable is, then look as if running under the debugger.
+			// This assumes that we have the following folders (with the cmake created projects):
+			// root
+			//     \-bin
+			//          ... various utilities ...
+			//     \-build
+			//          \-bin
+			//               ... various utilities ...
+			// 
+			s = exeRoot + "../../bin/" + name;
+		}
+
+		fullPath(s, s, "");
+		if (!isExistingFile(s))
+		{
+			CZ_LOG(logDefault, Fatal, "vim-vs utility '%s' not found", name);
+			return "";
+		}
+		if (quote)
+			return std::string("\"") + s + "\"";
+		else
+			return s;
+	}
+
+	bool load()
+	{
+		exeRoot = getProcessPath();
+
+		auto found = findConfigFile(root);
+		if (!found)
+		{
+			fprintf(stderr, "Could not find a '%s' file in current working directory or any of the parents\n", VIMVS_CFG_FILE);
+			return false;
+		}
+
+		// Create/open our log file before doing anything else, since we know where the config file is
+		fileLogger = std::make_unique<FileLogger>(root + VIMVS_LOG_FILE);
+		if (!fileLogger->isOpen())
+		{
+			fprintf(stderr, "Could not open log file '%s'\n", fileLogger->getFilename().c_str());
+			return false;
+		}
+
+		IniFile cfg;
+		cfg.open((root + VIMVS_CFG_FILE).c_str());
+		std::string str = cfg.getValue<const char*>("General", "solution", "");
+		if (!fullPath(slnfile, str, root) || !isExistingFile(slnfile))
+		{
+			CZ_LOG(logDefault, Fatal, "Invalid solution path (%s)", str.c_str());
+			fprintf(stderr, "Invalid solution path (%s)\n", str.c_str());
+			return false;
+		}
+		CZ_LOG(logDefault, Log, "Using solution file '%s'", slnfile.c_str());
+
+		str = cfg.getValue<const char*>("General", "common_ycm_params", "");
+		commonYcmParams = VIMVS_FIXED_YCM_PARAMS;
+		if (str.size())
+		{
+			commonYcmParams += str;
+		}
+		else
+		{
+			CZ_LOG(logDefault, Log, "common_ycm_params option not found in the config file");
+		}
+		CZ_LOG(logDefault, Log, "Using '%s' as common_ycm_params", commonYcmParams.c_str());
+
+		// Log verbosity per category (e.g: "logDefault=Verbose"). "*" sets all the categories.
+		if (auto section = cfg.getSection("Log", false))
+		{
+			for (int i = 0; i < section->getNumEntries(); i++)
+			{
+				auto entry = section->getEntry(i);
+				LogVerbosity verbosity;
+				if (!logVerbosityFromString(entry->asString(), verbosity))
+				{
+					CZ_LOG(logDefault, Warning, "Invalid log verbosity '%s' for '%s'", entry->asString().c_str(), entry->getName().c_str());
+					continue;
+				}
+
+				if (entry->getName() == "*")
+				{
+					LogCategoryBase::iterate([&](LogCategoryBase& c) { c.setVerbosity(verbosity); });
+				}
+				else if (auto category = LogCategoryBase::find(entry->getName()))
+				{
+					category->setVerbosity(verbosity);
+				}
+				else
+				{
+					CZ_LOG(logDefault, Warning, "Unknown log category '%s'", entry->getName().c_str());
+				}
+			}
+		}
+
+		if (auto section = cfg.getSection("MSBuildProperties", false))
+		{
+			for (int i = 0; i < section->getNumEntries(); i++)
+			{
+				auto entry = section->getEntry(i);
+				msbuildProperties[entry->getName()] = entry->asString();
+				CZ_LOG(logDefault, Log, "MSBuild property %s=%s", entry->getName().c_str(), entry->asString().c_str());
+			}
+		}
+
+		return true;
+	}
+
+	static bool findConfigFile(std::string& dir)
+	{
+		std::string d = getCWD();
+		std::string previous;
+		std::string f;
+		do
+		{
+			ensureTrailingSlash(d);
+			if (isExistingFile(d + VIMVS_CFG_FILE))
+			{
+				dir = d;
+				return true;
+			}
+			previous = d;
+		} while (fullPath(d, d + "..", "") && d != previous);
+		return false;
+	}
+};
+
+Parameters gParams(Parameters::Auto);
+std::unique_ptr<Config> gCfg;
+std::unique_ptr<Database> gDb;
+
+// Each configuration has its own flat index and find index
+std::string getIndexFilename(const std::string& configurationKey, const char* basename = VIMVS_INDEX_FILE)
+{
+	if (configurationKey.empty())
+		return gCfg->root + basename;
+	auto name = replace(replace(configurationKey, '|', '_'), ' ', '_');
+	return gCfg->root + basename + "." + name;
+}
+
+//! Writes the flat index for the current database configuration
+bool writeFlatIndex(const std::string& configurationKey)
+{
+	FlatIndexWriter writer;
+	gDb->iterateFiles([&](const SourceFileView& f)
+	{
+		writer.add(f.id, f.fullpath, f.defines, f.includes);
+	});
+	return writer.write(getIndexFilename(configurationKey));
+}
+
+//! Fills a find index writer with the files of the current database configuration
+void addFindIndexFiles(FindIndexWriter& writer)
+{
+	gDb->iterateFiles([&](const SourceFileView& f)
+	{
+		writer.add(f.fullpath, f.prjName);
+	});
+}
+
+std::string xmlEscape(const std::string& str)
+{
+	std::string res;
+	for (auto c : str)
+	{
+		switch (c)
+		{
+		case '&': res += "&amp;"; break;
+		case '<': res += "&lt;"; break;
+		case '>': res += "&gt;"; break;
+		case '"': res += "&quot;"; break;
+		default: res += c;
+		}
+	}
+	return res;
+}
+
+// Finds what projects changed since the database was last built for the current configuration, without running
+// msbuild. A project changed if its project files (or anything they import, which includes the toolset's props) changed,
+// or if the solution now builds it with another configuration. Projects the solution builds that the database doesn't
+// know about are added to 'changed' too.
+// \param buildHash
+//		Hash of the msbuild parameters (see calcBuildHash). If those changed, any project might have.
+// \param current
+//		The projects the solution has now (see parseSolution)
+// \param removed
+//		Projects in the database the solution doesn't build anymore
+// Returns false if an incremental build is not possible (e.g: The database was never built for this configuration)
+bool findChangedProjects(
+	int64_t buildHash, const std::vector<SlnProject>& current,
+	std::vector<ProjectInfo>& changed, std::vector<std::string>& removed)
+{
+	bool slnFound = false;
+	// By lower case project file, since the name msbuild gives a project can differ from the solution's
+	std::unordered_map<std::string, ProjectInfo> previous;
+	for (auto&& prj : gDb->getProjects())
+	{
+		if (prj.name == VIMVS_SOLUTION_PRJNAME)
+		{
+			if (prj.clHash != buildHash || tolower(prj.prjFile) != tolower(gCfg->slnfile))
+				return false;
+			slnFound = true;
+		}
+		else
+		{
+			previous[tolower(prj.prjFile)] = prj;
+		}
+	}
+	if (!slnFound)
+		return false;
+
+	for (auto&& slnPrj : current)
+	{
+		if (!slnPrj.build)
+			continue;
+		auto prjConfiguration = getConfigurationKey(slnPrj.configuration, slnPrj.platform);
+		auto it = previous.find(tolower(slnPrj.path));
+		if (it == previous.end())
+		{
+			CZ_LOG(logDefault, Log, "Project %s was added", slnPrj.name.c_str());
+			ProjectInfo prj;
+			prj.name = slnPrj.name;
+			prj.prjFile = slnPrj.path;
+			prj.prjConfiguration = prjConfiguration;
+			changed.push_back(std::move(prj));
+			continue;
+		}
+
+		auto prj = std::move(it->second);
+		previous.erase(it);
+		if (calcFilesStamp(prj.files) != prj.stamp)
+		{
+			CZ_LOG(logDefault, Log, "Project %s changed", prj.name.c_str());
+			changed.push_back(std::move(prj));
+		}
+		else if (prj.prjConfiguration != prjConfiguration)
+		{
+			CZ_LOG(logDefault, Log, "Project %s: configuration changed to %s", prj.name.c_str(), prjConfiguration.c_str());
+			prj.prjConfiguration = prjConfiguration;
+			changed.push_back(std::move(prj));
+		}
+	}
+
+	for (auto&& prj : previous)
+		removed.push_back(prj.second.name);
+	return true;
+}
+
+// Creates an msbuild project that builds only the specified projects, with the same properties the solution would
+// give them
+std::string writeIncrementalProject(const std::vector<ProjectInfo>& projects)
+{
+	auto fname = gCfg->root + VIMVS_INCREMENTAL_FILE;
+	std::ofstream out(nativePath(fname), std::ofstream::out | std::ofstream::trunc);
+
+	auto sln = splitFolderAndFile(gCfg->slnfile);
+	std::string slnName;
+	auto slnExt = getExtension(sln.second, &slnName);
+
+	out << "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n";
+	out << "<Project xmlns=\"http://schemas.microsoft.com/developer/msbuild/2003\">\n";
+	out << "  <ItemGroup>\n";
+	for (auto&& prj : projects)
+	{
+		auto sep = prj.prjConfiguration.find('|');
+		auto configuration = prj.prjConfiguration.substr(0, sep);
+		auto platform = sep == std::string::npos ? "" : prj.prjConfiguration.substr(sep + 1);
+		out << "    <VimvsProject Include=\"" << xmlEscape(prj.prjFile) << "\">\n";
+		out << "      <AdditionalProperties>Configuration=" << xmlEscape(configuration) << ";Platform=" << xmlEscape(platform) << "</AdditionalProperties>\n";
+		out << "    </VimvsProject>\n";
+	}
+	out << "  </ItemGroup>\n";
+	out << "  <Target Name=\"Build\">\n";
+	out << "    <MSBuild Projects=\"@(VimvsProject)\" BuildInParallel=\"true\" Properties=\""
+		<< "SolutionDir=" << xmlEscape(sln.first)
+		<< ";SolutionPath=" << xmlEscape(gCfg->slnfile)
+		<< ";SolutionFileName=" << xmlEscape(sln.second)
+		<< ";SolutionName=" << xmlEscape(slnName)
+		<< ";SolutionExt=." << xmlEscape(slnExt)
+		<< ";BuildProjectReferences=false\" />\n";
+	out << "  </Target>\n";
+	out << "</Project>\n";
+	return fname;
+}
+
+// Saves what was used to generate the rows of the projects we just parsed, so the next -incremental build knows
+// what changed, and removes the rows of those projects that were not seen in this build
+// \param wholeSolution
+//		True if the database now has the whole solution, so projects not part of it anymore are removed
+// \param removed
+//		With -incremental, the projects not part of the solution anymore (see findChangedProjects). If null, that's
+//		every project the parser didn't see.
+// \param buildHash
+//		See calcBuildHash
+void saveProjects(const Parser& parser, bool wholeSolution, const std::vector<std::string>* removed, int64_t buildHash)
+{
+	std::unordered_map<std::string, ProjectInfo> previous;
+	for (auto&& prj : gDb->getProjects())
+		previous[prj.name] = prj;
+
+	for (auto&& p : parser.getProjects())
+	{
+		auto prj = p.second;
+		prj.stamp = calcFilesStamp(prj.files);
+		auto it = previous.find(prj.name);
+		if (it != previous.end() && it->second.clHash == prj.clHash)
+			CZ_LOG(logDefault, Log, "Project %s: compiler command lines didn't change", prj.name.c_str());
+		gDb->setProject(prj);
+		gDb->removeStaleFiles(prj.name);
+	}
+
+	if (!wholeSolution)
+		return;
+
+	if (removed)
+	{
+		for (auto&& name : *removed)
+		{
+			CZ_LOG(logDefault, Log, "Project %s is not part of the solution anymore", name.c_str());
+			gDb->removeProject(name);
+		}
+	}
+	else
+	{
+		// Headers not used by any source file
+		gDb->removeStaleFiles("");
+
+		// Anything we didn't see is not part of the solution anymore
+		for (auto&& prj : previous)
+		{
+			if (prj.first != VIMVS_SOLUTION_PRJNAME && parser.getProjects().count(prj.first) == 0)
+			{
+				CZ_LOG(logDefault, Log, "Project %s is not part of the solution anymore", prj.first.c_str());
+				gDb->removeProject(prj.first);
+			}
+		}
+	}
+
+	ProjectInfo sln;
+	sln.name = VIMVS_SOLUTION_PRJNAME;
+	sln.prjFile = gCfg->slnfile;
+	sln.files = gCfg->slnfile;
+	sln.stamp = calcFilesStamp(sln.files);
+	sln.clHash = buildHash;
+	gDb->setProject(sln);
+}
+
+// Fills the parser with what the native evaluator finds, instead of running msbuild
+// \param filter
+//		If not empty, only these projects are evaluated
+bool evaluateNative(
+	Parser& parser, const std::string& configuration, const std::string& platform, const std::set<std::string>& filter)
+{
+	std::vector<EvaluatedProject> projects;
+	bool ok = evaluateSolution(gCfg->slnfile, configuration, platform, gCfg->msbuildProperties, filter, projects);
+
+	for (auto&& eprj : projects)
+	{
+		if (!eprj.ok)
+			continue;
+		printf("Project %s: %d files\n", eprj.name.c_str(), static_cast<int>(eprj.sources.size()));
+
+		// Group the files by compile settings, since the evaluator shares the settings between files
+		std::vector<std::pair<const CompileSettings*, std::vector<std::string>>> groups;
+		std::unordered_map<const CompileSettings*, size_t> groupIndex;
+		for (auto&& src : eprj.sources)
+		{
+			auto it = groupIndex.find(src.second.get());
+			if (it == groupIndex.end())
+			{
+				it = groupIndex.emplace(src.second.get(), groups.size()).first;
+				groups.emplace_back(src.second.get(), std::vector<std::string>());
+			}
+			groups[it->second].second.push_back(src.first);
+		}
+
+		ProjectInfo prj;
+		prj.name = eprj.name;
+		prj.prjFile = eprj.prjFile;
+		prj.prjConfiguration = getConfigurationKey(eprj.configuration, eprj.platform);
+		for (auto&& f : eprj.files)
+			prj.files += (prj.files.size() ? ";" : "") + f;
+		// There are no command lines, so hash the settings instead, in the order the database has them
+		for (auto&& g : groups)
+		{
+			prj.clHash = hash(std::to_string(prj.clHash) + joinDefines(g.first->defines) +
+				joinUserIncs(g.first->userIncs) + joinSystemIncludes(g.first->systemIncs));
+		}
+		parser.setProject(prj);
+
+		for (auto&& g : groups)
+		{
+			parser.addTranslationUnits(
+				eprj.name, eprj.prjFile, g.second, g.first->defines, g.first->userIncs, g.first->systemIncs);
+		}
+	}
+
+	return ok;
+}
+
+std::string genParams(std::vector<std::string> p)
+{
+	std::string res;
+	for (auto s : p)
+	{
+		res += "\"";
+		res += s;
+		res += "\" ";
+	}
+	return res;
+}
+
+// Hash of what we pass msbuild for a configuration (properties, fast parser, ...), which affects every project
+int64_t calcBuildHash(const std::vector<std::string>& params, bool native)
+{
+	return hash(genParams(params) + (native ? "native" : ""));
+}
+
+
+struct Cmd
+{
+	const char* cmd;
+	bool(*func)(const Cmd&, const std::string&);
+	const char* help;
+};
+
+struct Options
+{
+	std::string configuration;
+	std::string platform;
+};
+Options gOptions;
+
+// Configurations to build, from -configurations="Debug|x64;Release|Win32", or -configuration and -platform
+std::vector<Options> getBuildConfigurations()
+{
+	std::vector<Options> res;
+	std::string str = gParams.get("configurations");
+	size_t s = 0;
+	while (s < str.size())
+	{
+		auto e = str.find(';', s);
+		if (e == std::string::npos)
+			e = str.size();
+		auto c = trim(str.substr(s, e - s));
+		if (c.size())
+		{
+			Options o;
+			auto sep = c.find('|');
+			o.configuration = c.substr(0, sep);
+			if (sep != std::string::npos)
+				o.platform = c.substr(sep + 1);
+			res.push_back(std::move(o));
+		}
+		s = e + 1;
+	}
+
+	if (res.empty())
+		res.push_back(gOptions);
+	return res;
+}
+
+// The database is only opened when needed, so queries that can be answered with the flat index don't pay for it
+bool openDatabase(bool inMemory = false)
+{
+	if (gDb)
+		return true;
+	gDb = std::make_unique<Database>();
+	if (gDb->open(gCfg->root + VIMVS_DB_FILE, inMemory))
+	{
+		gDb->setConfiguration(getConfigurationKey(gOptions.configuration, gOptions.platform));
+		return true;
+	}
+	gDb.reset();
+	return false;
+}
+
+bool cmd_help(const Cmd& cmd, const std::string& val);
+
+bool cmd_getroot(const Cmd& cmd, const std::string& val)
+{
+	printf("ROOT:%s\n", gCfg->root.c_str());
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//		Queries
+//////////////////////////////////////////////////////////////////////////
+
+//! Queries the editor makes, used by the command line (-getycm, -getalt, -find), and by -server.
+// The indexes and database are kept open between queries, and reopened if their files change (e.g: -builddb ran).
+class Queries
+{
+public:
+	//! Gets what goes after "YCM_CMD:" in -getycm
+	// \param inferredFrom
+	//		If the file is not in the database (e.g: it was just created), the flags are the ones of the nearest file
+	//		that is, and this is set to that file. Empty otherwise.
+	bool getYcm(const std::string& file, std::string& out, std::string& inferredFrom, std::string& error);
+	//! Gets the alternate files, best first
+	bool getAlt(const std::string& file, std::vector<std::string>& out, std::string& error);
+	bool find(const FindQuery& query, std::vector<std::string>& out, std::string& error);
+	//! Closes the database and indexes. They are opened again by the next query that needs them.
+	// On Windows, a file that is open can't be replaced, which is how -builddb writes the indexes (and the database,
+	// with -inmemorydb), so -server does this once it's idle.
+	void release();
+
+private:
+	template<typename T>
+	struct Cached
+	{
+		std::unique_ptr<T> index;
+		std::string filename;
+		int64_t stamp = 0;
+	};
+
+	//! Opens the index, or reuses the one already open if the file didn't change. Returns nullptr if not possible.
+	template<typename T>
+	T* getIndex(Cached<T>& cached, const std::string& filename);
+	//! Like openDatabase, but reopens the database if the file changed
+	bool refreshDatabase();
+	//! Finds the file to take the flags from, for a file not in the database: A file in the same directory, or else
+	// in the nearest parent directory that has one.
+	bool getNearestFile(const std::string& fullpath, SourceFile& out);
+
+	Cached<FlatIndex> m_flatIndex;
+	Cached<FindIndex> m_findIndex;
+	// If there is no find index file, the index is built in memory from the database, for this configuration
+	std::string m_findIndexData;
+	std::string m_findIndexKey;
+	int64_t m_dbStamp = 0;
+};
+
+template<typename T>
+T* Queries::getIndex(Cached<T>& cached, const std::string& filename)
+{
+	auto stamp = getFileModificationTime(filename);
+	if (cached.index && cached.filename == filename && cached.stamp == stamp)
+		return cached.index.get();
+
+	cached.index = std::make_unique<T>();
+	cached.filename = filename;
+	cached.stamp = stamp;
+	if (!cached.index->open(filename))
+		cached.index.reset();
+	return cached.index.get();
+}
+
+void Queries::release()
+{
+	gDb.reset();
+	m_flatIndex.index.reset();
+	m_findIndex.index.reset();
+}
+
+bool Queries::refreshDatabase()
+{
+	// A -builddb with -inmemorydb replaces the file, and we would keep reading the old one. The database might also
+	// have been closed by 'release', in which case what we built from it is still good if it didn't change.
+	auto filename = gCfg->root + VIMVS_DB_FILE;
+	if (getFileModificationTime(filename) != m_dbStamp)
+	{
+		if (gDb)
+			CZ_LOG(logDefault, Log, "Database changed. Reopening it.");
+		gDb.reset();
+		m_findIndexData.clear();
+	}
+
+	if (!gDb)
+	{
+		if (!openDatabase())
+			return false;
+		// Opening it can write to it (e.g: creating indexes, or upgrading it), so the time is only taken after that
+		m_dbStamp = getFileModificationTime(filename);
+	}
+	gDb->setConfiguration(getConfigurationKey(gOptions.configuration, gOptions.platform));
+	return true;
+}
+
+bool Queries::getNearestFile(const std::string& fullpath, SourceFile& out)
+{
+	// Each step is a lookup in the files_dir index, so this is cheap even for files far from any other
+	auto dir = splitFolderAndFile(fullpath).first;
+	while (dir.size())
+	{
+		if (gDb->getFileInDirectory(dir, out))
+			return true;
+		auto parent = splitFolderAndFile(removeTrailingSlash(dir)).first;
+		if (parent.size() >= dir.size())
+			break;
+		dir = std::move(parent);
+	}
+	return false;
+}
+
+bool Queries::getYcm(const std::string& file, std::string& out, std::string& inferredFrom, std::string& error)
+{
+	auto v = file;
+	fullPath(v, file, getCWD());
+	inferredFrom.clear();
+
+	FlatIndexFile indexedFile;
+	auto index = getIndex(m_flatIndex, getIndexFilename(getConfigurationKey(gOptions.configuration, gOptions.platform)));
+	if (index && index->find(hashPath(v), indexedFile))
+	{
+		out = formatString("|%s|%s|%s", gCfg->commonYcmParams.c_str(), indexedFile.defines, indexedFile.includes);
+		return true;
+	}
+
+	if (!refreshDatabase())
+	{
+		error = "Could not open the database";
+		return false;
+	}
+
+	SourceFile f = gDb->getFile(v);
+	if (!f.id)
+	{
+		// Files created since the last -builddb are not in the database, but the flags of the files near them are
+		// usually the right ones
+		if (!getNearestFile(v, f))
+		{
+			error = "Not found";
+			return false;
+		}
+		CZ_LOG(logDefault, Log, "'%s' not in the database. Using the flags of '%s'", v.c_str(), f.fullpath.c_str());
+		inferredFrom = f.fullpath;
+	}
+
+	out = formatString("|%s|%s|%s", gCfg->commonYcmParams.c_str(), f.defines.c_str(), f.includes.c_str());
+	return true;
+}
+
+bool Queries::find(const FindQuery& query, std::vector<std::string>& out, std::string& error)
+{
+	auto key = getConfigurationKey(gOptions.configuration, gOptions.platform);
+	auto index = getIndex(m_findIndex, getIndexFilename(key, VIMVS_FIND_FILE));
+	if (!index)
+	{
+		// Databases built before the find index existed don't have one, so build it in memory
+		if (!refreshDatabase())
+		{
+			error = "Could not open the database";
+			return false;
+		}
+
+		if (m_findIndexData.empty() || m_findIndexKey != key)
+		{
+			CZ_LOG(logDefault, Log, "Find index not found. Building it from the database.");
+			FindIndexWriter writer;
+			addFindIndexFiles(writer);
+			m_findIndexData = writer.serialize();
+			m_findIndexKey = key;
+		}
+		// Not kept in m_findIndex, so the next query checks for the file again
+		m_findIndex.index = std::make_unique<FindIndex>();
+		CZ_CHECK(m_findIndex.index->open(
+			"<memory>", reinterpret_cast<const uint8_t*>(m_findIndexData.data()), m_findIndexData.size()));
+		index = m_findIndex.index.get();
+	}
+
+	auto matches = index->find(query);
+	CZ_LOG(logDefault, Log, "%d matches for '%s'", static_cast<int>(matches.size()), query.pattern.c_str());
+	out.clear();
+	for (auto&& m : matches)
+		out.emplace_back(m.path);
+	return true;
+}
+
+bool Queries::getAlt(const std::string& file, std::vector<std::string>& out, std::string& error)
+{
+	auto v = removeQuotes(file);
+	fullPath(v, v, getCWD());
+	static std::vector<const char*> sources = { "cpp", "c", "cc", "c++", "cxx"};
+	static std::vector<const char*> headers = { "h", "hh", "hxx", "hpp", "h++", "inl"};
+	auto isIn = [](auto&& ext, auto&& c) -> bool
+	{
+		for (auto&& e : c)
+		{
+			if (ext == e)
+				return true;
+		}
+		return false;
+	};
+
+	auto ext = tolower(getExtension(v));
+	if (!isIn(ext, sources) && !isIn(ext, headers))
+	{
+		error = formatString( "File '%s' doesn't have a known source/header extension", v.c_str());
+		CZ_LOG(logDefault, Error, error.c_str());
+		return false;
+	}
+
+	if (!refreshDatabase())
+	{
+		error = "Could not open the database";
+		return false;
+	}
+
+	// Alternate files don't depend on the configuration
+	SourceFile src = gDb->getFile(v, true);
+	if (!src.id)
+	{
+		error = formatString(
+			"File '%s' not found in the database. Do a full build (-builddb) first to update the database",
+			v.c_str());
+		CZ_LOG(logDefault, Error, error.c_str());
+		return false;
+	}
+
+	auto basename = src.name;
+	ext = tolower(getExtension(basename, &basename));
+
+	const std::vector<const char*>* altext;
+	if (isIn(ext, sources))
+		altext = &headers;
+	else if (isIn(ext, headers))
+		altext = &sources;
+	else
+	{
+		error = "File extension not recognized as a C/C++ extension";
+		CZ_LOG(logDefault, Log, error.c_str());
+		return false;
+	}
+
+	// Only the full path is needed, so don't bother getting everything else
+	PathRanker ranker(src.fullpath);
+	for (auto&& e : *altext)
+	{
+		gDb->iterateWithBasename(basename + "." + e, [&](std::string_view fullpath)
+		{
+			ranker.add(std::string(fullpath));
+		});
+	}
+	out = ranker.getRanked();
+	
+	if (!out.size())
+	{
+		error = "No alt file found";
+		CZ_LOG(logDefault, Log, error.c_str());
+		return false;
+	}
+
+	CZ_LOG(logDefault, Log, "ALT:%s", out[0].c_str());
+	for (auto it = out.begin() + 1; it < out.end(); ++it)
+		CZ_LOG(logDefault, Log, "OTHER:%s", it->c_str());
+
+	return true;
+}
+
+bool cmd_getycm(const Cmd& cmd, const std::string& val)
+{
+	Queries queries;
+	std::string out, inferredFrom, error;
+	bool res = queries.getYcm(val, out, inferredFrom, error);
+	if (res)
+		out = "YCM_CMD:" + out;
+	else
+		out = error;
+
+	CZ_LOG(logDefault, Log, "%s=%s", res ? "Success" : "Error", out.c_str());
+	printf("%s\n", out.c_str());
+	if (inferredFrom.size())
+		printf("INFERRED:%s\n", inferredFrom.c_str());
+	return res;
+}
+
+//! Builds a FindQuery from the -find options (or the equivalent -server request fields)
+bool getFindQuery(
+	const std::string& pattern, const std::string& prj, const std::string& kind, int maxResults, FindQuery& query,
+	std::string& error)
+{
+	query.pattern = pattern;
+	query.project = prj;
+	auto k = tolower(kind);
+	if (k == "source")
+		query.kind = FileKind::Source;
+	else if (k == "header")
+		query.kind = FileKind::Header;
+	else if (k != "")
+	{
+		error = formatString("Invalid kind '%s'", kind.c_str());
+		return false;
+	}
+	if (maxResults > 0)
+		query.maxResults = maxResults;
+	return true;
+}
+
+bool cmd_find(const Cmd& cmd, const std::string& val)
+{
+	Queries queries;
+	FindQuery query;
+	std::vector<std::string> files;
+	std::string error;
+	if (!getFindQuery(removeQuotes(val), removeQuotes(gParams.get("prj")), gParams.get("kind"),
+			atoi(gParams.get("max").c_str()), query, error) ||
+		!queries.find(query, files, error))
+	{
+		fprintf(stderr, "%s\n", error.c_str());
+		return false;
+	}
+
+	for (auto&& f : files)
+		printf("FILE:%s\n", f.c_str());
+	return true;
+}
+
+bool cmd_getalt(const Cmd& cmd, const std::string& val)
+{
+	Queries queries;
+	std::vector<std::string> alts;
+	std::string error;
+	if (!queries.getAlt(val, alts, error))
+	{
+		fprintf(stderr, "%s\n", error.c_str());
+		return false;
+	}
+
+	printf("ALT:%s\n", alts[0].c_str());
+	for (auto it = alts.begin() + 1; it < alts.end(); ++it)
+		printf("OTHER:%s\n", it->c_str());
+	return true;
+}
+
+//! Handles one -server request. Returns false if the server should stop.
+bool handleServerRequest(Queries& queries, const nlohmann::json& req, nlohmann::json& res)
+{
+	auto getString = [&req](const char* name) -> std::string
+	{
+		auto it = req.find(name);
+		return (it != req.end() && it->is_string()) ? it->get<std::string>() : "";
+	};
+
+	// Sent with every request, so the server doesn't need to know when the editor changes them
+	if (req.count("configuration"))
+		gOptions.configuration = getString("configuration");
+	if (req.count("platform"))
+		gOptions.platform = getString("platform");
+
+	auto cmd = getString("cmd");
+	CZ_TRACE_SCOPE_DETAIL("server", "request", cmd);
+	std::string error;
+	if (cmd == "getroot")
+	{
+		res["root"] = gCfg->root;
+	}
+	else if (cmd == "getycm")
+	{
+		std::string out, inferredFrom;
+		if (queries.getYcm(getString("file"), out, inferredFrom, error))
+		{
+			res["ycm"] = out;
+			if (inferredFrom.size())
+				res["inferred"] = inferredFrom;
+		}
+	}
+	else if (cmd == "getalt")
+	{
+		std::vector<std::string> alts;
+		if (queries.getAlt(getString("file"), alts, error))
+		{
+			res["alt"] = alts[0];
+			res["others"] = std::vector<std::string>(alts.begin() + 1, alts.end());
+		}
+	}
+	else if (cmd == "find")
+	{
+		FindQuery query;
+		std::vector<std::string> files;
+		auto max = req.find("max");
+		if (getFindQuery(getString("pattern"), getString("prj"), getString("kind"),
+				(max != req.end() && max->is_number()) ? max->get<int>() : 0, query, error) &&
+			queries.find(query, files, error))
+		{
+			res["files"] = files;
+		}
+	}
+	else if (cmd == "exit")
+	{
+		return false;
+	}
+	else
+	{
+		error = formatString("Unknown command '%s'", cmd.c_str());
+	}
+
+	if (error.size())
+		res["error"] = error;
+	return true;
+}
+
+//
+// Reads requests from stdin and writes the responses to stdout, until stdin is closed.
+// Uses the format of Vim's channels in "json" mode (see :help channel-use): Each message is a JSON array with a
+// request number and the request, in one line. The response is a JSON array with the same number, so a client can
+// have several requests in flight. Requests are handled in the order received.
+// Example:
+//		[1,{"cmd":"getalt","file":"C:\\Work\\Foo\\foo.cpp","configuration":"Debug","platform":"x64"}]
+//		[1,{"alt":"C:\\Work\\Foo\\foo.h","others":[]}]
+//
+bool cmd_server(const Cmd& cmd, const std::string& val)
+{
+	Queries queries;
+
+	// Once idle, the database and indexes are closed, so -builddb can replace them (see Queries::release)
+	std::mutex mtx;
+	std::condition_variable idleCv;
+	bool stop = false;
+	bool released = true;
+	auto lastRequest = std::chrono::steady_clock::now();
+	std::thread idleThread([&]()
+	{
+		trace::setThreadName("Server idle");
+		std::unique_lock<std::mutex> lk(mtx);
+		while (!stop)
+		{
+			if (!released && std::chrono::steady_clock::now() - lastRequest >= kServerIdleTime)
+			{
+				CZ_LOG(logDefault, Log, "Server idle. Closing the database and indexes.");
+				queries.release();
+				released = true;
+			}
+			if (released)
+				idleCv.wait(lk);
+			else
+				idleCv.wait_until(lk, lastRequest + kServerIdleTime);
+		}
+	});
+	SCOPE_EXIT
+	{
+		{
+			std::lock_guard<std::mutex> lk(mtx);
+			stop = true;
+		}
+		idleCv.notify_one();
+		idleThread.join();
+	};
+
+	std::string line;
+	while (std::getline(std::cin, line))
+	{
+		if (trim(line).empty())
+			continue;
+		std::lock_guard<std::mutex> lk(mtx);
+		newFileSystemGeneration();
+
+		nlohmann::json msg;
+		try
+		{
+			msg = nlohmann::json::parse(line);
+		}
+		catch (const std::exception&)
+		{
+		}
+
+		// Anything wrong with the request is answered with an error, as long as we know what request it was, so the
+		// client isn't left waiting for a response
+		nlohmann::json id;
+		if (msg.is_array() && msg.size() && msg[0].is_number())
+		{
+			id = msg[0];
+		}
+		else
+		{
+			static std::regex rgx("[[:space:]]*\\[[[:space:]]*(-?[0-9]{1,18})[[:space:]]*,.*", std::regex_constants::egrep);
+			std::smatch matches;
+			if (!std::regex_match(line, matches, rgx))
+			{
+				CZ_LOG(logDefault, Warning, "Invalid -server request without a request number: %s", line.c_str());
+				continue;
+			}
+			id = std::stoll(matches[1].str());
+		}
+
+		nlohmann::json res = nlohmann::json::object();
+		bool keepGoing = true;
+		if (!msg.is_array() || msg.size() != 2 || !msg[1].is_object())
+		{
+			CZ_LOG(logDefault, Warning, "Invalid -server request: %s", line.c_str());
+			res["error"] = "Invalid request. Expected [number,{\"cmd\":...}]";
+		}
+		else
+		{
+			try
+			{
+				keepGoing = handleServerRequest(queries, msg[1], res);
+			}
+			catch (const std::exception& e)
+			{
+				CZ_LOG(logDefault, Warning, "Failed to handle -server request '%s': %s", line.c_str(), e.what());
+				res = nlohmann::json::object();
+				res["error"] = formatString("Invalid request (%s)", e.what());
+			}
+		}
+		auto str = nlohmann::json::array({ id, res }).dump();
+		fprintf(stdout, "%s\n", str.c_str());
+		fflush(stdout);
+		if (!keepGoing)
+			break;
+
+		lastRequest = std::chrono::steady_clock::now();
+		released = false;
+		idleCv.notify_one();
+	}
+
+	return true;
+}
+
+// Compiles several files in parallel, launching the compiler directly
+bool cmd_compile(const Cmd& /*cmd*/, const std::string& val)
+{
+	if (!openDatabase())
+		return false;
+
+	std::vector<std::string> files;
+	std::string v;
+	if (beginsWith(val, "files:", &v))
+	{
+		v = removeQuotes(v);
+		size_t start = 0;
+		while (start < v.size())
+		{
+			auto e = v.find(';', start);
+			if (e == std::string::npos)
+				e = v.size();
+			std::string f = trim(v.substr(start, e - start));
+			if (f.size() && fullPath(f, f, getCWD()))
+				files.push_back(std::move(f));
+			start = e + 1;
+		}
+	}
+	else if (beginsWith(val, "dir:", &v))
+	{
+		std::string dir;
+		if (!fullPath(dir, removeQuotes(v), getCWD()))
+		{
+			fprintf(stderr, "Invalid directory '%s'\n", v.c_str());
+			return false;
+		}
+		ensureTrailingSlash(dir);
+		dir = tolower(dir);
+		gDb->iterateFiles([&](const SourceFileView& f)
+		{
+			std::string fullpath(f.fullpath);
+			if (beginsWith(tolower(fullpath), dir))
+				files.push_back(std::move(fullpath));
+		});
+	}
+	else
+	{
+		auto msg = formatString("Invalid -compile parameter (%s)", val.c_str());
+		CZ_LOG(logDefault, Error, msg);
+		fprintf(stderr, "%s\n", msg);
+		return false;
+	}
+
+	std::vector<CompileJob> jobs;
+	for (auto&& f : files)
+	{
+		CompileJob job;
+		job.file = f;
+		if (gDb->getCompileCommand(f, job.cmd))
+			jobs.push_back(std::move(job));
+		else if (beginsWith(val, "files:"))
+			fprintf(stderr, "No compiler command line for '%s'. Do a full build (-builddb) first to update the database\n", f.c_str());
+		// With dir:, files without a command line are just headers
+	}
+
+	int maxJobs = static_cast<int>(std::thread::hardware_concurrency());
+	if (gParams.has("jobs"))
+		maxJobs = atoi(gParams.get("jobs").c_str());
+	maxJobs = std::max(1, maxJobs);
+
+	JobServer jobServer;
+	QuickfixWriter quickfix;
+	quickfix.open(gCfg->root + VIMVS_QUICKFIX_FILE);
+	// Errors are written to the quickfix file as the jobs finish, so the editor can show them before everything is
+	// compiled
+	Parser parser(*gDb, false, true, false);
+	parser.setQuickfix(&quickfix);
+	int done = 0;
+	auto failed = runCompileJobs(jobs, maxJobs, jobServer, [&](const CompileJob& job, int exitCode, const std::string& output)
+	{
+		done++;
+		printf("[%d/%d] %s%s\n", done, static_cast<int>(jobs.size()), job.file.c_str(), exitCode ? " FAILED" : "");
+		parser.inject(output);
+		fflush(stdout);
+	});
+
+	printf("Done!");
+	if (failed)
+	{
+		CZ_LOG(logDefault, Error, "%d files failed to compile", failed);
+		fprintf(stderr, "VIMVS: %d files failed to compile\n", failed);
+		return false;
+	}
+	return true;
+}
+
+//! Number of projects the solution builds for a configuration, for the progress summaries. 0 if not known.
+int countSolutionProjects(const Options& cfg)
+{
+	std::vector<SlnProject> projects;
+	if (!parseSolution(gCfg->slnfile, cfg.configuration, cfg.platform, projects))
+		return 0;
+	return static_cast<int>(std::count_if(projects.begin(), projects.end(), [](const SlnProject& p) { return p.build; }));
+}
+
+// Good tips on how invoke msbuild to build, clean, rebuild a specific project
+// http://stackoverflow.com/questions/13915636/specify-project-file-of-a-solution-using-msbuild
+// http://stackoverflow.com/questions/9285756/how-do-i-compile-a-single-source-file-within-an-msvc-project-from-the-command-li
+bool cmd_build(const Cmd& cmd, const std::string& val)
+{
+	// The build output can be millions of lines, which the editor reads as we write them. A large buffer saves a lot
+	// of small writes. The parser flushes it every so often, so the editor still sees the build progressing, and the
+	// messages printed before the steps the parser is not involved in (or that don't print anything) are flushed
+	// right away. Line buffering wouldn't help, since on Windows it's the same as full buffering.
+	setvbuf(stdout, nullptr, _IOFBF, 1 << 20);
+
+	bool builddb = std::string(cmd.cmd) == "builddb";
+	bool progress = gParams.has("progress");
+	if (!openDatabase(builddb && gParams.has("inmemorydb")))
+		return false;
+	bool fastParser = gParams.has("fastparser");
+	QuickfixWriter quickfix;
+	quickfix.open(gCfg->root + VIMVS_QUICKFIX_FILE);
+	std::ofstream msbuildlog(nativePath(gCfg->root + VIMVS_MSBUILDLOG_FILE), std::ofstream::out);
+
+	if (builddb)
+		CZ_LOG(logDefault, Log, "Generating compile database");
+
+	std::vector<std::string> launchParams;
+	std::string fileToCompile; // Set when compiling a single file
+	auto v = val;
+	if (val == "")
+	{
+		launchParams.push_back(gCfg->slnfile);
+	}
+	else if (beginsWith(v, "prj:", &v))
+	{
+		launchParams.push_back(gCfg->slnfile);
+		launchParams.push_back("/t:" + v);
+	}
+	else if (beginsWith(v, "file:", &v))
+	{
+		v = removeQuotes(v);
+		// We only need the project, which doesn't depend on the configuration
+		SourceFile src = gDb->getFile(v, true);
+		if (!src.id)
+		{
+			auto msg = formatString(
+				"File '%s' not found in the database. Do a full build (-builddb) first to update the database",
+				v.c_str());
+			CZ_LOG(logDefault, Error, msg);
+			fprintf(stderr, "%s\n", msg);
+			return false;
+		}
+
+		fileToCompile = src.fullpath;
+		launchParams.push_back(formatString("\"%s\"", src.prjFile.c_str()));
+		launchParams.push_back("/t:clCompile");
+		launchParams.push_back(formatString("/p:SelectedFiles=\"%s\"", src.fullpath.c_str()));
+	}
+	else
+	{
+		auto msg = formatString("Invalid -build parameter (%s)", val.c_str());
+		CZ_LOG(logDefault, Error, msg);
+		fprintf(stderr, "%s\n", msg);
+		return false;
+	}
+
+	if (builddb)
+	{
+		if (fastParser)
+		{
+			launchParams.push_back("/p:TrackFileAccess=false");
+			launchParams.push_back(formatString("/p:CLToolExe=%s.exe", VIMVS_FAST_PARSER_CL));
+			launchParams.push_back(formatString("/p:LIBToolExe=%s.exe", VIMVS_FAST_PARSER_LIB));
+			launchParams.push_back(formatString("/p:LINKToolExe=%s.exe", VIMVS_FAST_PARSER_LINK));
+			auto dummyPath = splitFolderAndFile(gCfg->getUtilityPath((std::string(VIMVS_FAST_PARSER_CL) + ".exe").c_str())).first;
+			dummyPath = removeTrailingSlash(dummyPath);
+			launchParams.push_back("/p:CLToolPath=" + dummyPath);
+			launchParams.push_back("/p:LIBToolPath=" + dummyPath);
+			launchParams.push_back("/p:LINKToolPath=" + dummyPath);
+			launchParams.push_back(std::string("/p:ForceImportBeforeCppTargets=") + gCfg->getUtilityPath("gen_fastparser.props", true));
+		}
+		else
+		{
+			launchParams.push_back(std::string("/p:ForceImportBeforeCppTargets=") + gCfg->getUtilityPath("gen.props", true));
+		}
+	}
+
+	launchParams.push_back("/maxcpucount");
+
+	// Only builds for the whole solution know what projects are part of the solution
+	bool wholeSolution = val == "" || val == "prj:Build" || val == "prj:Rebuild";
+	bool native = builddb && gParams.has("native");
+	if (native && !wholeSolution)
+	{
+		CZ_LOG(logDefault, Warning, "-native only works when building the whole solution. Ignoring it.");
+		fprintf(stderr, "-native only works when building the whole solution. Ignoring it.\n");
+		native = false;
+	}
+	// The native evaluator only knows the source files, so headers always need the fast parser
+	if (native)
+		fastParser = true;
+
+	bool incremental = builddb && gParams.has("incremental");
+	if (incremental && val != "")
+	{
+		CZ_LOG(logDefault, Warning, "-incremental only works when building the whole solution. Ignoring it.");
+		fprintf(stderr, "-incremental only works when building the whole solution. Ignoring it.\n");
+		incremental = false;
+	}
+
+	// With the fast parser, the dummy tools send us what they were called with (see ToolChannel.h). If the channel
+	// can't be created, the command lines are found in msbuild's output instead.
+	ToolChannel toolChannel;
+	bool useChannel = builddb && fastParser && !native && toolChannel.open();
+	if (useChannel)
+		launchParams.push_back("/p:VimVsChannel=true");
+
+	bool pchReport = builddb && gParams.has("pchreport");
+	if (pchReport && !fastParser)
+	{
+		CZ_LOG(logDefault, Warning, "-pchreport requires -fastparser or -native. Ignoring it.");
+		fprintf(stderr, "-pchreport requires -fastparser or -native. Ignoring it.\n");
+		pchReport = false;
+	}
+	std::unique_ptr<std::ofstream> pchReportFile;
+	if (pchReport)
+		pchReportFile = std::make_unique<std::ofstream>(nativePath(gCfg->root + VIMVS_PCHREPORT_FILE), std::ofstream::out);
+
+	// Several configurations can be built one after the other. MSBuild already uses all the cores (/maxcpucount),
+	// so there is little to gain by building them in parallel.
+	auto configurations = getBuildConfigurations();
+	bool failed = false;
+	if (builddb)
+		gDb->beginGeneration();
+	for (auto&& cfg : configurations)
+	{
+		auto params = launchParams;
+		if (cfg.configuration != "")
+			params.push_back(formatString("/p:Configuration=\"%s\"", cfg.configuration.c_str()));
+		if (cfg.platform != "")
+			params.push_back(formatString("/p:Platform=\"%s\"", cfg.platform.c_str()));
+
+		auto key = getConfigurationKey(cfg.configuration, cfg.platform);
+		gDb->setConfiguration(key);
+		if (configurations.size() > 1)
+		{
+			printf("Building configuration %s\n", key.c_str());
+			fflush(stdout);
+			CZ_LOG(logDefault, Log, "Building configuration %s", key.c_str());
+		}
+
+		auto buildHash = calcBuildHash(params, native);
+		bool partial = false;
+		std::set<std::string> changedNames;
+		std::vector<std::string> removedNames;
+		if (incremental)
+		{
+			// Only the solution and the stamps of the project files are checked, so this is much cheaper than
+			// running msbuild
+			std::vector<SlnProject> slnProjects;
+			std::vector<ProjectInfo> changed;
+			if (!parseSolution(gCfg->slnfile, cfg.configuration, cfg.platform, slnProjects) ||
+				!findChangedProjects(buildHash, slnProjects, changed, removedNames))
+			{
+				printf("No usable information from a previous build. Doing a full build.\n");
+				removedNames.clear();
+			}
+			else if (changed.empty() && removedNames.empty())
+			{
+				printf("Database is up to date\n");
+				CZ_LOG(logDefault, Log, "Database is up to date for configuration '%s'", key.c_str());
+				continue;
+			}
+			else
+			{
+				for (auto&& name : removedNames)
+					printf("Project %s is not part of the solution anymore\n", name.c_str());
+				for (auto&& prj : changed)
+				{
+					printf("Project %s changed\n", prj.name.c_str());
+					changedNames.insert(prj.name);
+				}
+				// Build the changed projects instead of the solution
+				if (changed.size())
+					params[0] = writeIncrementalProject(changed);
+				partial = true;
+			}
+		}
+		// With -incremental, if projects were only removed, there is nothing to build
+		bool nothingToBuild = partial && changedNames.empty();
+
+		Parser parser(*gDb, builddb, true, fastParser);
+		parser.setAsyncScan(gParams.has("asyncscan"));
+		parser.setQuickfix(&quickfix);
+		if (useChannel)
+			parser.setToolChannel(&toolChannel);
+		if (progress)
+			parser.setProgressMode(wholeSolution && !partial ? countSolutionProjects(cfg) : 0);
+		auto logfunc = [&](bool iscmdline, const std::string& str)
+		{
+			if (iscmdline)
+			{
+				CZ_LOG(logDefault, Log, "msbuild command line: %s\n", str.c_str());
+			}
+			else
+			{
+				parser.inject(str);
+				msbuildlog << str;
+			}
+		};
+
+		// Compiling a single file doesn't need msbuild if we know the compiler command line
+		CompileCommand compileCmd;
+		bool direct = fileToCompile.size() && !builddb && !gParams.has("msbuild") &&
+			gDb->getCompileCommand(fileToCompile, compileCmd);
+
+		int exitCode = 0;
+		if (nothingToBuild)
+		{
+			CZ_LOG(logDefault, Log, "No projects to build");
+		}
+		else if (native)
+		{
+			printf("Evaluating projects...\n");
+			fflush(stdout);
+			exitCode = evaluateNative(parser, cfg.configuration, cfg.platform, changedNames) ? 0 : EXIT_FAILURE;
+		}
+		else if (direct)
+		{
+			CZ_LOG(logDefault, Log, "Compiling '%s' directly", fileToCompile.c_str());
+			ChildProcessLauncher launcher;
+			launcher.setWorkingDirectory(compileCmd.workdir);
+			// The compiler gets the system includes from the environment, like msbuild's CL task does
+			launcher.setEnvironmentVariable("INCLUDE", getIncludeEnvironment(compileCmd.includes));
+			exitCode = launcher.launch(compileCmd.compiler, compileCmd.args, logfunc);
+		}
+		else
+		{
+			ChildProcessLauncher launcher;
+			if (useChannel)
+				launcher.setEnvironmentVariable(VIMVS_CHANNEL_ENV, toolChannel.getName());
+			exitCode = launcher.launch(gCfg->getUtilityPath("vimvs.msbuild.bat"), genParams(params), logfunc);
+		}
+
+		parser.waitForLines();
+		if (progress)
+			parser.writeProgress();
+		if (fastParser)
+		{
+			printf("Parsing for header dependencies...\n");
+			fflush(stdout);
+		}
+		parser.finishWork();
+
+		if (pchReport)
+		{
+			auto str = gParams.get("pchreport");
+			int minPercent = str == "" ? 50 : std::max(0, std::min(100, atoi(str.c_str())));
+			auto report = parser.calcPchReport(minPercent);
+			if (configurations.size() > 1)
+				*pchReportFile << "Configuration " << key << "\n";
+			writePchReport(*pchReportFile, report);
+			for (auto&& prj : report)
+			{
+				printf("PCH: %s: %d candidates, ~%lld bytes saved\n",
+					prj.prjName.c_str(), static_cast<int>(prj.candidates.size()), static_cast<long long>(prj.bytesSaved));
+			}
+			printf("PCH report written to '%s'\n", (gCfg->root + VIMVS_PCHREPORT_FILE).c_str());
+		}
+
+		// If the build failed, we might not have all the information, so next time these projects need to be
+		// processed again. Also, when compiling a single file, the other files of the project were not seen.
+		if (builddb && exitCode == 0 && !beginsWith(val, "file:"))
+			saveProjects(parser, wholeSolution, partial ? &removedNames : nullptr, buildHash);
+
+		if (builddb && !gDb->persist())
+			fprintf(stderr, "Failed to write the database\n");
+
+		// Done after all the database changes, so the index is never older than the database
+		if (builddb && !writeFlatIndex(key))
+			fprintf(stderr, "Failed to write the flat index. Queries will use the database.\n");
+		if (builddb)
+		{
+			FindIndexWriter writer;
+			addFindIndexFiles(writer);
+			if (!writer.write(getIndexFilename(key, VIMVS_FIND_FILE)))
+				fprintf(stderr, "Failed to write the find index. -find will use the database.\n");
+		}
+
+		if (exitCode)
+		{
+			CZ_LOG(logDefault, Error, "build failed");
+			failed = true;
+		}
+	}
+
+	if (builddb && gParams.has("vacuum"))
+	{
+		gDb->vacuum();
+		gDb->persist();
+	}
+
+	printf("Done!");
+
+	if (failed)
+	{
+		//printf("%s\n", launcher.getFullOutput().c_str());
+		fprintf(stderr, "VIMVS: Build failed\n");
+		return false;
+		//return EXIT_FAILURE;
+	}
+
+	return true;
+}
+
+Cmd gCmds[] =
+{
+
+{
+"help", &cmd_help,
+"\
+Vim-vs by Rui Figueira (http://bitbucket.org/ruifig/vim-vs)\n\
+\n\
+-help\n\
+Shows this help\n\
+\n\
+-trace=<FILE>\n\
+Can be used with any command. Records where the time is spent, and writes it to FILE as a Chrome trace, which\n\
+can be opened with chrome://tracing or https://ui.perfetto.dev\n\
+"
+},
+
+{
+"getroot", &cmd_getroot,
+"\
+-getroot\n\
+Gets the project root (aka: The folder where vimvs configuration file is located)\n\
+"
+},
+{
+"getycm", &cmd_getycm,
+"\
+-getycm=<FILE>\n\
+Gets the command line required to parse the file FILE with YouCompleteMe\n\
+Uses the flags for the configuration specified with -configuration and -platform\n\
+If FILE is not in the database (e.g: it was created after the last -builddb), it uses the flags of a file in the\n\
+same directory, in the parent directory, or in the project that lists FILE, and also prints an INFERRED:<FILE> line\n\
+with the file used.\n\
+"
+},
+{
+"getalt", &cmd_getalt,
+"\
+-getalt=<FILE>\n\
+Gets the file considered the best alternate (e.g: Given an header file, it returns the source file)\n\
+"
+},
+{
+"find", &cmd_find,
+"\
+-find=<PATTERN>\n\
+Finds the files in the database whose paths best match PATTERN, best match first. PATTERN can have several words\n\
+separated by spaces, and small typos are tolerated.\n\
+Uses an index written by -builddb, for the configuration specified with -configuration and -platform\n\
+Options:\n\
+-prj=PROJECT\n\
+	Only files of the project PROJECT. Headers belong to the first project found to use them.\n\
+-kind=( source | header )\n\
+	Only source or header files\n\
+-max=N\n\
+	Maximum number of files listed. Default is 100\n\
+"
+},
+{
+"server", &cmd_server,
+"\
+-server\n\
+Keeps running, answering queries (-getroot, -getycm, -getalt and -find) sent to stdin as JSON, one per line, in\n\
+the format of Vim's channels in json mode. Saves launching vimvs for each query.\n\
+Example request: [1,{\"cmd\":\"getalt\",\"file\":\"C:\\\\Foo\\\\foo.cpp\"}]\n\
+Example response: [1,{\"alt\":\"C:\\\\Foo\\\\foo.h\",\"others\":[]}]\n\
+Requests can have \"configuration\" and \"platform\" fields. Errors are reported in an \"error\" field.\n\
+"
+},
+{
+"build", &cmd_build,
+"\
+-build[ = ( <prj:PROJECT> | <file:FILE> ) ]\n\
+Builds the entire solution, one project, or compiles 1 single file\n\
+Examples:\n\
+-build\n\
+	Build the entire solution\n\
+-build=prj:Foo\n\
+	Build the project 'Foo'\n\
+-build=file:bar.cpp\n\
+	Compiles the file 'bar.cpp'. If the database has the compiler command line for the file (see -builddb), the\n\
+	compiler is launched directly, without the msbuild startup cost. Use -msbuild to always use msbuild.\n\
+Options:\n\
+-progress\n\
+	Instead of the whole build output, only shows the errors and warnings (once each), and every second a\n\
+	summary of the progress (projects done, source files compiled, errors and warnings so far).\n\
+"
+},
+{
+"compile", &cmd_compile,
+"\
+-compile=( <files:FILE;FILE;...> | <dir:DIRECTORY> )\n\
+Compiles several files in parallel, by launching the compiler directly with the command lines in the database\n\
+(see -builddb). With dir:, compiles all the source files in the database that are in that directory or below.\n\
+Options:\n\
+-jobs=N\n\
+	Maximum number of compilers running at once. Default is the number of cores. When launched from a GNU make\n\
+	build, make's jobserver is used too, so the whole build doesn't run more than make's -j jobs.\n\
+"
+},
+{
+"builddb", &cmd_build,
+"\
+Same as '-build', but adds compile parameters to the sqlite database.\n\
+Options:\n\
+-fastparser\n\
+	Replaces the compiler/linker with dummy tools, and finds header dependencies by parsing the files\n\
+	The dummy tools send vimvs their exact arguments, so this doesn't depend on msbuild's verbosity.\n\
+-configurations=\"CONFIGURATION|PLATFORM;...\"\n\
+	Builds the database for several configurations, one after the other, instead of just the one specified\n\
+	with -configuration and -platform\n\
+-inmemorydb\n\
+	Builds the database in memory, and only writes it to disk at the end. Other vimvs instances (e.g: queries\n\
+	from the editor) keep using the old database until then.\n\
+-vacuum\n\
+	After building the database, gives back to the OS the space used by the rows removed.\n\
+-incremental\n\
+	Only processes the projects whose project files (or anything they import) changed since the last time the\n\
+	database was built, and the projects added to the solution. Projects removed from the solution have their\n\
+	rows removed, and projects not changed keep their rows. If the msbuild parameters changed, everything is\n\
+	processed.\n\
+-native\n\
+	Doesn't run msbuild. Instead, evaluates the solution and project files directly to find the source files\n\
+	and their compile settings, and parses the files for header dependencies. Much faster, but anything\n\
+	computed by msbuild targets is missed. Extra msbuild properties (e.g: VCTargetsPath) can be set in the\n\
+	[MSBuildProperties] section of the " VIMVS_CFG_FILE " file.\n\
+-asyncscan\n\
+	With -fastparser or -native, reads the files for the header dependencies many at once, in the background (with\n\
+	io_uring on Linux). Can be faster when the files are not in the OS cache, but is slower when they are.\n\
+-pchreport[=PERCENT]\n\
+	Requires -fastparser or -native. For each project, lists headers included by at least PERCENT% (default 50) of its\n\
+	translation units, as precompiled header candidates. The report is written to " VIMVS_PCHREPORT_FILE "\n\
+"
+},
+{ nullptr, nullptr, nullptr }
+};
+
+bool cmd_help(const Cmd& cmd, const std::string& val)
+{
+	auto c = &gCmds[0];
+	while (c->cmd)
+	{
+		printf("%s\n", c->help);
+		c++;
+	}
+
+	return true;
+}
+
+} // namespace cz
+
+
+// The arguments are taken from the OS by gParams (see Parameters::Parameters), so they are not used here
+#ifdef _WIN32
+int wmain(int argc, wchar_t *argv[], wchar_t *envp[])
+#else
+int main()
+#endif
+{
+	using namespace cz;
+
+	// If we want to just show the help, then don't try to load the configuration
+	gOptions.configuration = gParams.get("configuration");
+	gOptions.platform = gParams.get("platform");
+
+	// Microbenchmarks and self checks, for development only, so not in the help
+	if (gParams.has("bench"))
+		return runBenchmarks(gParams.get("bench")) ? EXIT_SUCCESS : EXIT_FAILURE;
+	if (gParams.has("check"))
+		return runChecks(gParams.get("check")) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+	if (gParams.has("trace"))
+	{
+		trace::start();
+		trace::setThreadName("Main");
+	}
+
+	if (!gParams.has("help"))
+	{
+		gCfg = std::make_unique<Config>();
+		if (!gCfg->load())
+			return EXIT_FAILURE;
+	}
+	SCOPE_EXIT{ gCfg.reset(); };
+	SCOPE_EXIT{ gDb.reset(); };
+
+	// Stopped before the configuration is released, so the log file is still there
+	SCOPE_EXIT
+	{
+		if (gParams.has("trace"))
+			trace::stop(gParams.get("trace"));
+	};
+
+	if (gParams.has("test"))
+	{
+#if 0
+		buildgraph::Graph graph;
+		auto includeDirs = std::make_shared<buildgraph::IncludeDirs>();
+		includeDirs->addI("C:/Program Files (x86)/Microsoft Visual Studio 14.0/VC/include/");
+		includeDirs->addI("C:/Program Files (x86)/Microsoft Visual Studio 14.0/VC/atlmfc/include/");
+		includeDirs->addI("C:/Program Files (x86)/Windows Kits/10/Include/10.0.14393.0/ucrt/");
+		includeDirs->addI("C:/Program Files (x86)/Windows Kits/10/Include/10.0.14393.0/um/");
+		includeDirs->addI("C:/Program Files (x86)/Windows Kits/10/Include/10.0.14393.0/shared/");
+		includeDirs->addI("C:/Program Files (x86)/Windows Kits/10/Include/10.0.14393.0/winrt/");
+		includeDirs->addI("C:/Program Files (x86)/Windows Kits/NETFXSDK/4.6.2/Include/um/");
+		includeDirs->addI("C:\\Work\\crazygaze\\vim-vs\\dummy\\..\\dummy\\d0\\d1\\d2\\d3\\");
+		std::string f("C:\\Work\\crazygaze\\vim-vs\\dummy\\dummy.cpp");
+		includeDirs->pushParent(splitFolderAndFile(f).first);
+		graph.processIncludes(buildgraph::Node::Type::Source, f, includeDirs, true);
+		graph.finishWork();
+#endif
+		return EXIT_SUCCESS;
+	}
+
+	auto cmd = &gCmds[0];
+	while (cmd->cmd)
+	{
+		if (gParams.has(cmd->cmd))
+		{
+			auto val = gParams.get(cmd->cmd);
+			CZ_LOG(logDefault, Log, "Executing -%s=%s", cmd->cmd, val.c_str());
+			return cmd->func(*cmd, val) ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+		cmd++;
+	}
+
+	return EXIT_SUCCESS;
+}
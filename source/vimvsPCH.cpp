@@ -1,11 +1,11 @@
-#pragma warning(disable:4503)
-#pragma warning(disable:4244)
-
-//
-// Disable code analysis warnings
-//
-
-// warning C6001: Using uninitialized memory 'buf'.
-#pragma warning( disable: 6001 )
-
-#include "vimvsPCH.h"
+#pragma warning(disable:4503)
+#pragma warning(disable:4244)
+
+//
+// Disable code analysis warnings
+//
+
+// warning C6001: Using uninitialized memory 'buf'.
+#pragma warning( disable: 6001 )
+
+#include "vimvsPCH.h"